@@ -0,0 +1,217 @@
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+#include <osg/Math>
+#include <osg/Timer>
+
+#include <components/esm/loadland.hpp>
+#include <components/esm/loadnpc.hpp>
+#include <components/misc/stringops.hpp>
+
+#include "mwbase/environment.hpp"
+#include "mwbase/mechanicsmanager.hpp"
+#include "mwbase/statemanager.hpp"
+#include "mwbase/world.hpp"
+
+#include "mwworld/cellstore.hpp"
+#include "mwworld/class.hpp"
+#include "mwworld/esmstore.hpp"
+#include "mwworld/manualref.hpp"
+#include "mwworld/player.hpp"
+
+namespace
+{
+    /// Nearest-rank percentile of an already sorted sample list.
+    double percentile(const std::vector<double>& sorted, int p)
+    {
+        if (sorted.empty())
+            return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+        if (rank > 0)
+            --rank;
+        return sorted[std::min(rank, sorted.size()-1)];
+    }
+}
+
+namespace OMW
+{
+
+Benchmark::Benchmark(int frames, float timeStep)
+    : mFrames(frames)
+    , mTimeStep(timeStep)
+    , mCombatants(0)
+    , mCellChanges(0)
+{
+}
+
+void Benchmark::prepare()
+{
+    if (MWBase::Environment::get().getStateManager()->getState() != MWBase::StateManager::State_Running)
+        return;
+
+    if (mCellChanges > 0)
+        runCellChanges();
+
+    if (mCombatants > 0)
+        spawnCombatants();
+
+    // The player walks a circle, turning around once over the course of the run, so the results cover every view
+    // direction and the physics, terrain and cell loading of a moving player.
+    MWBase::Environment::get().getWorld()->getPlayer().setAutoMove(true);
+}
+
+void Benchmark::updatePlayer()
+{
+    if (MWBase::Environment::get().getStateManager()->getState() != MWBase::StateManager::State_Running)
+        return;
+
+    MWBase::World* world = MWBase::Environment::get().getWorld();
+    const float yawPerFrame = 2 * osg::PI / mFrames;
+    world->rotateObject(world->getPlayerPtr(), 0, 0, yawPerFrame, true);
+}
+
+void Benchmark::finish()
+{
+    if (MWBase::Environment::get().getStateManager()->getState() == MWBase::StateManager::State_Running)
+        MWBase::Environment::get().getWorld()->getPlayer().setAutoMove(false);
+}
+
+void Benchmark::runCellChanges()
+{
+    MWBase::World* world = MWBase::Environment::get().getWorld();
+    if (!world->isCellExterior())
+    {
+        std::cerr << "The cell change benchmark needs the player to start in an exterior cell" << std::endl;
+        return;
+    }
+
+    // Far enough away that none of the loaded cells are shared, so every change unloads one grid of
+    // 'exterior cell load distance' and loads another. The player ends up where they started.
+    const ESM::Position start = world->getPlayerPtr().getRefData().getPosition();
+    ESM::Position away = start;
+    away.pos[0] += 8 * ESM::Land::REAL_SIZE;
+
+    for (int i=0; i<mCellChanges * 2; ++i)
+    {
+        osg::Timer_t changeStart = osg::Timer::instance()->tick();
+        world->changeToExteriorCell(i % 2 == 0 ? away : start);
+        addSample("cell change", osg::Timer::instance()->delta_s(changeStart, osg::Timer::instance()->tick()));
+    }
+}
+
+void Benchmark::spawnCombatants()
+{
+    MWBase::World* world = MWBase::Environment::get().getWorld();
+    const MWWorld::ESMStore& store = world->getStore();
+
+    // Generic NPCs that carry a weapon, so the combat AI has items to choose from. Unique, essential or scripted NPCs
+    // could trigger quest scripts or break the game when they are copied or killed.
+    std::vector<std::string> candidates;
+    const MWWorld::Store<ESM::NPC>& npcs = store.get<ESM::NPC>();
+    for (MWWorld::Store<ESM::NPC>::iterator it = npcs.begin(); it != npcs.end(); ++it)
+    {
+        if (Misc::StringUtils::ciEqual(it->mId, "player") || (it->mFlags & ESM::NPC::Essential) || it->mPersistent
+                || !it->mScript.empty())
+            continue;
+
+        for (std::vector<ESM::ContItem>::const_iterator item = it->mInventory.mList.begin(); item != it->mInventory.mList.end(); ++item)
+        {
+            if (store.get<ESM::Weapon>().search(item->mItem.toString()))
+            {
+                candidates.push_back(it->mId);
+                break;
+            }
+        }
+    }
+
+    if (candidates.empty())
+    {
+        std::cerr << "No armed NPCs found for the combat benchmark" << std::endl;
+        return;
+    }
+
+    MWWorld::Ptr player = world->getPlayerPtr();
+    const ESM::Position& playerPos = player.getRefData().getPosition();
+
+    std::vector<MWWorld::Ptr> actors;
+    for (int i=0; i<mCombatants; ++i)
+    {
+        // Spread the picks over all candidates, so the actors don't all carry the same equipment
+        const std::string& id = candidates[(i * candidates.size()) / mCombatants];
+
+        // In rings around the player
+        float angle = 2 * osg::PI * i / mCombatants;
+        float radius = 400.f + 200.f * (i % 3);
+        ESM::Position pos = playerPos;
+        pos.pos[0] += std::cos(angle) * radius;
+        pos.pos[1] += std::sin(angle) * radius;
+
+        MWWorld::ManualRef ref(store, id, 1);
+        ref.getPtr().getCellRef().setPosition(pos);
+        actors.push_back(world->safePlaceObject(ref.getPtr(), player.getCell(), pos));
+    }
+
+    // Pair the actors up, so every one of them has an enemy for the whole run
+    MWBase::MechanicsManager* mechanics = MWBase::Environment::get().getMechanicsManager();
+    for (std::size_t i=0; i+1<actors.size(); i+=2)
+    {
+        mechanics->startCombat(actors[i], actors[i+1]);
+        mechanics->startCombat(actors[i+1], actors[i]);
+    }
+
+    // With an odd number, the last actor joins the first fight
+    if (actors.size() % 2 == 1 && actors.size() > 1)
+    {
+        mechanics->startCombat(actors.back(), actors.front());
+        mechanics->startCombat(actors.front(), actors.back());
+    }
+    else if (actors.size() == 1)
+        std::cerr << "The combat benchmark needs at least two NPCs, the only one has no enemy" << std::endl;
+
+    std::cout << "Spawned " << actors.size() << " armed NPCs for the combat benchmark" << std::endl;
+}
+
+void Benchmark::addSample(const std::string &subsystem, double seconds)
+{
+    mSamples[subsystem].push_back(seconds * 1000.0);
+}
+
+void Benchmark::writeJson(std::ostream &stream) const
+{
+    static const int percentiles[] = { 50, 90, 95, 99 };
+    static const size_t numPercentiles = sizeof(percentiles)/sizeof(percentiles[0]);
+
+    stream << std::fixed << std::setprecision(4);
+    stream << "{\n";
+    stream << "  \"frames\": " << mFrames << ",\n";
+    stream << "  \"timestep\": " << mTimeStep << ",\n";
+    stream << "  \"subsystems\": {";
+
+    for (SampleMap::const_iterator it = mSamples.begin(); it != mSamples.end(); ++it)
+    {
+        std::vector<double> sorted = it->second;
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0.0;
+        for (std::vector<double>::const_iterator sample = sorted.begin(); sample != sorted.end(); ++sample)
+            total += *sample;
+
+        if (it != mSamples.begin())
+            stream << ",";
+        stream << "\n    \"" << it->first << "\": { ";
+        stream << "\"samples\": " << sorted.size();
+        stream << ", \"mean\": " << (sorted.empty() ? 0.0 : total / sorted.size());
+        for (size_t i=0; i<numPercentiles; ++i)
+            stream << ", \"p" << percentiles[i] << "\": " << percentile(sorted, percentiles[i]);
+        stream << ", \"max\": " << (sorted.empty() ? 0.0 : sorted.back());
+        stream << " }";
+    }
+
+    stream << "\n  }\n}" << std::endl;
+}
+
+}
@@ -0,0 +1,64 @@
+#ifndef OPENMW_BENCHMARK_H
+#define OPENMW_BENCHMARK_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include <ostream>
+
+namespace OMW
+{
+    /// \brief Collects per-subsystem frame timings of a benchmark run and reports their distribution
+    class Benchmark
+    {
+        public:
+
+            /// @param frames Number of frames to run, 0 disables the benchmark
+            /// @param timeStep Fixed simulation time step (in seconds) used for each frame
+            Benchmark(int frames = 0, float timeStep = 1/60.f);
+
+            bool isEnabled() const { return mFrames > 0; }
+
+            int getNumFrames() const { return mFrames; }
+
+            float getTimeStep() const { return mTimeStep; }
+
+            /// Spawn \a actors armed NPCs fighting each other around the player in prepare().
+            void setCombatants(int actors) { mCombatants = actors; }
+
+            /// Move the player \a changes times to a distant exterior cell grid and back in prepare().
+            void setCellChanges(int changes) { mCellChanges = changes; }
+
+            /// Set up the configured scenarios in the running game. Call once before the first frame.
+            void prepare();
+
+            /// Move the player along the benchmark path. Call at the start of every frame.
+            void updatePlayer();
+
+            /// Stop the player after the last frame.
+            void finish();
+
+            /// Record the time (in seconds) \a subsystem took in the current frame.
+            void addSample(const std::string& subsystem, double seconds);
+
+            /// Write percentiles of the recorded timings (in milliseconds) as a JSON object.
+            void writeJson(std::ostream& stream) const;
+
+        private:
+            /// Load and unload the exterior cell grid around the player repeatedly, for benchmarking cell changes
+            void runCellChanges();
+
+            /// Place armed NPCs around the player and make them fight each other, for benchmarking the combat AI
+            void spawnCombatants();
+
+            int mFrames;
+            float mTimeStep;
+            int mCombatants;
+            int mCellChanges;
+
+            typedef std::map<std::string, std::vector<double> > SampleMap;
+            SampleMap mSamples;
+    };
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include <SDL.h>
 
 #include <components/misc/rng.hpp>
+#include <components/misc/profiler.hpp>
 
 #include <components/vfs/manager.hpp>
 #include <components/vfs/registerarchives.hpp>
@@ -25,6 +26,7 @@
 #include <components/compiler/extensions0.hpp>
 
 #include <components/files/configurationmanager.hpp>
+#include <components/files/contentfileskey.hpp>
 #include <components/translation/translation.hpp>
 
 #include <components/version/version.hpp>
@@ -84,6 +86,7 @@ void OMW::Engine::frame(float frametime)
 {
     try
     {
+        OPENMW_PROFILE_ZONE("Engine::frame");
         mStartTick = mViewer->getStartTick();
         mEnvironment.setFrameDuration (frametime);
 
@@ -183,6 +186,13 @@ void OMW::Engine::frame(float frametime)
         stats->setAttribute(frameNumber, "physics_time_taken", osg::Timer::instance()->delta_s(beforePhysicsTick, afterPhysicsTick));
         stats->setAttribute(frameNumber, "physics_time_end", osg::Timer::instance()->delta_s(mStartTick, afterPhysicsTick));
 
+        if (mBenchmark.isEnabled())
+        {
+            mBenchmark.addSample("script", osg::Timer::instance()->delta_s(beforeScriptTick, afterScriptTick));
+            mBenchmark.addSample("mechanics", osg::Timer::instance()->delta_s(beforeMechanicsTick, afterMechanicsTick));
+            mBenchmark.addSample("physics", osg::Timer::instance()->delta_s(beforePhysicsTick, afterPhysicsTick));
+            mBenchmark.addSample("gui", osg::Timer::instance()->delta_s(afterPhysicsTick, osg::Timer::instance()->tick()));
+        }
     }
     catch (const std::exception& e)
     {
@@ -208,6 +218,8 @@ OMW::Engine::Engine(Files::ConfigurationManager& configurationManager)
   , mFSStrict (false)
   , mScriptBlacklistUse (true)
   , mNewGame (false)
+  , mRandomSeed (0)
+  , mUseRandomSeed (false)
   , mCfgMgr(configurationManager)
 {
     Misc::Rng::init();
@@ -334,7 +346,16 @@ void OMW::Engine::createWindow(Settings::Manager& settings)
         pos_y = SDL_WINDOWPOS_UNDEFINED_DISPLAY(screen);
     }
 
-    Uint32 flags = SDL_WINDOW_OPENGL|SDL_WINDOW_SHOWN|SDL_WINDOW_RESIZABLE;
+    Uint32 flags = SDL_WINDOW_OPENGL|SDL_WINDOW_RESIZABLE;
+    // benchmark runs render offscreen into a hidden window, so they work on machines without a desktop session
+    if (mBenchmark.isEnabled())
+    {
+        flags |= SDL_WINDOW_HIDDEN;
+        fullscreen = false;
+        vsync = false;
+    }
+    else
+        flags |= SDL_WINDOW_SHOWN;
     if(fullscreen)
         flags |= SDL_WINDOW_FULLSCREEN;
 
@@ -505,16 +526,22 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
             window->playVideo(logo, true);
     }
 
+    // caches derived from the content files are only valid for the same content files and the same OpenMW build
+    std::string cacheKey = Version::getOpenmwVersionDescription(mResDir.string()) + "\n"
+            + Files::getContentFilesKey(mFileCollections, mContentFiles);
+
     // Create the world
     mEnvironment.setWorld( new MWWorld::World (mViewer, rootNode, mResourceSystem.get(),
         mFileCollections, mContentFiles, mEncoder, mFallbackMap,
-        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string()));
+        mActivationDistanceOverride, mCellName, mStartupScript, mResDir.string(),
+        (mCfgMgr.getCachePath() / "terrain").string(), cacheKey));
     mEnvironment.getWorld()->setupPlayer();
     input->setPlayer(&mEnvironment.getWorld()->getPlayer());
 
     window->setStore(mEnvironment.getWorld()->getStore());
     window->initUI();
-    window->renderWorldMap();
+    window->renderWorldMap(Settings::Manager::getBool("global map cache", "Map") ?
+        (mCfgMgr.getCachePath() / "globalmap.bin").string() : std::string(), cacheKey);
 
     //Load translation data
     mTranslationDataStorage.setEncoder(mEncoder);
@@ -527,9 +554,13 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
     mScriptContext = new MWScript::CompilerContext (MWScript::CompilerContext::Type_Full);
     mScriptContext->setExtensions (&mExtensions);
 
-    mEnvironment.setScriptManager (new MWScript::ScriptManager (mEnvironment.getWorld()->getStore(),
+    MWScript::ScriptManager* scriptManager = new MWScript::ScriptManager (mEnvironment.getWorld()->getStore(),
         mVerboseScripts, *mScriptContext, mWarningsMode,
-        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>()));
+        mScriptBlacklistUse ? mScriptBlacklist : std::vector<std::string>());
+    mEnvironment.setScriptManager (scriptManager);
+
+    if (Settings::Manager::getBool("script cache", "Game"))
+        scriptManager->setCacheFile(mCfgMgr.getCachePath() / "scripts.bin", cacheKey);
 
     // Create game mechanics system
     MWMechanics::MechanicsManager* mechanics = new MWMechanics::MechanicsManager;
@@ -550,6 +581,14 @@ void OMW::Engine::prepareEngine (Settings::Manager & settings)
                 << "%)"
                 << std::endl;
     }
+    if (Settings::Manager::getBool("precompile scripts", "Game"))
+    {
+        std::pair<int, int> result = scriptManager->precompileAll(OpenThreads::GetNumberOfProcessors());
+        if (result.first != result.second)
+            std::cerr << (result.first - result.second) << " of " << result.first << " scripts failed to compile" << std::endl;
+    }
+    mEnvironment.getScriptManager()->saveCache();
+
     if (mCompileAllDialogue)
     {
         std::pair<int, int> result = MWDialogue::ScriptTest::compileAll(&mExtensions, mWarningsMode);
@@ -627,6 +666,8 @@ void OMW::Engine::go()
                                    "mechanics_time_taken", 1000.0, true, false, "mechanics_time_begin", "mechanics_time_end", 10000);
     statshandler->addUserStatsLine("Physics", osg::Vec4f(1.f, 1.f, 1.f, 1.f), osg::Vec4f(1.f, 1.f, 1.f, 1.f),
                                    "physics_time_taken", 1000.0, true, false, "physics_time_begin", "physics_time_end", 10000);
+    statshandler->addUserStatsLine("Skinned vertices", osg::Vec4f(1.f, 1.f, 1.f, 1.f), osg::Vec4f(1.f, 1.f, 1.f, 1.f),
+                                   "skinned_vertices", 1.0, true, false, "", "", 0);
 
     mViewer->addEventHandler(statshandler);
 
@@ -645,11 +686,17 @@ void OMW::Engine::go()
 
     prepareEngine (settings);
 
+    if (mUseRandomSeed || mBenchmark.isEnabled())
+        Misc::Rng::init(mRandomSeed);
+
+    if (!mProfileTraceFile.empty())
+        Misc::Profiler::get().start();
+
     if (!mSaveGameFile.empty())
     {
         mEnvironment.getStateManager()->loadGame(mSaveGameFile);
     }
-    else if (!mSkipMenu)
+    else if (!mSkipMenu && !mBenchmark.isEnabled())
     {
         mEnvironment.getWorld()->preloadCommonAssets();
 
@@ -671,6 +718,15 @@ void OMW::Engine::go()
         mEnvironment.getStateManager()->newGame (!mNewGame);
     }
 
+    if (mBenchmark.isEnabled())
+    {
+        runBenchmark();
+        writeProfileTrace();
+        mEnvironment.getScriptManager()->saveCache();
+        settings.saveUser(settingspath);
+        return;
+    }
+
     // Start the main rendering loop
     osg::Timer frameTimer;
     double simulationTime = 0.0;
@@ -712,12 +768,70 @@ void OMW::Engine::go()
         }
     }
 
+    writeProfileTrace();
+
+    mEnvironment.getScriptManager()->saveCache();
+
     // Save user settings
     settings.saveUser(settingspath);
 
     std::cout << "Quitting peacefully." << std::endl;
 }
 
+void OMW::Engine::runBenchmark()
+{
+    std::cout << "Running benchmark for " << mBenchmark.getNumFrames() << " frames" << std::endl;
+
+    mBenchmark.prepare();
+
+    const float dt = mBenchmark.getTimeStep();
+    double simulationTime = 0.0;
+
+    for (int i=0; i<mBenchmark.getNumFrames() && !mViewer->done() && !mEnvironment.getStateManager()->hasQuitRequest(); ++i)
+    {
+        osg::Timer_t frameStart = osg::Timer::instance()->tick();
+
+        mBenchmark.updatePlayer();
+
+        simulationTime += dt;
+        mViewer->advance(simulationTime);
+
+        frame(dt);
+
+        osg::Timer_t beforeRenderTick = osg::Timer::instance()->tick();
+        mViewer->eventTraversal();
+        mViewer->updateTraversal();
+        mViewer->renderingTraversals();
+        osg::Timer_t afterRenderTick = osg::Timer::instance()->tick();
+
+        mBenchmark.addSample("rendering", osg::Timer::instance()->delta_s(beforeRenderTick, afterRenderTick));
+        mBenchmark.addSample("frame", osg::Timer::instance()->delta_s(frameStart, afterRenderTick));
+    }
+
+    mBenchmark.finish();
+    mBenchmark.writeJson(std::cout);
+}
+
+void OMW::Engine::writeProfileTrace()
+{
+    if (mProfileTraceFile.empty())
+        return;
+
+    Misc::Profiler& profiler = Misc::Profiler::get();
+    profiler.stop();
+
+    boost::filesystem::ofstream stream;
+    stream.open(boost::filesystem::path(mProfileTraceFile));
+    if (stream.fail())
+    {
+        std::cerr << "Failed to open " << mProfileTraceFile << " for writing the profiler trace" << std::endl;
+        return;
+    }
+    profiler.writeChromeTrace(stream);
+
+    std::cout << "Wrote " << profiler.getNumZones() << " profiler zones to " << mProfileTraceFile << std::endl;
+}
+
 void OMW::Engine::setCompileAll (bool all)
 {
     mCompileAll = all;
@@ -753,6 +867,32 @@ void OMW::Engine::setStartupScript (const std::string& path)
     mStartupScript = path;
 }
 
+void OMW::Engine::setBenchmark (int frames, float timeStep)
+{
+    mBenchmark = Benchmark(frames, timeStep);
+}
+
+void OMW::Engine::setBenchmarkCombatants (int actors)
+{
+    mBenchmark.setCombatants(actors);
+}
+
+void OMW::Engine::setBenchmarkCellChanges (int changes)
+{
+    mBenchmark.setCellChanges(changes);
+}
+
+void OMW::Engine::setProfileTraceFile (const std::string& path)
+{
+    mProfileTraceFile = path;
+}
+
+void OMW::Engine::setRandomSeed (unsigned int seed)
+{
+    mRandomSeed = seed;
+    mUseRandomSeed = true;
+}
+
 void OMW::Engine::setActivationDistanceOverride (int distance)
 {
     mActivationDistanceOverride = distance;
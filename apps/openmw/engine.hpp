@@ -13,6 +13,8 @@
 
 #include "mwworld/ptr.hpp"
 
+#include "benchmark.hpp"
+
 namespace Resource
 {
     class ResourceSystem;
@@ -104,6 +106,11 @@ namespace OMW
             std::vector<std::string> mScriptBlacklist;
             bool mScriptBlacklistUse;
             bool mNewGame;
+            unsigned int mRandomSeed;
+            bool mUseRandomSeed;
+
+            Benchmark mBenchmark;
+            std::string mProfileTraceFile;
 
             osg::Timer_t mStartTick;
 
@@ -124,6 +131,12 @@ namespace OMW
             void createWindow(Settings::Manager& settings);
             void setWindowIcon();
 
+            /// Run the configured number of frames with a fixed time step, then print the timings
+            void runBenchmark();
+
+            /// Write the zones recorded by the profiler, if a trace file was requested
+            void writeProfileTrace();
+
         public:
             Engine(Files::ConfigurationManager& configurationManager);
             virtual ~Engine();
@@ -186,6 +199,24 @@ namespace OMW
             /// Set path for a script that is run on startup in the console.
             void setStartupScript (const std::string& path);
 
+            /// Run a deterministic benchmark instead of the interactive main loop.
+            ///
+            /// \param frames Number of frames to simulate (0 disables the benchmark)
+            /// \param timeStep Fixed frame duration in seconds
+            void setBenchmark (int frames, float timeStep);
+
+            /// Spawn \a actors armed NPCs fighting each other around the player before running the benchmark.
+            void setBenchmarkCombatants (int actors);
+
+            /// Move the player \a changes times to a distant exterior cell grid and back before running the benchmark.
+            void setBenchmarkCellChanges (int changes);
+
+            /// Record profiler zones while running and write them as a Chrome trace to \a path on exit.
+            void setProfileTraceFile (const std::string& path);
+
+            /// Seed the random number generator with a fixed value instead of the current time.
+            void setRandomSeed (unsigned int seed);
+
             /// Override the game setting specified activation distance.
             void setActivationDistanceOverride (int distance);
 
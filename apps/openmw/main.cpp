@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <cstdio>
 
 #include <components/version/version.hpp>
@@ -152,7 +153,27 @@ bool parseOptions (int argc, char** argv, OMW::Engine& engine, Files::Configurat
         ("export-fonts", bpo::value<bool>()->implicit_value(true)
             ->default_value(false), "Export Morrowind .fnt fonts to PNG image and XML file in current directory")
 
-        ("activate-dist", bpo::value <int> ()->default_value (-1), "activation distance override");
+        ("activate-dist", bpo::value <int> ()->default_value (-1), "activation distance override")
+
+        ("random-seed", bpo::value <unsigned int> (),
+            "seed value for the random number generator (default: seeded from the current time)")
+
+        ("benchmark", bpo::value <int> ()->default_value (0),
+            "run the given number of frames with a fixed time step in a hidden window, then print frame timings as JSON and quit.\n"
+            "Use together with --load-savegame or --skip-menu and --start.")
+
+        ("benchmark-fps", bpo::value <int> ()->default_value (60),
+            "simulated frame rate used for the fixed time step of --benchmark")
+
+        ("benchmark-combat", bpo::value <int> ()->default_value (0),
+            "spawn the given number of armed NPCs fighting each other around the player before running --benchmark")
+
+        ("benchmark-cells", bpo::value <int> ()->default_value (0),
+            "move the player back and forth between two distant exterior cell grids the given number of times before running --benchmark, "
+            "timing each cell change")
+
+        ("profile-trace", bpo::value <std::string> ()->default_value (""),
+            "record CPU profiler zones and write them to the given file on exit (Chrome trace / Perfetto JSON format)");
 
     bpo::parsed_options valid_opts = bpo::command_line_parser(argc, argv)
         .options(desc).allow_unregistered().run();
@@ -251,6 +272,21 @@ bool parseOptions (int argc, char** argv, OMW::Engine& engine, Files::Configurat
     engine.setActivationDistanceOverride (variables["activate-dist"].as<int>());
     engine.enableFontExport(variables["export-fonts"].as<bool>());
 
+    engine.setProfileTraceFile(variables["profile-trace"].as<std::string>());
+
+    if (variables.count("random-seed"))
+        engine.setRandomSeed(variables["random-seed"].as<unsigned int>());
+
+    int benchmarkFrames = variables["benchmark"].as<int>();
+    if (benchmarkFrames > 0)
+    {
+        int fps = std::max(1, variables["benchmark-fps"].as<int>());
+        engine.setBenchmark(benchmarkFrames, 1.f / fps);
+        engine.setBenchmarkCombatants(variables["benchmark-combat"].as<int>());
+        engine.setBenchmarkCellChanges(variables["benchmark-cells"].as<int>());
+        engine.setSoundUsage(false);
+    }
+
     return true;
 }
 
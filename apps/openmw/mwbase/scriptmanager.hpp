@@ -50,6 +50,9 @@ namespace MWBase
             ///< Return locals for script \a name.
 
             virtual MWScript::GlobalScripts& getGlobalScripts() = 0;
+
+            virtual void saveCache() = 0;
+            ///< Write the compiled scripts to the script cache, if there is one and it is out of date.
    };
 }
 
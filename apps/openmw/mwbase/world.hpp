@@ -294,6 +294,11 @@ namespace MWBase
             virtual bool castRay (float x1, float y1, float z1, float x2, float y2, float z2) = 0;
             ///< cast a Ray and return true if there is an object in the ray path.
 
+            virtual bool findNavMeshPath (const MWWorld::CellStore* cell, const osg::Vec3f& start, const osg::Vec3f& end,
+                                          std::vector<osg::Vec3f>& path) const = 0;
+            ///< Find a path on the navigation mesh of \a cell. \a path receives the points to walk to after \a start.
+            /// \return false if there is no navigation mesh for the cell yet, or no path on it
+
             virtual bool toggleCollisionMode() = 0;
             ///< Toggle collision mode for player. If disabled player object should ignore
             /// collisions and gravity.
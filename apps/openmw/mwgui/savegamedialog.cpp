@@ -393,7 +393,20 @@ namespace MWGui
 
 
         // Decode screenshot
-        const std::vector<char>& data = mCurrentSlot->mProfile.mScreenshot;
+        std::vector<char> data;
+        try
+        {
+            MWState::loadScreenshot(*mCurrentSlot, data);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to read savegame screenshot: " << e.what() << std::endl;
+        }
+        if (data.empty())
+        {
+            mScreenshot->setImageTexture("");
+            return;
+        }
         Files::IMemStream instream (&data[0], data.size());
 
         osgDB::ReaderWriter* readerwriter = osgDB::Registry::instance()->getReaderWriterForExtension("jpg");
@@ -369,9 +369,9 @@ namespace MWGui
         MWBase::Environment::get().getInputManager()->changeInputMode(false);
     }
 
-    void WindowManager::renderWorldMap()
+    void WindowManager::renderWorldMap(const std::string& cacheFile, const std::string& cacheKey)
     {
-        mMap->renderGlobalMap(mLoadingScreen);
+        mMap->renderGlobalMap(mLoadingScreen, cacheFile, cacheKey);
     }
 
     void WindowManager::setNewGame(bool newgame)
@@ -128,7 +128,9 @@ namespace MWGui
     void setStore (const MWWorld::ESMStore& store);
 
     void initUI();
-    void renderWorldMap();
+    void renderWorldMap(const std::string& cacheFile, const std::string& cacheKey);
+    ///< @param cacheFile Where to cache the global map image, empty for no caching
+    /// @param cacheKey Identifies the content the cached image is valid for
 
     virtual Loading::Listener* getLoadingScreen();
 
@@ -6,6 +6,7 @@ namespace MWMechanics
 {
 
     Actor::Actor(const MWWorld::Ptr &ptr, MWRender::Animation *animation)
+        : mPendingAiDuration(0.f)
     {
         mCharacterController.reset(new CharacterController(ptr, animation));
     }
@@ -25,4 +26,14 @@ namespace MWMechanics
         return mAiState;
     }
 
+    float Actor::getPendingAiDuration() const
+    {
+        return mPendingAiDuration;
+    }
+
+    void Actor::setPendingAiDuration(float duration)
+    {
+        mPendingAiDuration = duration;
+    }
+
 }
@@ -31,10 +31,16 @@ namespace MWMechanics
 
         AiState& getAiState();
 
+        /// Time that passed since the AI of this actor was last executed
+        float getPendingAiDuration() const;
+        void setPendingAiDuration(float duration);
+
     private:
         std::auto_ptr<CharacterController> mCharacterController;
 
         AiState mAiState;
+
+        float mPendingAiDuration;
     };
 
 }
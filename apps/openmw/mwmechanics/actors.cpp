@@ -2,11 +2,17 @@
 
 #include <typeinfo>
 #include <iostream>
+#include <algorithm>
+
+#include <osg/Timer>
 
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/loadnpc.hpp>
+#include <components/misc/profiler.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/workqueue.hpp>
+#include <components/settings/settings.hpp>
 
 #include "../mwworld/esmstore.hpp"
 #include "../mwworld/class.hpp"
@@ -44,6 +50,19 @@ bool isConscious(const MWWorld::Ptr& ptr)
     return !stats.isDead() && !stats.getKnockedDown();
 }
 
+/// The longest time step that deferred AI is executed with, unless the frame itself took longer. Longer steps would
+/// let timers and movement decisions jump after an actor waited for many frames.
+const float sMaxPendingAiDuration = 0.25f;
+
+/// Sort actors by the time since their AI was last executed, longest first
+struct ComparePendingAiDuration
+{
+    bool operator() (const std::pair<float, MWWorld::Ptr>& left, const std::pair<float, MWWorld::Ptr>& right) const
+    {
+        return left.first > right.first;
+    }
+};
+
 void adjustBoundItem (const std::string& item, bool bound, const MWWorld::Ptr& actor)
 {
     if (bound)
@@ -238,48 +257,6 @@ namespace MWMechanics
         calculateRestoration(ptr, duration);
     }
 
-    void Actors::updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
-                                    MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance)
-    {
-        static const float fMaxHeadTrackDistance = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                .find("fMaxHeadTrackDistance")->getFloat();
-        static const float fInteriorHeadTrackMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
-                .find("fInteriorHeadTrackMult")->getFloat();
-        float maxDistance = fMaxHeadTrackDistance;
-        const ESM::Cell* currentCell = actor.getCell()->getCell();
-        if (!currentCell->isExterior() && !(currentCell->mData.mFlags & ESM::Cell::QuasiEx))
-            maxDistance *= fInteriorHeadTrackMult;
-
-        const ESM::Position& actor1Pos = actor.getRefData().getPosition();
-        const ESM::Position& actor2Pos = targetActor.getRefData().getPosition();
-        float sqrDist = (actor1Pos.asVec3() - actor2Pos.asVec3()).length2();
-
-        if (sqrDist > maxDistance*maxDistance)
-            return;
-
-        if (targetActor.getClass().getCreatureStats(targetActor).isDead())
-            return;
-
-        if (!actor.getRefData().getBaseNode())
-            return;
-
-        // stop tracking when target is behind the actor
-        osg::Vec3f actorDirection = actor.getRefData().getBaseNode()->getAttitude() * osg::Vec3f(0,1,0);
-        osg::Vec3f targetDirection (actor2Pos.asVec3() - actor1Pos.asVec3());
-        actorDirection.z() = 0;
-        targetDirection.z() = 0;
-        actorDirection.normalize();
-        targetDirection.normalize();
-        if (std::acos(actorDirection * targetDirection) < osg::DegreesToRadians(90.f)
-            && sqrDist <= sqrHeadTrackDistance
-            && MWBase::Environment::get().getWorld()->getLOS(actor, targetActor) // check LOS and awareness last as it's the most expensive function
-            && MWBase::Environment::get().getMechanicsManager()->awarenessCheck(targetActor, actor))
-        {
-            sqrHeadTrackDistance = sqrDist;
-            headTrackTarget = targetActor;
-        }
-    }
-
     void Actors::engageCombat (const MWWorld::Ptr& actor1, const MWWorld::Ptr& actor2, bool againstPlayer)
     {
         CreatureStats& creatureStats = actor1.getClass().getCreatureStats(actor1);
@@ -902,7 +879,157 @@ namespace MWMechanics
         }
     }
 
-    Actors::Actors() {}
+    Actors::Actors()
+        : mAiUpdateBudget(std::max(0.f, Settings::Manager::getFloat("ai update budget", "Game")) / 1000.f)
+        , mAiWorkItems(0)
+    {
+        float fullRateDistance = Settings::Manager::getFloat("ai full rate distance", "Game");
+        mSqrAiFullRateDistance = fullRateDistance * fullRateDistance;
+
+        int numThreads = Settings::Manager::getInt("ai neighbour query threads", "Game");
+        if (numThreads > 0)
+        {
+            mAiWorkQueue = new SceneUtil::WorkQueue(numThreads);
+            // one for each thread, and as many again to balance actors with more neighbours than the others
+            mAiWorkItems = numThreads * 2;
+        }
+    }
+
+    void Actors::updateAiTargets(const MWWorld::Ptr& player, bool updateCombat, bool updateHeadTracking, float sqrProcessingDistance)
+    {
+        OPENMW_PROFILE_ZONE("Actors::updateAiTargets");
+
+        static const float fMaxHeadTrackDistance = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
+                .find("fMaxHeadTrackDistance")->getFloat();
+        static const float fInteriorHeadTrackMult = MWBase::Environment::get().getWorld()->getStore().get<ESM::GameSetting>()
+                .find("fInteriorHeadTrackMult")->getFloat();
+
+        // Search phase: take a snapshot of the actors, then find the actors in range of each of them on the worker
+        // threads, without touching anything else
+        mAiTargetActors.clear();
+        mCombatQuery.clear();
+        mHeadTrackQuery.clear();
+        for (PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
+        {
+            const MWWorld::Ptr& ptr = iter->first;
+            mAiTargetActors.push_back(std::make_pair(ptr, iter->second));
+
+            NeighbourQuery::Point point;
+            point.mPosition = ptr.getRefData().getPosition().asVec3();
+            point.mVisible = !ptr.getClass().getCreatureStats(ptr).isDead();
+            point.mRange = 7168.f;
+            mCombatQuery.addPoint(point);
+
+            float maxDistance = fMaxHeadTrackDistance;
+            const ESM::Cell* currentCell = ptr.getCell()->getCell();
+            if (!currentCell->isExterior() && !(currentCell->mData.mFlags & ESM::Cell::QuasiEx))
+                maxDistance *= fInteriorHeadTrackMult;
+            point.mRange = maxDistance;
+            // stop tracking when target is behind the actor
+            if (ptr.getRefData().getBaseNode())
+                point.mForward = ptr.getRefData().getBaseNode()->getAttitude() * osg::Vec3f(0,1,0);
+            mHeadTrackQuery.addPoint(point);
+        }
+
+        // Not worth waking up the threads for a handful of actors
+        SceneUtil::WorkQueue* workQueue = mAiTargetActors.size() >= 32 ? mAiWorkQueue.get() : NULL;
+        if (updateCombat)
+            mCombatQuery.run(workQueue, mAiWorkItems);
+        if (updateHeadTracking)
+            mHeadTrackQuery.run(workQueue, mAiWorkItems);
+
+        // Everything else stays on the main thread: the line of sight, awareness and faction checks, starting combat
+        // and setting the head tracking targets, in the order of the snapshot
+        for (std::size_t i=0; i<mAiTargetActors.size(); ++i)
+        {
+            const MWWorld::Ptr& ptr = mAiTargetActors[i].first;
+            if (ptr.getClass().getCreatureStats(ptr).isDead())
+                continue;
+            if ((player.getRefData().getPosition().asVec3() - ptr.getRefData().getPosition().asVec3()).length2() > sqrProcessingDistance)
+                continue;
+
+            // player is not AI-controlled
+            if (updateCombat && ptr != player)
+            {
+                adjustCommandedActor(ptr);
+
+                const std::vector<std::size_t>& targets = mCombatQuery.getNeighbours(i);
+                for (std::vector<std::size_t>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+                {
+                    const MWWorld::Ptr& target = mAiTargetActors[*it].first;
+                    engageCombat(ptr, target, target == player);
+                }
+            }
+
+            if (updateHeadTracking)
+            {
+                MWWorld::Ptr headTrackTarget;
+                if (ptr.getRefData().getBaseNode())
+                {
+                    // nearest first, so the first target passing the checks is the one to look at
+                    const std::vector<std::size_t>& targets = mHeadTrackQuery.getNeighbours(i);
+                    for (std::vector<std::size_t>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+                    {
+                        const MWWorld::Ptr& target = mAiTargetActors[*it].first;
+                        // check LOS and awareness last as it's the most expensive function
+                        if (!target.getClass().getCreatureStats(target).isDead()
+                                && MWBase::Environment::get().getWorld()->getLOS(ptr, target)
+                                && MWBase::Environment::get().getMechanicsManager()->awarenessCheck(target, ptr))
+                        {
+                            headTrackTarget = target;
+                            break;
+                        }
+                    }
+                }
+                mAiTargetActors[i].second->getCharacterController()->setHeadTrackTarget(headTrackTarget);
+            }
+        }
+    }
+
+    bool Actors::isAiUrgent(const MWWorld::Ptr& ptr, const MWWorld::Ptr& player) const
+    {
+        if (mAiUpdateBudget <= 0.f)
+            return true;
+
+        const AiSequence& sequence = ptr.getClass().getCreatureStats(ptr).getAiSequence();
+        if (sequence.isInCombat() || sequence.getTypeId() == AiPackage::TypeIdPursue)
+            return true;
+
+        return (player.getRefData().getPosition().asVec3() - ptr.getRefData().getPosition().asVec3()).length2()
+                <= mSqrAiFullRateDistance;
+    }
+
+    void Actors::executeAi(const MWWorld::Ptr& ptr, Actor& actor)
+    {
+        float duration = actor.getPendingAiDuration();
+        actor.setPendingAiDuration(0.f);
+        ptr.getClass().getCreatureStats(ptr).getAiSequence().execute(ptr, *actor.getCharacterController(), actor.getAiState(), duration);
+    }
+
+    void Actors::executeDeferredAi()
+    {
+        OPENMW_PROFILE_ZONE("Actors::executeDeferredAi");
+
+        // Round-robin: actors that did not get their turn in the previous frames come first.
+        // At least one actor is executed per frame, so all of them are eventually.
+        std::sort(mDeferredAi.begin(), mDeferredAi.end(), ComparePendingAiDuration());
+
+        const osg::Timer* timer = osg::Timer::instance();
+        osg::Timer_t start = timer->tick();
+        for (std::vector<std::pair<float, MWWorld::Ptr> >::iterator it = mDeferredAi.begin(); it != mDeferredAi.end(); ++it)
+        {
+            if (it != mDeferredAi.begin() && timer->delta_s(start, timer->tick()) >= mAiUpdateBudget)
+                break;
+
+            // the AI of the actors before may have removed this one, or knocked it out
+            PtrActorMap::iterator found = mActors.find(it->second);
+            if (found == mActors.end() || !isConscious(found->first))
+                continue;
+            executeAi(found->first, *found->second);
+        }
+
+        mDeferredAi.clear();
+    }
 
     Actors::~Actors()
     {
@@ -961,6 +1088,7 @@ namespace MWMechanics
 
     void Actors::update (float duration, bool paused)
     {
+        OPENMW_PROFILE_ZONE("Actors::update");
         if(!paused)
         {
             static float timerUpdateAITargets = 0;
@@ -982,6 +1110,15 @@ namespace MWMechanics
 
             /// \todo move update logic to Actor class where appropriate
 
+            mDeferredAi.clear();
+
+            // Combat and head tracking targets are updated for all actors before any of them runs its AI, rather than for
+            // each actor right before its own AI. So an actor whose AI comes first in mActors can already see that
+            // actors after it engaged it this frame.
+            if (MWBase::Environment::get().getMechanicsManager()->isAIActive()
+                    && (timerUpdateAITargets == 0 || timerUpdateHeadTrack == 0))
+                updateAiTargets(player, timerUpdateAITargets == 0, timerUpdateHeadTrack == 0, sqrProcessingDistance);
+
              // AI and magic effects update
             for(PtrActorMap::iterator iter(mActors.begin()); iter != mActors.end(); ++iter)
             {
@@ -1003,32 +1140,6 @@ namespace MWMechanics
                     }
                     if (MWBase::Environment::get().getMechanicsManager()->isAIActive() && inProcessingRange)
                     {
-                        if (timerUpdateAITargets == 0)
-                        {
-                            if (iter->first != player)
-                                adjustCommandedActor(iter->first);
-
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
-                            {
-                                if (it->first == iter->first || iter->first == player) // player is not AI-controlled
-                                    continue;
-                                engageCombat(iter->first, it->first, it->first == player);
-                            }
-                        }
-                        if (timerUpdateHeadTrack == 0)
-                        {
-                            float sqrHeadTrackDistance = std::numeric_limits<float>::max();
-                            MWWorld::Ptr headTrackTarget;
-
-                            for(PtrActorMap::iterator it(mActors.begin()); it != mActors.end(); ++it)
-                            {
-                                if (it->first == iter->first)
-                                    continue;
-                                updateHeadTracking(iter->first, it->first, headTrackTarget, sqrHeadTrackDistance);
-                            }
-                            iter->second->getCharacterController()->setHeadTrackTarget(headTrackTarget);
-                        }
-
                         if (iter->first.getClass().isNpc() && iter->first != player)
                             updateCrimePersuit(iter->first, duration);
 
@@ -1036,11 +1147,21 @@ namespace MWMechanics
                         {
                             CreatureStats &stats = iter->first.getClass().getCreatureStats(iter->first);
                             if (isConscious(iter->first))
-                                stats.getAiSequence().execute(iter->first, *iter->second->getCharacterController(), iter->second->getAiState(), duration);
+                            {
+                                Actor& actor = *iter->second;
+                                actor.setPendingAiDuration(std::min(actor.getPendingAiDuration() + duration,
+                                                                    std::max(duration, sMaxPendingAiDuration)));
+                                if (isAiUrgent(iter->first, player))
+                                    executeAi(iter->first, actor);
+                                else
+                                    mDeferredAi.push_back(std::make_pair(actor.getPendingAiDuration(), iter->first));
+                            }
 
                             if (stats.getAiSequence().isInCombat() && !stats.isDead()) hostilesCount++;
                         }
                     }
+                    else
+                        iter->second->setPendingAiDuration(0.f);
 
                     if(iter->first.getTypeName() == typeid(ESM::NPC).name())
                         updateNpc(iter->first, duration);
@@ -1050,6 +1171,9 @@ namespace MWMechanics
             timerUpdateAITargets += duration;
             timerUpdateHeadTrack += duration;
 
+            if (!mDeferredAi.empty())
+                executeDeferredAi();
+
             // Looping magic VFX update
             // Note: we need to do this before any of the animations are updated.
             // Reaching the text keys may trigger Hit / Spellcast (and as such, particles),
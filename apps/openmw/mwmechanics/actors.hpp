@@ -7,9 +7,17 @@
 #include <map>
 #include <list>
 
+#include <osg/ref_ptr>
+
 #include "movement.hpp"
+#include "neighbourquery.hpp"
 #include "../mwbase/world.hpp"
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWWorld
 {
     class Ptr;
@@ -43,6 +51,21 @@ namespace MWMechanics
 
             void killDeadActors ();
 
+            /// Start combat between actors that notice each other and pick the actors they look at, for all actors
+            /// at once before their AI is executed.
+            /// @note Only the distance and direction search for the candidates runs on the AI worker threads, the
+            /// checks and decisions run on the calling thread.
+            void updateAiTargets (const MWWorld::Ptr& player, bool updateCombat, bool updateHeadTracking, float sqrProcessingDistance);
+
+            /// Whether the AI of \a ptr has to be executed every frame, rather than when the time budget allows
+            bool isAiUrgent (const MWWorld::Ptr& ptr, const MWWorld::Ptr& player) const;
+
+            /// Execute the AI of \a ptr for the time that passed since its last execution.
+            void executeAi (const MWWorld::Ptr& ptr, Actor& actor);
+
+            /// Execute the AI of the actors in mDeferredAi that waited longest, until the time budget is used up.
+            void executeDeferredAi ();
+
         public:
 
             Actors();
@@ -86,9 +109,6 @@ namespace MWMechanics
             */
             void engageCombat(const MWWorld::Ptr& actor1, const MWWorld::Ptr& actor2, bool againstPlayer);
 
-            void updateHeadTracking(const MWWorld::Ptr& actor, const MWWorld::Ptr& targetActor,
-                                            MWWorld::Ptr& headTrackTarget, float& sqrHeadTrackDistance);
-
             void restoreDynamicStats(bool sleep);
             ///< If the player is sleeping, this should be called every hour.
 
@@ -134,6 +154,23 @@ namespace MWMechanics
     private:
         PtrActorMap mActors;
 
+        /// Actors whose AI is not urgent in the current frame, with the time their AI has been waiting. Looked up in
+        /// mActors again before their AI is executed, as the AI of another actor may remove them.
+        std::vector<std::pair<float, MWWorld::Ptr> > mDeferredAi;
+
+        /// Time in seconds per frame for executing deferred AI, 0 executes all AI every frame
+        float mAiUpdateBudget;
+        float mSqrAiFullRateDistance;
+
+        /// Snapshot of the actors taken by updateAiTargets, in the order of mActors
+        std::vector<std::pair<MWWorld::Ptr, Actor*> > mAiTargetActors;
+        NeighbourQuery mCombatQuery;
+        NeighbourQuery mHeadTrackQuery;
+
+        /// May be NULL to find AI targets on the main thread
+        osg::ref_ptr<SceneUtil::WorkQueue> mAiWorkQueue;
+        int mAiWorkItems;
+
     };
 }
 
@@ -92,6 +92,7 @@ namespace MWMechanics
         ESM::Position mShortcutFailPos;
         osg::Vec3f mLastActorPos;
         MWMechanics::Movement mMovement;
+        CombatActionCache mActionCache;
         
         AiCombatStorage():
         mAttackCooldown(0),
@@ -108,7 +109,8 @@ namespace MWMechanics
         mStrength(),
         mForceNoShortcut(false),
         mLastActorPos(0,0,0),
-        mMovement(){}    
+        mMovement(),
+        mActionCache(){}    
 
         void startCombatMove(bool isNpc, bool isDistantCombat, float distToTarget, float rangeAttack);
         void updateCombatMove(float duration);
@@ -246,7 +248,7 @@ namespace MWMechanics
         boost::shared_ptr<Action>& currentAction = storage.mCurrentAction;
         if (characterController.readyToPrepareAttack())
         {
-            currentAction = prepareNextAction(actor, target);
+            currentAction = prepareNextAction(actor, target, storage.mActionCache);
             actionCooldown = currentAction->getActionCooldown();
         }
 
@@ -14,6 +14,8 @@
 #include <components/esm/loadench.hpp>
 #include <components/esm/loadmgef.hpp>
 
+#include <components/misc/profiler.hpp>
+
 namespace
 {
 
@@ -83,135 +85,173 @@ int numEffectsToCure (const MWWorld::Ptr& actor, int effectFilter=-1)
     return toCure;
 }
 
+float getDamageRating(const ESM::Weapon* weapon)
+{
+    if (weapon->mData.mType >= ESM::Weapon::MarksmanBow)
+        return (weapon->mData.mChop[0] + weapon->mData.mChop[1]) / 2.f;
+
+    float rating = 0.f;
+    for (int i=0; i<2; ++i)
+    {
+        rating += weapon->mData.mSlash[i];
+        rating += weapon->mData.mThrust[i];
+        rating += weapon->mData.mChop[i];
+    }
+    return rating / 6.f;
 }
 
-namespace MWMechanics
+/// Look up the parts of the rating of \a item that only depend on its record.
+/// @return false if \a item is not a weapon
+bool getWeapon(const MWWorld::Ptr& item, MWMechanics::CombatActionCache::Weapon& weapon)
 {
+    if (item.getTypeName() != typeid(ESM::Weapon).name())
+        return false;
+
+    weapon.mItem = item;
+    weapon.mWeapon = item.get<ESM::Weapon>()->mBase;
+    weapon.mDamageRating = getDamageRating(weapon.mWeapon);
+    weapon.mEnchantment = NULL;
+    if (!weapon.mWeapon->mEnchant.empty())
+    {
+        const ESM::Enchantment* enchantment = MWBase::Environment::get().getWorld()->getStore().get<ESM::Enchantment>().find(weapon.mWeapon->mEnchant);
+        if (enchantment->mData.mType == ESM::Enchantment::WhenStrikes)
+            weapon.mEnchantment = enchantment;
+    }
+    weapon.mSkill = item.getClass().getEquipmentSkill(item);
+    return true;
+}
 
-    float ratePotion (const MWWorld::Ptr &item, const MWWorld::Ptr& actor)
+float rateCachedWeapon(const MWMechanics::CombatActionCache::Weapon& weapon, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy,
+                       float arrowRating, float boltRating)
+{
+    const MWWorld::Ptr& item = weapon.mItem;
+    float rating = weapon.mDamageRating;
+
+    if (item.getClass().hasItemHealth(item))
     {
-        if (item.getTypeName() != typeid(ESM::Potion).name())
+        if (item.getClass().getItemHealth(item) == 0)
             return 0.f;
-
-        const ESM::Potion* potion = item.get<ESM::Potion>()->mBase;
-        return rateEffects(potion->mEffects, actor, MWWorld::Ptr());
+        rating *= item.getClass().getItemHealth(item) / float(item.getClass().getItemMaxHealth(item));
     }
 
-    float rateWeapon (const MWWorld::Ptr &item, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy, int type,
-                      float arrowRating, float boltRating)
+    if (weapon.mWeapon->mData.mType == ESM::Weapon::MarksmanBow)
     {
-        if (item.getTypeName() != typeid(ESM::Weapon).name())
-            return 0.f;
+        if (arrowRating <= 0.f)
+            rating = 0.f;
+        else
+            rating += arrowRating;
+    }
+    else if (weapon.mWeapon->mData.mType == ESM::Weapon::MarksmanCrossbow)
+    {
+        if (boltRating <= 0.f)
+            rating = 0.f;
+        else
+            rating += boltRating;
+    }
 
-        const ESM::Weapon* weapon = item.get<ESM::Weapon>()->mBase;
+    if (weapon.mEnchantment
+            && (item.getCellRef().getEnchantmentCharge() == -1
+                || item.getCellRef().getEnchantmentCharge() >= weapon.mEnchantment->mData.mCost))
+        rating += MWMechanics::rateEffects(weapon.mEnchantment->mEffects, actor, enemy);
 
-        if (type != -1 && weapon->mData.mType != type)
-            return 0.f;
+    if (weapon.mSkill != -1)
+        rating *= actor.getClass().getSkill(actor, weapon.mSkill) / 100.f;
 
-        float rating=0.f;
+    return rating;
+}
 
-        if (weapon->mData.mType >= ESM::Weapon::MarksmanBow)
-        {
-            rating = (weapon->mData.mChop[0] + weapon->mData.mChop[1]) / 2.f;
-        }
-        else
-        {
-            for (int i=0; i<2; ++i)
-            {
-                rating += weapon->mData.mSlash[i];
-                rating += weapon->mData.mThrust[i];
-                rating += weapon->mData.mChop[i];
-            }
-            rating /= 6.f;
-        }
+/// @return whether \a actor may cast \a spell in combat at all
+bool isCombatSpell(const ESM::Spell* spell, const MWWorld::Ptr& actor)
+{
+    if (spell->mData.mType != ESM::Spell::ST_Spell)
+        return false;
 
-        if (item.getClass().hasItemHealth(item))
-        {
-            if (item.getClass().getItemHealth(item) == 0)
-                return 0.f;
-            rating *= item.getClass().getItemHealth(item) / float(item.getClass().getItemMaxHealth(item));
-        }
+    // Don't make use of racial bonus spells, like MW. Can be made optional later
+    if (actor.getClass().isNpc())
+    {
+        std::string raceid = actor.get<ESM::NPC>()->mBase->mRace;
+        const ESM::Race* race = MWBase::Environment::get().getWorld()->getStore().get<ESM::Race>().find(raceid);
+        if (race->mPowers.exists(spell->mId))
+            return false;
+    }
+    return true;
+}
 
-        if (weapon->mData.mType == ESM::Weapon::MarksmanBow)
-        {
-            if (arrowRating <= 0.f)
-                rating = 0.f;
-            else
-                rating += arrowRating;
-        }
-        else if (weapon->mData.mType == ESM::Weapon::MarksmanCrossbow)
-        {
-            if (boltRating <= 0.f)
-                rating = 0.f;
-            else
-                rating += boltRating;
-        }
+float rateCachedSpell(const ESM::Spell* spell, int rangeTypes, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy)
+{
+    const MWMechanics::CreatureStats& stats = actor.getClass().getCreatureStats(actor);
 
-        if (!weapon->mEnchant.empty())
-        {
-            const ESM::Enchantment* enchantment = MWBase::Environment::get().getWorld()->getStore().get<ESM::Enchantment>().find(weapon->mEnchant);
-            if (enchantment->mData.mType == ESM::Enchantment::WhenStrikes
-                    && (item.getCellRef().getEnchantmentCharge() == -1
-                        || item.getCellRef().getEnchantmentCharge() >= enchantment->mData.mCost))
-                rating += rateEffects(enchantment->mEffects, actor, enemy);
-        }
+    if (spell->mData.mCost > stats.getMagicka().getCurrent())
+        return 0.f;
 
-        int skill = item.getClass().getEquipmentSkill(item);
-        if (skill != -1)
-            rating *= actor.getClass().getSkill(actor, skill) / 100.f;
+    float successChance = MWMechanics::getSpellSuccessChance(spell, actor);
+    if (successChance == 0.f)
+        return 0.f;
 
-        return rating;
-    }
+    // Spells don't stack, so early out if the spell is still active on the target
+    if ((rangeTypes & Self) && stats.getActiveSpells().isSpellActive(spell->mId))
+        return 0.f;
+    if ( ((rangeTypes & Touch) || (rangeTypes & Target)) && enemy.getClass().getCreatureStats(enemy).getActiveSpells().isSpellActive(spell->mId))
+        return 0.f;
 
-    float rateSpell(const ESM::Spell *spell, const MWWorld::Ptr &actor, const MWWorld::Ptr& enemy)
-    {
-        const CreatureStats& stats = actor.getClass().getCreatureStats(actor);
+    return MWMechanics::rateEffects(spell->mEffects, actor, enemy) * (successChance / 100.f);
+}
 
-        float successChance = MWMechanics::getSpellSuccessChance(spell, actor);
-        if (successChance == 0.f)
-            return 0.f;
+/// @return the enchantment of \a item if it can be cast from the item, or NULL
+const ESM::Enchantment* getCastOnceEnchantment(const MWWorld::Ptr& item)
+{
+    std::string enchantmentId = item.getClass().getEnchantment(item);
+    if (enchantmentId.empty())
+        return NULL;
+
+    const ESM::Enchantment* enchantment = MWBase::Environment::get().getWorld()->getStore().get<ESM::Enchantment>().find(enchantmentId);
+    if (enchantment->mData.mType != ESM::Enchantment::CastOnce)
+        return NULL;
+    return enchantment;
+}
 
-        if (spell->mData.mType != ESM::Spell::ST_Spell)
-            return 0.f;
+}
 
-        // Don't make use of racial bonus spells, like MW. Can be made optional later
-        if (actor.getClass().isNpc())
-        {
-            std::string raceid = actor.get<ESM::NPC>()->mBase->mRace;
-            const ESM::Race* race = MWBase::Environment::get().getWorld()->getStore().get<ESM::Race>().find(raceid);
-            if (race->mPowers.exists(spell->mId))
-                return 0.f;
-        }
+namespace MWMechanics
+{
 
-        if (spell->mData.mCost > stats.getMagicka().getCurrent())
+    float ratePotion (const MWWorld::Ptr &item, const MWWorld::Ptr& actor)
+    {
+        if (item.getTypeName() != typeid(ESM::Potion).name())
             return 0.f;
 
-        // Spells don't stack, so early out if the spell is still active on the target
-        int types = getRangeTypes(spell->mEffects);
-        if ((types & Self) && stats.getActiveSpells().isSpellActive(spell->mId))
+        const ESM::Potion* potion = item.get<ESM::Potion>()->mBase;
+        return rateEffects(potion->mEffects, actor, MWWorld::Ptr());
+    }
+
+    float rateWeapon (const MWWorld::Ptr &item, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy, int type,
+                      float arrowRating, float boltRating)
+    {
+        CombatActionCache::Weapon weapon;
+        if (!getWeapon(item, weapon))
             return 0.f;
-        if ( ((types & Touch) || (types & Target)) && enemy.getClass().getCreatureStats(enemy).getActiveSpells().isSpellActive(spell->mId))
+
+        if (type != -1 && weapon.mWeapon->mData.mType != type)
             return 0.f;
 
-        return rateEffects(spell->mEffects, actor, enemy) * (successChance / 100.f);
+        return rateCachedWeapon(weapon, actor, enemy, arrowRating, boltRating);
     }
 
-    float rateMagicItem(const MWWorld::Ptr &ptr, const MWWorld::Ptr &actor, const MWWorld::Ptr& enemy)
+    float rateSpell(const ESM::Spell *spell, const MWWorld::Ptr &actor, const MWWorld::Ptr& enemy)
     {
-        if (ptr.getClass().getEnchantment(ptr).empty())
+        if (!isCombatSpell(spell, actor))
             return 0.f;
 
-        const ESM::Enchantment* enchantment = MWBase::Environment::get().getWorld()->getStore().get<ESM::Enchantment>().find(ptr.getClass().getEnchantment(ptr));
+        return rateCachedSpell(spell, getRangeTypes(spell->mEffects), actor, enemy);
+    }
 
-        if (enchantment->mData.mType == ESM::Enchantment::CastOnce)
-        {
-            return rateEffects(enchantment->mEffects, actor, enemy);
-        }
-        else
-        {
-            //if (!ptr.getClass().canBeEquipped(ptr, actor))
+    float rateMagicItem(const MWWorld::Ptr &ptr, const MWWorld::Ptr &actor, const MWWorld::Ptr& enemy)
+    {
+        const ESM::Enchantment* enchantment = getCastOnceEnchantment(ptr);
+        if (!enchantment)
             return 0.f;
-        }
+
+        return rateEffects(enchantment->mEffects, actor, enemy);
     }
 
     float rateEffect(const ESM::ENAMstruct &effect, const MWWorld::Ptr &actor, const MWWorld::Ptr &enemy)
@@ -483,9 +523,77 @@ namespace MWMechanics
         // Already done in AiCombat itself
     }
 
-    boost::shared_ptr<Action> prepareNextAction(const MWWorld::Ptr &actor, const MWWorld::Ptr &enemy)
+    CombatActionCache::CombatActionCache()
+    {
+    }
+
+    void CombatActionCache::update(const MWWorld::Ptr& actor)
+    {
+        const Spells& spells = actor.getClass().getCreatureStats(actor).getSpells();
+        if (mSpellList.update(&spells, spells.getStateId()))
+        {
+            mSpells.clear();
+            for (Spells::TIterator it = spells.begin(); it != spells.end(); ++it)
+            {
+                if (!isCombatSpell(it->first, actor))
+                    continue;
+
+                Spell spell;
+                spell.mSpell = it->first;
+                spell.mRangeTypes = getRangeTypes(it->first->mEffects);
+                mSpells.push_back(spell);
+            }
+        }
+
+        MWWorld::ContainerStore* store = NULL;
+        if (actor.getClass().hasInventoryStore(actor))
+            store = &actor.getClass().getInventoryStore(actor);
+
+        if (!mStore.update(store, store ? store->getStateId() : 0))
+            return;
+
+        mPotions.clear();
+        mMagicItems.clear();
+        mWeapons.clear();
+        mArrows.clear();
+        mBolts.clear();
+
+        if (!store)
+            return;
+
+        for (MWWorld::ContainerStoreIterator it = store->begin(); it != store->end(); ++it)
+        {
+            if (it.getType() == MWWorld::ContainerStore::Type_Potion)
+            {
+                mPotions.push_back(it);
+                continue;
+            }
+
+            if (const ESM::Enchantment* enchantment = getCastOnceEnchantment(*it))
+            {
+                MagicItem item = { it, enchantment };
+                mMagicItems.push_back(item);
+            }
+
+            Weapon weapon;
+            if (!getWeapon(*it, weapon))
+                continue;
+
+            if (weapon.mWeapon->mData.mType == ESM::Weapon::Arrow)
+                mArrows.push_back(weapon);
+            else if (weapon.mWeapon->mData.mType == ESM::Weapon::Bolt)
+                mBolts.push_back(weapon);
+
+            std::vector<int> equipmentSlots = it->getClass().getEquipmentSlots(*it).first;
+            if (std::find(equipmentSlots.begin(), equipmentSlots.end(), (int)MWWorld::InventoryStore::Slot_CarriedRight)
+                    != equipmentSlots.end())
+                mWeapons.push_back(weapon);
+        }
+    }
+
+    boost::shared_ptr<Action> prepareNextAction(const MWWorld::Ptr &actor, const MWWorld::Ptr &enemy, CombatActionCache& cache)
     {
-        Spells& spells = actor.getClass().getCreatureStats(actor).getSpells();
+        OPENMW_PROFILE_ZONE("prepareNextAction");
 
         float bestActionRating = 0.f;
         // Default to hand-to-hand combat
@@ -496,87 +604,92 @@ namespace MWMechanics
             return bestAction;
         }
 
-        if (actor.getClass().hasInventoryStore(actor))
+        cache.update(actor);
+
+        // Items may have been used up since the cache was built, without being removed yet
+        for (std::vector<MWWorld::ContainerStoreIterator>::const_iterator it = cache.mPotions.begin(); it != cache.mPotions.end(); ++it)
         {
-            MWWorld::InventoryStore& store = actor.getClass().getInventoryStore(actor);
+            MWWorld::Ptr potion = **it;
+            if (potion.getRefData().getCount() <= 0)
+                continue;
 
-            for (MWWorld::ContainerStoreIterator it = store.begin(); it != store.end(); ++it)
+            float rating = rateEffects(potion.get<ESM::Potion>()->mBase->mEffects, actor, MWWorld::Ptr());
+            if (rating > bestActionRating)
             {
-                float rating = ratePotion(*it, actor);
-                if (rating > bestActionRating)
-                {
-                    bestActionRating = rating;
-                    bestAction.reset(new ActionPotion(*it));
-                }
+                bestActionRating = rating;
+                bestAction.reset(new ActionPotion(potion));
             }
+        }
 
-            for (MWWorld::ContainerStoreIterator it = store.begin(); it != store.end(); ++it)
-            {
-                float rating = rateMagicItem(*it, actor, enemy);
-                if (rating > bestActionRating)
-                {
-                    bestActionRating = rating;
-                    bestAction.reset(new ActionEnchantedItem(it));
-                }
-            }
+        for (std::vector<CombatActionCache::MagicItem>::const_iterator it = cache.mMagicItems.begin(); it != cache.mMagicItems.end(); ++it)
+        {
+            if ((*it->mItem).getRefData().getCount() <= 0)
+                continue;
 
-            float bestArrowRating = 0;
-            MWWorld::Ptr bestArrow;
-            for (MWWorld::ContainerStoreIterator it = store.begin(); it != store.end(); ++it)
+            float rating = rateEffects(it->mEnchantment->mEffects, actor, enemy);
+            if (rating > bestActionRating)
             {
-                float rating = rateWeapon(*it, actor, enemy, ESM::Weapon::Arrow);
-                if (rating > bestArrowRating)
-                {
-                    bestArrowRating = rating;
-                    bestArrow = *it;
-                }
+                bestActionRating = rating;
+                bestAction.reset(new ActionEnchantedItem(it->mItem));
             }
+        }
 
-            float bestBoltRating = 0;
-            MWWorld::Ptr bestBolt;
-            for (MWWorld::ContainerStoreIterator it = store.begin(); it != store.end(); ++it)
+        float bestArrowRating = 0;
+        MWWorld::Ptr bestArrow;
+        for (std::vector<CombatActionCache::Weapon>::const_iterator it = cache.mArrows.begin(); it != cache.mArrows.end(); ++it)
+        {
+            if (it->mItem.getRefData().getCount() <= 0)
+                continue;
+
+            float rating = rateCachedWeapon(*it, actor, enemy, 0.f, 0.f);
+            if (rating > bestArrowRating)
             {
-                float rating = rateWeapon(*it, actor, enemy, ESM::Weapon::Bolt);
-                if (rating > bestBoltRating)
-                {
-                    bestBoltRating = rating;
-                    bestBolt = *it;
-                }
+                bestArrowRating = rating;
+                bestArrow = it->mItem;
             }
+        }
 
-            for (MWWorld::ContainerStoreIterator it = store.begin(); it != store.end(); ++it)
+        float bestBoltRating = 0;
+        MWWorld::Ptr bestBolt;
+        for (std::vector<CombatActionCache::Weapon>::const_iterator it = cache.mBolts.begin(); it != cache.mBolts.end(); ++it)
+        {
+            if (it->mItem.getRefData().getCount() <= 0)
+                continue;
+
+            float rating = rateCachedWeapon(*it, actor, enemy, 0.f, 0.f);
+            if (rating > bestBoltRating)
             {
-                std::vector<int> equipmentSlots = it->getClass().getEquipmentSlots(*it).first;
-                if (std::find(equipmentSlots.begin(), equipmentSlots.end(), (int)MWWorld::InventoryStore::Slot_CarriedRight)
-                        == equipmentSlots.end())
-                    continue;
+                bestBoltRating = rating;
+                bestBolt = it->mItem;
+            }
+        }
 
-                float rating = rateWeapon(*it, actor, enemy, -1, bestArrowRating, bestBoltRating);
-                if (rating > bestActionRating)
-                {
-                    const ESM::Weapon* weapon = it->get<ESM::Weapon>()->mBase;
+        for (std::vector<CombatActionCache::Weapon>::const_iterator it = cache.mWeapons.begin(); it != cache.mWeapons.end(); ++it)
+        {
+            if (it->mItem.getRefData().getCount() <= 0)
+                continue;
 
-                    MWWorld::Ptr ammo;
-                    if (weapon->mData.mType == ESM::Weapon::MarksmanBow)
-                        ammo = bestArrow;
-                    else if (weapon->mData.mType == ESM::Weapon::MarksmanCrossbow)
-                        ammo = bestBolt;
+            float rating = rateCachedWeapon(*it, actor, enemy, bestArrowRating, bestBoltRating);
+            if (rating > bestActionRating)
+            {
+                MWWorld::Ptr ammo;
+                if (it->mWeapon->mData.mType == ESM::Weapon::MarksmanBow)
+                    ammo = bestArrow;
+                else if (it->mWeapon->mData.mType == ESM::Weapon::MarksmanCrossbow)
+                    ammo = bestBolt;
 
-                    bestActionRating = rating;
-                    bestAction.reset(new ActionWeapon(*it, ammo));
-                }
+                bestActionRating = rating;
+                bestAction.reset(new ActionWeapon(it->mItem, ammo));
             }
         }
 
-        for (Spells::TIterator it = spells.begin(); it != spells.end(); ++it)
+        for (std::vector<CombatActionCache::Spell>::const_iterator it = cache.mSpells.begin(); it != cache.mSpells.end(); ++it)
         {
-            const ESM::Spell* spell = it->first;
-
-            float rating = rateSpell(spell, actor, enemy);
+            float rating = rateCachedSpell(it->mSpell, it->mRangeTypes, actor, enemy);
             if (rating > bestActionRating)
             {
                 bestActionRating = rating;
-                bestAction.reset(new ActionSpell(spell->mId));
+                bestAction.reset(new ActionSpell(it->mSpell->mId));
             }
         }
 
@@ -1,15 +1,26 @@
 #ifndef OPENMW_AICOMBAT_ACTION_H
 #define OPENMW_AICOMBAT_ACTION_H
 
+#include <vector>
+
 #include <boost/shared_ptr.hpp>
 
 #include "../mwworld/ptr.hpp"
 #include "../mwworld/containerstore.hpp"
 
+#include "cachedsource.hpp"
+
 #include <components/esm/loadspel.hpp>
 
+namespace ESM
+{
+    struct Enchantment;
+    struct Weapon;
+}
+
 namespace MWMechanics
 {
+    class Spells;
 
     class Action
     {
@@ -72,6 +83,54 @@ namespace MWMechanics
         virtual void getCombatRange (float& rangeAttack, float& rangeFollow);
     };
 
+    /// @brief The items and spells of an actor that may be used in combat, with the parts of their ratings that do not
+    /// change during combat.
+    /// @note Only rebuilt when items are added to or removed from the actor's inventory, or spells to or from its
+    /// spell list, so that choosing the next action does not look up every item and spell again.
+    class CombatActionCache
+    {
+    public:
+        struct Weapon
+        {
+            MWWorld::Ptr mItem;
+            const ESM::Weapon* mWeapon;
+            /// Average damage, not yet accounting for item health, ammunition and skill
+            float mDamageRating;
+            /// The enchantment applied on strike, or NULL
+            const ESM::Enchantment* mEnchantment;
+            int mSkill;
+        };
+
+        struct MagicItem
+        {
+            MWWorld::ContainerStoreIterator mItem;
+            const ESM::Enchantment* mEnchantment;
+        };
+
+        struct Spell
+        {
+            const ESM::Spell* mSpell;
+            int mRangeTypes;
+        };
+
+        CombatActionCache();
+
+        /// Rebuild the parts of the cache whose source changed since the last update.
+        void update(const MWWorld::Ptr& actor);
+
+        std::vector<MWWorld::ContainerStoreIterator> mPotions;
+        std::vector<MagicItem> mMagicItems;
+        /// Weapons that can be equipped in the right hand
+        std::vector<Weapon> mWeapons;
+        std::vector<Weapon> mArrows;
+        std::vector<Weapon> mBolts;
+        std::vector<Spell> mSpells;
+
+    private:
+        CachedSource<MWWorld::ContainerStore> mStore;
+        CachedSource<Spells> mSpellList;
+    };
+
     float rateSpell (const ESM::Spell* spell, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy);
     float rateMagicItem (const MWWorld::Ptr& ptr, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy);
     float ratePotion (const MWWorld::Ptr& item, const MWWorld::Ptr &actor);
@@ -84,7 +143,8 @@ namespace MWMechanics
     /// @note target may be empty
     float rateEffects (const ESM::EffectList& list, const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy);
 
-    boost::shared_ptr<Action> prepareNextAction (const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy);
+    /// @param cache The candidates of \a actor, updated as needed
+    boost::shared_ptr<Action> prepareNextAction (const MWWorld::Ptr& actor, const MWWorld::Ptr& enemy, CombatActionCache& cache);
 }
 
 #endif
@@ -15,10 +15,33 @@
 #include "actorutil.hpp"
 
 #include <components/esm/aisequence.hpp>
+#include <components/misc/profiler.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
 
+namespace
+{
+    /// Profiler zone names of the packages, indexed by AiPackage::TypeId
+    const char* const sPackageZoneNames[] = {
+        "AiWander::execute",
+        "AiTravel::execute",
+        "AiEscort::execute",
+        "AiFollow::execute",
+        "AiActivate::execute",
+        "AiCombat::execute",
+        "AiPursue::execute",
+        "AiAvoidDoor::execute"
+    };
+
+    const char* getPackageZoneName(int typeId)
+    {
+        if (typeId < 0 || typeId >= static_cast<int>(sizeof(sPackageZoneNames) / sizeof(sPackageZoneNames[0])))
+            return "AiPackage::execute";
+        return sPackageZoneNames[typeId];
+    }
+}
+
 namespace MWMechanics
 {
 
@@ -217,7 +240,13 @@ void AiSequence::execute (const MWWorld::Ptr& actor, CharacterController& charac
             }
         }
 
-        if (package->execute (actor,characterController,state,duration))
+        bool done;
+        {
+            Misc::ProfileZone zone (getPackageZoneName(mLastAiPackage));
+            done = package->execute (actor,characterController,state,duration);
+        }
+
+        if (done)
         {
             // To account for the rare case where AiPackage::execute() queued another AI package
             // (e.g. AiPursue executing a dialogue script that uses startCombat)
@@ -0,0 +1,39 @@
+#ifndef GAME_MWMECHANICS_CACHEDSOURCE_H
+#define GAME_MWMECHANICS_CACHEDSOURCE_H
+
+#include <cstddef>
+
+namespace MWMechanics
+{
+    /// @brief The object that a cache was built from, with the state id it had at that time.
+    /// @par State ids are unique among all objects of a type, see ContainerStore::getStateId and Spells::getStateId,
+    /// so an object created at the address of a destroyed one is still noticed.
+    template <typename Source>
+    class CachedSource
+    {
+    public:
+        CachedSource()
+            : mSource(NULL)
+            , mStateId(0)
+        {
+        }
+
+        /// Remember \a source and its \a stateId.
+        /// @return true if the cache has to be rebuilt, because either differs from the last call
+        bool update(const Source* source, int stateId)
+        {
+            if (source == mSource && stateId == mStateId)
+                return false;
+
+            mSource = source;
+            mStateId = stateId;
+            return true;
+        }
+
+    private:
+        const Source* mSource;
+        int mStateId;
+    };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include "neighbourquery.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include <components/misc/profiler.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+namespace
+{
+
+    class FindNeighboursWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        FindNeighboursWorkItem(MWMechanics::NeighbourQuery& query, std::size_t begin, std::size_t end)
+            : mQuery(query)
+            , mBegin(begin)
+            , mEnd(end)
+        {
+        }
+
+        virtual void doWork()
+        {
+            OPENMW_PROFILE_ZONE("FindNeighboursWorkItem::doWork");
+            mQuery.findNeighbours(mBegin, mEnd);
+        }
+
+    private:
+        MWMechanics::NeighbourQuery& mQuery;
+        std::size_t mBegin;
+        std::size_t mEnd;
+    };
+
+}
+
+namespace MWMechanics
+{
+
+    void NeighbourQuery::clear()
+    {
+        mPoints.clear();
+        mNeighbours.clear();
+    }
+
+    std::size_t NeighbourQuery::addPoint(const Point &point)
+    {
+        mPoints.push_back(point);
+        return mPoints.size() - 1;
+    }
+
+    void NeighbourQuery::run(SceneUtil::WorkQueue *workQueue, int numItems)
+    {
+        // keep the allocated lists around for the next run
+        mNeighbours.resize(mPoints.size());
+
+        std::size_t numPoints = mPoints.size();
+        if (!workQueue || numItems <= 1 || numPoints < 2)
+        {
+            findNeighbours(0, numPoints);
+            return;
+        }
+
+        std::vector<osg::ref_ptr<FindNeighboursWorkItem> > items;
+        for (int i=0; i<numItems; ++i)
+        {
+            std::size_t begin = numPoints * i / numItems;
+            std::size_t end = numPoints * (i+1) / numItems;
+            if (begin == end)
+                continue;
+            items.push_back(new FindNeighboursWorkItem(*this, begin, end));
+            workQueue->addWorkItem(items.back());
+        }
+
+        for (std::vector<osg::ref_ptr<FindNeighboursWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+            (*it)->waitTillDone();
+    }
+
+    void NeighbourQuery::findNeighbours(std::size_t begin, std::size_t end)
+    {
+        std::vector<std::pair<float, std::size_t> > found;
+        for (std::size_t i=begin; i<end; ++i)
+        {
+            const Point& point = mPoints[i];
+            std::vector<std::size_t>& neighbours = mNeighbours[i];
+            neighbours.clear();
+
+            osg::Vec3f forward (point.mForward.x(), point.mForward.y(), 0.f);
+            bool anyDirection = forward.length2() == 0.f;
+            float sqrRange = point.mRange * point.mRange;
+
+            found.clear();
+            for (std::size_t j=0; j<mPoints.size(); ++j)
+            {
+                const Point& other = mPoints[j];
+                if (j == i || !other.mVisible)
+                    continue;
+
+                osg::Vec3f offset = other.mPosition - point.mPosition;
+                float sqrDistance = offset.length2();
+                if (sqrDistance > sqrRange)
+                    continue;
+
+                if (!anyDirection && forward.x() * offset.x() + forward.y() * offset.y() <= 0.f)
+                    continue;
+
+                found.push_back(std::make_pair(sqrDistance, j));
+            }
+
+            std::sort(found.begin(), found.end());
+
+            neighbours.reserve(found.size());
+            for (std::vector<std::pair<float, std::size_t> >::const_iterator it = found.begin(); it != found.end(); ++it)
+                neighbours.push_back(it->second);
+        }
+    }
+
+}
@@ -0,0 +1,64 @@
+#ifndef GAME_MWMECHANICS_NEIGHBOURQUERY_H
+#define GAME_MWMECHANICS_NEIGHBOURQUERY_H
+
+#include <vector>
+#include <cstddef>
+
+#include <osg/Vec3f>
+
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
+namespace MWMechanics
+{
+    /// @brief Finds the neighbours of each of a set of points, such as the actors an actor may notice.
+    /// @par The points are a snapshot copied from the world beforehand, so the search can run on worker threads
+    /// while nothing else is accessed. The results do not depend on the number of threads or work items.
+    /// @par Only this distance and direction search runs on the threads. Deciding whether to engage or look at a
+    /// neighbour needs line of sight, awareness and faction checks, which access the world and stay on the main
+    /// thread, see Actors::updateAiTargets.
+    class NeighbourQuery
+    {
+    public:
+        struct Point
+        {
+            osg::Vec3f mPosition;
+            /// Only find neighbours less than 90 degrees off this direction, ignoring the height difference.
+            /// A zero vector accepts all directions.
+            osg::Vec3f mForward;
+            /// Points further away are not neighbours
+            float mRange;
+            /// Whether this point can be a neighbour of other points
+            bool mVisible;
+        };
+
+        void clear();
+
+        /// @return the index of the new point
+        std::size_t addPoint(const Point& point);
+
+        std::size_t getNumPoints() const { return mPoints.size(); }
+
+        /// Find the neighbours of all points.
+        /// @param workQueue Queue to split the points over, or NULL to search on the calling thread.
+        /// @param numItems Number of work items to split the points into.
+        /// @note Waits until all work items are done.
+        void run(SceneUtil::WorkQueue* workQueue, int numItems);
+
+        /// Find the neighbours of the points in [begin, end). Can run concurrently for disjoint ranges.
+        void findNeighbours(std::size_t begin, std::size_t end);
+
+        /// Indices of the neighbours of the point \a index, nearest first. Neighbours at the same distance are
+        /// ordered by index.
+        const std::vector<std::size_t>& getNeighbours(std::size_t index) const { return mNeighbours[index]; }
+
+    private:
+        std::vector<Point> mPoints;
+        std::vector<std::vector<std::size_t> > mNeighbours;
+    };
+
+}
+
+#endif
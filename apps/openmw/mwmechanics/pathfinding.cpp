@@ -191,10 +191,19 @@ namespace MWMechanics
         }
 
         // Refer to AiWander reseach topic on openmw forums for some background.
-        // Maybe there is no pathgrid for this cell.  Just go to destination and let
-        // physics take care of any blockages.
+        // Maybe there is no pathgrid for this cell.  Use the navigation mesh if
+        // it has been built, otherwise just go to destination and let physics
+        // take care of any blockages.
         if(!mPathgrid || mPathgrid->mPoints.empty())
         {
+            std::vector<osg::Vec3f> navMeshPath;
+            if (MWBase::Environment::get().getWorld()->findNavMeshPath(mCell, MakeOsgVec3(startPoint), MakeOsgVec3(endPoint), navMeshPath))
+            {
+                for (std::vector<osg::Vec3f>::const_iterator it = navMeshPath.begin(); it != navMeshPath.end(); ++it)
+                    mPath.push_back(MakePathgridPoint(*it));
+                return;
+            }
+
             mPath.push_back(endPoint);
             return;
         }
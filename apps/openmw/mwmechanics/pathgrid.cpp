@@ -1,10 +1,12 @@
 #include "pathgrid.hpp"
 
-#include "../mwbase/world.hpp"
-#include "../mwbase/environment.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
 
-#include "../mwworld/cellstore.hpp"
-#include "../mwworld/esmstore.hpp"
+#include <components/esm/loadcell.hpp>
+#include <components/misc/profiler.hpp>
 
 namespace
 {
@@ -49,6 +51,63 @@ namespace
 
 namespace MWMechanics
 {
+    PathgridNextHops::PathgridNextHops(const ESM::Pathgrid &pathgrid)
+        : mPathgrid(pathgrid)
+        , mNumPoints(static_cast<int>(pathgrid.mPoints.size()))
+    {
+    }
+
+    /*
+     * Runs Dijkstra's algorithm from every point, with the same edge costs as
+     * aStarSearch.  Each point reached inherits the first hop of the point it
+     * was reached from, so one search fills a whole row of the table.
+     */
+    void PathgridNextHops::doWork()
+    {
+        OPENMW_PROFILE_ZONE("PathgridNextHops::doWork");
+
+        std::vector<std::vector<std::pair<int, float> > > edges (mNumPoints);
+        for (std::size_t i = 0; i < mPathgrid.mEdges.size(); ++i)
+        {
+            const ESM::Pathgrid::Edge& edge = mPathgrid.mEdges[i];
+            edges[edge.mV0].push_back(std::make_pair(edge.mV1,
+                    costAStar(mPathgrid.mPoints[edge.mV0], mPathgrid.mPoints[edge.mV1])));
+        }
+
+        mNextHops.assign(mNumPoints * mNumPoints, -1);
+
+        typedef std::pair<float, int> Entry; // cost so far, point index
+        std::vector<float> cost (mNumPoints);
+        for (int source = 0; source < mNumPoints; ++source)
+        {
+            short* nextHops = &mNextHops[source * mNumPoints];
+            std::fill(cost.begin(), cost.end(), -1.f);
+            cost[source] = 0.f;
+            nextHops[source] = static_cast<short>(source);
+
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+            open.push(Entry(0.f, source));
+            while (!open.empty())
+            {
+                Entry current = open.top();
+                open.pop();
+                if (current.first > cost[current.second])
+                    continue; // already reached at a lower cost
+
+                for (std::size_t j = 0; j < edges[current.second].size(); ++j)
+                {
+                    int dest = edges[current.second][j].first;
+                    float tentative = current.first + edges[current.second][j].second;
+                    if (cost[dest] >= 0.f && tentative >= cost[dest])
+                        continue;
+                    cost[dest] = tentative;
+                    nextHops[dest] = current.second == source ? static_cast<short>(dest) : nextHops[current.second];
+                    open.push(Entry(tentative, dest));
+                }
+            }
+        }
+    }
+
     PathgridGraph::PathgridGraph()
         : mCell(NULL)
         , mPathgrid(NULL)
@@ -60,6 +119,36 @@ namespace MWMechanics
     {
     }
 
+    PathgridGraph::PathgridGraph(const PathgridGraph& graph)
+    {
+        copyGraph(graph);
+    }
+
+    PathgridGraph& PathgridGraph::operator=(const PathgridGraph& graph)
+    {
+        if (this != &graph)
+        {
+            mPathCache.clear();
+            mPathCacheIndex.clear();
+            copyGraph(graph);
+        }
+        return *this;
+    }
+
+    void PathgridGraph::copyGraph(const PathgridGraph& graph)
+    {
+        mCell = graph.mCell;
+        mPathgrid = graph.mPathgrid;
+        mIsExterior = graph.mIsExterior;
+        mGraph = graph.mGraph;
+        mIsGraphConstructed = graph.mIsGraphConstructed;
+        mSCCId = graph.mSCCId;
+        mSCCIndex = graph.mSCCIndex;
+        mSCCStack = graph.mSCCStack;
+        mSCCPoint = graph.mSCCPoint;
+        mNextHops = graph.mNextHops;
+    }
+
     /*
      * mGraph is populated with the cost of each allowed edge.
      *
@@ -96,7 +185,7 @@ namespace MWMechanics
      *    +---------------->
      *      high cost
      */
-    bool PathgridGraph::load(const MWWorld::CellStore *cell)
+    bool PathgridGraph::load(const ESM::Cell *cell, const ESM::Pathgrid *pathgrid)
     {
         if(!cell)
             return false;
@@ -104,9 +193,9 @@ namespace MWMechanics
         if(mIsGraphConstructed)
             return true;
 
-        mCell = cell->getCell();
-        mIsExterior = cell->getCell()->isExterior();
-        mPathgrid = MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*cell->getCell());
+        mCell = cell;
+        mIsExterior = cell->isExterior();
+        mPathgrid = pathgrid;
         if(!mPathgrid)
             return false;
 
@@ -209,6 +298,18 @@ namespace MWMechanics
         }
     }
 
+    void PathgridGraph::prepareNextHops(const ESM::Pathgrid *pathgrid, SceneUtil::WorkQueue *workQueue)
+    {
+        if (mNextHops || !workQueue)
+            return;
+
+        if (!pathgrid || pathgrid->mPoints.size() < 2 || static_cast<int>(pathgrid->mPoints.size()) > PathgridNextHops::sMaxPoints)
+            return;
+
+        mNextHops = new PathgridNextHops(*pathgrid);
+        workQueue->addWorkItem(mNextHops);
+    }
+
     bool PathgridGraph::isPointConnected(const int start, const int end) const
     {
         return (mGraph[start].componentId == mGraph[end].componentId);
@@ -236,20 +337,33 @@ namespace MWMechanics
      *   gScore - past accumulated costs vector indexed by point index
      *   fScore - future estimated costs vector indexed by point index
      *
-     * TODO: An intersting exercise might be to cache the paths created for a
-     *       start/goal pair.  To cache the results the paths need to be in
-     *       pathgrid points form (currently they are converted to world
-     *       co-ordinates).  Essentially trading speed w/ memory.
+     * The paths are cached per start/goal pair, in pathgrid points form.  Small
+     * pathgrids get a next-hop table built on a worker thread instead, see
+     * prepareNextHops().
      */
     std::list<ESM::Pathgrid::Point> PathgridGraph::aStarSearch(const int start,
                                                                const int goal) const
     {
+        OPENMW_PROFILE_ZONE("PathgridGraph::aStarSearch");
+
         std::list<ESM::Pathgrid::Point> path;
         if(!isPointConnected(start, goal))
         {
             return path; // there is no path, return an empty path
         }
 
+        if(mNextHops && mNextHops->isDone())
+            return walkNextHops(start, goal);
+
+        PathKey key (start, goal);
+        std::map<PathKey, PathCache::iterator>::iterator found = mPathCacheIndex.find(key);
+        if(found != mPathCacheIndex.end())
+        {
+            // move to the front, it's the most recently used now
+            mPathCache.splice(mPathCache.begin(), mPathCache, found->second);
+            return found->second->second;
+        }
+
         int graphSize = static_cast<int> (mGraph.size());
         std::vector<float> gScore (graphSize, -1);
         std::vector<float> fScore (graphSize, -1);
@@ -321,6 +435,35 @@ namespace MWMechanics
 
         // add first node to path explicitly
         path.push_front(mPathgrid->mPoints[start]);
+
+        if(mPathCache.size() >= sMaxCachedPaths)
+        {
+            mPathCacheIndex.erase(mPathCache.back().first);
+            mPathCache.pop_back();
+        }
+        mPathCache.push_front(std::make_pair(key, path));
+        mPathCacheIndex[key] = mPathCache.begin();
+
+        return path;
+    }
+
+    bool PathgridGraph::isPathCached(const int start, const int end) const
+    {
+        return mPathCacheIndex.find(PathKey(start, end)) != mPathCacheIndex.end();
+    }
+
+    std::list<ESM::Pathgrid::Point> PathgridGraph::walkNextHops(const int start, const int goal) const
+    {
+        std::list<ESM::Pathgrid::Point> path;
+        int current = start;
+        path.push_back(mPathgrid->mPoints[current]);
+        while(current != goal)
+        {
+            current = mNextHops->getNextHop(current, goal);
+            if(current == -1)
+                return std::list<ESM::Pathgrid::Point>(); // not reachable after all
+            path.push_back(mPathgrid->mPoints[current]);
+        }
         return path;
     }
 }
@@ -2,26 +2,64 @@
 #define GAME_MWMECHANICS_PATHGRID_H
 
 #include <components/esm/loadpgrd.hpp>
+#include <components/sceneutil/workqueue.hpp>
 #include <list>
+#include <map>
+#include <utility>
 
 namespace ESM
 {
     struct Cell;
 }
 
-namespace MWWorld
-{
-    class CellStore;
-}
-
 namespace MWMechanics
 {
+    /// @brief The next point on the shortest path between every pair of points of a pathgrid.
+    /// @par Built as a work item, since it takes a shortest path search from every point. Only reads the
+    /// pathgrid record, which does not change while the game runs.
+    class PathgridNextHops : public SceneUtil::WorkItem
+    {
+        public:
+            /// The table has an entry for each pair of points, so it is only worth it for small grids
+            static const int sMaxPoints = 256;
+
+            PathgridNextHops(const ESM::Pathgrid& pathgrid);
+
+            virtual void doWork();
+
+            /// @return the point after \a current on the way to \a goal, or -1 if \a goal can not be reached
+            /// @note Only valid once isDone()
+            int getNextHop(int current, int goal) const
+            {
+                return mNextHops[current * mNumPoints + goal];
+            }
+
+        private:
+            const ESM::Pathgrid& mPathgrid;
+            int mNumPoints;
+            std::vector<short> mNextHops;
+    };
+
     class PathgridGraph
     {
         public:
             PathgridGraph();
 
-            bool load(const MWWorld::CellStore *cell);
+            /// The copy shares the next-hop table but starts with an empty path cache, since the cache
+            /// index points into the cache it belongs to.
+            PathgridGraph(const PathgridGraph& graph);
+            PathgridGraph& operator=(const PathgridGraph& graph);
+
+            /// The number of paths searched with A* that are kept
+            static const std::size_t sMaxCachedPaths = 64;
+
+            /// @param pathgrid The pathgrid of \a cell, may be NULL if it has none
+            bool load(const ESM::Cell *cell, const ESM::Pathgrid *pathgrid);
+
+            /// Queue building the next-hop table for a small pathgrid, if not done yet. Until it is built,
+            /// paths are searched with A*.
+            /// @note May be called before load().
+            void prepareNextHops(const ESM::Pathgrid *pathgrid, SceneUtil::WorkQueue* workQueue);
 
             // returns true if end point is strongly connected (i.e. reachable
             // from start point) both start and end are pathgrid point indexes
@@ -32,9 +70,18 @@ namespace MWMechanics
             // cells) co-ordinates
             //
             // NOTE: if start equals end an empty path is returned
+            //
+            // Walks the next-hop table if it is built, otherwise recently
+            // searched paths are returned from a cache
             std::list<ESM::Pathgrid::Point> aStarSearch(const int start,
                                                         const int end) const;
+
+            bool isPathCached(const int start, const int end) const;
+
         private:
+            void copyGraph(const PathgridGraph& graph);
+
+            std::list<ESM::Pathgrid::Point> walkNextHops(const int start, const int end) const;
 
             const ESM::Cell *mCell;
             const ESM::Pathgrid *mPathgrid;
@@ -73,6 +120,14 @@ namespace MWMechanics
             // methods used to calculate connected components
             void recursiveStrongConnect(int v);
             void buildConnectedPoints();
+
+            osg::ref_ptr<PathgridNextHops> mNextHops;
+
+            // the most recently searched paths, least recently used at the back
+            typedef std::pair<int, int> PathKey; // start and end point index
+            typedef std::list<std::pair<PathKey, std::list<ESM::Pathgrid::Point> > > PathCache;
+            mutable PathCache mPathCache;
+            mutable std::map<PathKey, PathCache::iterator> mPathCacheIndex;
     };
 }
 
@@ -2,6 +2,8 @@
 
 #include <cstdlib>
 
+#include <OpenThreads/Atomic>
+
 #include <components/esm/loadspel.hpp>
 #include <components/esm/spellstate.hpp>
 #include <components/misc/rng.hpp>
@@ -13,8 +15,29 @@
 
 #include "magiceffects.hpp"
 
+namespace
+{
+    // atomic, the Spells of actors in preloaded cells are constructed on the preload threads
+    OpenThreads::Atomic sLastStateId;
+}
+
 namespace MWMechanics
 {
+    Spells::Spells()
+        : mStateId(static_cast<int>(++sLastStateId))
+    {
+    }
+
+    void Spells::flagAsModified()
+    {
+        mStateId = static_cast<int>(++sLastStateId);
+    }
+
+    int Spells::getStateId() const
+    {
+        return mStateId;
+    }
+
     Spells::TIterator Spells::begin() const
     {
         return mSpells.begin();
@@ -67,6 +90,7 @@ namespace MWMechanics
             }
 
             mSpells.insert (std::make_pair (spell, random));
+            flagAsModified();
         }
     }
 
@@ -102,7 +126,10 @@ namespace MWMechanics
         }
 
         if (iter!=mSpells.end())
+        {
             mSpells.erase (iter);
+            flagAsModified();
+        }
 
         if (spellId==mSelectedSpell)
             mSelectedSpell.clear();
@@ -145,6 +172,7 @@ namespace MWMechanics
     void Spells::clear()
     {
         mSpells.clear();
+        flagAsModified();
     }
 
     void Spells::setSelectedSpell (const std::string& spellId)
@@ -204,6 +232,7 @@ namespace MWMechanics
             else
                 ++iter;
         }
+        flagAsModified();
     }
 
     void Spells::purgeBlightDisease()
@@ -216,6 +245,7 @@ namespace MWMechanics
             else
                 ++iter;
         }
+        flagAsModified();
     }
 
     void Spells::purgeCorprusDisease()
@@ -228,6 +258,7 @@ namespace MWMechanics
             else
                 ++iter;
         }
+        flagAsModified();
     }
 
     void Spells::purgeCurses()
@@ -240,6 +271,7 @@ namespace MWMechanics
             else
                 ++iter;
         }
+        flagAsModified();
     }
 
     void Spells::visitEffectSources(EffectSourceVisitor &visitor) const
@@ -326,6 +358,8 @@ namespace MWMechanics
 
     void Spells::readState(const ESM::SpellState &state)
     {
+        flagAsModified();
+
         for (ESM::SpellState::TContainer::const_iterator it = state.mSpells.begin(); it != state.mSpells.end(); ++it)
         {
             // Discard spells that are no longer available due to changed content files
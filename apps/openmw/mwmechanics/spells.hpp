@@ -58,11 +58,17 @@ namespace MWMechanics
 
             std::map<SpellKey, CorprusStats> mCorprusSpells;
 
+            int mStateId;
+
             /// Get spell from ID, throws exception if not found
             const ESM::Spell* getSpell(const std::string& id) const;
 
+            void flagAsModified();
+
         public:
 
+            Spells();
+
             void worsenCorprus(const ESM::Spell* spell);
             static bool hasCorprusEffect(const ESM::Spell *spell);
             const std::map<SpellKey, CorprusStats> & getCorprusSpells() const;
@@ -115,6 +121,10 @@ namespace MWMechanics
 
             void readState (const ESM::SpellState& state);
             void writeState (ESM::SpellState& state) const;
+
+            int getStateId() const;
+            ///< Changes whenever spells are added or removed. A new state never repeats an earlier state of any
+            /// spell list, but a copy of a spell list starts out with the same state.
     };
 }
 
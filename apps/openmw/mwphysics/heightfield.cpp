@@ -0,0 +1,108 @@
+#include "heightfield.hpp"
+
+#include <sstream>
+
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+
+#include <components/esm/loadland.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/resource/objectcache.hpp>
+
+namespace MWPhysics
+{
+
+    HeightFieldShape::HeightFieldShape()
+        : mTriSize(0.f)
+        , mSqrtVerts(0)
+        , mMinHeight(0.f)
+        , mMaxHeight(0.f)
+        , mShape(NULL)
+    {
+    }
+
+    HeightFieldShape::HeightFieldShape(const HeightFieldShape &copy, const osg::CopyOp &copyop)
+        : osg::Object(copy, copyop)
+        , mHeights(copy.mHeights)
+        , mTriSize(copy.mTriSize)
+        , mSqrtVerts(copy.mSqrtVerts)
+        , mMinHeight(0.f)
+        , mMaxHeight(0.f)
+        , mShape(NULL)
+    {
+        if (!mHeights.empty())
+            build();
+    }
+
+    HeightFieldShape::HeightFieldShape(const float *heights, float triSize, int sqrtVerts)
+        : mHeights(heights, heights + sqrtVerts*sqrtVerts)
+        , mTriSize(triSize)
+        , mSqrtVerts(sqrtVerts)
+        , mMinHeight(0.f)
+        , mMaxHeight(0.f)
+        , mShape(NULL)
+    {
+        build();
+    }
+
+    HeightFieldShape::~HeightFieldShape()
+    {
+        delete mShape;
+    }
+
+    void HeightFieldShape::build()
+    {
+        // find the minimum and maximum heights (needed for bullet)
+        mMinHeight = mHeights[0];
+        mMaxHeight = mHeights[0];
+        for (std::size_t i = 1; i < mHeights.size(); ++i)
+        {
+            float h = mHeights[i];
+            if (h > mMaxHeight) mMaxHeight = h;
+            if (h < mMinHeight) mMinHeight = h;
+        }
+
+        mShape = new btHeightfieldTerrainShape(
+            mSqrtVerts, mSqrtVerts, &mHeights[0], 1,
+            mMinHeight, mMaxHeight, 2,
+            PHY_FLOAT, true
+        );
+        mShape->setUseDiamondSubdivision(true);
+        mShape->setLocalScaling(btVector3(mTriSize, mTriSize, 1));
+    }
+
+    HeightFieldManager::HeightFieldManager()
+        : ResourceManager(NULL)
+    {
+    }
+
+    osg::ref_ptr<HeightFieldShape> HeightFieldManager::getShape(int x, int y, const ESM::Land *land)
+    {
+        std::ostringstream stream;
+        stream << x << " " << y;
+        const std::string key = stream.str();
+
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(key);
+        if (obj)
+            return osg::ref_ptr<HeightFieldShape>(static_cast<HeightFieldShape*>(obj.get()));
+
+        if (!land || !(land->mDataTypes&ESM::Land::DATA_VHGT))
+            return osg::ref_ptr<HeightFieldShape>();
+
+        OPENMW_PROFILE_ZONE("HeightFieldManager::getShape");
+
+        // Actually only VHGT is needed here, but the rest is needed for rendering anyway.
+        // Load everything now to reduce IO overhead.
+        const int flags = ESM::Land::DATA_VCLR|ESM::Land::DATA_VHGT|ESM::Land::DATA_VNML|ESM::Land::DATA_VTEX;
+        const ESM::Land::LandData* data = land->getLandData(flags);
+        if (!data)
+            return osg::ref_ptr<HeightFieldShape>();
+
+        const float verts = ESM::Land::LAND_SIZE;
+        const float worldsize = ESM::Land::REAL_SIZE;
+        osg::ref_ptr<HeightFieldShape> shape (new HeightFieldShape(data->mHeights, worldsize / (verts-1), ESM::Land::LAND_SIZE));
+
+        mCache->addEntryToObjectCache(key, shape.get());
+        return shape;
+    }
+
+}
@@ -0,0 +1,68 @@
+#ifndef OPENMW_MWPHYSICS_HEIGHTFIELD_H
+#define OPENMW_MWPHYSICS_HEIGHTFIELD_H
+
+#include <vector>
+
+#include <osg/Object>
+#include <osg/ref_ptr>
+
+#include <components/resource/resourcemanager.hpp>
+
+class btHeightfieldTerrainShape;
+
+namespace ESM
+{
+    struct Land;
+}
+
+namespace MWPhysics
+{
+
+    /// The collision shape of an exterior cell's terrain, with its own copy of the heights.
+    class HeightFieldShape : public osg::Object
+    {
+    public:
+        HeightFieldShape();
+        HeightFieldShape(const HeightFieldShape& copy, const osg::CopyOp& copyop);
+        HeightFieldShape(const float* heights, float triSize, int sqrtVerts);
+
+        META_Object(MWPhysics, HeightFieldShape)
+
+        btHeightfieldTerrainShape* getShape() { return mShape; }
+
+        float getMinHeight() const { return mMinHeight; }
+        float getMaxHeight() const { return mMaxHeight; }
+
+        float getTriSize() const { return mTriSize; }
+        int getSqrtVerts() const { return mSqrtVerts; }
+
+    protected:
+        virtual ~HeightFieldShape();
+
+    private:
+        void build();
+
+        std::vector<float> mHeights;
+        float mTriSize;
+        int mSqrtVerts;
+        float mMinHeight;
+        float mMaxHeight;
+        btHeightfieldTerrainShape* mShape;
+    };
+
+    /// Builds and caches the terrain collision shapes of exterior cells, so a cell that is loaded again, or was
+    /// preloaded, does not build its shape on the main thread.
+    /// @note May be used from any thread.
+    class HeightFieldManager : public Resource::ResourceManager
+    {
+    public:
+        HeightFieldManager();
+
+        /// Return the shape of cell \a x, \a y, building it from \a land if it is not in cache.
+        /// @note May return a null pointer if the land has no heights.
+        osg::ref_ptr<HeightFieldShape> getShape(int x, int y, const ESM::Land* land);
+    };
+
+}
+
+#endif
@@ -9,18 +9,25 @@
 #include <BulletCollision/CollisionShapes/btSphereShape.h>
 #include <BulletCollision/CollisionShapes/btStaticPlaneShape.h>
 #include <BulletCollision/CollisionShapes/btCompoundShape.h>
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btConcaveShape.h>
+#include <BulletCollision/CollisionShapes/btTriangleCallback.h>
 #include <BulletCollision/CollisionDispatch/btCollisionObject.h>
 #include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
 #include <BulletCollision/CollisionDispatch/btDefaultCollisionConfiguration.h>
 #include <BulletCollision/CollisionDispatch/btCollisionWorld.h>
 #include <BulletCollision/BroadphaseCollision/btDbvtBroadphase.h>
 #include <LinearMath/btQuickprof.h>
+#include <LinearMath/btScalar.h>
 
 #include <components/nifbullet/bulletnifloader.hpp>
 #include <components/resource/resourcesystem.hpp>
 #include <components/resource/bulletshapemanager.hpp>
 
 #include <components/esm/loadgmst.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/navmesh/tile.hpp>
+#include <components/settings/settings.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
 
@@ -45,6 +52,7 @@
 
 #include "collisiontype.hpp"
 #include "actor.hpp"
+#include "heightfield.hpp"
 #include "convert.hpp"
 #include "trace.h"
 
@@ -463,47 +471,34 @@ namespace MWPhysics
     class HeightField
     {
     public:
-        HeightField(const float* heights, int x, int y, float triSize, float sqrtVerts)
+        HeightField(osg::ref_ptr<HeightFieldShape> shape, int x, int y)
+            : mShape(shape)
         {
-            // find the minimum and maximum heights (needed for bullet)
-            float minh = heights[0];
-            float maxh = heights[0];
-            for(int i = 1;i < sqrtVerts*sqrtVerts;++i)
-            {
-                float h = heights[i];
-                if(h > maxh) maxh = h;
-                if(h < minh) minh = h;
-            }
-
-            mShape = new btHeightfieldTerrainShape(
-                sqrtVerts, sqrtVerts, heights, 1,
-                minh, maxh, 2,
-                PHY_FLOAT, true
-            );
-            mShape->setUseDiamondSubdivision(true);
-            mShape->setLocalScaling(btVector3(triSize, triSize, 1));
-
+            float cellSize = shape->getTriSize() * (shape->getSqrtVerts()-1);
             btTransform transform(btQuaternion::getIdentity(),
-                                  btVector3((x+0.5f) * triSize * (sqrtVerts-1),
-                                            (y+0.5f) * triSize * (sqrtVerts-1),
-                                            (maxh+minh)*0.5f));
+                                  btVector3((x+0.5f) * cellSize,
+                                            (y+0.5f) * cellSize,
+                                            (shape->getMaxHeight()+shape->getMinHeight())*0.5f));
 
             mCollisionObject = new btCollisionObject;
-            mCollisionObject->setCollisionShape(mShape);
+            mCollisionObject->setCollisionShape(shape->getShape());
             mCollisionObject->setWorldTransform(transform);
         }
         ~HeightField()
         {
             delete mCollisionObject;
-            delete mShape;
         }
         btCollisionObject* getCollisionObject()
         {
             return mCollisionObject;
         }
+        osg::ref_ptr<HeightFieldShape> getShape()
+        {
+            return mShape;
+        }
 
     private:
-        btHeightfieldTerrainShape* mShape;
+        osg::ref_ptr<HeightFieldShape> mShape;
         btCollisionObject* mCollisionObject;
 
         void operator=(const HeightField&);
@@ -521,10 +516,9 @@ namespace MWPhysics
         {
             mPtr = ptr;
 
-            mCollisionObject.reset(new btCollisionObject);
-            mCollisionObject->setCollisionShape(shapeInstance->getCollisionShape());
+            mCollisionObject.setCollisionShape(shapeInstance->getCollisionShape());
 
-            mCollisionObject->setUserPointer(static_cast<PtrHolder*>(this));
+            mCollisionObject.setUserPointer(static_cast<PtrHolder*>(this));
 
             setScale(ptr.getCellRef().getScale());
             setRotation(toBullet(ptr.getRefData().getBaseNode()->getAttitude()));
@@ -544,17 +538,17 @@ namespace MWPhysics
 
         void setRotation(const btQuaternion& quat)
         {
-            mCollisionObject->getWorldTransform().setRotation(quat);
+            mCollisionObject.getWorldTransform().setRotation(quat);
         }
 
         void setOrigin(const btVector3& vec)
         {
-            mCollisionObject->getWorldTransform().setOrigin(vec);
+            mCollisionObject.getWorldTransform().setOrigin(vec);
         }
 
         btCollisionObject* getCollisionObject()
         {
-            return mCollisionObject.get();
+            return &mCollisionObject;
         }
 
         /// Return solid flag. Not used by the object itself, true by default.
@@ -631,20 +625,72 @@ namespace MWPhysics
                 ++it;
             }
 
-            collisionWorld->updateSingleAabb(mCollisionObject.get());
+            collisionWorld->updateSingleAabb(&mCollisionObject);
         }
 
     private:
-        std::auto_ptr<btCollisionObject> mCollisionObject;
+        btCollisionObject mCollisionObject;
         osg::ref_ptr<Resource::BulletShapeInstance> mShapeInstance;
         bool mSolid;
     };
 
     // ---------------------------------------------------------------
 
+    /// @brief Memory for Objects, allocated in chunks and reused after objects are removed.
+    /// @par Loading a cell adds hundreds of collision objects at once, and unloading removes them again. With the pool
+    /// this does not allocate and free each of them separately, and the objects of a cell end up close in memory.
+    class ObjectPool
+    {
+    public:
+        ObjectPool()
+            : mSlotSize((sizeof(Object) + sAlignment - 1) / sAlignment * sAlignment)
+        {
+        }
+
+        ~ObjectPool()
+        {
+            for (std::vector<char*>::iterator it = mChunks.begin(); it != mChunks.end(); ++it)
+                btAlignedFree(*it);
+        }
+
+        Object* create(const MWWorld::Ptr& ptr, osg::ref_ptr<Resource::BulletShapeInstance> shapeInstance)
+        {
+            if (mFree.empty())
+            {
+                char* chunk = static_cast<char*>(btAlignedAlloc(mSlotSize * sChunkSize, sAlignment));
+                mChunks.push_back(chunk);
+                for (std::size_t i=sChunkSize; i>0; --i)
+                    mFree.push_back(chunk + (i-1) * mSlotSize);
+            }
+
+            void* memory = mFree.back();
+            mFree.pop_back();
+            return new (memory) Object(ptr, shapeInstance);
+        }
+
+        void destroy(Object* object)
+        {
+            object->~Object();
+            mFree.push_back(object);
+        }
+
+    private:
+        // btCollisionObject needs 16 byte alignment for its SIMD transform
+        static const std::size_t sAlignment = 16;
+        static const std::size_t sChunkSize = 256;
+
+        std::size_t mSlotSize;
+        std::vector<char*> mChunks;
+        std::vector<void*> mFree;
+    };
+
     PhysicsSystem::PhysicsSystem(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> parentNode)
         : mShapeManager(new Resource::BulletShapeManager(resourceSystem->getVFS(), resourceSystem->getSceneManager(), resourceSystem->getNifFileManager()))
+        , mHeightFieldManager(new HeightFieldManager)
         , mResourceSystem(resourceSystem)
+        , mObjectPool(new ObjectPool)
+        , mBatchingObjects(false)
+        , mBroadphaseOptimizeThreshold(Settings::Manager::getInt("collision rebalance threshold", "Cells"))
         , mDebugDrawEnabled(false)
         , mTimeAccum(0.0f)
         , mWaterHeight(0)
@@ -652,6 +698,7 @@ namespace MWPhysics
         , mParentNode(parentNode)
     {
         mResourceSystem->addResourceManager(mShapeManager.get());
+        mResourceSystem->addResourceManager(mHeightFieldManager.get());
 
         mCollisionConfiguration = new btDefaultCollisionConfiguration();
         mDispatcher = new btCollisionDispatcher(mCollisionConfiguration);
@@ -667,6 +714,7 @@ namespace MWPhysics
     PhysicsSystem::~PhysicsSystem()
     {
         mResourceSystem->removeResourceManager(mShapeManager.get());
+        mResourceSystem->removeResourceManager(mHeightFieldManager.get());
 
         if (mWaterCollisionObject.get())
             mCollisionWorld->removeCollisionObject(mWaterCollisionObject.get());
@@ -677,10 +725,12 @@ namespace MWPhysics
             delete it->second;
         }
 
+        mObjectBatch.clear();
+
         for (ObjectMap::iterator it = mObjects.begin(); it != mObjects.end(); ++it)
         {
             mCollisionWorld->removeCollisionObject(it->second->getCollisionObject());
-            delete it->second;
+            mObjectPool->destroy(it->second);
         }
 
         for (ActorMap::iterator it = mActors.begin(); it != mActors.end(); ++it)
@@ -704,6 +754,11 @@ namespace MWPhysics
         return mShapeManager.get();
     }
 
+    HeightFieldManager *PhysicsSystem::getHeightFieldManager()
+    {
+        return mHeightFieldManager.get();
+    }
+
     bool PhysicsSystem::toggleDebugRendering()
     {
         mDebugDrawEnabled = !mDebugDrawEnabled;
@@ -748,6 +803,104 @@ namespace MWPhysics
         return true;
     }
 
+    class NavMeshTriangleCollector : public btTriangleCallback
+    {
+    public:
+        NavMeshTriangleCollector(const btTransform& transform, NavMesh::Geometry& geometry)
+            : mTransform(transform)
+            , mGeometry(geometry)
+        {
+        }
+
+        virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+        {
+            mGeometry.addTriangle(toOsg(mTransform * triangle[0]), toOsg(mTransform * triangle[1]), toOsg(mTransform * triangle[2]));
+        }
+
+    private:
+        const btTransform& mTransform;
+        NavMesh::Geometry& mGeometry;
+    };
+
+    static void collectNavMeshTriangles(const btCollisionShape* shape, const btTransform& transform, NavMesh::Geometry& geometry)
+    {
+        if (shape->isCompound())
+        {
+            const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+            for (int i=0; i<compound->getNumChildShapes(); ++i)
+                collectNavMeshTriangles(compound->getChildShape(i), transform * compound->getChildTransform(i), geometry);
+        }
+        else if (shape->isConcave())
+        {
+            // triangle meshes and heightfields
+            NavMeshTriangleCollector collector(transform, geometry);
+            btVector3 aabbMax(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+            static_cast<const btConcaveShape*>(shape)->processAllTriangles(&collector, -aabbMax, aabbMax);
+        }
+        else if (shape->getShapeType() == BOX_SHAPE_PROXYTYPE)
+        {
+            const btBoxShape* box = static_cast<const btBoxShape*>(shape);
+            btVector3 corners[8];
+            for (int i=0; i<8; ++i)
+            {
+                box->getVertex(i, corners[i]);
+                corners[i] = transform * corners[i];
+            }
+
+            // getVertex numbers the corners by the bits of their x, y and z sign
+            static const int faces[6][4] = { {0,1,3,2}, {4,5,7,6}, {0,1,5,4}, {2,3,7,6}, {0,2,6,4}, {1,3,7,5} };
+            for (int i=0; i<6; ++i)
+            {
+                geometry.addTriangle(toOsg(corners[faces[i][0]]), toOsg(corners[faces[i][1]]), toOsg(corners[faces[i][2]]));
+                geometry.addTriangle(toOsg(corners[faces[i][0]]), toOsg(corners[faces[i][2]]), toOsg(corners[faces[i][3]]));
+            }
+        }
+        // other shapes are only used for actors and projectiles
+    }
+
+    static void addNavMeshShape(const osg::Referenced* owner, const btCollisionObject* collisionObject, const osg::BoundingBox& bounds,
+                                NavMeshShapeList& shapes)
+    {
+        const btCollisionShape* shape = collisionObject->getCollisionShape();
+        const btTransform& transform = collisionObject->getWorldTransform();
+
+        btVector3 aabbMin, aabbMax;
+        shape->getAabb(transform, aabbMin, aabbMax);
+        if (bounds.valid() && (aabbMax.x() < bounds.xMin() || aabbMin.x() > bounds.xMax()
+                || aabbMax.y() < bounds.yMin() || aabbMin.y() > bounds.yMax()))
+            return;
+
+        NavMeshShape navMeshShape;
+        navMeshShape.mOwner = owner;
+        navMeshShape.mShape = shape;
+        navMeshShape.mPosition = toOsg(transform.getOrigin());
+        navMeshShape.mRotation = toOsg(transform.getRotation());
+        navMeshShape.mBounds = osg::BoundingBox(toOsg(aabbMin), toOsg(aabbMax));
+        shapes.push_back(navMeshShape);
+    }
+
+    void PhysicsSystem::getNavMeshShapes(const osg::BoundingBox &bounds, NavMeshShapeList &shapes) const
+    {
+        for (HeightFieldMap::const_iterator it = mHeightFields.begin(); it != mHeightFields.end(); ++it)
+            addNavMeshShape(it->second->getShape().get(), it->second->getCollisionObject(), bounds, shapes);
+        for (ObjectMap::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+        {
+            const btCollisionObject* collisionObject = it->second->getCollisionObject();
+            if (it->second->isAnimated() || !collisionObject->getBroadphaseHandle()
+                    || collisionObject->getBroadphaseHandle()->m_collisionFilterGroup != CollisionType_World)
+                continue;
+            addNavMeshShape(it->second->getShapeInstance(), collisionObject, bounds, shapes);
+        }
+    }
+
+    void PhysicsSystem::getNavMeshGeometry(const NavMeshShapeList &shapes, NavMesh::Geometry &geometry)
+    {
+        OPENMW_PROFILE_ZONE("PhysicsSystem::getNavMeshGeometry");
+
+        for (NavMeshShapeList::const_iterator it = shapes.begin(); it != shapes.end(); ++it)
+            collectNavMeshTriangles(it->mShape, btTransform(toBullet(it->mRotation), toBullet(it->mPosition)), geometry);
+    }
+
     class DeepestNotMeContactTestResultCallback : public btCollisionWorld::ContactResultCallback
     {
         const btCollisionObject* mMe;
@@ -1059,9 +1212,14 @@ namespace MWPhysics
             return MovementSolver::traceDown(ptr, found->second, mCollisionWorld, maxHeight);
     }
 
-    void PhysicsSystem::addHeightField (const float* heights, int x, int y, float triSize, float sqrtVerts)
+    void PhysicsSystem::addHeightField (int x, int y, const ESM::Land* land)
     {
-        HeightField *heightfield = new HeightField(heights, x, y, triSize, sqrtVerts);
+        // usually built by a preload work item already
+        osg::ref_ptr<HeightFieldShape> shape = mHeightFieldManager->getShape(x, y, land);
+        if (!shape)
+            return;
+
+        HeightField *heightfield = new HeightField(shape, x, y);
         mHeightFields[std::make_pair(x,y)] = heightfield;
 
         mCollisionWorld->addCollisionObject(heightfield->getCollisionObject(), CollisionType_HeightMap,
@@ -1074,6 +1232,8 @@ namespace MWPhysics
         if(heightfield != mHeightFields.end())
         {
             mCollisionWorld->removeCollisionObject(heightfield->second->getCollisionObject());
+            if (mUnrefQueue.get())
+                mUnrefQueue->push(heightfield->second->getShape().get());
             delete heightfield->second;
             mHeightFields.erase(heightfield);
         }
@@ -1085,16 +1245,71 @@ namespace MWPhysics
         if (!shapeInstance || !shapeInstance->getCollisionShape())
             return;
 
-        Object *obj = new Object(ptr, shapeInstance);
+        Object *obj = mObjectPool->create(ptr, shapeInstance);
         mObjects.insert(std::make_pair(ptr, obj));
 
         if (obj->isAnimated())
             mAnimatedObjects.insert(obj);
 
+        if (mBatchingObjects)
+        {
+            mObjectBatch.push_back(std::make_pair(obj, collisionType));
+            return;
+        }
+
         mCollisionWorld->addCollisionObject(obj->getCollisionObject(), collisionType,
                                            CollisionType_Actor|CollisionType_HeightMap|CollisionType_Projectile);
     }
 
+    void PhysicsSystem::beginObjectBatch()
+    {
+        mBatchingObjects = true;
+    }
+
+    void PhysicsSystem::endObjectBatch()
+    {
+        mBatchingObjects = false;
+        if (mObjectBatch.empty())
+            return;
+
+        OPENMW_PROFILE_ZONE("PhysicsSystem::endObjectBatch");
+
+        btCollisionObjectArray& collisionObjects = mCollisionWorld->getCollisionObjectArray();
+        collisionObjects.reserve(collisionObjects.size() + static_cast<int>(mObjectBatch.size()));
+
+        for (std::vector<std::pair<Object*, int> >::const_iterator it = mObjectBatch.begin(); it != mObjectBatch.end(); ++it)
+            mCollisionWorld->addCollisionObject(it->first->getCollisionObject(), it->second,
+                                               CollisionType_Actor|CollisionType_HeightMap|CollisionType_Projectile);
+
+        // The tree of the broadphase is only rebalanced a little with each insertion. Reinsert as many leaves as were
+        // added, so the collision queries of the following frames don't pay for the objects inserted in a row. Unlike
+        // btDbvtBroadphase::optimize(), which rebuilds the trees of all loaded cells, this is proportional to the batch.
+        // New proxies always go to the dynamic set (m_sets[0]).
+        if (mBroadphaseOptimizeThreshold > 0 && static_cast<int>(mObjectBatch.size()) >= mBroadphaseOptimizeThreshold)
+            mBroadphase->m_sets[0].optimizeIncremental(static_cast<int>(mObjectBatch.size()));
+
+        mObjectBatch.clear();
+    }
+
+    void PhysicsSystem::destroyObject(Object *object)
+    {
+        if (mUnrefQueue.get())
+            mUnrefQueue->push(object->getShapeInstance());
+
+        mAnimatedObjects.erase(object);
+
+        for (std::vector<std::pair<Object*, int> >::iterator it = mObjectBatch.begin(); it != mObjectBatch.end(); ++it)
+        {
+            if (it->first == object)
+            {
+                mObjectBatch.erase(it);
+                break;
+            }
+        }
+
+        mObjectPool->destroy(object);
+    }
+
     void PhysicsSystem::remove(const MWWorld::Ptr &ptr)
     {
         ObjectMap::iterator found = mObjects.find(ptr);
@@ -1102,12 +1317,7 @@ namespace MWPhysics
         {
             mCollisionWorld->removeCollisionObject(found->second->getCollisionObject());
 
-            if (mUnrefQueue.get())
-                mUnrefQueue->push(found->second->getShapeInstance());
-
-            mAnimatedObjects.erase(found->second);
-
-            delete found->second;
+            destroyObject(found->second);
             mObjects.erase(found);
         }
 
@@ -1119,6 +1329,56 @@ namespace MWPhysics
         }
     }
 
+    void PhysicsSystem::removeObjects(const std::vector<MWWorld::Ptr> &ptrs)
+    {
+        OPENMW_PROFILE_ZONE("PhysicsSystem::removeObjects");
+
+#if BT_BULLET_VERSION < 286
+        // btCollisionWorld::removeCollisionObject searches the whole object array for the object it removes. Remove
+        // the proxies first, then compact the array in one pass. Newer Bullet versions remember the array index of
+        // each object instead, and must be left to update it themselves.
+        bool removedAny = false;
+        for (std::vector<MWWorld::Ptr>::const_iterator it = ptrs.begin(); it != ptrs.end(); ++it)
+        {
+            ObjectMap::iterator found = mObjects.find(*it);
+            if (found == mObjects.end())
+            {
+                remove(*it); // actors
+                continue;
+            }
+
+            btCollisionObject* collisionObject = found->second->getCollisionObject();
+            btBroadphaseProxy* proxy = collisionObject->getBroadphaseHandle();
+            if (proxy)
+            {
+                mBroadphase->getOverlappingPairCache()->cleanProxyFromPairs(proxy, mDispatcher);
+                mBroadphase->destroyProxy(proxy, mDispatcher);
+                collisionObject->setBroadphaseHandle(NULL);
+                removedAny = true;
+            }
+
+            destroyObject(found->second);
+            mObjects.erase(found);
+        }
+
+        if (!removedAny)
+            return;
+
+        // every object left in the world has a proxy
+        btCollisionObjectArray& collisionObjects = mCollisionWorld->getCollisionObjectArray();
+        int kept = 0;
+        for (int i=0; i<collisionObjects.size(); ++i)
+        {
+            if (collisionObjects[i]->getBroadphaseHandle())
+                collisionObjects[kept++] = collisionObjects[i];
+        }
+        collisionObjects.resize(kept);
+#else
+        for (std::vector<MWWorld::Ptr>::const_iterator it = ptrs.begin(); it != ptrs.end(); ++it)
+            remove(*it);
+#endif
+    }
+
     void PhysicsSystem::updateCollisionMapPtr(CollisionMap& map, const MWWorld::Ptr &old, const MWWorld::Ptr &updated)
     {
         CollisionMap::iterator found = map.find(old);
@@ -1174,6 +1434,13 @@ namespace MWPhysics
         return NULL;
     }
 
+    void PhysicsSystem::updateObjectAabb(btCollisionObject *collisionObject)
+    {
+        // objects held back by beginObjectBatch() get their bounds when they are added
+        if (collisionObject->getBroadphaseHandle())
+            mCollisionWorld->updateSingleAabb(collisionObject);
+    }
+
     void PhysicsSystem::updateScale(const MWWorld::Ptr &ptr)
     {
         ObjectMap::iterator found = mObjects.find(ptr);
@@ -1181,7 +1448,7 @@ namespace MWPhysics
         {
             float scale = ptr.getCellRef().getScale();
             found->second->setScale(scale);
-            mCollisionWorld->updateSingleAabb(found->second->getCollisionObject());
+            updateObjectAabb(found->second->getCollisionObject());
             return;
         }
         ActorMap::iterator foundActor = mActors.find(ptr);
@@ -1199,7 +1466,7 @@ namespace MWPhysics
         if (found != mObjects.end())
         {
             found->second->setRotation(toBullet(ptr.getRefData().getBaseNode()->getAttitude()));
-            mCollisionWorld->updateSingleAabb(found->second->getCollisionObject());
+            updateObjectAabb(found->second->getCollisionObject());
             return;
         }
         ActorMap::iterator foundActor = mActors.find(ptr);
@@ -1217,7 +1484,7 @@ namespace MWPhysics
         if (found != mObjects.end())
         {
             found->second->setOrigin(toBullet(ptr.getRefData().getPosition().asVec3()));
-            mCollisionWorld->updateSingleAabb(found->second->getCollisionObject());
+            updateObjectAabb(found->second->getCollisionObject());
             return;
         }
         ActorMap::iterator foundActor = mActors.find(ptr);
@@ -1275,6 +1542,7 @@ namespace MWPhysics
 
     const PtrVelocityList& PhysicsSystem::applyQueuedMovement(float dt)
     {
+        OPENMW_PROFILE_ZONE("PhysicsSystem::applyQueuedMovement");
         mMovementResults.clear();
 
         mTimeAccum += dt;
@@ -4,8 +4,11 @@
 #include <memory>
 #include <map>
 #include <set>
+#include <vector>
 
+#include <osg/BoundingBox>
 #include <osg/Quat>
+#include <osg/Referenced>
 #include <osg/ref_ptr>
 
 #include "../mwworld/ptr.hpp"
@@ -33,8 +36,18 @@ namespace SceneUtil
     class UnrefQueue;
 }
 
+namespace ESM
+{
+    struct Land;
+}
+
+namespace NavMesh
+{
+    class Geometry;
+}
+
 class btCollisionWorld;
-class btBroadphaseInterface;
+struct btDbvtBroadphase;
 class btDefaultCollisionConfiguration;
 class btCollisionDispatcher;
 class btCollisionObject;
@@ -44,8 +57,22 @@ namespace MWPhysics
 {
     typedef std::vector<std::pair<MWWorld::Ptr,osg::Vec3f> > PtrVelocityList;
 
+    /// A collision shape to build a navigation mesh from. Holds on to the resource that owns the shape, so it can
+    /// still be triangulated on a worker thread after its object was removed from the physics system.
+    struct NavMeshShape
+    {
+        osg::ref_ptr<const osg::Referenced> mOwner;
+        const btCollisionShape* mShape;
+        osg::Vec3f mPosition;
+        osg::Quat mRotation;
+        osg::BoundingBox mBounds;
+    };
+    typedef std::vector<NavMeshShape> NavMeshShapeList;
+
     class HeightField;
+    class HeightFieldManager;
     class Object;
+    class ObjectPool;
     class Actor;
 
     class PhysicsSystem
@@ -58,6 +85,8 @@ namespace MWPhysics
 
             Resource::BulletShapeManager* getShapeManager();
 
+            HeightFieldManager* getHeightFieldManager();
+
             void enableWater(float height);
             void setWaterHeight(float height);
             void disableWater();
@@ -65,6 +94,14 @@ namespace MWPhysics
             void addObject (const MWWorld::Ptr& ptr, const std::string& mesh, int collisionType = CollisionType_World);
             void addActor (const MWWorld::Ptr& ptr, const std::string& mesh);
 
+            /// Hold back objects added with addObject() until endObjectBatch(), to add all objects of a cell at once.
+            /// @note Collision queries do not see the held back objects. Actors are added right away.
+            void beginObjectBatch();
+
+            /// Add the objects held back since beginObjectBatch() to the collision world, and partially rebalance
+            /// the broadphase if it is enabled and enough objects were added.
+            void endObjectBatch();
+
             void updatePtr (const MWWorld::Ptr& old, const MWWorld::Ptr& updated);
 
             Actor* getActor(const MWWorld::Ptr& ptr);
@@ -73,12 +110,17 @@ namespace MWPhysics
             // Object or Actor
             void remove (const MWWorld::Ptr& ptr);
 
+            /// Remove many objects or actors at once, e.g. when unloading a cell. Faster than remove() for each of them.
+            void removeObjects (const std::vector<MWWorld::Ptr>& ptrs);
+
             void updateScale (const MWWorld::Ptr& ptr);
             void updateRotation (const MWWorld::Ptr& ptr);
             void updatePosition (const MWWorld::Ptr& ptr);
 
 
-            void addHeightField (const float* heights, int x, int y, float triSize, float sqrtVerts);
+            /// Add the terrain collision of exterior cell \a x, \a y, using the shape cached by the HeightFieldManager
+            /// if there is one.
+            void addHeightField (int x, int y, const ESM::Land* land);
 
             void removeHeightField (int x, int y);
 
@@ -164,23 +206,44 @@ namespace MWPhysics
 
             bool isOnSolidGround (const MWWorld::Ptr& actor) const;
 
+            /// Collect the collision shapes of the terrain and the static objects overlapping the horizontal
+            /// extent of \a bounds, or of all of them if \a bounds is not valid. Doors and animated objects are left out.
+            void getNavMeshShapes(const osg::BoundingBox& bounds, NavMeshShapeList& shapes) const;
+
+            /// Add the triangles of \a shapes to \a geometry.
+            /// @note Does not access the physics system, so may be called from any thread.
+            static void getNavMeshGeometry(const NavMeshShapeList& shapes, NavMesh::Geometry& geometry);
+
         private:
 
             void updateWater();
 
+            void updateObjectAabb(btCollisionObject* collisionObject);
+
+            void destroyObject(Object* object);
+
             osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
 
-            btBroadphaseInterface* mBroadphase;
+            btDbvtBroadphase* mBroadphase;
             btDefaultCollisionConfiguration* mCollisionConfiguration;
             btCollisionDispatcher* mDispatcher;
             btCollisionWorld* mCollisionWorld;
 
             std::auto_ptr<Resource::BulletShapeManager> mShapeManager;
+            std::auto_ptr<HeightFieldManager> mHeightFieldManager;
             Resource::ResourceSystem* mResourceSystem;
 
             typedef std::map<MWWorld::ConstPtr, Object*> ObjectMap;
             ObjectMap mObjects;
 
+            std::auto_ptr<ObjectPool> mObjectPool;
+
+            bool mBatchingObjects;
+            // objects held back until endObjectBatch(), with their collision type
+            std::vector<std::pair<Object*, int> > mObjectBatch;
+            // rebalance the broadphase after adding at least this many objects at once, 0 to never rebalance
+            int mBroadphaseOptimizeThreshold;
+
             std::set<Object*> mAnimatedObjects; // stores pointers to elements in mObjects
 
             typedef std::map<MWWorld::ConstPtr, Actor*> ActorMap;
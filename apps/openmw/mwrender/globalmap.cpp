@@ -1,6 +1,16 @@
 #include "globalmap.hpp"
 
+#include <algorithm>
 #include <climits>
+#include <memory>
+#include <stdexcept>
+#include <iostream>
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <OpenThreads/Thread>
 
 #include <osg/Image>
 #include <osg/Texture2D>
@@ -14,6 +24,10 @@
 #include <components/loadinglistener/loadinglistener.hpp>
 #include <components/settings/settings.hpp>
 #include <components/files/memorystream.hpp>
+#include <components/misc/binarycache.hpp>
+#include <components/misc/compression.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include <components/esm/globalmap.hpp>
 
@@ -27,6 +41,142 @@
 namespace
 {
 
+    const char sCacheMagic[4] = { 'O', 'M', 'W', 'G' };
+
+    /// Increase when the layout of the cache file or the colours of the map change.
+    const boost::uint32_t sCacheVersion = 2;
+
+    /// Fill \a ramp with the map colour of every possible WNAM height, indexed by height - SCHAR_MIN.
+    /// SCHAR_MIN (index 0) is also used for cells without land.
+    void createColourRamp (unsigned char ramp[256][3])
+    {
+        for (int i=0; i<256; ++i)
+        {
+            float y = ((i + SCHAR_MIN) << 4) / 2048.f;
+
+            unsigned char r,g,b;
+            if (y < 0)
+            {
+                r = static_cast<unsigned char>(14 * y + 38);
+                g = static_cast<unsigned char>(20 * y + 56);
+                b = static_cast<unsigned char>(18 * y + 51);
+            }
+            else if (y < 0.3f)
+            {
+                if (y < 0.1f)
+                    y *= 8.f;
+                else
+                {
+                    y -= 0.1f;
+                    y += 0.8f;
+                }
+                r = static_cast<unsigned char>(66 - 32 * y);
+                g = static_cast<unsigned char>(48 - 23 * y);
+                b = static_cast<unsigned char>(33 - 16 * y);
+            }
+            else
+            {
+                y -= 0.3f;
+                y *= 1.428f;
+                r = static_cast<unsigned char>(34 - 29 * y);
+                g = static_cast<unsigned char>(25 - 20 * y);
+                b = static_cast<unsigned char>(17 - 12 * y);
+            }
+
+            ramp[i][0] = r;
+            ramp[i][1] = g;
+            ramp[i][2] = b;
+        }
+    }
+
+    /// Rasterizes the cell columns \a firstX to \a lastX of the world map into \a data.
+    class RenderGlobalMapWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        RenderGlobalMapWorkItem(const MWWorld::Store<ESM::Land>& store, int firstX, int lastX, int minX, int minY, int maxY,
+                                int cellSize, int width, const unsigned char (*colourRamp)[3],
+                                const std::vector<int>& vertexIndex, unsigned char* data)
+            : mStore(store)
+            , mFirstX(firstX), mLastX(lastX)
+            , mMinX(minX), mMinY(minY), mMaxY(maxY)
+            , mCellSize(cellSize)
+            , mWidth(width)
+            , mColourRamp(colourRamp)
+            , mVertexIndex(vertexIndex)
+            , mData(data)
+        {
+        }
+
+        virtual void doWork()
+        {
+            // Read into our own buffer rather than the land records, which may be in use by the terrain preloading
+            std::auto_ptr<ESM::Land::LandData> landDataBuffer (new ESM::Land::LandData);
+
+            const int rowStride = mWidth * 3;
+
+            for (int x = mFirstX; x <= mLastX; ++x)
+            {
+                for (int y = mMinY; y <= mMaxY; ++y)
+                {
+                    const ESM::Land* land = mStore.search (x,y);
+
+                    const signed char* wnam = 0;
+                    if (land && (land->mDataTypes & ESM::Land::DATA_WNAM))
+                    {
+                        land->loadData(ESM::Land::DATA_WNAM, *landDataBuffer);
+                        wnam = landDataBuffer->mWnam;
+                    }
+
+                    unsigned char* cellData = mData + (y-mMinY) * mCellSize * rowStride + (x-mMinX) * mCellSize * 3;
+
+                    if (!wnam)
+                    {
+                        // SCHAR_MIN maps to the first ramp entry
+                        for (int cellY=0; cellY<mCellSize; ++cellY)
+                        {
+                            unsigned char* texel = cellData + cellY * rowStride;
+                            for (int cellX=0; cellX<mCellSize; ++cellX, texel += 3)
+                            {
+                                texel[0] = mColourRamp[0][0];
+                                texel[1] = mColourRamp[0][1];
+                                texel[2] = mColourRamp[0][2];
+                            }
+                        }
+                        continue;
+                    }
+
+                    for (int cellY=0; cellY<mCellSize; ++cellY)
+                    {
+                        const signed char* wnamRow = wnam + mVertexIndex[cellY] * 9;
+                        unsigned char* texel = cellData + cellY * rowStride;
+                        for (int cellX=0; cellX<mCellSize; ++cellX, texel += 3)
+                        {
+                            const unsigned char* colour = mColourRamp[wnamRow[mVertexIndex[cellX]] - SCHAR_MIN];
+                            texel[0] = colour[0];
+                            texel[1] = colour[1];
+                            texel[2] = colour[2];
+                        }
+                    }
+                }
+            }
+        }
+
+        int getNumCells() const
+        {
+            return (mLastX-mFirstX+1) * (mMaxY-mMinY+1);
+        }
+
+    private:
+        const MWWorld::Store<ESM::Land>& mStore;
+        int mFirstX, mLastX;
+        int mMinX, mMinY, mMaxY;
+        int mCellSize;
+        int mWidth;
+        const unsigned char (*mColourRamp)[3];
+        const std::vector<int>& mVertexIndex;
+        unsigned char* mData;
+    };
+
     // Create a screen-aligned quad with given texture coordinates.
     // Assumes a top-left origin of the sampled image.
     osg::ref_ptr<osg::Geometry> createTexturedQuad(float leftTexCoord, float topTexCoord, float rightTexCoord, float bottomTexCoord)
@@ -110,8 +260,10 @@ namespace MWRender
     {
     }
 
-    void GlobalMap::render (Loading::Listener* loadingListener)
+    void GlobalMap::render (Loading::Listener* loadingListener, const std::string& cacheFile, const std::string& cacheKey)
     {
+        OPENMW_PROFILE_ZONE("GlobalMap::render");
+
         const MWWorld::ESMStore &esmStore =
             MWBase::Environment::get().getWorld()->getStore();
 
@@ -132,85 +284,51 @@ namespace MWRender
         mWidth = mCellSize*(mMaxX-mMinX+1);
         mHeight = mCellSize*(mMaxY-mMinY+1);
 
-        loadingListener->loadingOn();
-        loadingListener->setLabel("Creating map");
-        loadingListener->setProgressRange((mMaxX-mMinX+1) * (mMaxY-mMinY+1));
-        loadingListener->setProgress(0);
-
-        osg::ref_ptr<osg::Image> image = new osg::Image;
-        image->allocateImage(mWidth, mHeight, 1, GL_RGB, GL_UNSIGNED_BYTE);
-        unsigned char* data = image->data();
-
-        for (int x = mMinX; x <= mMaxX; ++x)
+        osg::ref_ptr<osg::Image> image;
+        bool cached = !cacheFile.empty() && loadCache(cacheFile, cacheKey, image);
+        if (!cached)
         {
-            for (int y = mMinY; y <= mMaxY; ++y)
-            {
-                ESM::Land* land = esmStore.get<ESM::Land>().search (x,y);
+            loadingListener->loadingOn();
+            loadingListener->setLabel("Creating map");
+            loadingListener->setProgressRange((mMaxX-mMinX+1) * (mMaxY-mMinY+1));
+            loadingListener->setProgress(0);
 
-                if (land)
-                {
-                    int mask = ESM::Land::DATA_WNAM;
-                    if (!land->isDataLoaded(mask))
-                        land->loadData(mask);
-                }
-
-                const ESM::Land::LandData *landData =
-                    land ? land->getLandData (ESM::Land::DATA_WNAM) : 0;
+            image = new osg::Image;
+            image->allocateImage(mWidth, mHeight, 1, GL_RGB, GL_UNSIGNED_BYTE);
 
-                for (int cellY=0; cellY<mCellSize; ++cellY)
-                {
-                    for (int cellX=0; cellX<mCellSize; ++cellX)
-                    {
-                        int vertexX = static_cast<int>(float(cellX)/float(mCellSize) * 9);
-                        int vertexY = static_cast<int>(float(cellY) / float(mCellSize) * 9);
+            unsigned char colourRamp[256][3];
+            createColourRamp(colourRamp);
 
-                        int texelX = (x-mMinX) * mCellSize + cellX;
-                        int texelY = (y-mMinY) * mCellSize + cellY;
+            std::vector<int> vertexIndex (mCellSize);
+            for (int i=0; i<mCellSize; ++i)
+                vertexIndex[i] = static_cast<int>(float(i) / float(mCellSize) * 9);
 
-                        unsigned char r,g,b;
+            // Each work item rasterizes a strip of cell columns into its own part of the image
+            int numThreads = std::max(1, static_cast<int>(OpenThreads::GetNumberOfProcessors()));
+            int numColumns = mMaxX-mMinX+1;
+            int columnsPerItem = std::max(1, std::min(8, numColumns / (numThreads*4)));
 
-                        float y = 0;
-                        if (landData)
-                            y = (landData->mWnam[vertexY * 9 + vertexX] << 4) / 2048.f;
-                        else
-                            y = (SCHAR_MIN << 4) / 2048.f;
-                        if (y < 0)
-                        {
-                            r = static_cast<unsigned char>(14 * y + 38);
-                            g = static_cast<unsigned char>(20 * y + 56);
-                            b = static_cast<unsigned char>(18 * y + 51);
-                        }
-                        else if (y < 0.3f)
-                        {
-                            if (y < 0.1f)
-                                y *= 8.f;
-                            else
-                            {
-                                y -= 0.1f;
-                                y += 0.8f;
-                            }
-                            r = static_cast<unsigned char>(66 - 32 * y);
-                            g = static_cast<unsigned char>(48 - 23 * y);
-                            b = static_cast<unsigned char>(33 - 16 * y);
-                        }
-                        else
-                        {
-                            y -= 0.3f;
-                            y *= 1.428f;
-                            r = static_cast<unsigned char>(34 - 29 * y);
-                            g = static_cast<unsigned char>(25 - 20 * y);
-                            b = static_cast<unsigned char>(17 - 12 * y);
-                        }
+            std::vector<osg::ref_ptr<RenderGlobalMapWorkItem> > workItems;
+            {
+                osg::ref_ptr<SceneUtil::WorkQueue> workQueue = new SceneUtil::WorkQueue(numThreads);
+                for (int x = mMinX; x <= mMaxX; x += columnsPerItem)
+                {
+                    osg::ref_ptr<RenderGlobalMapWorkItem> item = new RenderGlobalMapWorkItem(esmStore.get<ESM::Land>(),
+                        x, std::min(x+columnsPerItem-1, mMaxX), mMinX, mMinY, mMaxY, mCellSize, mWidth,
+                        colourRamp, vertexIndex, image->data());
+                    workItems.push_back(item);
+                    workQueue->addWorkItem(item);
+                }
 
-                        data[texelY * mWidth * 3 + texelX * 3] = r;
-                        data[texelY * mWidth * 3 + texelX * 3+1] = g;
-                        data[texelY * mWidth * 3 + texelX * 3+2] = b;
-                    }
+                for (std::vector<osg::ref_ptr<RenderGlobalMapWorkItem> >::iterator item = workItems.begin(); item != workItems.end(); ++item)
+                {
+                    (*item)->waitTillDone();
+                    loadingListener->increaseProgress((*item)->getNumCells());
                 }
-                loadingListener->increaseProgress();
-                if (land)
-                    land->unloadData();
             }
+
+            if (!cacheFile.empty())
+                saveCache(cacheFile, cacheKey, *image);
         }
 
         mBaseTexture = new osg::Texture2D;
@@ -223,7 +341,90 @@ namespace MWRender
 
         clear();
 
-        loadingListener->loadingOff();
+        if (!cached)
+            loadingListener->loadingOff();
+    }
+
+    bool GlobalMap::loadCache(const std::string& cacheFile, const std::string& cacheKey, osg::ref_ptr<osg::Image>& image)
+    {
+        if (!boost::filesystem::exists(cacheFile))
+            return false;
+
+        try
+        {
+            boost::filesystem::ifstream stream (cacheFile, std::ios::binary);
+
+            Misc::readCacheHeader (stream, sCacheMagic, sCacheVersion);
+
+            std::string key;
+            Misc::readBinaryString (stream, key);
+
+            boost::int32_t cellSize = 0, minX = 0, maxX = 0, minY = 0, maxY = 0;
+            Misc::readBinary (stream, cellSize);
+            Misc::readBinary (stream, minX);
+            Misc::readBinary (stream, maxX);
+            Misc::readBinary (stream, minY);
+            Misc::readBinary (stream, maxY);
+
+            // content files or settings changed
+            if (key!=cacheKey || cellSize!=mCellSize || minX!=mMinX || maxX!=mMaxX || minY!=mMinY || maxY!=mMaxY)
+                return false;
+
+            boost::uint32_t compressedSize = 0;
+            Misc::readBinary (stream, compressedSize);
+            if (!stream || compressedSize > (1 << 28))
+                throw std::runtime_error ("invalid data size");
+
+            std::string compressed (compressedSize, '\0');
+            if (compressedSize)
+                stream.read (&compressed[0], compressedSize);
+            if (!stream)
+                throw std::runtime_error ("unexpected end of file");
+
+            std::string data;
+            Misc::decompress (compressed.data(), compressed.size(), data, static_cast<size_t>(mWidth) * mHeight * 3);
+
+            image = new osg::Image;
+            image->allocateImage(mWidth, mHeight, 1, GL_RGB, GL_UNSIGNED_BYTE);
+            std::copy(data.begin(), data.end(), image->data());
+            return true;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to load global map cache " << cacheFile << ": " << e.what() << std::endl;
+            return false;
+        }
+    }
+
+    void GlobalMap::saveCache(const std::string& cacheFile, const std::string& cacheKey, const osg::Image& image) const
+    {
+        try
+        {
+            // the map compresses very well, so prefer speed over size
+            std::string compressed;
+            Misc::compress (std::string(reinterpret_cast<const char*>(image.data()), image.getTotalSizeInBytes()), compressed, 1);
+
+            boost::filesystem::create_directories (boost::filesystem::path(cacheFile).parent_path());
+
+            boost::filesystem::ofstream stream (cacheFile, std::ios::binary);
+
+            Misc::writeCacheHeader (stream, sCacheMagic, sCacheVersion);
+            Misc::writeBinaryString (stream, cacheKey);
+            Misc::writeBinary (stream, static_cast<boost::int32_t>(mCellSize));
+            Misc::writeBinary (stream, static_cast<boost::int32_t>(mMinX));
+            Misc::writeBinary (stream, static_cast<boost::int32_t>(mMaxX));
+            Misc::writeBinary (stream, static_cast<boost::int32_t>(mMinY));
+            Misc::writeBinary (stream, static_cast<boost::int32_t>(mMaxY));
+            Misc::writeBinary (stream, static_cast<boost::uint32_t>(compressed.size()));
+            stream.write (compressed.data(), compressed.size());
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write global map cache " << cacheFile << ": " << e.what() << std::endl;
+        }
     }
 
     void GlobalMap::worldPosToImageSpace(float x, float z, float& imageX, float& imageY)
@@ -33,7 +33,10 @@ namespace MWRender
         GlobalMap(osg::Group* root);
         ~GlobalMap();
 
-        void render(Loading::Listener* loadingListener);
+        /// Create the base image of the world map.
+        /// @param cacheFile Load the image from this file if it was created with the same \a cacheKey, or
+        ///     store it there otherwise. Empty to disable caching.
+        void render(Loading::Listener* loadingListener, const std::string& cacheFile, const std::string& cacheKey);
 
         int getWidth() const { return mWidth; }
         int getHeight() const { return mHeight; }
@@ -68,6 +71,10 @@ namespace MWRender
         osg::ref_ptr<osg::Texture2D> getOverlayTexture();
 
     private:
+        bool loadCache(const std::string& cacheFile, const std::string& cacheKey, osg::ref_ptr<osg::Image>& image);
+
+        void saveCache(const std::string& cacheFile, const std::string& cacheKey, const osg::Image& image) const;
+
         /**
          * Request rendering a 2d quad onto mOverlayTexture.
          * x, y, width and height are the destination coordinates (top-left coordinate origin)
@@ -22,10 +22,14 @@
 #include "npcanimation.hpp"
 #include "creatureanimation.hpp"
 #include "vismask.hpp"
+#include "staticbatch.hpp"
 
 namespace
 {
 
+    /// Size of the square groups that the objects of a cell are sorted into, a fourth of the width of an exterior cell.
+    const float sChunkSize = 2048.f;
+
     /// Removes all particle systems and related nodes in a subgraph.
     class RemoveParticlesVisitor : public osg::NodeVisitor
     {
@@ -84,31 +88,40 @@ Objects::~Objects()
     mObjects.clear();
 
     for (CellMap::iterator iter = mCellSceneNodes.begin(); iter != mCellSceneNodes.end(); ++iter)
-        iter->second->getParent(0)->removeChild(iter->second);
+        iter->second.mNode->getParent(0)->removeChild(iter->second.mNode);
     mCellSceneNodes.clear();
 }
 
-void Objects::insertBegin(const MWWorld::Ptr& ptr)
+osg::Group* Objects::getChunkNode(const MWWorld::CellStore* store, const osg::Vec3f& position)
 {
-    osg::ref_ptr<osg::Group> cellnode;
+    CellNode& cell = mCellSceneNodes[store];
+    if (!cell.mNode)
+    {
+        cell.mNode = new osg::Group;
+        mRootNode->addChild(cell.mNode);
+    }
+
+    std::pair<int, int> chunk (static_cast<int>(std::floor(position.x() / sChunkSize)),
+                               static_cast<int>(std::floor(position.y() / sChunkSize)));
 
-    CellMap::iterator found = mCellSceneNodes.find(ptr.getCell());
-    if (found == mCellSceneNodes.end())
+    osg::ref_ptr<osg::Group>& chunkNode = cell.mChunks[chunk];
+    if (!chunkNode)
     {
-        cellnode = new osg::Group;
-        mRootNode->addChild(cellnode);
-        mCellSceneNodes[ptr.getCell()] = cellnode;
+        chunkNode = new osg::Group;
+        cell.mNode->addChild(chunkNode);
     }
-    else
-        cellnode = found->second;
+    return chunkNode;
+}
+
+void Objects::insertBegin(const MWWorld::Ptr& ptr)
+{
+    const float *f = ptr.getRefData().getPosition().pos;
 
     osg::ref_ptr<SceneUtil::PositionAttitudeTransform> insert (new SceneUtil::PositionAttitudeTransform);
-    cellnode->addChild(insert);
+    getChunkNode(ptr.getCell(), osg::Vec3f(f[0], f[1], f[2]))->addChild(insert);
 
     insert->getOrCreateUserDataContainer()->addUserObject(new PtrHolder(ptr));
 
-    const float *f = ptr.getRefData().getPosition().pos;
-
     insert->setPosition(osg::Vec3(f[0], f[1], f[2]));
 
     const float scale = ptr.getCellRef().getScale();
@@ -166,6 +179,8 @@ bool Objects::removeObject (const MWWorld::Ptr& ptr)
     if(!ptr.getRefData().getBaseNode())
         return true;
 
+    unbatchObject(ptr);
+
     PtrAnimationMap::iterator iter = mObjects.find(ptr);
     if(iter != mObjects.end())
     {
@@ -199,12 +214,14 @@ void Objects::removeCell(const MWWorld::CellStore* store)
             ++iter;
     }
 
+    mStaticBatches.erase(store);
+
     CellMap::iterator cell = mCellSceneNodes.find(store);
     if(cell != mCellSceneNodes.end())
     {
-        cell->second->getParent(0)->removeChild(cell->second);
+        cell->second.mNode->getParent(0)->removeChild(cell->second.mNode);
         if (mUnrefQueue.get())
-            mUnrefQueue->push(cell->second);
+            mUnrefQueue->push(cell->second.mNode);
         mCellSceneNodes.erase(cell);
     }
 }
@@ -215,16 +232,10 @@ void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
     if (!objectNode)
         return;
 
-    MWWorld::CellStore *newCell = cur.getCell();
+    unbatchObject(old);
 
-    osg::Group* cellnode;
-    if(mCellSceneNodes.find(newCell) == mCellSceneNodes.end()) {
-        cellnode = new osg::Group;
-        mRootNode->addChild(cellnode);
-        mCellSceneNodes[newCell] = cellnode;
-    } else {
-        cellnode = mCellSceneNodes[newCell];
-    }
+    const float *f = cur.getRefData().getPosition().pos;
+    osg::Group* cellnode = getChunkNode(cur.getCell(), osg::Vec3f(f[0], f[1], f[2]));
 
     osg::UserDataContainer* userDataContainer = objectNode->getUserDataContainer();
     if (userDataContainer)
@@ -248,6 +259,62 @@ void Objects::updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur)
     }
 }
 
+void Objects::setStaticBatch(const MWWorld::CellStore* store, StaticBatch* batch)
+{
+    CellMap::iterator cell = mCellSceneNodes.find(store);
+    if (!batch->getNode() || cell == mCellSceneNodes.end())
+        return;
+
+    CellBatch cellBatch;
+    cellBatch.mBatch = batch;
+
+    const std::vector<StaticBatch::Object>& objects = batch->getObjects();
+    for (std::vector<StaticBatch::Object>::const_iterator it = objects.begin(); it != objects.end(); ++it)
+    {
+        if (!it->mMerged)
+            continue;
+
+        // the object was disabled, moved or otherwise changed since the batch was created
+        SceneUtil::PositionAttitudeTransform* baseNode = it->mPtr.getRefData().getBaseNode();
+        if (!baseNode || it->mPtr.getCell() != store
+                || (baseNode->getPosition() - it->mPosition).length2() > 1e-4f
+                || (baseNode->getScale() - it->mScale).length2() > 1e-6f
+                || (baseNode->getAttitude().asVec4() - it->mRotation.asVec4()).length2() > 1e-6f)
+            return;
+
+        cellBatch.mHiddenNodes[baseNode] = baseNode->getNodeMask();
+    }
+
+    for (std::map<osg::ref_ptr<osg::Node>, unsigned int>::iterator it = cellBatch.mHiddenNodes.begin(); it != cellBatch.mHiddenNodes.end(); ++it)
+        it->first->setNodeMask(0);
+
+    batch->attachStateSets();
+    cell->second.mNode->addChild(batch->getNode());
+    mStaticBatches[store] = cellBatch;
+}
+
+void Objects::unbatchObject(const MWWorld::Ptr& ptr)
+{
+    CellBatchMap::iterator found = mStaticBatches.find(ptr.getCell());
+    if (found == mStaticBatches.end())
+        return;
+
+    CellBatch& cellBatch = found->second;
+    if (cellBatch.mHiddenNodes.find(ptr.getRefData().getBaseNode()) == cellBatch.mHiddenNodes.end())
+        return;
+
+    for (std::map<osg::ref_ptr<osg::Node>, unsigned int>::iterator it = cellBatch.mHiddenNodes.begin(); it != cellBatch.mHiddenNodes.end(); ++it)
+        it->first->setNodeMask(it->second);
+
+    osg::Group* node = cellBatch.mBatch->getNode();
+    if (node->getNumParents())
+        node->getParent(0)->removeChild(node);
+    if (mUnrefQueue.get())
+        mUnrefQueue->push(node);
+
+    mStaticBatches.erase(found);
+}
+
 Animation* Objects::getAnimation(const MWWorld::Ptr &ptr)
 {
     PtrAnimationMap::const_iterator iter = mObjects.find(ptr);
@@ -7,12 +7,14 @@
 
 #include <osg/ref_ptr>
 #include <osg/Object>
+#include <osg/Vec3f>
 
 #include "../mwworld/ptr.hpp"
 
 namespace osg
 {
     class Group;
+    class Node;
 }
 
 namespace osgUtil
@@ -38,6 +40,7 @@ namespace SceneUtil
 namespace MWRender{
 
 class Animation;
+class StaticBatch;
 
 class PtrHolder : public osg::Object
 {
@@ -64,7 +67,15 @@ public:
 class Objects{
     typedef std::map<MWWorld::ConstPtr,Animation*> PtrAnimationMap;
 
-    typedef std::map<const MWWorld::CellStore*, osg::ref_ptr<osg::Group> > CellMap;
+    struct CellNode
+    {
+        osg::ref_ptr<osg::Group> mNode;
+
+        /// The objects of a cell are grouped by their position when inserted, so that intersection tests and culling
+        /// can skip whole groups of objects.
+        std::map<std::pair<int, int>, osg::ref_ptr<osg::Group> > mChunks;
+    };
+    typedef std::map<const MWWorld::CellStore*, CellNode> CellMap;
     CellMap mCellSceneNodes;
     PtrAnimationMap mObjects;
 
@@ -74,8 +85,21 @@ class Objects{
 
     osg::ref_ptr<SceneUtil::UnrefQueue> mUnrefQueue;
 
+    struct CellBatch
+    {
+        osg::ref_ptr<StaticBatch> mBatch;
+
+        /// The base nodes of the merged objects, hidden while the batch is shown, with their original node mask.
+        std::map<osg::ref_ptr<osg::Node>, unsigned int> mHiddenNodes;
+    };
+    typedef std::map<const MWWorld::CellStore*, CellBatch> CellBatchMap;
+    CellBatchMap mStaticBatches;
+
     void insertBegin(const MWWorld::Ptr& ptr);
 
+    /// Get the group of the given cell that objects at \a position are inserted into, creating it if necessary.
+    osg::Group* getChunkNode(const MWWorld::CellStore* store, const osg::Vec3f& position);
+
 public:
     Objects(Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Group> rootNode, SceneUtil::UnrefQueue* unrefQueue);
     ~Objects();
@@ -98,6 +122,15 @@ public:
     /// Updates containing cell for object rendering data
     void updatePtr(const MWWorld::Ptr &old, const MWWorld::Ptr &cur);
 
+    /// Show the merged geometry of a built StaticBatch in place of the objects it contains.
+    /// @note The objects of the cell must be inserted already. If any of them was changed since the batch was created,
+    /// the batch is discarded.
+    void setStaticBatch(const MWWorld::CellStore* store, StaticBatch* batch);
+
+    /// If the object is part of a StaticBatch, discard the batch of its cell and show the individual objects again.
+    /// @note Call before the object is changed or removed.
+    void unbatchObject(const MWWorld::Ptr& ptr);
+
 private:
     void operator = (const Objects&);
     Objects(const Objects&);
@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <limits>
+#include <algorithm>
 
 #include <osg/Light>
 #include <osg/LightModel>
@@ -10,6 +11,7 @@
 #include <osg/Group>
 #include <osg/UserDataContainer>
 #include <osg/ComputeBoundsVisitor>
+#include <osg/Program>
 
 #include <osgUtil/LineSegmentIntersector>
 #include <osgUtil/IncrementalCompileOperation>
@@ -28,10 +30,15 @@
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/workqueue.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
+#include <components/sceneutil/skeleton.hpp>
+#include <components/sceneutil/riggeometry.hpp>
+#include <components/sceneutil/instancing.hpp>
 
 #include <components/terrain/terraingrid.hpp>
+#include <components/terrain/quadtreeworld.hpp>
 
 #include <components/esm/loadcell.hpp>
+#include <components/esm/loadligh.hpp>
 #include <components/fallback/fallback.hpp>
 
 #include "../mwworld/cellstore.hpp"
@@ -45,6 +52,7 @@
 #include "water.hpp"
 #include "terrainstorage.hpp"
 #include "util.hpp"
+#include "staticbatch.hpp"
 
 namespace MWRender
 {
@@ -156,8 +164,9 @@ namespace MWRender
         : mViewer(viewer)
         , mRootNode(rootNode)
         , mResourceSystem(resourceSystem)
-        , mWorkQueue(new SceneUtil::WorkQueue)
+        , mWorkQueue(new SceneUtil::WorkQueue(std::max(1, Settings::Manager::getInt("preload num threads", "Cells"))))
         , mUnrefQueue(new SceneUtil::UnrefQueue)
+        , mStaticBatching(Settings::Manager::getBool("static batching", "Cells"))
         , mFogDepth(0.f)
         , mUnderwaterColor(fallback->getFallbackColour("Water_UnderwaterColor"))
         , mUnderwaterWeight(fallback->getFallbackFloat("Water_UnderwaterColorWeight"))
@@ -180,6 +189,13 @@ namespace MWRender
 
         mObjects.reset(new Objects(mResourceSystem, sceneRoot, mUnrefQueue.get()));
 
+        if (mStaticBatching && Settings::Manager::getBool("static instancing", "Cells"))
+        {
+            mInstancingProgram = new osg::Program;
+            mInstancingProgram->addShader(readShader(osg::Shader::VERTEX, resourcePath + "/shaders/instancing_vertex.glsl"));
+            SceneUtil::bindInstanceAttributes(mInstancingProgram);
+        }
+
         mViewer->setIncrementalCompileOperation(new osgUtil::IncrementalCompileOperation);
 
         mResourceSystem->getSceneManager()->setIncrementalCompileOperation(mViewer->getIncrementalCompileOperation());
@@ -188,8 +204,15 @@ namespace MWRender
 
         mWater.reset(new Water(mRootNode, sceneRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(), fallback, resourcePath));
 
-        mTerrain.reset(new Terrain::TerrainGrid(sceneRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
-                                                new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain, mUnrefQueue.get()));
+        if (Settings::Manager::getBool("distant land", "Terrain"))
+            mTerrain.reset(new Terrain::QuadTreeWorld(sceneRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
+                                                      new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain,
+                                                      Settings::Manager::getFloat("lod factor", "Terrain")));
+        else
+            mTerrain.reset(new Terrain::TerrainGrid(sceneRoot, mResourceSystem, mViewer->getIncrementalCompileOperation(),
+                                                    new TerrainStorage(mResourceSystem->getVFS(), false), Mask_Terrain, mUnrefQueue.get()));
+        mTerrain->setCompositeMapResolution(Settings::Manager::getInt("composite map resolution", "Terrain"));
+        mTerrain->setCompositeMapsOnly(Settings::Manager::getBool("composite maps only", "Terrain"));
 
         mCamera.reset(new Camera(mViewer->getCamera()));
 
@@ -242,6 +265,9 @@ namespace MWRender
 
         mRootNode->getOrCreateStateSet()->addUniform(new osg::Uniform("near", mNearClip));
         mRootNode->getOrCreateStateSet()->addUniform(new osg::Uniform("far", mViewDistance));
+
+        SceneUtil::Skeleton::setUpdateLod(Settings::Manager::getFloat("animation lod distance", "Objects"),
+                                          Settings::Manager::getInt("animation lod max interval", "Objects"));
     }
 
     RenderingManager::~RenderingManager()
@@ -268,6 +294,15 @@ namespace MWRender
         return mUnrefQueue.get();
     }
 
+    void RenderingManager::setTerrainCache(const std::string& directory, const std::string& key)
+    {
+        if (Settings::Manager::getBool("composite map cache", "Terrain"))
+        {
+            boost::uint64_t maxSize = std::max(0, Settings::Manager::getInt("composite map cache size", "Terrain"));
+            mTerrain->setCompositeMapCache(directory, key, maxSize * 1024 * 1024);
+        }
+    }
+
     Terrain::World* RenderingManager::getTerrain()
     {
         return mTerrain.get();
@@ -373,6 +408,7 @@ namespace MWRender
     {
         mPathgrid->removeCell(store);
         mObjects->removeCell(store);
+        mStaticBatches.erase(store);
 
         if (store->getCell()->isExterior())
             mTerrain->unloadCell(store->getCell()->getGridX(), store->getCell()->getGridY());
@@ -380,6 +416,65 @@ namespace MWRender
         mWater->removeCell(store);
     }
 
+    struct AddStaticsVisitor
+    {
+        AddStaticsVisitor(StaticBatch* batch)
+            : mBatch(batch)
+        {
+        }
+
+        bool operator()(const MWWorld::Ptr& ptr)
+        {
+            mBatch->addObject(ptr);
+            return true;
+        }
+
+        StaticBatch* mBatch;
+    };
+
+    struct AddLightsVisitor
+    {
+        AddLightsVisitor(StaticBatch* batch)
+            : mBatch(batch)
+        {
+        }
+
+        bool operator()(const MWWorld::Ptr& ptr)
+        {
+            if (!ptr.getRefData().isEnabled() || ptr.getRefData().isDeleted())
+                return true;
+
+            // the light is attached to the model, close enough to the reference to group the objects around it
+            const ESM::Position& position = ptr.getRefData().getPosition();
+            mBatch->addLight(osg::Vec3f(position.pos[0], position.pos[1], position.pos[2]),
+                             ptr.get<ESM::Light>()->mBase->mData.mRadius);
+            return true;
+        }
+
+        StaticBatch* mBatch;
+    };
+
+    void RenderingManager::batchStatics(MWWorld::CellStore *store)
+    {
+        if (!mStaticBatching)
+            return;
+
+        osg::ref_ptr<StaticBatch> batch (new StaticBatch);
+        if (mInstancingProgram)
+            batch->setInstancing(mInstancingProgram);
+        AddStaticsVisitor visitor (batch);
+        store->forEachType<ESM::Static>(visitor);
+        if (batch->getObjects().empty())
+            return;
+
+        AddLightsVisitor lightsVisitor (batch);
+        store->forEachType<ESM::Light>(lightsVisitor);
+
+        osg::ref_ptr<StaticBatchWorkItem> item (new StaticBatchWorkItem(batch, mResourceSystem->getSceneManager()));
+        mWorkQueue->addWorkItem(item);
+        mStaticBatches[store] = item;
+    }
+
     void RenderingManager::setSkyEnabled(bool enabled)
     {
         mSky->setEnabled(enabled);
@@ -445,6 +540,23 @@ namespace MWRender
     {
         mUnrefQueue->flush(mWorkQueue.get());
 
+        for (StaticBatchMap::iterator it = mStaticBatches.begin(); it != mStaticBatches.end();)
+        {
+            if (it->second->isDone())
+            {
+                mObjects->setStaticBatch(it->first, it->second->getBatch());
+                mStaticBatches.erase(it++);
+            }
+            else
+                ++it;
+        }
+
+        // skinning happens during the cull traversal, so the count covers the previous frame
+        unsigned int frameNumber = mViewer->getFrameStamp()->getFrameNumber();
+        unsigned int skinnedVertices = SceneUtil::RigGeometry::resetNumSkinnedVertices();
+        if (frameNumber > 0)
+            mViewer->getViewerStats()->setAttribute(frameNumber-1, "skinned_vertices", skinnedVertices);
+
         if (!paused)
         {
             mEffectManager->update(dt);
@@ -501,16 +613,19 @@ namespace MWRender
             mCamera->rotateCamera(-ptr.getRefData().getPosition().rot[0], -ptr.getRefData().getPosition().rot[2], false);
         }
 
+        mObjects->unbatchObject(ptr);
         ptr.getRefData().getBaseNode()->setAttitude(rot);
     }
 
     void RenderingManager::moveObject(const MWWorld::Ptr &ptr, const osg::Vec3f &pos)
     {
+        mObjects->unbatchObject(ptr);
         ptr.getRefData().getBaseNode()->setPosition(pos);
     }
 
     void RenderingManager::scaleObject(const MWWorld::Ptr &ptr, const osg::Vec3f &scale)
     {
+        mObjects->unbatchObject(ptr);
         ptr.getRefData().getBaseNode()->setScale(scale);
 
         if (ptr == mCamera->getTrackingPtr()) // update height of camera
@@ -677,6 +792,16 @@ namespace MWRender
 
             if (ptrHolder)
                 result.mHitObject = ptrHolder->mPtr;
+            else if (intersection.drawable.valid() && intersection.drawable->getUserDataContainer())
+            {
+                // the geometry of a StaticBatch, which contains many objects
+                osg::UserDataContainer* userDataContainer = intersection.drawable->getUserDataContainer();
+                for (unsigned int i=0; i<userDataContainer->getNumUserObjects(); ++i)
+                {
+                    if (MergedObjects* mergedObjects = dynamic_cast<MergedObjects*>(userDataContainer->getUserObject(i)))
+                        result.mHitObject = mergedObjects->getPtr(intersection.primitiveIndex);
+                }
+            }
         }
 
         return result;
@@ -15,6 +15,7 @@ namespace osg
 {
     class Group;
     class PositionAttitudeTransform;
+    class Program;
 }
 
 namespace Resource
@@ -54,6 +55,7 @@ namespace MWRender
     class StateUpdater;
 
     class EffectManager;
+    class StaticBatchWorkItem;
     class SkyManager;
     class NpcAnimation;
     class Pathgrid;
@@ -75,6 +77,10 @@ namespace MWRender
         SceneUtil::UnrefQueue* getUnrefQueue();
         Terrain::World* getTerrain();
 
+        /// Save the composite maps of the terrain to \a directory, if enabled in the settings.
+        /// @param key identifies the content files; cached composite maps with a different key are not used
+        void setTerrainCache(const std::string& directory, const std::string& key);
+
         void preloadCommonAssets();
 
         double getReferenceTime() const;
@@ -100,6 +106,11 @@ namespace MWRender
         void addCell(const MWWorld::CellStore* store);
         void removeCell(const MWWorld::CellStore* store);
 
+        /// Merge the static objects of a cell into a StaticBatch in the background, if enabled in the settings.
+        /// The batch replaces the objects once it is built.
+        /// @note Call after the objects of the cell are inserted.
+        void batchStatics(MWWorld::CellStore* store);
+
         void updatePtr(const MWWorld::Ptr& old, const MWWorld::Ptr& updated);
 
         void rotateObject(const MWWorld::Ptr& ptr, const osg::Quat& rot);
@@ -207,6 +218,12 @@ namespace MWRender
 
         std::auto_ptr<Pathgrid> mPathgrid;
         std::auto_ptr<Objects> mObjects;
+
+        bool mStaticBatching;
+        osg::ref_ptr<osg::Program> mInstancingProgram;
+        typedef std::map<const MWWorld::CellStore*, osg::ref_ptr<StaticBatchWorkItem> > StaticBatchMap;
+        StaticBatchMap mStaticBatches;
+
         std::auto_ptr<Water> mWater;
         std::auto_ptr<Terrain::World> mTerrain;
         std::auto_ptr<SkyManager> mSky;
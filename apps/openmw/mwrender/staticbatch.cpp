@@ -0,0 +1,660 @@
+#include "staticbatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include <osg/Geometry>
+#include <osg/Group>
+#include <osg/KdTree>
+#include <osg/Material>
+#include <osg/MatrixTransform>
+#include <osg/Program>
+#include <osg/Uniform>
+#include <osg/UserDataContainer>
+
+#include <components/esm/loadstat.hpp>
+
+#include <components/resource/scenemanager.hpp>
+
+#include <components/sceneutil/lightmanager.hpp>
+#include <components/sceneutil/instancing.hpp>
+
+#include "../mwworld/class.hpp"
+
+#include "vismask.hpp"
+
+namespace
+{
+
+    struct FirstTriangleLess
+    {
+        bool operator()(const std::pair<unsigned int, MWWorld::Ptr>& left, const std::pair<unsigned int, MWWorld::Ptr>& right) const
+        {
+            return left.first < right.first;
+        }
+    };
+
+    /// Merged geometry is split into chunks of this size in world units, so that it can still be culled.
+    const float sChunkSize = 2048.f;
+
+    /// Vertex arrays in the merged geometry.
+    enum Layout
+    {
+        Layout_Normals = 0x1,
+        Layout_Colors = 0x2,
+        Layout_TexCoordShift = 2
+    };
+
+    struct GeometryEntry
+    {
+        const osg::Geometry* mGeometry;
+        osg::Matrixf mMatrix;
+        // index into StaticBatch::getObjects()
+        std::size_t mObject;
+    };
+
+    /// Geometries that are rendered with the same state sets and vertex arrays, and can be merged into one.
+    struct BatchKey
+    {
+        std::vector<const osg::StateSet*> mStateSets;
+        int mLayout;
+        int mChunkX;
+        int mChunkY;
+        // the set of cell lights that reach the objects
+        int mLightSet;
+
+        bool operator<(const BatchKey& other) const
+        {
+            if (mChunkX != other.mChunkX)
+                return mChunkX < other.mChunkX;
+            if (mChunkY != other.mChunkY)
+                return mChunkY < other.mChunkY;
+            if (mLightSet != other.mLightSet)
+                return mLightSet < other.mLightSet;
+            if (mLayout != other.mLayout)
+                return mLayout < other.mLayout;
+            return mStateSets < other.mStateSets;
+        }
+    };
+
+    typedef std::map<BatchKey, std::vector<GeometryEntry> > Batches;
+
+    /// Models with at least this many references in a cell are instanced rather than merged, if instancing is enabled.
+    /// Merging a few copies costs little memory, and keeps the fixed function pipeline.
+    const unsigned int sMinInstances = 8;
+
+    /// The references of a model in one chunk, drawn as one InstancedGeometry per geometry of the model.
+    struct InstanceKey
+    {
+        std::string mModel;
+        int mChunkX;
+        int mChunkY;
+        int mLightSet;
+
+        bool operator<(const InstanceKey& other) const
+        {
+            if (mChunkX != other.mChunkX)
+                return mChunkX < other.mChunkX;
+            if (mChunkY != other.mChunkY)
+                return mChunkY < other.mChunkY;
+            if (mLightSet != other.mLightSet)
+                return mLightSet < other.mLightSet;
+            return mModel < other.mModel;
+        }
+    };
+
+    struct InstanceEntry
+    {
+        osg::Matrixf mMatrix;
+        std::size_t mObject;
+    };
+
+    typedef std::map<InstanceKey, std::vector<InstanceEntry> > Instances;
+
+    /// The state set hierarchies created by build(), to attach on the main thread.
+    typedef std::vector<std::pair<osg::ref_ptr<osg::Group>, osg::ref_ptr<const osg::StateSet> > > StateSetList;
+
+    /// The geometry of each instanced model relative to the object, empty if the model can not be instanced.
+    typedef std::map<std::string, Batches> ModelGeometry;
+
+    /// @return the vertex array layout of \a geometry, or -1 if it can not be merged
+    int getLayout(const osg::Geometry& geometry)
+    {
+        if (std::strcmp(geometry.className(), "Geometry") != 0 // e.g. RigGeometry, MorphGeometry
+                || geometry.getDrawCallback() || geometry.getNumVertexAttribArrays())
+            return -1;
+
+        const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        if (!vertices)
+            return -1;
+        unsigned int numVertices = vertices->size();
+
+        int layout = 0;
+        if (const osg::Array* normals = geometry.getNormalArray())
+        {
+            if (!dynamic_cast<const osg::Vec3Array*>(normals) || normals->getNumElements() != numVertices)
+                return -1;
+            layout |= Layout_Normals;
+        }
+        if (const osg::Array* colors = geometry.getColorArray())
+        {
+            if (!dynamic_cast<const osg::Vec4Array*>(colors) || colors->getNumElements() != numVertices)
+                return -1;
+            layout |= Layout_Colors;
+        }
+
+        unsigned int numTexCoords = 0;
+        for (unsigned int i=0; i<geometry.getNumTexCoordArrays(); ++i)
+        {
+            const osg::Array* texCoords = geometry.getTexCoordArray(i);
+            if (!texCoords)
+                break;
+            if (!dynamic_cast<const osg::Vec2Array*>(texCoords) || texCoords->getNumElements() != numVertices)
+                return -1;
+            ++numTexCoords;
+        }
+        if (numTexCoords != geometry.getNumTexCoordArrays())
+            return -1;
+        layout |= numTexCoords << Layout_TexCoordShift;
+
+        for (unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+        {
+            const osg::PrimitiveSet* primitives = geometry.getPrimitiveSet(i);
+            if (primitives->getMode() != GL_TRIANGLES
+                    || (primitives->getType() != osg::PrimitiveSet::DrawArraysPrimitiveType && !primitives->getDrawElements()))
+                return -1;
+        }
+
+        return layout;
+    }
+
+    /// Collect the geometries of a model with their transformation and state sets.
+    /// @return false if the model has anything that can not be merged
+    bool collectGeometry(const osg::Node& node, const osg::Matrixf& matrix, const osg::Vec3f& position, std::size_t object,
+                         std::vector<const osg::StateSet*>& stateSets, Batches& batches)
+    {
+        // hidden nodes only keep the mask of the update visitor, see NifOsg::Loader
+        if (!(node.getNodeMask() & ~MWRender::Mask_UpdateVisitor))
+            return true;
+
+        if (node.getNodeMask() != ~0u || node.getUpdateCallback() || node.getCullCallback() || node.getEventCallback())
+            return false;
+
+        if (node.getStateSet())
+            stateSets.push_back(node.getStateSet());
+
+        bool mergeable = true;
+        if (const osg::Geometry* geometry = dynamic_cast<const osg::Geometry*>(&node))
+        {
+            BatchKey key;
+            key.mLayout = getLayout(*geometry);
+            key.mStateSets = stateSets;
+            key.mChunkX = static_cast<int>(std::floor(position.x() / sChunkSize));
+            key.mChunkY = static_cast<int>(std::floor(position.y() / sChunkSize));
+            key.mLightSet = 0;
+            mergeable = key.mLayout != -1;
+
+            if (mergeable)
+            {
+                GeometryEntry entry;
+                entry.mGeometry = geometry;
+                entry.mMatrix = matrix;
+                entry.mObject = object;
+                batches[key].push_back(entry);
+            }
+        }
+        else if (std::strcmp(node.className(), "MatrixTransform") == 0)
+        {
+            const osg::MatrixTransform& transform = static_cast<const osg::MatrixTransform&>(node);
+            osg::Matrixf childMatrix = osg::Matrixf(transform.getMatrix()) * matrix;
+            for (unsigned int i=0; i<transform.getNumChildren() && mergeable; ++i)
+                mergeable = collectGeometry(*transform.getChild(i), childMatrix, position, object, stateSets, batches);
+        }
+        else if (std::strcmp(node.className(), "Group") == 0 || std::strcmp(node.className(), "Geode") == 0)
+        {
+            const osg::Group& group = static_cast<const osg::Group&>(node);
+            for (unsigned int i=0; i<group.getNumChildren() && mergeable; ++i)
+                mergeable = collectGeometry(*group.getChild(i), matrix, position, object, stateSets, batches);
+        }
+        else
+            mergeable = false; // e.g. particles, lights, LOD or switch nodes
+
+        if (node.getStateSet())
+            stateSets.pop_back();
+
+        return mergeable;
+    }
+
+    /// @return the osg::Material::ColorMode of the state sets as passed to the instancing shader, or -1 if the shader
+    /// does not support it
+    int getColorMode(const std::vector<const osg::StateSet*>& stateSets)
+    {
+        for (std::vector<const osg::StateSet*>::const_reverse_iterator it = stateSets.rbegin(); it != stateSets.rend(); ++it)
+        {
+            const osg::Material* material = static_cast<const osg::Material*>((*it)->getAttribute(osg::StateAttribute::MATERIAL));
+            if (!material)
+                continue;
+
+            switch (material->getColorMode())
+            {
+            case osg::Material::OFF:
+                return 0;
+            case osg::Material::AMBIENT_AND_DIFFUSE:
+                return 1;
+            case osg::Material::EMISSION:
+                return 2;
+            default:
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    /// @return true if the instancing shader draws the geometry of a model like the fixed function pipeline does
+    bool canInstance(const Batches& geometry)
+    {
+        for (Batches::const_iterator it = geometry.begin(); it != geometry.end(); ++it)
+        {
+            // the shader passes on four texture coordinate sets, and always applies lighting
+            if ((it->first.mLayout >> Layout_TexCoordShift) > 4 || getColorMode(it->first.mStateSets) == -1)
+                return false;
+
+            const std::vector<const osg::StateSet*>& stateSets = it->first.mStateSets;
+            for (std::vector<const osg::StateSet*>::const_iterator stateSet = stateSets.begin(); stateSet != stateSets.end(); ++stateSet)
+            {
+                osg::StateAttribute::GLModeValue lighting = (*stateSet)->getMode(GL_LIGHTING);
+                if (lighting != osg::StateAttribute::INHERIT && !(lighting & osg::StateAttribute::ON))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    /// @return the bounding box of the vertices of \a batches, with the transformation of each entry applied
+    osg::BoundingBox getBound(const Batches& batches)
+    {
+        osg::BoundingBox box;
+        for (Batches::const_iterator it = batches.begin(); it != batches.end(); ++it)
+        {
+            for (std::vector<GeometryEntry>::const_iterator entry = it->second.begin(); entry != it->second.end(); ++entry)
+            {
+                // only read the template, getBound() would compute and store its bounds
+                const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(entry->mGeometry->getVertexArray());
+                for (osg::Vec3Array::const_iterator vertex = vertices->begin(); vertex != vertices->end(); ++vertex)
+                    box.expandBy(*vertex * entry->mMatrix);
+            }
+        }
+        return box;
+    }
+
+    bool intersects(const osg::BoundingBox& box, const osg::BoundingSphere& sphere)
+    {
+        osg::Vec3f nearest (osg::clampBetween(sphere.center().x(), box.xMin(), box.xMax()),
+                            osg::clampBetween(sphere.center().y(), box.yMin(), box.yMax()),
+                            osg::clampBetween(sphere.center().z(), box.zMin(), box.zMax()));
+        return (nearest - sphere.center()).length2() <= sphere.radius2();
+    }
+
+    /// @return the number of triangles that \a geometry draws per instance
+    unsigned int getNumTriangles(const osg::Geometry& geometry)
+    {
+        unsigned int count = 0;
+        for (unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+            count += geometry.getPrimitiveSet(i)->getNumIndices() / 3;
+        return count;
+    }
+
+    /// Recreate the state set hierarchy of a model below \a root. The state sets themselves are shared with the model,
+    /// so they are only recorded in \a stateSetList here and attached later on the main thread.
+    /// @return the group to add the geometry to
+    osg::Group* createStateSetPath(osg::Group* root, const std::vector<const osg::StateSet*>& stateSets, StateSetList& stateSetList)
+    {
+        osg::ref_ptr<osg::Group> parent (new osg::Group);
+        parent->addCullCallback(new SceneUtil::LightListCallback);
+        root->addChild(parent);
+
+        for (std::vector<const osg::StateSet*>::const_iterator it = stateSets.begin(); it != stateSets.end(); ++it)
+        {
+            osg::ref_ptr<osg::Group> group (new osg::Group);
+            stateSetList.push_back(std::make_pair(group, osg::ref_ptr<const osg::StateSet>(*it)));
+            parent->addChild(group);
+            parent = group;
+        }
+        return parent;
+    }
+
+    void appendGeometry(const GeometryEntry& entry, int layout, osg::Geometry& merged)
+    {
+        const osg::Geometry& geometry = *entry.mGeometry;
+
+        osg::Vec3Array* vertices = static_cast<osg::Vec3Array*>(merged.getVertexArray());
+        unsigned int firstVertex = vertices->size();
+
+        const osg::Vec3Array* srcVertices = static_cast<const osg::Vec3Array*>(geometry.getVertexArray());
+        for (osg::Vec3Array::const_iterator it = srcVertices->begin(); it != srcVertices->end(); ++it)
+            vertices->push_back(*it * entry.mMatrix);
+
+        if (layout & Layout_Normals)
+        {
+            osg::Vec3Array* normals = static_cast<osg::Vec3Array*>(merged.getNormalArray());
+            const osg::Vec3Array* srcNormals = static_cast<const osg::Vec3Array*>(geometry.getNormalArray());
+            for (osg::Vec3Array::const_iterator it = srcNormals->begin(); it != srcNormals->end(); ++it)
+            {
+                osg::Vec3f normal = osg::Matrixf::transform3x3(*it, entry.mMatrix);
+                normal.normalize();
+                normals->push_back(normal);
+            }
+        }
+
+        if (layout & Layout_Colors)
+        {
+            osg::Vec4Array* colors = static_cast<osg::Vec4Array*>(merged.getColorArray());
+            const osg::Vec4Array* srcColors = static_cast<const osg::Vec4Array*>(geometry.getColorArray());
+            colors->insert(colors->end(), srcColors->begin(), srcColors->end());
+        }
+
+        for (unsigned int i=0; i<merged.getNumTexCoordArrays(); ++i)
+        {
+            osg::Vec2Array* texCoords = static_cast<osg::Vec2Array*>(merged.getTexCoordArray(i));
+            const osg::Vec2Array* srcTexCoords = static_cast<const osg::Vec2Array*>(geometry.getTexCoordArray(i));
+            texCoords->insert(texCoords->end(), srcTexCoords->begin(), srcTexCoords->end());
+        }
+
+        osg::DrawElementsUInt* indices = static_cast<osg::DrawElementsUInt*>(merged.getPrimitiveSet(0));
+        for (unsigned int i=0; i<geometry.getNumPrimitiveSets(); ++i)
+        {
+            const osg::PrimitiveSet* primitives = geometry.getPrimitiveSet(i);
+            if (const osg::DrawElements* elements = primitives->getDrawElements())
+            {
+                for (unsigned int j=0; j<elements->getNumIndices(); ++j)
+                    indices->push_back(firstVertex + elements->index(j));
+            }
+            else
+            {
+                const osg::DrawArrays* arrays = static_cast<const osg::DrawArrays*>(primitives);
+                for (int j=0; j<arrays->getCount(); ++j)
+                    indices->push_back(firstVertex + arrays->getFirst() + j);
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> mergeGeometry(const std::vector<GeometryEntry>& entries, int layout,
+                                              const std::vector<MWRender::StaticBatch::Object>& objects)
+    {
+        osg::ref_ptr<osg::Geometry> merged (new osg::Geometry);
+        merged->setVertexArray(new osg::Vec3Array);
+        if (layout & Layout_Normals)
+            merged->setNormalArray(new osg::Vec3Array, osg::Array::BIND_PER_VERTEX);
+        if (layout & Layout_Colors)
+            merged->setColorArray(new osg::Vec4Array, osg::Array::BIND_PER_VERTEX);
+        for (int i=0; i < (layout >> Layout_TexCoordShift); ++i)
+            merged->setTexCoordArray(i, new osg::Vec2Array, osg::Array::BIND_PER_VERTEX);
+        merged->addPrimitiveSet(new osg::DrawElementsUInt(GL_TRIANGLES));
+
+        osg::ref_ptr<MWRender::MergedObjects> mergedObjects (new MWRender::MergedObjects);
+        const osg::DrawElementsUInt* indices = static_cast<const osg::DrawElementsUInt*>(merged->getPrimitiveSet(0));
+        for (std::vector<GeometryEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+        {
+            // the geometries of an object are consecutive
+            if (it == entries.begin() || it->mObject != (it-1)->mObject)
+                mergedObjects->addObject(indices->size() / 3, objects[it->mObject].mPtr);
+            appendGeometry(*it, layout, *merged);
+        }
+        merged->getOrCreateUserDataContainer()->addUserObject(mergedObjects);
+
+        merged->setUseDisplayList(false);
+        merged->setUseVertexBufferObjects(true);
+        merged->setDataVariance(osg::Object::STATIC);
+
+        // the merged geometry replaces the templates, so it needs its own KdTree for fast intersection tests
+        osg::ref_ptr<osg::KdTree> kdTree (new osg::KdTree);
+        osg::KdTree::BuildOptions buildOptions;
+        if (kdTree->build(buildOptions, merged))
+            merged->setShape(kdTree);
+
+        return merged;
+    }
+
+}
+
+namespace MWRender
+{
+
+void StaticBatch::addObject(const MWWorld::Ptr& ptr)
+{
+    if (ptr.getTypeName() != typeid(ESM::Static).name() || !ptr.getRefData().isEnabled() || ptr.getRefData().isDeleted())
+        return;
+
+    // marker objects that have a hardcoded function in the game logic are hidden, see Scene
+    const std::string& id = ptr.getCellRef().getRefId();
+    if (id == "prisonmarker" || id == "divinemarker" || id == "templemarker" || id == "northmarker")
+        return;
+
+    Object object;
+    object.mPtr = ptr;
+    object.mModel = ptr.getClass().getModel(ptr);
+    if (object.mModel.empty())
+        return;
+
+    // the transformation that Objects::insertBegin and Scene::updateObjectRotation give to the base node
+    const ESM::Position& position = ptr.getRefData().getPosition();
+    object.mPosition = osg::Vec3f(position.pos[0], position.pos[1], position.pos[2]);
+    object.mRotation = osg::Quat(position.rot[2], osg::Vec3(0,0,-1))
+            * osg::Quat(position.rot[1], osg::Vec3(0,-1,0)) * osg::Quat(position.rot[0], osg::Vec3(-1,0,0));
+
+    // Scene::loadCell clamps the scale before inserting the object
+    float scale = std::max(0.5f, std::min(2.f, ptr.getCellRef().getScale()));
+    object.mScale = osg::Vec3f(scale, scale, scale);
+    ptr.getClass().adjustScale(ptr, object.mScale, true);
+
+    object.mMerged = false;
+    mObjects.push_back(object);
+}
+
+void StaticBatch::addLight(const osg::Vec3f& position, float radius)
+{
+    mLights.push_back(osg::BoundingSphere(position, radius));
+}
+
+void StaticBatch::setInstancing(osg::Program* program)
+{
+    mInstancingProgram = program;
+}
+
+void StaticBatch::build(Resource::SceneManager* sceneManager)
+{
+    std::map<std::string, unsigned int> modelCounts;
+    if (mInstancingProgram)
+    {
+        for (std::vector<Object>::const_iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+            ++modelCounts[it->mModel];
+    }
+
+    Batches batches;
+    Instances instances;
+    ModelGeometry modelGeometry;
+    std::map<std::string, osg::BoundingBox> modelBounds;
+    std::vector<const osg::StateSet*> stateSets;
+    std::map<std::vector<std::size_t>, int> lightSets;
+
+    for (std::vector<Object>::iterator it = mObjects.begin(); it != mObjects.end(); ++it)
+    {
+        try
+        {
+            osg::ref_ptr<const osg::Node> model = sceneManager->getTemplate(it->mModel);
+
+            osg::Matrixf matrix = osg::Matrixf::scale(it->mScale) * osg::Matrixf::rotate(it->mRotation)
+                    * osg::Matrixf::translate(it->mPosition);
+            std::size_t object = it - mObjects.begin();
+
+            const Batches* instanceGeometry = NULL;
+            if (modelCounts[it->mModel] >= sMinInstances)
+            {
+                ModelGeometry::iterator found = modelGeometry.find(it->mModel);
+                if (found == modelGeometry.end())
+                {
+                    Batches geometry;
+                    if (!collectGeometry(*model, osg::Matrixf(), osg::Vec3f(), 0, stateSets, geometry) || !canInstance(geometry))
+                    {
+                        stateSets.clear();
+                        geometry.clear();
+                    }
+                    found = modelGeometry.insert(std::make_pair(it->mModel, geometry)).first;
+                    modelBounds[it->mModel] = getBound(geometry);
+                }
+                if (!found->second.empty())
+                    instanceGeometry = &found->second;
+            }
+
+            // collect into a separate map first, so that a model that can not be merged leaves nothing behind
+            Batches objectBatches;
+            osg::BoundingBox bound;
+            if (instanceGeometry)
+            {
+                const osg::BoundingBox& modelBound = modelBounds[it->mModel];
+                for (unsigned int i=0; i<8; ++i)
+                    bound.expandBy(modelBound.corner(i) * matrix);
+            }
+            else
+            {
+                if (!collectGeometry(*model, matrix, it->mPosition, object, stateSets, objectBatches))
+                {
+                    stateSets.clear();
+                    continue;
+                }
+                bound = getBound(objectBatches);
+            }
+
+            std::vector<std::size_t> lights;
+            for (std::vector<osg::BoundingSphere>::const_iterator light = mLights.begin(); light != mLights.end(); ++light)
+            {
+                if (bound.valid() && intersects(bound, *light))
+                    lights.push_back(light - mLights.begin());
+            }
+            int lightSet = lightSets.insert(std::make_pair(lights, static_cast<int>(lightSets.size()))).first->second;
+
+            if (instanceGeometry)
+            {
+                InstanceKey key;
+                key.mModel = it->mModel;
+                key.mChunkX = static_cast<int>(std::floor(it->mPosition.x() / sChunkSize));
+                key.mChunkY = static_cast<int>(std::floor(it->mPosition.y() / sChunkSize));
+                key.mLightSet = lightSet;
+                InstanceEntry entry;
+                entry.mMatrix = matrix;
+                entry.mObject = object;
+                instances[key].push_back(entry);
+                it->mMerged = true;
+                continue;
+            }
+
+            for (Batches::iterator batch = objectBatches.begin(); batch != objectBatches.end(); ++batch)
+            {
+                BatchKey key = batch->first;
+                key.mLightSet = lightSet;
+                std::vector<GeometryEntry>& entries = batches[key];
+                entries.insert(entries.end(), batch->second.begin(), batch->second.end());
+            }
+            it->mMerged = true;
+        }
+        catch (std::exception&)
+        {
+            // the error is shown when the object is inserted
+        }
+    }
+
+    if (batches.empty() && instances.empty())
+        return;
+
+    mNode = new osg::Group;
+    for (Batches::const_iterator it = batches.begin(); it != batches.end(); ++it)
+        createStateSetPath(mNode, it->first.mStateSets, mStateSets)->addChild(mergeGeometry(it->second, it->first.mLayout, mObjects));
+
+    for (Instances::const_iterator it = instances.begin(); it != instances.end(); ++it)
+    {
+        const Batches& geometry = modelGeometry[it->first.mModel];
+        for (Batches::const_iterator batch = geometry.begin(); batch != geometry.end(); ++batch)
+        {
+            osg::Group* parent = createStateSetPath(mNode, batch->first.mStateSets, mStateSets);
+            int colorMode = getColorMode(batch->first.mStateSets);
+
+            for (std::vector<GeometryEntry>::const_iterator entry = batch->second.begin(); entry != batch->second.end(); ++entry)
+            {
+                // intersection tests see the triangles of each instance in turn, see InstancedGeometry::accept
+                unsigned int numTriangles = getNumTriangles(*entry->mGeometry);
+                osg::ref_ptr<MergedObjects> mergedObjects (new MergedObjects);
+
+                std::vector<osg::Matrixf> matrices;
+                matrices.reserve(it->second.size());
+                for (std::vector<InstanceEntry>::const_iterator instance = it->second.begin(); instance != it->second.end(); ++instance)
+                {
+                    mergedObjects->addObject(matrices.size() * numTriangles, mObjects[instance->mObject].mPtr);
+                    matrices.push_back(entry->mMatrix * instance->mMatrix);
+                }
+
+                osg::ref_ptr<SceneUtil::InstancedGeometry> instanced (new SceneUtil::InstancedGeometry(*entry->mGeometry, matrices));
+                instanced->getOrCreateUserDataContainer()->addUserObject(mergedObjects);
+                // the program is shared by all batches, so it is attached in attachStateSets()
+                osg::StateSet* stateset = instanced->getOrCreateStateSet();
+                stateset->addUniform(new osg::Uniform("colorMode", colorMode));
+                mInstancedStateSets.push_back(stateset);
+                parent->addChild(instanced);
+            }
+        }
+    }
+}
+
+void StaticBatch::attachStateSets()
+{
+    for (StateSetList::iterator it = mStateSets.begin(); it != mStateSets.end(); ++it)
+        it->first->setStateSet(const_cast<osg::StateSet*>(it->second.get()));
+    mStateSets.clear();
+
+    for (std::vector<osg::ref_ptr<osg::StateSet> >::iterator it = mInstancedStateSets.begin(); it != mInstancedStateSets.end(); ++it)
+        (*it)->setAttributeAndModes(mInstancingProgram, osg::StateAttribute::ON);
+    mInstancedStateSets.clear();
+}
+
+osg::Group* StaticBatch::getNode()
+{
+    return mNode;
+}
+
+const std::vector<StaticBatch::Object>& StaticBatch::getObjects() const
+{
+    return mObjects;
+}
+
+void MergedObjects::addObject(unsigned int firstTriangle, const MWWorld::Ptr& ptr)
+{
+    mObjects.push_back(std::make_pair(firstTriangle, ptr));
+}
+
+MWWorld::Ptr MergedObjects::getPtr(unsigned int primitiveIndex) const
+{
+    std::vector<std::pair<unsigned int, MWWorld::Ptr> >::const_iterator it = std::upper_bound(mObjects.begin(), mObjects.end(),
+        std::make_pair(primitiveIndex, MWWorld::Ptr()), FirstTriangleLess());
+    if (it == mObjects.begin())
+        return MWWorld::Ptr();
+    return (it-1)->second;
+}
+
+StaticBatchWorkItem::StaticBatchWorkItem(StaticBatch* batch, Resource::SceneManager* sceneManager)
+    : mBatch(batch)
+    , mSceneManager(sceneManager)
+{
+}
+
+void StaticBatchWorkItem::doWork()
+{
+    mBatch->build(mSceneManager);
+}
+
+StaticBatch* StaticBatchWorkItem::getBatch()
+{
+    return mBatch;
+}
+
+}
@@ -0,0 +1,144 @@
+#ifndef OPENMW_MWRENDER_STATICBATCH_H
+#define OPENMW_MWRENDER_STATICBATCH_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <osg/BoundingSphere>
+#include <osg/Object>
+#include <osg/ref_ptr>
+#include <osg/Vec3f>
+#include <osg/Quat>
+
+#include <components/sceneutil/workqueue.hpp>
+
+#include "../mwworld/ptr.hpp"
+
+namespace osg
+{
+    class Group;
+    class Program;
+    class StateSet;
+}
+
+namespace Resource
+{
+    class SceneManager;
+}
+
+namespace MWRender
+{
+
+    /// @brief The models of the static objects in a cell, merged into a few large geometries.
+    /// @par Saves the draw calls and the cull traversal of thousands of individual objects. Only models without
+    /// controllers, particles, lights or other special nodes are merged; other objects are rendered on their own.
+    /// Optionally, models with many references are instanced rather than merged.
+    /// @par Created on the main thread when the cell is loaded, built by a StaticBatchWorkItem on the preload threads,
+    /// then handed to Objects.
+    /// @par The merged geometry of a chunk is split by the set of cell lights that reach its objects, so that each
+    /// group gets a light list that fits its objects. Picking still finds the merged objects, see MergedObjects.
+    class StaticBatch : public osg::Referenced
+    {
+    public:
+        struct Object
+        {
+            MWWorld::Ptr mPtr;
+            std::string mModel;
+
+            // the transformation of the base node when the object is inserted
+            osg::Vec3f mPosition;
+            osg::Quat mRotation;
+            osg::Vec3f mScale;
+
+            // set by build()
+            bool mMerged;
+        };
+
+        /// Add an object to merge, if it is a static object that is enabled and has a model.
+        /// @note Call from the main thread, before build().
+        void addObject(const MWWorld::Ptr& ptr);
+
+        /// Add a light of the cell. Merged objects are only grouped with objects that are reached by the same lights.
+        /// @note Call from the main thread, before build().
+        void addLight(const osg::Vec3f& position, float radius);
+
+        /// Draw models that are repeated often in the cell with SceneUtil::InstancedGeometry instead of merging them.
+        /// @param program the instancing shader, created once and shared by all batches
+        void setInstancing(osg::Program* program);
+
+        /// Merge the models of the objects.
+        /// @note May be called from a worker thread. The state sets of the models are not attached yet, see
+        /// attachStateSets().
+        void build(Resource::SceneManager* sceneManager);
+
+        /// Attach the state sets of the models and the instancing program to the merged geometry. They are shared with
+        /// the model templates and other batches, whose parent lists must only be changed on the main thread.
+        /// @note Call from the main thread, after build() and before the node is added to the scene.
+        void attachStateSets();
+
+        /// @return NULL if no models could be merged
+        osg::Group* getNode();
+
+        const std::vector<Object>& getObjects() const;
+
+    private:
+        std::vector<Object> mObjects;
+        std::vector<osg::BoundingSphere> mLights;
+        osg::ref_ptr<osg::Group> mNode;
+
+        /// The groups created by build() with the state set to attach to them.
+        std::vector<std::pair<osg::ref_ptr<osg::Group>, osg::ref_ptr<const osg::StateSet> > > mStateSets;
+
+        /// The state sets of the instanced geometries, to attach the instancing program to.
+        std::vector<osg::ref_ptr<osg::StateSet> > mInstancedStateSets;
+
+        osg::ref_ptr<osg::Program> mInstancingProgram;
+    };
+
+    /// User data of a merged or instanced geometry: the objects its triangles belong to, so that the objects of a
+    /// StaticBatch can still be picked.
+    class MergedObjects : public osg::Object
+    {
+    public:
+        MergedObjects()
+        {
+        }
+
+        MergedObjects(const MergedObjects& copy, const osg::CopyOp& copyop)
+            : osg::Object(copy, copyop)
+            , mObjects(copy.mObjects)
+        {
+        }
+
+        META_Object(MWRender, MergedObjects)
+
+        /// Add an object whose triangles start at \a firstTriangle and end where the next object starts.
+        void addObject(unsigned int firstTriangle, const MWWorld::Ptr& ptr);
+
+        /// @param primitiveIndex the index of the triangle, as reported by osgUtil::LineSegmentIntersector
+        MWWorld::Ptr getPtr(unsigned int primitiveIndex) const;
+
+    private:
+        // sorted by the first triangle
+        std::vector<std::pair<unsigned int, MWWorld::Ptr> > mObjects;
+    };
+
+    /// Worker thread item: build a StaticBatch.
+    class StaticBatchWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        StaticBatchWorkItem(StaticBatch* batch, Resource::SceneManager* sceneManager);
+
+        virtual void doWork();
+
+        StaticBatch* getBatch();
+
+    private:
+        osg::ref_ptr<StaticBatch> mBatch;
+        Resource::SceneManager* mSceneManager;
+    };
+
+}
+
+#endif
@@ -2,7 +2,9 @@
 #define OPENMW_MWRENDER_UTIL_H
 
 #include <osg/NodeCallback>
+#include <osg/Shader>
 #include <osg/ref_ptr>
+#include <map>
 #include <string>
 
 namespace osg
@@ -19,6 +21,10 @@ namespace MWRender
 {
     void overrideTexture(const std::string& texture, Resource::ResourceSystem* resourceSystem, osg::ref_ptr<osg::Node> node);
 
+    /// Read a shader from \a file, replacing each key of \a defineMap in the source with its value.
+    osg::ref_ptr<osg::Shader> readShader (osg::Shader::Type type, const std::string& file,
+                                          const std::map<std::string, std::string>& defineMap = std::map<std::string, std::string>());
+
     // Node callback to entirely skip the traversal.
     class NoTraverseCallback : public osg::NodeCallback
     {
@@ -6,19 +6,149 @@
 #include <exception>
 #include <algorithm>
 
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
 #include <components/esm/loadscpt.hpp>
 
 #include <components/misc/stringops.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/misc/binarycache.hpp>
 
 #include <components/compiler/scanner.hpp>
 #include <components/compiler/context.hpp>
 #include <components/compiler/exception.hpp>
 #include <components/compiler/quickfileparser.hpp>
 
+#include <components/sceneutil/workqueue.hpp>
+
 #include "../mwworld/esmstore.hpp"
 
 #include "extensions.hpp"
 
+namespace
+{
+    const char sCacheMagic[4] = { 'O', 'M', 'W', 'S' };
+
+    /// Increase when the layout of the cache file or of the generated code changes.
+    const boost::uint32_t sCacheVersion = 2;
+
+    const char sLocalTypes[3] = { 's', 'l', 'f' };
+
+    /// Thrown by WorkerContext to abort compiling a script that needs the main thread.
+    struct MemberAccessDeferred {};
+
+    /// Context for compiling on a worker thread. Looking up the locals of another script needs a reference of the
+    /// accessed object and may scan that script, which is only safe on the main thread, so such scripts are
+    /// deferred to it.
+    class WorkerContext : public Compiler::Context
+    {
+    public:
+        WorkerContext (const Compiler::Context& context)
+            : mContext (context)
+        {
+            setExtensions (context.getExtensions());
+        }
+
+        virtual bool canDeclareLocals() const
+        {
+            return mContext.canDeclareLocals();
+        }
+
+        virtual char getGlobalType (const std::string& name) const
+        {
+            return mContext.getGlobalType (name);
+        }
+
+        virtual std::pair<char, bool> getMemberType (const std::string& name, const std::string& id) const
+        {
+            throw MemberAccessDeferred();
+        }
+
+        virtual bool isId (const std::string& name) const
+        {
+            return mContext.isId (name);
+        }
+
+        virtual bool isJournalId (const std::string& name) const
+        {
+            return mContext.isJournalId (name);
+        }
+
+    private:
+        const Compiler::Context& mContext;
+    };
+
+    /// Compiles a share of the scripts using its own parser, so that several of these can run at once.
+    class CompileScriptsWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        struct Result
+        {
+            const ESM::Script* mScript;
+            bool mSuccess;
+            bool mFromCache;
+            /// Accesses members of other scripts, compile on the main thread
+            bool mDeferred;
+            MWScript::ScriptManager::CompiledScript mCompiled;
+        };
+
+        CompileScriptsWorkItem (MWScript::ScriptManager& scriptManager, const Compiler::Context& context, int warningsMode)
+            : mScriptManager (scriptManager)
+            , mErrorHandler (std::cerr)
+            , mContext (context)
+            , mParser (mErrorHandler, mContext)
+        {
+            mErrorHandler.setWarningsMode (warningsMode);
+        }
+
+        void addScript (const ESM::Script* script)
+        {
+            Result result;
+            result.mScript = script;
+            result.mSuccess = false;
+            result.mFromCache = false;
+            result.mDeferred = false;
+            mResults.push_back (result);
+        }
+
+        virtual void doWork()
+        {
+            OPENMW_PROFILE_ZONE("CompileScriptsWorkItem::doWork");
+            for (std::vector<Result>::iterator it = mResults.begin(); it != mResults.end(); ++it)
+            {
+                it->mFromCache = mScriptManager.getCachedScript (*it->mScript, it->mCompiled);
+                if (it->mFromCache)
+                {
+                    it->mSuccess = true;
+                    continue;
+                }
+
+                try
+                {
+                    it->mSuccess = mScriptManager.compile (*it->mScript, mParser, mErrorHandler, it->mCompiled);
+                }
+                catch (const MemberAccessDeferred&)
+                {
+                    it->mDeferred = true;
+                }
+            }
+        }
+
+        const std::vector<Result>& getResults() const
+        {
+            return mResults;
+        }
+
+    private:
+        MWScript::ScriptManager& mScriptManager;
+        Compiler::StreamErrorHandler mErrorHandler;
+        WorkerContext mContext;
+        Compiler::FileParser mParser;
+        std::vector<Result> mResults;
+    };
+}
+
 namespace MWScript
 {
     ScriptManager::ScriptManager (const MWWorld::ESMStore& store, bool verbose,
@@ -26,7 +156,8 @@ namespace MWScript
         const std::vector<std::string>& scriptBlacklist)
     : mErrorHandler (std::cerr), mStore (store), mVerbose (verbose),
       mCompilerContext (compilerContext), mParser (mErrorHandler, mCompilerContext),
-      mOpcodesInstalled (false), mGlobalScripts (store)
+      mOpcodesInstalled (false), mWarningsMode (warningsMode), mGlobalScripts (store),
+      mCacheDirty (false)
     {
         mErrorHandler.setWarningsMode (warningsMode);
 
@@ -37,53 +168,81 @@ namespace MWScript
         std::sort (mScriptBlacklist.begin(), mScriptBlacklist.end());
     }
 
-    bool ScriptManager::compile (const std::string& name)
+    bool ScriptManager::getCachedScript (const ESM::Script& script, CompiledScript& compiled) const
     {
-        mParser.reset();
-        mErrorHandler.reset();
+        std::map<std::string, CachedScript>::const_iterator iter = mCache.find (script.mId);
 
-        if (const ESM::Script *script = mStore.get<ESM::Script>().find (name))
+        if (iter==mCache.end() || iter->second.mTextHash!=Misc::hashFnv1a (script.mScriptText))
+            return false;
+
+        compiled = iter->second.mScript;
+        return true;
+    }
+
+    bool ScriptManager::compile (const ESM::Script& script, Compiler::FileParser& parser,
+        Compiler::ErrorHandler& errorHandler, CompiledScript& compiled)
+    {
+        parser.reset();
+        errorHandler.reset();
+
+        if (mVerbose)
+            std::cout << "compiling script: " << script.mId << std::endl;
+
+        bool Success = true;
+        try
         {
+            std::istringstream input (script.mScriptText);
+
+            Compiler::Scanner scanner (errorHandler, input, mCompilerContext.getExtensions());
+
+            scanner.scan (parser);
+
+            if (!errorHandler.isGood())
+                Success = false;
+        }
+        catch (const Compiler::SourceException&)
+        {
+            // error has already been reported via error handler
+            Success = false;
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << "An exception has been thrown: " << error.what() << std::endl;
+            Success = false;
+        }
+
+        if (!Success)
+        {
+            std::cerr
+                << "compiling failed: " << script.mId << std::endl;
             if (mVerbose)
-                std::cout << "compiling script: " << name << std::endl;
+                std::cerr << script.mScriptText << std::endl << std::endl;
 
-            bool Success = true;
-            try
-            {
-                std::istringstream input (script->mScriptText);
+            return false;
+        }
 
-                Compiler::Scanner scanner (mErrorHandler, input, mCompilerContext.getExtensions());
+        parser.getCode (compiled.first);
+        compiled.second = parser.getLocals();
 
-                scanner.scan (mParser);
+        return true;
+    }
 
-                if (!mErrorHandler.isGood())
-                    Success = false;
-            }
-            catch (const Compiler::SourceException&)
-            {
-                // error has already been reported via error handler
-                Success = false;
-            }
-            catch (const std::exception& error)
-            {
-                std::cerr << "An exception has been thrown: " << error.what() << std::endl;
-                Success = false;
-            }
+    bool ScriptManager::compile (const std::string& name)
+    {
+        if (const ESM::Script *script = mStore.get<ESM::Script>().find (name))
+        {
+            CompiledScript compiled;
 
-            if (!Success)
+            if (getCachedScript (*script, compiled))
             {
-                std::cerr
-                    << "compiling failed: " << name << std::endl;
-                if (mVerbose)
-                    std::cerr << script->mScriptText << std::endl << std::endl;
+                mScripts.insert (std::make_pair (name, compiled));
+                return true;
             }
 
-            if (Success)
+            if (compile (*script, mParser, mErrorHandler, compiled))
             {
-                std::vector<Interpreter::Type_Code> code;
-                mParser.getCode (code);
-                mScripts.insert (std::make_pair (name, std::make_pair (code, mParser.getLocals())));
-
+                mScripts.insert (std::make_pair (name, compiled));
+                mCacheDirty = true;
                 return true;
             }
         }
@@ -93,6 +252,7 @@ namespace MWScript
 
     void ScriptManager::run (const std::string& name, Interpreter::Context& interpreterContext)
     {
+        OPENMW_PROFILE_ZONE("ScriptManager::run");
         // compile script
         ScriptCollection::iterator iter = mScripts.find (name);
 
@@ -152,6 +312,198 @@ namespace MWScript
         return std::make_pair (count, success);
     }
 
+    std::pair<int, int> ScriptManager::precompileAll (int numThreads)
+    {
+        OPENMW_PROFILE_ZONE("ScriptManager::precompileAll");
+
+        numThreads = std::max (1, numThreads);
+
+        std::vector<osg::ref_ptr<CompileScriptsWorkItem> > items;
+        for (int i=0; i<numThreads; ++i)
+            items.push_back (new CompileScriptsWorkItem (*this, mCompilerContext, mWarningsMode));
+
+        const MWWorld::Store<ESM::Script>& scripts = mStore.get<ESM::Script>();
+
+        int count = 0;
+        for (MWWorld::Store<ESM::Script>::iterator iter = scripts.begin(); iter != scripts.end(); ++iter)
+            if (mScripts.find (iter->mId)==mScripts.end() && !std::binary_search (mScriptBlacklist.begin(),
+                mScriptBlacklist.end(), Misc::StringUtils::lowerCase (iter->mId)))
+                items[count++ % numThreads]->addScript (&*iter);
+
+        {
+            osg::ref_ptr<SceneUtil::WorkQueue> workQueue = new SceneUtil::WorkQueue (numThreads);
+            for (std::vector<osg::ref_ptr<CompileScriptsWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+                workQueue->addWorkItem (*it);
+            for (std::vector<osg::ref_ptr<CompileScriptsWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+                (*it)->waitTillDone();
+        }
+
+        int success = 0;
+        for (std::vector<osg::ref_ptr<CompileScriptsWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+        {
+            const std::vector<CompileScriptsWorkItem::Result>& results = (*it)->getResults();
+            for (std::vector<CompileScriptsWorkItem::Result>::const_iterator result = results.begin(); result != results.end(); ++result)
+            {
+                if (result->mDeferred)
+                {
+                    // adds the script to mScripts on success
+                    if (compile (result->mScript->mId))
+                    {
+                        ++success;
+                        continue;
+                    }
+                }
+                else if (result->mSuccess)
+                {
+                    ++success;
+                    if (!result->mFromCache)
+                        mCacheDirty = true;
+                    mScripts.insert (std::make_pair (result->mScript->mId, result->mCompiled));
+                    continue;
+                }
+
+                // failed -> ignore script from now on, same as in run()
+                mScripts.insert (std::make_pair (result->mScript->mId, CompiledScript()));
+            }
+        }
+
+        return std::make_pair (count, success);
+    }
+
+    void ScriptManager::setCacheFile (const boost::filesystem::path& file, const std::string& key)
+    {
+        mCacheFile = file;
+        mCacheKey = key;
+        mCache.clear();
+
+        if (!boost::filesystem::exists (file))
+        {
+            mCacheDirty = true;
+            return;
+        }
+
+        try
+        {
+            boost::filesystem::ifstream stream (file, std::ios::binary);
+
+            Misc::readCacheHeader (stream, sCacheMagic, sCacheVersion);
+
+            std::string key2;
+            Misc::readBinaryString (stream, key2);
+            if (key2!=key)
+            {
+                // content files changed
+                mCacheDirty = true;
+                return;
+            }
+
+            boost::uint32_t numScripts = 0;
+            Misc::readBinary (stream, numScripts);
+
+            for (boost::uint32_t i=0; i<numScripts && stream; ++i)
+            {
+                std::string name;
+                Misc::readBinaryString (stream, name);
+
+                CachedScript& cached = mCache[name];
+                Misc::readBinary (stream, cached.mTextHash);
+
+                boost::uint32_t codeSize = 0;
+                Misc::readBinary (stream, codeSize);
+                if (!stream || codeSize > (1 << 24))
+                    throw std::runtime_error ("invalid code size");
+                cached.mScript.first.resize (codeSize);
+                if (codeSize)
+                    stream.read (reinterpret_cast<char*> (&cached.mScript.first[0]),
+                        codeSize * sizeof (Interpreter::Type_Code));
+
+                for (int t=0; t<3; ++t)
+                {
+                    boost::uint32_t numLocals = 0;
+                    Misc::readBinary (stream, numLocals);
+                    for (boost::uint32_t l=0; l<numLocals && stream; ++l)
+                    {
+                        std::string local;
+                        Misc::readBinaryString (stream, local);
+                        cached.mScript.second.declare (sLocalTypes[t], local);
+                    }
+                }
+            }
+
+            if (!stream)
+                throw std::runtime_error ("unexpected end of file");
+
+            if (mVerbose)
+                std::cout << "loaded " << mCache.size() << " compiled scripts from " << file.string() << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to load script cache " << file.string() << ": " << e.what() << std::endl;
+            mCache.clear();
+            mCacheDirty = true;
+        }
+    }
+
+    void ScriptManager::saveCache()
+    {
+        if (mCacheFile.empty() || !mCacheDirty)
+            return;
+
+        // keep previously cached scripts that have not been needed this session
+        for (ScriptCollection::const_iterator iter = mScripts.begin(); iter != mScripts.end(); ++iter)
+        {
+            if (iter->second.first.empty())
+                continue;
+
+            const ESM::Script* script = mStore.get<ESM::Script>().search (iter->first);
+            if (!script)
+                continue;
+
+            CachedScript& cached = mCache[script->mId];
+            cached.mTextHash = Misc::hashFnv1a (script->mScriptText);
+            cached.mScript = iter->second;
+        }
+
+        try
+        {
+            boost::filesystem::create_directories (mCacheFile.parent_path());
+
+            boost::filesystem::ofstream stream (mCacheFile, std::ios::binary);
+
+            Misc::writeCacheHeader (stream, sCacheMagic, sCacheVersion);
+            Misc::writeBinaryString (stream, mCacheKey);
+            Misc::writeBinary (stream, static_cast<boost::uint32_t> (mCache.size()));
+
+            for (std::map<std::string, CachedScript>::const_iterator iter = mCache.begin(); iter != mCache.end(); ++iter)
+            {
+                Misc::writeBinaryString (stream, iter->first);
+                Misc::writeBinary (stream, iter->second.mTextHash);
+
+                const std::vector<Interpreter::Type_Code>& code = iter->second.mScript.first;
+                Misc::writeBinary (stream, static_cast<boost::uint32_t> (code.size()));
+                if (!code.empty())
+                    stream.write (reinterpret_cast<const char*> (&code[0]), code.size() * sizeof (Interpreter::Type_Code));
+
+                for (int t=0; t<3; ++t)
+                {
+                    const std::vector<std::string>& locals = iter->second.mScript.second.get (sLocalTypes[t]);
+                    Misc::writeBinary (stream, static_cast<boost::uint32_t> (locals.size()));
+                    for (std::vector<std::string>::const_iterator local = locals.begin(); local != locals.end(); ++local)
+                        Misc::writeBinaryString (stream, *local);
+                }
+            }
+
+            if (!stream)
+                throw std::runtime_error ("write failed");
+
+            mCacheDirty = false;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Failed to write script cache " << mCacheFile.string() << ": " << e.what() << std::endl;
+        }
+    }
+
     const Compiler::Locals& ScriptManager::getLocals (const std::string& name)
     {
         std::string name2 = Misc::StringUtils::lowerCase (name);
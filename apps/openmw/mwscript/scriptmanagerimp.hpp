@@ -4,6 +4,9 @@
 #include <map>
 #include <string>
 
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/path.hpp>
+
 #include <components/compiler/streamerrorhandler.hpp>
 #include <components/compiler/fileparser.hpp>
 
@@ -19,6 +22,11 @@ namespace MWWorld
     class ESMStore;
 }
 
+namespace ESM
+{
+    struct Script;
+}
+
 namespace Compiler
 {
     class Context;
@@ -41,15 +49,32 @@ namespace MWScript
             Compiler::FileParser mParser;
             Interpreter::Interpreter mInterpreter;
             bool mOpcodesInstalled;
+            int mWarningsMode;
+
+        public:
 
             typedef std::pair<std::vector<Interpreter::Type_Code>, Compiler::Locals> CompiledScript;
+
+        private:
+
             typedef std::map<std::string, CompiledScript> ScriptCollection;
 
+            struct CachedScript
+            {
+                boost::uint64_t mTextHash;
+                CompiledScript mScript;
+            };
+
             ScriptCollection mScripts;
             GlobalScripts mGlobalScripts;
             std::map<std::string, Compiler::Locals> mOtherLocals;
             std::vector<std::string> mScriptBlacklist;
 
+            std::map<std::string, CachedScript> mCache;
+            boost::filesystem::path mCacheFile;
+            std::string mCacheKey;
+            bool mCacheDirty;
+
         public:
 
             ScriptManager (const MWWorld::ESMStore& store, bool verbose,
@@ -71,6 +96,30 @@ namespace MWScript
             ///< Return locals for script \a name.
 
             virtual GlobalScripts& getGlobalScripts();
+
+            void setCacheFile (const boost::filesystem::path& file, const std::string& key);
+            ///< Load previously compiled scripts from \a file. Entries are only used when the file was
+            /// written with the same \a key (i.e. the same content files) and the script text is unchanged.
+
+            virtual void saveCache();
+
+            bool getCachedScript (const ESM::Script& script, CompiledScript& compiled) const;
+            ///< Look \a script up in the loaded script cache.
+            /// \return Found, and the script text did not change since it was cached?
+
+            bool compile (const ESM::Script& script, Compiler::FileParser& parser,
+                Compiler::ErrorHandler& errorHandler, CompiledScript& compiled);
+            ///< Compile \a script with the given parser, without touching the compiled script collection.
+            /// @note Thread safe as long as each thread uses its own parser and error handler, and the
+            /// world is not modified meanwhile.
+            /// \return Success?
+
+            std::pair<int, int> precompileAll (int numThreads);
+            ///< Compile all scripts that are not blacklisted on \a numThreads worker threads, blocking until they
+            /// are done. Scripts that access members of other scripts are compiled on the calling thread afterwards,
+            /// since that needs references of the accessed objects. Scripts that fail to compile are remembered as
+            /// such and not compiled again.
+            /// \return count, success
     };
 }
 
@@ -5,41 +5,161 @@
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <iostream>
 
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <components/esm/esmreader.hpp>
+#include <components/esm/esmwriter.hpp>
 #include <components/esm/defs.hpp>
 
 #include <components/misc/stringops.hpp>
 
+namespace
+{
+    const char * const sIndexFile = "slots.index";
+
+    void readProfile (const boost::filesystem::path& path, ESM::SavedGame& profile)
+    {
+        ESM::ESMReader reader;
+        reader.open (path.string());
+
+        if (reader.getRecName()!=ESM::REC_SAVE)
+            throw std::runtime_error ("not a saved game"); // invalid save file -> ignore
+
+        reader.getRecHeader();
+
+        profile.load (reader);
+    }
+}
+
 bool MWState::operator< (const Slot& left, const Slot& right)
 {
     return left.mTimeStamp<right.mTimeStamp;
 }
 
+void MWState::loadScreenshot (const Slot& slot, std::vector<char>& screenshot)
+{
+    if (!slot.mProfile.mScreenshot.empty())
+    {
+        screenshot = slot.mProfile.mScreenshot;
+        return;
+    }
+
+    ESM::SavedGame profile;
+    readProfile (slot.mPath, profile);
+    screenshot.swap (profile.mScreenshot);
+}
 
-void MWState::Character::addSlot (const boost::filesystem::path& path, const std::string& game)
+void MWState::Character::readIndex (Index& index) const
 {
-    Slot slot;
-    slot.mPath = path;
-    slot.mTimeStamp = boost::filesystem::last_write_time (path);
+    boost::filesystem::path path = mPath / sIndexFile;
+
+    if (!boost::filesystem::exists (path))
+        return;
+
+    try
+    {
+        ESM::ESMReader reader;
+        reader.open (path.string());
+
+        while (reader.hasMoreRecs())
+        {
+            ESM::NAME name = reader.getRecName();
+            reader.getRecHeader();
 
-    ESM::ESMReader reader;
-    reader.open (slot.mPath.string());
+            if (name!=ESM::REC_SAVE)
+            {
+                reader.skipRecord();
+                continue;
+            }
+
+            std::string file = reader.getHNString ("FILE");
+
+            IndexEntry entry;
+            reader.getHNT (entry.mFileSize, "FSIZ");
+            reader.getHNT (entry.mFileTime, "FTIM");
+            entry.mProfile.load (reader);
+
+            index[file] = entry;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to read saved game index " << path.string() << ": " << e.what() << std::endl;
+        index.clear();
+    }
+}
 
-    if (reader.getRecName()!=ESM::REC_SAVE)
-        return; // invalid save file -> ignore
+void MWState::Character::writeIndex (const Index& index) const
+{
+    boost::filesystem::path path = mPath / sIndexFile;
 
-    reader.getRecHeader();
+    try
+    {
+        boost::filesystem::ofstream stream (path, std::ios::binary);
+
+        ESM::ESMWriter writer;
+        writer.setFormat (ESM::SavedGame::sCurrentFormat);
+        writer.setVersion (0);
+        writer.setType (0);
+        writer.setAuthor ("");
+        writer.setDescription ("");
+        writer.setRecordCount (index.size());
+        writer.save (stream);
+
+        for (Index::const_iterator iter = index.begin(); iter!=index.end(); ++iter)
+        {
+            writer.startRecord (ESM::REC_SAVE);
+            writer.writeHNString ("FILE", iter->first);
+            writer.writeHNT ("FSIZ", iter->second.mFileSize);
+            writer.writeHNT ("FTIM", iter->second.mFileTime);
+            iter->second.mProfile.save (writer, false);
+            writer.endRecord (ESM::REC_SAVE);
+        }
 
-    slot.mProfile.load (reader);
+        writer.close();
 
-    if (Misc::StringUtils::lowerCase (slot.mProfile.mContentFiles.at (0))!=
+        if (stream.fail())
+            throw std::runtime_error ("write operation failed");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to write saved game index " << path.string() << ": " << e.what() << std::endl;
+    }
+}
+
+bool MWState::Character::addSlot (const boost::filesystem::path& path, const std::string& game, IndexEntry& entry)
+{
+    uint64_t fileSize = boost::filesystem::file_size (path);
+    int64_t fileTime = boost::filesystem::last_write_time (path);
+
+    // only parse the file if it is not in the index or has changed since
+    if (entry.mProfile.mContentFiles.empty() || entry.mFileSize!=fileSize || entry.mFileTime!=fileTime)
+    {
+        entry.mFileSize = fileSize;
+        entry.mFileTime = fileTime;
+        entry.mProfile = ESM::SavedGame();
+
+        readProfile (path, entry.mProfile);
+
+        // the screenshot is read again when the slot is selected
+        std::vector<char>().swap (entry.mProfile.mScreenshot);
+    }
+
+    if (Misc::StringUtils::lowerCase (entry.mProfile.mContentFiles.at (0))!=
         Misc::StringUtils::lowerCase (game))
-        return; // this file is for a different game -> ignore
+        return false; // this file is for a different game -> ignore
+
+    Slot slot;
+    slot.mPath = path;
+    slot.mTimeStamp = static_cast<std::time_t> (fileTime);
+    slot.mProfile = entry.mProfile;
 
     mSlots.push_back (slot);
+
+    return true;
 }
 
 void MWState::Character::addSlot (const ESM::SavedGame& profile)
@@ -85,18 +205,44 @@ MWState::Character::Character (const boost::filesystem::path& saves, const std::
     }
     else
     {
+        Index index;
+        readIndex (index);
+
+        Index newIndex;
+        bool indexChanged = false;
+
         for (boost::filesystem::directory_iterator iter (mPath);
             iter!=boost::filesystem::directory_iterator(); ++iter)
         {
             boost::filesystem::path slotPath = *iter;
+            std::string file = slotPath.filename().string();
+
+            // skip the index and saves that are still being written
+            if (file==sIndexFile || slotPath.extension()==".tmp")
+                continue;
+
+            Index::const_iterator found = index.find (file);
+            IndexEntry entry;
+            if (found!=index.end())
+                entry = found->second;
+            else
+                entry.mFileSize = entry.mFileTime = 0;
 
             try
             {
-                addSlot (slotPath, game);
+                addSlot (slotPath, game, entry);
+
+                indexChanged = indexChanged || found==index.end() ||
+                    entry.mFileSize!=found->second.mFileSize || entry.mFileTime!=found->second.mFileTime;
+                newIndex[file] = entry;
             }
             catch (...) {} // ignoring bad saved game files for now
         }
 
+        // also drop deleted files from the index
+        if (indexChanged || newIndex.size()!=index.size())
+            writeIndex (newIndex);
+
         std::sort (mSlots.begin(), mSlots.end());
     }
 }
@@ -108,6 +254,9 @@ void MWState::Character::cleanup()
         // All slots are gone, no need to keep the empty directory
         if (boost::filesystem::is_directory (mPath))
         {
+            boost::system::error_code ec;
+            boost::filesystem::remove (mPath / sIndexFile, ec);
+
             // Extra safety check to make sure the directory is empty (e.g. slots failed to parse header)
             boost::filesystem::directory_iterator it(mPath);
             if (it == boost::filesystem::directory_iterator())
@@ -159,6 +308,21 @@ const MWState::Slot *MWState::Character::updateSlot (const Slot *slot, const ESM
     return &mSlots.back();
 }
 
+void MWState::Character::restoreSlot (const Slot *slot, const Slot& previous)
+{
+    int index = slot - &mSlots[0];
+
+    if (index<0 || index>=static_cast<int> (mSlots.size()))
+    {
+        // sanity check; not entirely reliable
+        throw std::logic_error ("slot not found");
+    }
+
+    mSlots.erase (mSlots.begin()+index);
+
+    mSlots.insert (std::upper_bound (mSlots.begin(), mSlots.end(), previous), previous);
+}
+
 MWState::Character::SlotIterator MWState::Character::begin() const
 {
     return mSlots.rbegin();
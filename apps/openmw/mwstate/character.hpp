@@ -1,6 +1,9 @@
 #ifndef GAME_STATE_CHARACTER_H
 #define GAME_STATE_CHARACTER_H
 
+#include <map>
+#include <stdint.h>
+
 #include <boost/filesystem/path.hpp>
 
 #include <components/esm/savedgame.hpp>
@@ -16,6 +19,12 @@ namespace MWState
 
     bool operator< (const Slot& left, const Slot& right);
 
+    void loadScreenshot (const Slot& slot, std::vector<char>& screenshot);
+    ///< Read the jpg-encoded screenshot of \a slot.
+    ///
+    /// \note Screenshots are only kept in memory for slots created during this session, for
+    /// all other slots they are read from the save file on demand.
+
     class Character
     {
         public:
@@ -24,10 +33,26 @@ namespace MWState
 
         private:
 
+            struct IndexEntry
+            {
+                uint64_t mFileSize;
+                int64_t mFileTime;
+                ESM::SavedGame mProfile;
+            };
+
+            typedef std::map<std::string, IndexEntry> Index;
+
             boost::filesystem::path mPath;
             std::vector<Slot> mSlots;
 
-            void addSlot (const boost::filesystem::path& path, const std::string& game);
+            void readIndex (Index& index) const;
+
+            void writeIndex (const Index& index) const;
+            ///< Write the header index, so that unchanged save files do not need to be parsed again on
+            /// the next start.
+
+            bool addSlot (const boost::filesystem::path& path, const std::string& game, IndexEntry& entry);
+            ///< \return Was a slot added?
 
             void addSlot (const ESM::SavedGame& profile);
 
@@ -53,6 +78,12 @@ namespace MWState
             ///
             /// \attention The \a slot pointer will be invalidated by this call.
 
+            void restoreSlot (const Slot *slot, const Slot& previous);
+            ///< Undo an updateSlot call, e.g. when writing the save file failed and the old file was kept.
+            /// \note Slot must belong to this character.
+            ///
+            /// \attention The \a slot pointer will be invalidated by this call.
+
             SlotIterator begin() const;
             ///<  Any call to createSlot and updateSlot can invalidate the returned iterator.
 
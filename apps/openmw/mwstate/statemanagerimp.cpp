@@ -1,5 +1,7 @@
 #include "statemanagerimp.hpp"
 
+#include <memory>
+
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/esmreader.hpp>
 #include <components/esm/cellid.hpp>
@@ -8,6 +10,10 @@
 #include <components/loadinglistener/loadinglistener.hpp>
 
 #include <components/misc/stringops.hpp>
+#include <components/misc/compression.hpp>
+#include <components/misc/profiler.hpp>
+
+#include <components/sceneutil/workqueue.hpp>
 
 #include <components/settings/settings.hpp>
 
@@ -40,6 +46,146 @@
 
 #include "../mwscript/globalscripts.hpp"
 
+namespace MWState
+{
+    /// Reads from a string it owns, so decompressed records do not need to be copied into a std::istringstream.
+    class StringBuf : public std::streambuf
+    {
+    public:
+        StringBuf (std::string& data)
+        {
+            mData.swap (data);
+            char* begin = mData.empty() ? NULL : &mData[0];
+            setg (begin, begin, begin + mData.size());
+        }
+
+    protected:
+        virtual pos_type seekoff (off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+        {
+            if (dir == std::ios_base::cur)
+                off += gptr() - eback();
+            else if (dir == std::ios_base::end)
+                off += egptr() - eback();
+            return seekpos (off, which);
+        }
+
+        virtual pos_type seekpos (pos_type pos, std::ios_base::openmode which)
+        {
+            off_type off = pos;
+            if (!(which & std::ios_base::in) || off < 0 || off > egptr() - eback())
+                return pos_type (off_type (-1));
+            setg (eback(), eback() + off, egptr());
+            return pos;
+        }
+
+    private:
+        std::string mData;
+    };
+
+    struct IStringStream : private StringBuf, public std::istream
+    {
+        IStringStream (std::string& data)
+            : StringBuf (data)
+            , std::istream (static_cast<std::streambuf*> (this))
+        {
+        }
+    };
+
+    /// Compresses a saved game that has been serialized on the main thread and writes it to disk.
+    class WriteSaveGameWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        /// @param previous The slot that is being overwritten, restored if writing fails. NULL for a new slot.
+        WriteSaveGameWorkItem (const boost::filesystem::path& path, const Slot* previous, std::string& header,
+                               std::string& records, bool compress)
+            : mPath (path)
+            , mHasPrevious (previous != NULL)
+            , mCompress (compress)
+        {
+            if (previous)
+                mPrevious = *previous;
+
+            mHeader.swap (header);
+            mRecords.swap (records);
+        }
+
+        virtual void doWork()
+        {
+            OPENMW_PROFILE_ZONE("WriteSaveGameWorkItem::doWork");
+
+            boost::filesystem::path tempPath = mPath.string() + ".tmp";
+            try
+            {
+                if (mCompress)
+                {
+                    // The header and the SAVE record stay uncompressed, so the save dialog can read them quickly.
+                    std::string compressed;
+                    Misc::compress (mRecords, compressed, 1);
+
+                    std::ostringstream stream;
+                    ESM::ESMWriter writer;
+                    writer.setStream (stream);
+                    writer.startRecord (ESM::REC_ZSAV);
+                    writer.writeHNT ("SIZE", static_cast<uint64_t> (mRecords.size()));
+                    writer.startSubRecord ("DATA");
+                    writer.write (compressed.data(), compressed.size());
+                    writer.endRecord ("DATA");
+                    writer.endRecord (ESM::REC_ZSAV);
+                    writer.close();
+
+                    mRecords = stream.str();
+                }
+
+                // Write to a temporary file first, so a failed write does not trash the existing save file we are overwriting.
+                {
+                    boost::filesystem::ofstream filestream (tempPath, std::ios::binary);
+                    filestream.write (mHeader.data(), mHeader.size());
+                    filestream.write (mRecords.data(), mRecords.size());
+
+                    if (filestream.fail())
+                        throw std::runtime_error("Write operation failed (file stream)");
+                }
+
+                boost::filesystem::rename (tempPath, mPath);
+            }
+            catch (const std::exception& e)
+            {
+                mError = e.what();
+
+                boost::system::error_code ec;
+                boost::filesystem::remove (tempPath, ec);
+            }
+
+            std::string().swap (mHeader);
+            std::string().swap (mRecords);
+        }
+
+        const boost::filesystem::path& getPath() const
+        {
+            return mPath;
+        }
+
+        const std::string& getError() const
+        {
+            return mError;
+        }
+
+        const Slot* getPreviousSlot() const
+        {
+            return mHasPrevious ? &mPrevious : NULL;
+        }
+
+    private:
+        boost::filesystem::path mPath;
+        Slot mPrevious;
+        bool mHasPrevious;
+        bool mCompress;
+        std::string mHeader;
+        std::string mRecords;
+        std::string mError;
+    };
+}
+
 void MWState::StateManager::cleanup (bool force)
 {
     if (mState!=State_NoGame || force)
@@ -92,6 +238,55 @@ MWState::StateManager::StateManager (const boost::filesystem::path& saves, const
 
 }
 
+MWState::StateManager::~StateManager()
+{
+    // the work queue would discard a save that has not been written yet
+    if (mPendingSave)
+        mPendingSave->waitTillDone();
+}
+
+void MWState::StateManager::finishPendingSave (bool wait)
+{
+    if (!mPendingSave)
+        return;
+
+    if (wait)
+        mPendingSave->waitTillDone();
+    else if (!mPendingSave->isDone())
+        return;
+
+    osg::ref_ptr<WriteSaveGameWorkItem> save = mPendingSave;
+    mPendingSave = NULL;
+
+    if (save->getError().empty())
+        return;
+
+    std::stringstream error;
+    error << "Failed to save game: " << save->getError();
+
+    std::cerr << error.str() << std::endl;
+
+    std::vector<std::string> buttons;
+    buttons.push_back("#{sOk}");
+    MWBase::Environment::get().getWindowManager()->interactiveMessageBox(error.str(), buttons);
+
+    // The file was not replaced, so the slot has to match it again: clean up a new slot if no file was written,
+    // or restore the profile of the save file that was kept.
+    Character* character = getCurrentCharacter(false);
+    if (character)
+    {
+        for (Character::SlotIterator it = character->begin(); it != character->end(); ++it)
+            if (it->mPath == save->getPath())
+            {
+                if (!boost::filesystem::exists(save->getPath()))
+                    character->deleteSlot(&*it);
+                else if (save->getPreviousSlot())
+                    character->restoreSlot(&*it, *save->getPreviousSlot());
+                break;
+            }
+    }
+}
+
 void MWState::StateManager::requestQuit()
 {
     mQuitRequest = true;
@@ -172,6 +367,13 @@ void MWState::StateManager::endGame()
 
 void MWState::StateManager::saveGame (const std::string& description, const Slot *slot)
 {
+    finishPendingSave(true);
+
+    // Keep the slot that is overwritten, so it can be restored if the file can not be written.
+    std::auto_ptr<Slot> previous;
+    if (slot)
+        previous.reset (new Slot (*slot));
+
     try
     {
         ESM::SavedGame profile;
@@ -250,6 +452,10 @@ void MWState::StateManager::saveGame (const std::string& description, const Slot
         slot->mProfile.save (writer);
         writer.endRecord (ESM::REC_SAVE);
 
+        // The remaining records are kept separately, so they can be compressed.
+        std::ostringstream records;
+        writer.setStream (records);
+
         MWBase::Environment::get().getJournal()->write (writer, listener);
         MWBase::Environment::get().getDialogueManager()->write (writer, listener);
         MWBase::Environment::get().getWorld()->write (writer, listener);
@@ -263,15 +469,18 @@ void MWState::StateManager::saveGame (const std::string& description, const Slot
 
         writer.close();
 
-        if (stream.fail())
+        if (stream.fail() || records.fail())
             throw std::runtime_error("Write operation failed (memory stream)");
 
-        // All good, write to file
-        boost::filesystem::ofstream filestream (slot->mPath, std::ios::binary);
-        filestream << stream.rdbuf();
+        // All good, the game state has been captured. Compressing and writing to file does not need to block the game.
+        std::string header = stream.str();
+        std::string recordData = records.str();
+        mPendingSave = new WriteSaveGameWorkItem (slot->mPath, previous.get(), header, recordData,
+            Settings::Manager::getBool ("compress", "Saves"));
 
-        if (filestream.fail())
-            throw std::runtime_error("Write operation failed (file stream)");
+        if (!mWorkQueue)
+            mWorkQueue = new SceneUtil::WorkQueue;
+        mWorkQueue->addWorkItem (mPendingSave);
 
         Settings::Manager::setString ("character", "Saves",
             slot->mPath.parent_path().filename().string());
@@ -287,9 +496,11 @@ void MWState::StateManager::saveGame (const std::string& description, const Slot
         buttons.push_back("#{sOk}");
         MWBase::Environment::get().getWindowManager()->interactiveMessageBox(error.str(), buttons);
 
-        // If no file was written, clean up the slot
+        // If no file was written, clean up the slot, otherwise it has to match the file that was kept
         if (slot && !boost::filesystem::exists(slot->mPath))
             getCurrentCharacter()->deleteSlot(slot);
+        else if (slot && previous.get())
+            getCurrentCharacter()->restoreSlot(slot, *previous);
     }
 }
 
@@ -350,6 +561,8 @@ void MWState::StateManager::loadGame(const std::string& filepath)
 
 void MWState::StateManager::loadGame (const Character *character, const std::string& filepath)
 {
+    finishPendingSave(true);
+
     try
     {
         cleanup();
@@ -433,6 +646,26 @@ void MWState::StateManager::loadGame (const Character *character, const std::str
                     reader.getHNT(firstPersonCam, "FIRS");
                     break;
 
+                case ESM::REC_ZSAV:
+                    {
+                        // the remaining records are compressed, continue reading them from memory
+                        uint64_t size = 0;
+                        reader.getHNT(size, "SIZE");
+                        reader.getSubNameIs("DATA");
+                        reader.getSubHeader();
+                        std::vector<char> compressed(reader.getSubSize());
+                        if (!compressed.empty())
+                            reader.getExact(&compressed[0], compressed.size());
+
+                        std::string records;
+                        Misc::decompress(compressed.empty() ? NULL : &compressed[0], compressed.size(), records, size);
+
+                        reader.openRaw(Files::IStreamPtr(new IStringStream(records)), filepath);
+                        total = reader.getFileSize();
+                        currentPercent = 0;
+                    }
+                    break;
+
                 case ESM::REC_GSCR:
 
                     MWBase::Environment::get().getScriptManager()->getGlobalScripts().readRecord (reader, n.val);
@@ -524,6 +757,8 @@ void MWState::StateManager::quickLoad()
 
 void MWState::StateManager::deleteGame(const MWState::Character *character, const MWState::Slot *slot)
 {
+    finishPendingSave(true);
+
     mCharacterManager.deleteSlot(character, slot);
 }
 
@@ -549,6 +784,8 @@ void MWState::StateManager::update (float duration)
 {
     mTimePlayed += duration;
 
+    finishPendingSave(false);
+
     // Note: It would be nicer to trigger this from InputManager, i.e. the very beginning of the frame update.
     if (mAskLoadRecent)
     {
@@ -7,10 +7,19 @@
 
 #include <boost/filesystem/path.hpp>
 
+#include <osg/ref_ptr>
+
 #include "charactermanager.hpp"
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWState
 {
+    class WriteSaveGameWorkItem;
+
     class StateManager : public MWBase::StateManager
     {
             bool mQuitRequest;
@@ -19,8 +28,15 @@ namespace MWState
             CharacterManager mCharacterManager;
             double mTimePlayed;
 
+            osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+            osg::ref_ptr<WriteSaveGameWorkItem> mPendingSave;
+
         private:
 
+            void finishPendingSave (bool wait);
+            ///< Report the result of the last save, if it has been written to disk.
+            /// \param wait Block until it has been written.
+
             void cleanup (bool force = false);
 
             bool verifyProfile (const ESM::SavedGame& profile) const;
@@ -33,6 +49,8 @@ namespace MWState
 
             StateManager (const boost::filesystem::path& saves, const std::string& game);
 
+            virtual ~StateManager();
+
             virtual void requestQuit();
 
             virtual bool hasQuitRequest() const;
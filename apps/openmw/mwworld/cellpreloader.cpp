@@ -7,12 +7,15 @@
 #include <components/resource/bulletshapemanager.hpp>
 #include <components/resource/keyframemanager.hpp>
 #include <components/misc/resourcehelpers.hpp>
+#include <components/misc/profiler.hpp>
 #include <components/nifosg/nifloader.hpp>
 #include <components/terrain/world.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
 
+#include "../mwphysics/heightfield.hpp"
+
 #include "../mwworld/inventorystore.hpp"
 #include "../mwworld/esmstore.hpp"
 
@@ -45,15 +48,21 @@ namespace MWWorld
     {
     public:
         /// Constructor to be called from the main thread.
-        PreloadItem(MWWorld::CellStore* cell, Resource::SceneManager* sceneManager, Resource::BulletShapeManager* bulletShapeManager, Resource::KeyframeManager* keyframeManager, Terrain::World* terrain)
+        PreloadItem(MWWorld::CellStore* cell, Resource::SceneManager* sceneManager, Resource::BulletShapeManager* bulletShapeManager,
+                    MWPhysics::HeightFieldManager* heightFieldManager, Resource::KeyframeManager* keyframeManager, Terrain::World* terrain)
             : mIsExterior(cell->getCell()->isExterior())
             , mX(cell->getCell()->getGridX())
             , mY(cell->getCell()->getGridY())
+            , mLand(NULL)
             , mSceneManager(sceneManager)
             , mBulletShapeManager(bulletShapeManager)
+            , mHeightFieldManager(heightFieldManager)
             , mKeyframeManager(keyframeManager)
             , mTerrain(terrain)
         {
+            if (mIsExterior)
+                mLand = MWBase::Environment::get().getWorld()->getStore().get<ESM::Land>().search(mX, mY);
+
             ListModelsVisitor visitor (mMeshes);
             if (cell->getState() == MWWorld::CellStore::State_Loaded)
             {
@@ -77,6 +86,7 @@ namespace MWWorld
         /// Preload work to be called from the worker thread.
         virtual void doWork()
         {
+            OPENMW_PROFILE_ZONE("PreloadItem::doWork");
             for (MeshList::const_iterator it = mMeshes.begin(); it != mMeshes.end(); ++it)
             {
                 try
@@ -114,6 +124,7 @@ namespace MWWorld
             {
                 try
                 {
+                    mPreloadedObjects.push_back(mHeightFieldManager->getShape(mX, mY, mLand));
                     mPreloadedObjects.push_back(mTerrain->cacheCell(mX, mY));
                 }
                 catch(std::exception& e)
@@ -127,9 +138,11 @@ namespace MWWorld
         bool mIsExterior;
         int mX;
         int mY;
+        const ESM::Land* mLand;
         MeshList mMeshes;
         Resource::SceneManager* mSceneManager;
         Resource::BulletShapeManager* mBulletShapeManager;
+        MWPhysics::HeightFieldManager* mHeightFieldManager;
         Resource::KeyframeManager* mKeyframeManager;
         Terrain::World* mTerrain;
 
@@ -150,6 +163,7 @@ namespace MWWorld
 
         virtual void doWork()
         {
+            OPENMW_PROFILE_ZONE("UpdateCacheItem::doWork");
             mResourceSystem->updateCache(mReferenceTime);
 
             mTerrain->updateCache();
@@ -161,11 +175,13 @@ namespace MWWorld
         Terrain::World* mTerrain;
     };
 
-    CellPreloader::CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager, Terrain::World* terrain)
+    CellPreloader::CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager, MWPhysics::HeightFieldManager* heightFieldManager, Terrain::World* terrain)
         : mResourceSystem(resourceSystem)
         , mBulletShapeManager(bulletShapeManager)
+        , mHeightFieldManager(heightFieldManager)
         , mTerrain(terrain)
         , mExpiryDelay(0.0)
+        , mPreloadPathgrids(true)
     {
     }
 
@@ -197,9 +213,12 @@ namespace MWWorld
             return;
         }
 
-        osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mResourceSystem->getKeyframeManager(), mTerrain));
+        osg::ref_ptr<PreloadItem> item (new PreloadItem(cell, mResourceSystem->getSceneManager(), mBulletShapeManager, mHeightFieldManager, mResourceSystem->getKeyframeManager(), mTerrain));
         mWorkQueue->addWorkItem(item);
 
+        if (mPreloadPathgrids)
+            cell->preloadPathgrid(mWorkQueue);
+
         mPreloadCells[cell] = PreloadEntry(timestamp, item);
     }
 
@@ -234,4 +253,9 @@ namespace MWWorld
         mWorkQueue = workQueue;
     }
 
+    void CellPreloader::setPreloadPathgrids(bool enabled)
+    {
+        mPreloadPathgrids = enabled;
+    }
+
 }
@@ -16,6 +16,11 @@ namespace Terrain
     class World;
 }
 
+namespace MWPhysics
+{
+    class HeightFieldManager;
+}
+
 namespace MWWorld
 {
     class CellStore;
@@ -23,10 +28,11 @@ namespace MWWorld
     class CellPreloader
     {
     public:
-        CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager, Terrain::World* terrain);
+        CellPreloader(Resource::ResourceSystem* resourceSystem, Resource::BulletShapeManager* bulletShapeManager, MWPhysics::HeightFieldManager* heightFieldManager, Terrain::World* terrain);
         ~CellPreloader();
 
-        /// Ask a background thread to preload rendering meshes and collision shapes for objects in this cell.
+        /// Ask a background thread to preload rendering meshes and collision shapes for objects in this cell, and
+        /// the terrain and its collision shape for an exterior cell.
         /// @note The cell itself must be in State_Loaded or State_Preloaded.
         void preload(MWWorld::CellStore* cell, double timestamp);
 
@@ -40,12 +46,17 @@ namespace MWWorld
 
         void setWorkQueue(osg::ref_ptr<SceneUtil::WorkQueue> workQueue);
 
+        /// Also build the shortest path table of a preloaded cell's pathgrid, if it is small enough.
+        void setPreloadPathgrids(bool enabled);
+
     private:
         Resource::ResourceSystem* mResourceSystem;
         Resource::BulletShapeManager* mBulletShapeManager;
+        MWPhysics::HeightFieldManager* mHeightFieldManager;
         Terrain::World* mTerrain;
         osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
         double mExpiryDelay;
+        bool mPreloadPathgrids;
 
         struct PreloadEntry
         {
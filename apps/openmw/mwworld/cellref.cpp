@@ -25,6 +25,11 @@ namespace MWWorld
         return mCellRef.mRefID;
     }
 
+    const Misc::StringId& CellRef::getRefStringId() const
+    {
+        return mRefStringId;
+    }
+
     bool CellRef::getTeleport() const
     {
         return mCellRef.mTeleport;
@@ -3,6 +3,8 @@
 
 #include <components/esm/cellref.hpp>
 
+#include <components/misc/stringid.hpp>
+
 namespace ESM
 {
     struct ObjectState;
@@ -18,6 +20,7 @@ namespace MWWorld
 
         CellRef (const ESM::CellRef& ref)
             : mCellRef(ref)
+            , mRefStringId(ref.mRefID)
         {
             mChanged = false;
         }
@@ -34,6 +37,9 @@ namespace MWWorld
         // Id of object being referenced
         std::string getRefId() const;
 
+        // Interned id of object being referenced, for fast comparisons
+        const Misc::StringId& getRefStringId() const;
+
         // For doors - true if this door teleports to somewhere else, false
         // if it should open through animation.
         bool getTeleport() const;
@@ -113,6 +119,7 @@ namespace MWWorld
     private:
         bool mChanged;
         ESM::CellRef mCellRef;
+        Misc::StringId mRefStringId;
     };
 
 }
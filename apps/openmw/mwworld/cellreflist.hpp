@@ -1,18 +1,20 @@
 #ifndef GAME_MWWORLD_CELLREFLIST_H
 #define GAME_MWWORLD_CELLREFLIST_H
 
-#include <list>
+#include <components/misc/chunkedlist.hpp>
 
 #include "livecellref.hpp"
 
 namespace MWWorld
 {
     /// \brief Collection of references of one type
+    ///
+    /// \note References are never moved once added, so Ptrs to them and iterators stay valid.
     template <typename X>
     struct CellRefList
     {
         typedef LiveCellRef<X> LiveRef;
-        typedef std::list<LiveRef> List;
+        typedef Misc::ChunkedList<LiveRef> List;
         List mList;
 
         /// Search for the given reference in the given reclist from
@@ -1,12 +1,19 @@
 #include "cells.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include <OpenThreads/Thread>
 
 #include <components/esm/esmreader.hpp>
 #include <components/esm/esmwriter.hpp>
 #include <components/esm/defs.hpp>
 #include <components/esm/cellstate.hpp>
 #include <components/loadinglistener/loadinglistener.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/sceneutil/workqueue.hpp>
 
 #include "../mwbase/environment.hpp"
 #include "../mwbase/world.hpp"
@@ -16,6 +23,51 @@
 #include "containerstore.hpp"
 #include "cellstore.hpp"
 
+namespace
+{
+    /// Serializes a share of the cell snapshots into separate buffers, so that several of these can run at once.
+    class WriteCellsWorkItem : public SceneUtil::WorkItem
+    {
+    public:
+        void addCell (const MWWorld::CellStore::Snapshot* snapshot, std::string* buffer)
+        {
+            mCells.push_back (std::make_pair (snapshot, buffer));
+        }
+
+        virtual void doWork()
+        {
+            OPENMW_PROFILE_ZONE("WriteCellsWorkItem::doWork");
+            try
+            {
+                for (std::vector<std::pair<const MWWorld::CellStore::Snapshot*, std::string*> >::const_iterator
+                     it = mCells.begin(); it != mCells.end(); ++it)
+                {
+                    std::ostringstream stream;
+                    ESM::ESMWriter writer;
+                    writer.setStream (stream);
+                    it->first->write (writer);
+                    writer.close();
+                    *it->second = stream.str();
+                }
+            }
+            catch (const std::exception& e)
+            {
+                mError = e.what();
+            }
+        }
+
+        /// Empty unless doWork failed. Only valid once the item is done.
+        const std::string& getError() const
+        {
+            return mError;
+        }
+
+    private:
+        std::string mError;
+        std::vector<std::pair<const MWWorld::CellStore::Snapshot*, std::string*> > mCells;
+    };
+}
+
 MWWorld::CellStore *MWWorld::Cells::getCellStore (const ESM::Cell *cell)
 {
     if (cell->mData.mFlags & ESM::Cell::Interior)
@@ -69,29 +121,16 @@ MWWorld::Ptr MWWorld::Cells::getPtrAndCache (const std::string& name, CellStore&
     return ptr;
 }
 
-void MWWorld::Cells::writeCell (ESM::ESMWriter& writer, CellStore& cell) const
-{
-    if (cell.getState()!=CellStore::State_Loaded)
-        cell.load ();
-
-    ESM::CellState cellState;
-
-    cell.saveState (cellState);
-
-    writer.startRecord (ESM::REC_CSTA);
-    cellState.mId.save (writer);
-    cellState.save (writer);
-    cell.writeFog(writer);
-    cell.writeReferences (writer);
-    writer.endRecord (ESM::REC_CSTA);
-}
-
 MWWorld::Cells::Cells (const MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& reader)
 : mStore (store), mReader (reader),
   mIdCache (40, std::pair<std::string, CellStore *> ("", (CellStore*)0)), /// \todo make cache size configurable
   mIdCacheIndex (0)
 {}
 
+MWWorld::Cells::~Cells()
+{
+}
+
 MWWorld::CellStore *MWWorld::Cells::getExterior (int x, int y)
 {
     std::map<std::pair<int, int>, CellStore>::iterator result =
@@ -288,21 +327,70 @@ int MWWorld::Cells::countSavedGameRecords() const
 
 void MWWorld::Cells::write (ESM::ESMWriter& writer, Loading::Listener& progress) const
 {
+    std::vector<CellStore*> cells;
+
     for (std::map<std::pair<int, int>, CellStore>::iterator iter (mExteriors.begin());
         iter!=mExteriors.end(); ++iter)
         if (iter->second.hasState())
-        {
-            writeCell (writer, iter->second);
-            progress.increaseProgress();
-        }
+            cells.push_back (&iter->second);
 
     for (std::map<std::string, CellStore>::iterator iter (mInteriors.begin());
         iter!=mInteriors.end(); ++iter)
         if (iter->second.hasState())
+            cells.push_back (&iter->second);
+
+    // Loading reads the content files and the snapshots read live objects, so both stay on the main thread.
+    // Only the serialization of the snapshots runs on the workers.
+    std::vector<CellStore::Snapshot> snapshots (cells.size());
+    for (std::size_t i=0; i<cells.size(); ++i)
+    {
+        if (cells[i]->getState()!=CellStore::State_Loaded)
+            cells[i]->load();
+
+        cells[i]->takeSnapshot (snapshots[i]);
+    }
+
+    int numThreads = std::max (1, std::min (OpenThreads::GetNumberOfProcessors(), static_cast<int> (cells.size())));
+
+    if (numThreads == 1)
+    {
+        for (std::vector<CellStore::Snapshot>::const_iterator iter (snapshots.begin()); iter!=snapshots.end(); ++iter)
         {
-            writeCell (writer, iter->second);
+            iter->write (writer);
             progress.increaseProgress();
         }
+        return;
+    }
+
+    if (!mWriteQueue)
+        mWriteQueue = new SceneUtil::WorkQueue (std::max (1, OpenThreads::GetNumberOfProcessors()));
+
+    std::vector<std::string> buffers (snapshots.size());
+
+    std::vector<osg::ref_ptr<WriteCellsWorkItem> > items;
+    for (int i=0; i<numThreads; ++i)
+        items.push_back (new WriteCellsWorkItem);
+
+    for (std::size_t i=0; i<snapshots.size(); ++i)
+        items[i % numThreads]->addCell (&snapshots[i], &buffers[i]);
+
+    for (std::vector<osg::ref_ptr<WriteCellsWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+        mWriteQueue->addWorkItem (*it);
+
+    // Join the buffers in the same order as the serial path writes the cells
+    for (std::size_t i=0; i<buffers.size(); ++i)
+    {
+        items[i % numThreads]->waitTillDone();
+        if (!items[i % numThreads]->getError().empty())
+        {
+            // the other items still use the snapshots and buffers
+            for (std::vector<osg::ref_ptr<WriteCellsWorkItem> >::iterator it = items.begin(); it != items.end(); ++it)
+                (*it)->waitTillDone();
+            throw std::runtime_error ("failed to write cell: " + items[i % numThreads]->getError());
+        }
+        writer.writeRecords (buffers[i], 1);
+        progress.increaseProgress();
+    }
 }
 
 struct GetCellStoreCallback : public MWWorld::CellStore::GetCellStoreCallback
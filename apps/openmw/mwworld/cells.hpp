@@ -5,6 +5,8 @@
 #include <list>
 #include <string>
 
+#include <osg/ref_ptr>
+
 #include "ptr.hpp"
 
 namespace ESM
@@ -20,6 +22,11 @@ namespace Loading
     class Listener;
 }
 
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
 namespace MWWorld
 {
     class ESMStore;
@@ -33,6 +40,7 @@ namespace MWWorld
             mutable std::map<std::pair<int, int>, CellStore> mExteriors;
             std::vector<std::pair<std::string, CellStore *> > mIdCache;
             std::size_t mIdCacheIndex;
+            mutable osg::ref_ptr<SceneUtil::WorkQueue> mWriteQueue;
 
             Cells (const Cells&);
             Cells& operator= (const Cells&);
@@ -41,14 +49,14 @@ namespace MWWorld
 
             Ptr getPtrAndCache (const std::string& name, CellStore& cellStore);
 
-            void writeCell (ESM::ESMWriter& writer, CellStore& cell) const;
-
         public:
 
             void clear();
 
             Cells (const MWWorld::ESMStore& store, std::vector<ESM::ESMReader>& reader);
 
+            ~Cells();
+
             CellStore *getExterior (int x, int y);
 
             CellStore *getInterior (const std::string& name);
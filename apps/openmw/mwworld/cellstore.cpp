@@ -65,7 +65,7 @@ namespace
     }
 
     template<typename RecordType, typename T>
-    void writeReferenceCollection (ESM::ESMWriter& writer,
+    void copyReferenceCollection (std::vector<std::pair<unsigned int, boost::shared_ptr<ESM::ObjectState> > >& states,
         const MWWorld::CellRefList<T>& collection)
     {
         if (!collection.mList.empty())
@@ -86,13 +86,11 @@ namespace
                     continue;
                 }
 
-                RecordType state;
-                iter->save (state);
+                boost::shared_ptr<RecordType> state (new RecordType);
+                iter->save (*state);
 
                 // recordId currently unused
-                writer.writeHNT ("OBJE", collection.mList.front().mBase->sRecordId);
-
-                state.save (writer);
+                states.push_back (std::make_pair (collection.mList.front().mBase->sRecordId, state));
             }
         }
     }
@@ -178,7 +176,7 @@ namespace MWWorld
 
         if (const X *ptr = store.search (ref.mRefID))
         {
-            typename std::list<LiveRef>::iterator iter =
+            typename List::iterator iter =
                 std::find(mList.begin(), mList.end(), ref.mRefNum);
 
             LiveRef liveCellRef (ref, ptr);
@@ -359,9 +357,12 @@ namespace MWWorld
     {
         PtrType mFound;
         std::string mIdToFind;
+        // rejects most references without comparing strings
+        Misc::StringId mStringIdToFind;
         bool operator()(const PtrType& ptr)
         {
-            if (ptr.getCellRef().getRefId() == mIdToFind)
+            // the search is case-sensitive, so only the exact ID matches
+            if (ptr.getCellRef().getRefStringId() == mStringIdToFind && ptr.getCellRef().getRefId() == mIdToFind)
             {
                 mFound = ptr;
                 return false;
@@ -374,6 +375,7 @@ namespace MWWorld
     {
         SearchVisitor<MWWorld::Ptr> searchVisitor;
         searchVisitor.mIdToFind = id;
+        searchVisitor.mStringIdToFind = Misc::StringId::find(id);
         forEach(searchVisitor);
         return searchVisitor.mFound;
     }
@@ -382,6 +384,7 @@ namespace MWWorld
     {
         SearchVisitor<MWWorld::ConstPtr> searchVisitor;
         searchVisitor.mIdToFind = id;
+        searchVisitor.mStringIdToFind = Misc::StringId::find(id);
         forEachConst(searchVisitor);
         return searchVisitor.mFound;
     }
@@ -437,7 +440,7 @@ namespace MWWorld
 
             // TODO: the pathgrid graph only needs to be loaded for active cells, so move this somewhere else.
             // In a simple test, loading the graph for all cells in MW + expansions took 200 ms
-            mPathgridGraph.load(this);
+            mPathgridGraph.load(mCell, MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*mCell));
         }
     }
 
@@ -629,52 +632,77 @@ namespace MWWorld
         state.mLastRespawn = mLastRespawn.toEsm();
     }
 
-    void CellStore::writeFog(ESM::ESMWriter &writer) const
+    void CellStore::readFog(ESM::ESMReader &reader)
     {
-        if (mFogState.get())
+        mFogState.reset(new ESM::FogState());
+        mFogState->load(reader);
+    }
+
+    CellStore::Snapshot::Snapshot()
+    : mInterior (false)
+    {}
+
+    void CellStore::Snapshot::write (ESM::ESMWriter& writer) const
+    {
+        writer.startRecord (ESM::REC_CSTA);
+        mState.mId.save (writer);
+        mState.save (writer);
+
+        if (mFog)
+            mFog->save (writer, mInterior);
+
+        for (std::vector<std::pair<unsigned int, boost::shared_ptr<ESM::ObjectState> > >::const_iterator
+            it = mReferences.begin(); it != mReferences.end(); ++it)
+        {
+            writer.writeHNT ("OBJE", it->first);
+            it->second->save (writer);
+        }
+
+        for (std::vector<std::pair<ESM::RefNum, ESM::CellId> >::const_iterator it = mMovedReferences.begin();
+            it != mMovedReferences.end(); ++it)
         {
-            mFogState->save(writer, mCell->mData.mFlags & ESM::Cell::Interior);
+            it->first.save (writer, true, "MVRF");
+            it->second.save (writer);
         }
+
+        writer.endRecord (ESM::REC_CSTA);
     }
 
-    void CellStore::readFog(ESM::ESMReader &reader)
+    void CellStore::takeSnapshot (Snapshot& snapshot) const
     {
-        mFogState.reset(new ESM::FogState());
-        mFogState->load(reader);
-    }
+        saveState (snapshot.mState);
 
-    void CellStore::writeReferences (ESM::ESMWriter& writer) const
-    {
-        writeReferenceCollection<ESM::ObjectState> (writer, mActivators);
-        writeReferenceCollection<ESM::ObjectState> (writer, mPotions);
-        writeReferenceCollection<ESM::ObjectState> (writer, mAppas);
-        writeReferenceCollection<ESM::ObjectState> (writer, mArmors);
-        writeReferenceCollection<ESM::ObjectState> (writer, mBooks);
-        writeReferenceCollection<ESM::ObjectState> (writer, mClothes);
-        writeReferenceCollection<ESM::ContainerState> (writer, mContainers);
-        writeReferenceCollection<ESM::CreatureState> (writer, mCreatures);
-        writeReferenceCollection<ESM::DoorState> (writer, mDoors);
-        writeReferenceCollection<ESM::ObjectState> (writer, mIngreds);
-        writeReferenceCollection<ESM::CreatureLevListState> (writer, mCreatureLists);
-        writeReferenceCollection<ESM::ObjectState> (writer, mItemLists);
-        writeReferenceCollection<ESM::ObjectState> (writer, mLights);
-        writeReferenceCollection<ESM::ObjectState> (writer, mLockpicks);
-        writeReferenceCollection<ESM::ObjectState> (writer, mMiscItems);
-        writeReferenceCollection<ESM::NpcState> (writer, mNpcs);
-        writeReferenceCollection<ESM::ObjectState> (writer, mProbes);
-        writeReferenceCollection<ESM::ObjectState> (writer, mRepairs);
-        writeReferenceCollection<ESM::ObjectState> (writer, mStatics);
-        writeReferenceCollection<ESM::ObjectState> (writer, mWeapons);
-        writeReferenceCollection<ESM::ObjectState> (writer, mBodyParts);
+        if (mFogState.get())
+            snapshot.mFog.reset (new ESM::FogState (*mFogState));
+        snapshot.mInterior = (mCell->mData.mFlags & ESM::Cell::Interior) != 0;
+
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mActivators);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mPotions);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mAppas);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mArmors);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mBooks);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mClothes);
+        copyReferenceCollection<ESM::ContainerState> (snapshot.mReferences, mContainers);
+        copyReferenceCollection<ESM::CreatureState> (snapshot.mReferences, mCreatures);
+        copyReferenceCollection<ESM::DoorState> (snapshot.mReferences, mDoors);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mIngreds);
+        copyReferenceCollection<ESM::CreatureLevListState> (snapshot.mReferences, mCreatureLists);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mItemLists);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mLights);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mLockpicks);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mMiscItems);
+        copyReferenceCollection<ESM::NpcState> (snapshot.mReferences, mNpcs);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mProbes);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mRepairs);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mStatics);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mWeapons);
+        copyReferenceCollection<ESM::ObjectState> (snapshot.mReferences, mBodyParts);
 
         for (MovedRefTracker::const_iterator it = mMovedToAnotherCell.begin(); it != mMovedToAnotherCell.end(); ++it)
         {
             LiveCellRefBase* base = it->first;
-            ESM::RefNum refNum = base->mRef.getRefNum();
-            ESM::CellId movedTo = it->second->getCell()->getCellId();
-
-            refNum.save(writer, true, "MVRF");
-            movedTo.save(writer);
+            snapshot.mMovedReferences.push_back (std::make_pair (base->mRef.getRefNum(),
+                it->second->getCell()->getCellId()));
         }
     }
 
@@ -879,6 +907,11 @@ namespace MWWorld
         return mPathgridGraph.aStarSearch(start, end);
     }
 
+    void CellStore::preloadPathgrid(SceneUtil::WorkQueue *workQueue)
+    {
+        mPathgridGraph.prepareNextHops(MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*mCell), workQueue);
+    }
+
     void CellStore::setFog(ESM::FogState *fog)
     {
         mFogState.reset(fog);
@@ -6,6 +6,7 @@
 #include <string>
 #include <typeinfo>
 #include <map>
+#include <list>
 
 #include <boost/shared_ptr.hpp>
 
@@ -32,6 +33,7 @@
 #include <components/esm/loadnpc.hpp>
 #include <components/esm/loadmisc.hpp>
 #include <components/esm/loadbody.hpp>
+#include <components/esm/cellstate.hpp>
 
 #include "../mwmechanics/pathgrid.hpp"  // TODO: maybe belongs in mwworld
 
@@ -43,6 +45,7 @@ namespace ESM
     struct CellState;
     struct FogState;
     struct CellId;
+    struct ObjectState;
 }
 
 namespace MWWorld
@@ -349,11 +352,29 @@ namespace MWWorld
 
             void saveState (ESM::CellState& state) const;
 
-            void writeFog (ESM::ESMWriter& writer) const;
+            /// A copy of everything that goes into the CSTA record of a cell, so that it can be
+            /// written without touching the cell, e.g. on a worker thread.
+            struct Snapshot
+            {
+                ESM::CellState mState;
+                boost::shared_ptr<ESM::FogState> mFog;
+                bool mInterior;
 
-            void readFog (ESM::ESMReader& reader);
+                /// Record type and state of each reference that needs to be saved
+                std::vector<std::pair<unsigned int, boost::shared_ptr<ESM::ObjectState> > > mReferences;
+
+                /// References that were moved to another cell
+                std::vector<std::pair<ESM::RefNum, ESM::CellId> > mMovedReferences;
 
-            void writeReferences (ESM::ESMWriter& writer) const;
+                Snapshot();
+
+                void write (ESM::ESMWriter& writer) const;
+            };
+
+            void takeSnapshot (Snapshot& snapshot) const;
+            ///< Copies the state of the cell and of its references. Must be called from the main thread.
+
+            void readFog (ESM::ESMReader& reader);
 
             struct GetCellStoreCallback
             {
@@ -372,6 +393,9 @@ namespace MWWorld
 
             std::list<ESM::Pathgrid::Point> aStarSearch(const int start, const int end) const;
 
+            /// Build the shortest path table of a small pathgrid in the background. Call from the main thread.
+            void preloadPathgrid(SceneUtil::WorkQueue* workQueue);
+
         private:
 
             /// Run through references and store IDs
@@ -4,6 +4,8 @@
 #include <typeinfo>
 #include <stdexcept>
 
+#include <OpenThreads/Atomic>
+
 #include <components/esm/inventorystate.hpp>
 
 #include "../mwbase/environment.hpp"
@@ -21,6 +23,9 @@
 
 namespace
 {
+    // atomic, containers in preloaded cells are constructed on the preload threads
+    OpenThreads::Atomic sLastStateId;
+
     template<typename T>
     float getTotalWeight (const MWWorld::CellRefList<T>& cellRefList)
     {
@@ -42,12 +47,14 @@ namespace
     MWWorld::Ptr searchId (MWWorld::CellRefList<T>& list, const std::string& id,
         MWWorld::ContainerStore *store)
     {
-        std::string id2 = Misc::StringUtils::lowerCase (id);
+        Misc::StringId stringId = Misc::StringId::find(id);
+        if (stringId.empty())
+            return MWWorld::Ptr();
 
         for (typename MWWorld::CellRefList<T>::List::iterator iter (list.mList.begin());
              iter!=list.mList.end(); ++iter)
         {
-            if (Misc::StringUtils::ciEqual(iter->mBase->mId, id2))
+            if (iter->mRef.getRefStringId() == stringId)
             {
                 MWWorld::Ptr ptr (&*iter, 0);
                 ptr.setContainerStore (store);
@@ -113,7 +120,7 @@ void MWWorld::ContainerStore::storeStates (const CellRefList<T>& collection,
 
 const std::string MWWorld::ContainerStore::sGoldId = "gold_001";
 
-MWWorld::ContainerStore::ContainerStore() : mCachedWeight (0), mWeightUpToDate (false) {}
+MWWorld::ContainerStore::ContainerStore() : mCachedWeight (0), mWeightUpToDate (false), mStateId (static_cast<int>(++sLastStateId)) {}
 
 MWWorld::ContainerStore::~ContainerStore() {}
 
@@ -130,8 +137,11 @@ MWWorld::ContainerStoreIterator MWWorld::ContainerStore::end()
 int MWWorld::ContainerStore::count(const std::string &id)
 {
     int total=0;
+    Misc::StringId stringId = Misc::StringId::find(id);
+    if (stringId.empty())
+        return 0;
     for (MWWorld::ContainerStoreIterator iter (begin()); iter!=end(); ++iter)
-        if (Misc::StringUtils::ciEqual(iter->getCellRef().getRefId(), id))
+        if (iter->getCellRef().getRefStringId() == stringId)
             total += iter->getRefData().getCount();
     return total;
 }
@@ -183,7 +193,7 @@ bool MWWorld::ContainerStore::stacks(const ConstPtr& ptr1, const ConstPtr& ptr2)
     const MWWorld::Class& cls1 = ptr1.getClass();
     const MWWorld::Class& cls2 = ptr2.getClass();
 
-    if (!Misc::StringUtils::ciEqual(ptr1.getCellRef().getRefId(), ptr2.getCellRef().getRefId()))
+    if (ptr1.getCellRef().getRefStringId() != ptr2.getCellRef().getRefStringId())
         return false;
 
     // If it has an enchantment, don't stack when some of the charge is already used
@@ -308,9 +318,10 @@ MWWorld::ContainerStoreIterator MWWorld::ContainerStore::addImp (const Ptr& ptr,
     {
         int realCount = count * ptr.getClass().getValue(ptr);
 
+        Misc::StringId goldId = Misc::StringId::find(MWWorld::ContainerStore::sGoldId);
         for (MWWorld::ContainerStoreIterator iter (begin(type)); iter!=end(); ++iter)
         {
-            if (Misc::StringUtils::ciEqual((*iter).getCellRef().getRefId(), MWWorld::ContainerStore::sGoldId))
+            if ((*iter).getCellRef().getRefStringId() == goldId)
             {
                 iter->getRefData().setCount(iter->getRefData().getCount() + realCount);
                 flagAsModified();
@@ -368,8 +379,9 @@ int MWWorld::ContainerStore::remove(const std::string& itemId, int count, const
 {
     int toRemove = count;
 
-    for (ContainerStoreIterator iter(begin()); iter != end() && toRemove > 0; ++iter)
-        if (Misc::StringUtils::ciEqual(iter->getCellRef().getRefId(), itemId))
+    Misc::StringId stringId = Misc::StringId::find(itemId);
+    for (ContainerStoreIterator iter(begin()); iter != end() && toRemove > 0 && !stringId.empty(); ++iter)
+        if (iter->getCellRef().getRefStringId() == stringId)
             toRemove -= remove(*iter, toRemove, actor);
 
     flagAsModified();
@@ -560,6 +572,12 @@ void MWWorld::ContainerStore::clear()
 void MWWorld::ContainerStore::flagAsModified()
 {
     mWeightUpToDate = false;
+    mStateId = static_cast<int>(++sLastStateId);
+}
+
+int MWWorld::ContainerStore::getStateId() const
+{
+    return mStateId;
 }
 
 float MWWorld::ContainerStore::getWeight() const
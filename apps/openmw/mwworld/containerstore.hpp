@@ -75,6 +75,7 @@ namespace MWWorld
 
             mutable float mCachedWeight;
             mutable bool mWeightUpToDate;
+            int mStateId;
             ContainerStoreIterator addImp (const Ptr& ptr, int count);
             void addInitialItem (const std::string& id, const std::string& owner, int count, bool topLevel=true, const std::string& levItem = "");
 
@@ -165,6 +166,10 @@ namespace MWWorld
             float getWeight() const;
             ///< Return total weight of the items contained in *this.
 
+            int getStateId() const;
+            ///< Changes whenever items are added to or removed from this container. A new state never repeats an
+            /// earlier state of any container, but a copy of a container starts out with the same state.
+
             static int getType (const ConstPtr& ptr);
             ///< This function throws an exception, if ptr does not point to an object, that can be
             /// put into a container.
@@ -0,0 +1,151 @@
+#include "navmeshmanager.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <components/esm/loadcell.hpp>
+#include <components/esm/loadland.hpp>
+#include <components/esm/loadpgrd.hpp>
+#include <components/misc/profiler.hpp>
+#include <components/settings/settings.hpp>
+
+#include "../mwbase/environment.hpp"
+#include "../mwbase/world.hpp"
+
+#include "../mwphysics/physicssystem.hpp"
+
+#include "cellstore.hpp"
+#include "esmstore.hpp"
+
+namespace
+{
+
+    const float sMaxColumns = 1024.f * 1024.f;
+
+    /// Worker thread item: triangulate the collision shapes of a cell and rasterize them into its tile.
+    class BuildTileItem : public SceneUtil::WorkItem
+    {
+    public:
+        /// Takes over the contents of \a shapes. Constructor to be called from the main thread.
+        BuildTileItem(NavMesh::Tile* tile, MWPhysics::NavMeshShapeList& shapes)
+            : mTile(tile)
+        {
+            mShapes.swap(shapes);
+        }
+
+        virtual void doWork()
+        {
+            NavMesh::Geometry geometry;
+            MWPhysics::PhysicsSystem::getNavMeshGeometry(mShapes, geometry);
+            mShapes.clear();
+            mTile->build(geometry);
+        }
+
+    private:
+        osg::ref_ptr<NavMesh::Tile> mTile;
+        MWPhysics::NavMeshShapeList mShapes;
+    };
+
+}
+
+namespace MWWorld
+{
+
+    NavMeshManager::NavMeshManager(MWPhysics::PhysicsSystem *physics, SceneUtil::WorkQueue *workQueue)
+        : mPhysics(physics)
+        , mWorkQueue(workQueue)
+        , mMaxCachedTiles(std::max(0, Settings::Manager::getInt("max cached tiles", "Navigator")))
+        , mUseCounter(0)
+    {
+        mSettings.mCellSize = Settings::Manager::getFloat("cell size", "Navigator");
+        mSettings.mCellHeight = Settings::Manager::getFloat("cell height", "Navigator");
+    }
+
+    NavMeshManager::~NavMeshManager()
+    {
+        clear();
+    }
+
+    void NavMeshManager::addCell(const CellStore *cell)
+    {
+        TileEntry& entry = mTiles[cell];
+        entry.mActive = true;
+        if (entry.mTile)
+            return;
+
+        // the AI only uses the tiles of cells without a pathgrid
+        const ESM::Pathgrid* pathgrid = MWBase::Environment::get().getWorld()->getStore().get<ESM::Pathgrid>().search(*cell->getCell());
+        if (pathgrid && !pathgrid->mPoints.empty())
+            return;
+
+        OPENMW_PROFILE_ZONE("NavMeshManager::addCell");
+
+        osg::BoundingBox bounds;
+        if (cell->getCell()->isExterior())
+        {
+            const float cellSize = ESM::Land::REAL_SIZE;
+            bounds = osg::BoundingBox(cell->getCell()->getGridX() * cellSize, cell->getCell()->getGridY() * cellSize, 0.f,
+                                      (cell->getCell()->getGridX() + 1) * cellSize, (cell->getCell()->getGridY() + 1) * cellSize, 0.f);
+        }
+
+        MWPhysics::NavMeshShapeList shapes;
+        mPhysics->getNavMeshShapes(bounds, shapes);
+        if (shapes.empty())
+            return;
+        if (!bounds.valid())
+        {
+            for (MWPhysics::NavMeshShapeList::const_iterator it = shapes.begin(); it != shapes.end(); ++it)
+                bounds.expandBy(it->mBounds);
+        }
+
+        // use coarser columns for very large interiors, rather than running out of memory
+        NavMesh::Settings settings = mSettings;
+        float area = (bounds.xMax() - bounds.xMin()) * (bounds.yMax() - bounds.yMin());
+        settings.mCellSize = std::max(settings.mCellSize, std::sqrt(area / sMaxColumns));
+
+        entry.mTile = new NavMesh::Tile(bounds, settings);
+        entry.mBuildItem = new BuildTileItem(entry.mTile, shapes);
+        mWorkQueue->addWorkItem(entry.mBuildItem);
+    }
+
+    void NavMeshManager::removeCell(const CellStore *cell)
+    {
+        TileMap::iterator found = mTiles.find(cell);
+        if (found == mTiles.end())
+            return;
+        found->second.mActive = false;
+        found->second.mLastUsed = ++mUseCounter;
+
+        // drop the tiles of the cells that were left the longest time ago
+        unsigned int numCached = 0;
+        for (TileMap::const_iterator it = mTiles.begin(); it != mTiles.end(); ++it)
+            if (!it->second.mActive)
+                ++numCached;
+
+        while (numCached > mMaxCachedTiles)
+        {
+            TileMap::iterator oldest = mTiles.end();
+            for (TileMap::iterator it = mTiles.begin(); it != mTiles.end(); ++it)
+                if (!it->second.mActive && (oldest == mTiles.end() || it->second.mLastUsed < oldest->second.mLastUsed))
+                    oldest = it;
+
+            // the work item holds on to the tile until it is done
+            mTiles.erase(oldest);
+            --numCached;
+        }
+    }
+
+    bool NavMeshManager::findPath(const CellStore *cell, const osg::Vec3f &start, const osg::Vec3f &end, std::vector<osg::Vec3f> &path) const
+    {
+        TileMap::const_iterator found = mTiles.find(cell);
+        if (found == mTiles.end() || !found->second.mBuildItem || !found->second.mBuildItem->isDone())
+            return false;
+        return found->second.mTile->findPath(start, end, path);
+    }
+
+    void NavMeshManager::clear()
+    {
+        mTiles.clear();
+    }
+
+}
@@ -0,0 +1,69 @@
+#ifndef OPENMW_MWWORLD_NAVMESHMANAGER_H
+#define OPENMW_MWWORLD_NAVMESHMANAGER_H
+
+#include <map>
+#include <vector>
+
+#include <osg/ref_ptr>
+#include <osg/Vec3f>
+
+#include <components/navmesh/tile.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+namespace MWPhysics
+{
+    class PhysicsSystem;
+}
+
+namespace MWWorld
+{
+    class CellStore;
+
+    /// @brief Builds a navigation mesh tile for each loaded cell without a pathgrid on the background threads, for the
+    /// AI to find paths through these cells.
+    /// @par Tiles are kept after their cell is unloaded, so going back and forth between cells does not rebuild them.
+    /// They are built from the collision geometry at the time the cell is first loaded and never rebuilt, objects moved
+    /// later are not taken into account. Paths do not cross cell borders.
+    class NavMeshManager
+    {
+    public:
+        NavMeshManager(MWPhysics::PhysicsSystem* physics, SceneUtil::WorkQueue* workQueue);
+        ~NavMeshManager();
+
+        /// Collect the collision shapes of the cell and queue building its tile, unless there is one already or
+        /// the cell has a pathgrid.
+        /// @note Call after the cell's objects were added to the physics system.
+        void addCell(const CellStore* cell);
+
+        /// Allow the tile of the cell to be dropped from the cache.
+        void removeCell(const CellStore* cell);
+
+        /// Find a path with the tile of \a cell.
+        /// @return false if the tile is not built yet or there is no path on it
+        bool findPath(const CellStore* cell, const osg::Vec3f& start, const osg::Vec3f& end, std::vector<osg::Vec3f>& path) const;
+
+        void clear();
+
+    private:
+        MWPhysics::PhysicsSystem* mPhysics;
+        osg::ref_ptr<SceneUtil::WorkQueue> mWorkQueue;
+        NavMesh::Settings mSettings;
+        unsigned int mMaxCachedTiles;
+
+        struct TileEntry
+        {
+            TileEntry() : mActive(false), mLastUsed(0) {}
+
+            osg::ref_ptr<SceneUtil::WorkItem> mBuildItem;
+            osg::ref_ptr<NavMesh::Tile> mTile;
+            bool mActive;
+            unsigned int mLastUsed;
+        };
+        typedef std::map<const CellStore*, TileEntry> TileMap;
+        TileMap mTiles;
+        unsigned int mUseCounter;
+    };
+
+}
+
+#endif
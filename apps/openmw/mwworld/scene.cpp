@@ -25,6 +25,7 @@
 #include "cellvisitors.hpp"
 #include "cellstore.hpp"
 #include "cellpreloader.hpp"
+#include "navmeshmanager.hpp"
 
 namespace
 {
@@ -212,11 +213,7 @@ namespace MWWorld
         ListAndResetObjectsVisitor visitor;
 
         (*iter)->forEach<ListAndResetObjectsVisitor>(visitor);
-        for (std::vector<MWWorld::Ptr>::const_iterator iter2 (visitor.mObjects.begin());
-            iter2!=visitor.mObjects.end(); ++iter2)
-        {
-            mPhysics->remove(*iter2);
-        }
+        mPhysics->removeObjects(visitor.mObjects);
 
         if ((*iter)->getCell()->isExterior())
         {
@@ -231,6 +228,9 @@ namespace MWWorld
 
         MWBase::Environment::get().getMechanicsManager()->drop (*iter);
 
+        if (mNavMesh.get())
+            mNavMesh->removeCell(*iter);
+
         mRendering.removeCell(*iter);
         MWBase::Environment::get().getWindowManager()->removeCell(*iter);
 
@@ -248,9 +248,6 @@ namespace MWWorld
         {
             std::cout << "Loading cell " << cell->getCell()->getDescription() << std::endl;
 
-            float verts = ESM::Land::LAND_SIZE;
-            float worldsize = ESM::Land::REAL_SIZE;
-
             // Load terrain physics first...
             if (cell->getCell()->isExterior())
             {
@@ -259,15 +256,7 @@ namespace MWWorld
                         cell->getCell()->getGridX(),
                         cell->getCell()->getGridY()
                     );
-                if (land && land->mDataTypes&ESM::Land::DATA_VHGT) {
-                    // Actually only VHGT is needed here, but we'll need the rest for rendering anyway.
-                    // Load everything now to reduce IO overhead.
-                    const int flags = ESM::Land::DATA_VCLR|ESM::Land::DATA_VHGT|ESM::Land::DATA_VNML|ESM::Land::DATA_VTEX;
-
-                    const ESM::Land::LandData *data = land->getLandData (flags);
-                    mPhysics->addHeightField (data->mHeights, cell->getCell()->getGridX(), cell->getCell()->getGridY(),
-                        worldsize / (verts-1), verts);
-                }
+                mPhysics->addHeightField (cell->getCell()->getGridX(), cell->getCell()->getGridY(), land);
             }
 
             cell->respawn();
@@ -280,7 +269,12 @@ namespace MWWorld
             /// \todo rescale depending on the state of a new GMST
             insertCell (*cell, true, loadingListener);
 
+            // Attaches the terrain the preload threads built in changeCellGrid. Without preloading, or if the preload
+            // failed, the terrain of the cell is built synchronously here instead.
             mRendering.addCell(cell);
+            mRendering.batchStatics(cell);
+            if (mNavMesh.get())
+                mNavMesh->addCell(cell);
             bool waterEnabled = cell->getCell()->hasWater() || cell->isExterior();
             float waterLevel = cell->getWaterLevel();
             mRendering.setWaterEnabled(waterEnabled);
@@ -306,6 +300,10 @@ namespace MWWorld
             unloadCell (active++);
         assert(mActiveCells.empty());
         mCurrentCell = NULL;
+
+        // the cells may be deleted after this
+        if (mNavMesh.get())
+            mNavMesh->clear();
     }
 
     void Scene::playerMoved(const osg::Vec3f &pos)
@@ -375,7 +373,14 @@ namespace MWWorld
                 }
 
                 if (iter==mActiveCells.end())
-                    refsToLoad += MWBase::Environment::get().getWorld()->getExterior(x, y)->count();
+                {
+                    CellStore* cell = MWBase::Environment::get().getWorld()->getExterior(x, y);
+                    refsToLoad += cell->count();
+
+                    // let the preload threads build the terrain and load the models while the cells are loaded one by one
+                    if (mPreloadEnabled)
+                        mPreloader->preload(cell, mRendering.getReferenceTime());
+                }
             }
         }
 
@@ -458,8 +463,12 @@ namespace MWWorld
     , mPreloadDoors(Settings::Manager::getBool("preload doors", "Cells"))
     , mPreloadFastTravel(Settings::Manager::getBool("preload fast travel", "Cells"))
     {
-        mPreloader.reset(new CellPreloader(rendering.getResourceSystem(), physics->getShapeManager(), rendering.getTerrain()));
+        mPreloader.reset(new CellPreloader(rendering.getResourceSystem(), physics->getShapeManager(), physics->getHeightFieldManager(), rendering.getTerrain()));
         mPreloader->setWorkQueue(mRendering.getWorkQueue());
+        mPreloader->setPreloadPathgrids(Settings::Manager::getBool("preload pathgrids", "Cells"));
+
+        if (Settings::Manager::getBool("enable", "Navigator"))
+            mNavMesh.reset(new NavMeshManager(physics, mRendering.getWorkQueue()));
 
         mPhysics->setUnrefQueue(rendering.getUnrefQueue());
 
@@ -574,7 +583,9 @@ namespace MWWorld
     {
         InsertVisitor insertVisitor (cell, rescale, *loadingListener, *mPhysics, mRendering);
         cell.forEach (insertVisitor);
+        mPhysics->beginObjectBatch();
         insertVisitor.insert();
+        mPhysics->endObjectBatch();
 
         // do adjustPosition (snapping actors to ground) after objects are loaded, so we don't depend on the loading order
         AdjustPositionVisitor adjustPosVisitor;
@@ -789,4 +800,12 @@ namespace MWWorld
             }
         }
     }
+
+    bool Scene::findNavMeshPath(const CellStore *cell, const osg::Vec3f &start, const osg::Vec3f &end,
+                                std::vector<osg::Vec3f> &path) const
+    {
+        if (!mNavMesh.get())
+            return false;
+        return mNavMesh->findPath(cell, start, end, path);
+    }
 }
@@ -6,6 +6,7 @@
 
 #include <set>
 #include <memory>
+#include <vector>
 
 namespace osg
 {
@@ -43,6 +44,7 @@ namespace MWWorld
     class Player;
     class CellStore;
     class CellPreloader;
+    class NavMeshManager;
 
     class Scene
     {
@@ -58,6 +60,7 @@ namespace MWWorld
             MWPhysics::PhysicsSystem *mPhysics;
             MWRender::RenderingManager& mRendering;
             std::auto_ptr<CellPreloader> mPreloader;
+            std::auto_ptr<NavMeshManager> mNavMesh;
             float mPreloadTimer;
             int mHalfGridSize;
             float mCellLoadingThreshold;
@@ -128,6 +131,11 @@ namespace MWWorld
             bool isCellActive(const CellStore &cell);
 
             Ptr searchPtrViaActorId (int actorId);
+
+            /// Find a path on the navigation mesh of \a cell.
+            /// @return false if the navigation mesh is disabled or not built yet, or there is no path
+            bool findNavMeshPath(const CellStore* cell, const osg::Vec3f& start, const osg::Vec3f& end,
+                                 std::vector<osg::Vec3f>& path) const;
     };
 }
 
@@ -16,6 +16,7 @@
 #include <components/esm/cellid.hpp>
 
 #include <components/misc/rng.hpp>
+#include <components/misc/profiler.hpp>
 
 #include <components/files/collections.hpp>
 #include <components/misc/resourcehelpers.hpp>
@@ -157,7 +158,7 @@ namespace MWWorld
         const std::vector<std::string>& contentFiles,
         ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
         int activationDistanceOverride, const std::string& startCell, const std::string& startupScript,
-            const std::string& resourcePath)
+            const std::string& resourcePath, const std::string& cachePath, const std::string& cacheKey)
     : mResourceSystem(resourceSystem), mFallback(fallbackMap), mPlayer (0), mLocalScripts (mStore),
       mSky (true), mCells (mStore, mEsm),
       mGodMode(false), mScriptsEnabled(true), mContentFiles (contentFiles),
@@ -167,6 +168,7 @@ namespace MWWorld
     {
         mPhysics = new MWPhysics::PhysicsSystem(resourceSystem, rootNode);
         mRendering = new MWRender::RenderingManager(viewer, rootNode, resourceSystem, &mFallback, resourcePath);
+        mRendering->setTerrainCache(cachePath, cacheKey);
         mProjectileManager.reset(new ProjectileManager(mRendering->getLightRoot(), resourceSystem, mRendering, mPhysics));
 
         mEsm.resize(contentFiles.size());
@@ -1390,6 +1392,12 @@ namespace MWWorld
         return result.mHit;
     }
 
+    bool World::findNavMeshPath (const MWWorld::CellStore* cell, const osg::Vec3f& start, const osg::Vec3f& end,
+                                 std::vector<osg::Vec3f>& path) const
+    {
+        return mWorldScene->findNavMeshPath(cell, start, end, path);
+    }
+
     void World::processDoors(float duration)
     {
         std::map<MWWorld::Ptr, int>::iterator it = mDoorStates.begin();
@@ -1544,6 +1552,7 @@ namespace MWWorld
 
     void World::update (float duration, bool paused)
     {
+        OPENMW_PROFILE_ZONE("World::update");
         if (mGoToJail && !paused)
             goToJail();
 
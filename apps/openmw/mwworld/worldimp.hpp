@@ -176,7 +176,8 @@ namespace MWWorld
                 const Files::Collections& fileCollections,
                 const std::vector<std::string>& contentFiles,
                 ToUTF8::Utf8Encoder* encoder, const std::map<std::string,std::string>& fallbackMap,
-                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath);
+                int activationDistanceOverride, const std::string& startCell, const std::string& startupScript, const std::string& resourcePath,
+                const std::string& cachePath, const std::string& cacheKey);
 
             virtual ~World();
 
@@ -385,6 +386,11 @@ namespace MWWorld
             virtual bool castRay (float x1, float y1, float z1, float x2, float y2, float z2);
             ///< cast a Ray and return true if there is an object in the ray path.
 
+            virtual bool findNavMeshPath (const MWWorld::CellStore* cell, const osg::Vec3f& start, const osg::Vec3f& end,
+                                          std::vector<osg::Vec3f>& path) const;
+            ///< Find a path on the navigation mesh of \a cell. \a path receives the points to walk to after \a start.
+            /// \return false if there is no navigation mesh for the cell yet, or no path on it
+
             virtual bool toggleCollisionMode();
             ///< Toggle collision mode for player. If disabled player object should ignore
             /// collisions and gravity.
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <components/esm/esmwriter.hpp>
+#include <components/esm/defs.hpp>
+
+namespace
+{
+    void writeRecord(ESM::ESMWriter& writer, int index)
+    {
+        writer.startRecord(ESM::REC_CSTA);
+        writer.writeHNString("NAME", "cell");
+        writer.writeHNT("WLVL", static_cast<float>(index));
+        writer.writeHNT("OBJE", static_cast<unsigned int>(index * 7));
+        writer.endRecord(ESM::REC_CSTA);
+    }
+}
+
+TEST(ESMWriterTest, joined_buffers_are_the_same_as_writing_directly)
+{
+    const int numRecords = 5;
+
+    std::ostringstream expected;
+    ESM::ESMWriter direct;
+    direct.setStream(expected);
+    for (int i = 0; i < numRecords; ++i)
+        writeRecord(direct, i);
+    direct.close();
+
+    std::ostringstream joined;
+    ESM::ESMWriter writer;
+    writer.setStream(joined);
+    for (int i = 0; i < numRecords; ++i)
+    {
+        std::ostringstream buffer;
+        ESM::ESMWriter bufferWriter;
+        bufferWriter.setStream(buffer);
+        writeRecord(bufferWriter, i);
+        bufferWriter.close();
+        writer.writeRecords(buffer.str(), 1);
+    }
+    writer.close();
+
+    EXPECT_EQ(expected.str(), joined.str());
+    EXPECT_EQ(direct.getRecordCount(), writer.getRecordCount());
+}
+
+TEST(ESMWriterTest, does_not_join_records_into_an_unclosed_record)
+{
+    std::ostringstream stream;
+    ESM::ESMWriter writer;
+    writer.setStream(stream);
+    writer.startRecord(ESM::REC_CSTA);
+
+    EXPECT_THROW(writer.writeRecords(std::string(), 0), std::runtime_error);
+
+    writer.endRecord(ESM::REC_CSTA);
+}
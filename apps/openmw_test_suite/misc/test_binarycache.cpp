@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <stdexcept>
+
+#include <components/misc/binarycache.hpp>
+
+namespace
+{
+    const char sMagic[4] = { 'T', 'E', 'S', 'T' };
+}
+
+TEST(BinaryCacheTest, reads_what_was_written)
+{
+    std::stringstream stream;
+    Misc::writeCacheHeader(stream, sMagic, 3);
+    Misc::writeBinaryString(stream, "key");
+    Misc::writeBinary(stream, static_cast<boost::int32_t>(-42));
+
+    Misc::readCacheHeader(stream, sMagic, 3);
+    std::string key;
+    Misc::readBinaryString(stream, key);
+    boost::int32_t value = 0;
+    Misc::readBinary(stream, value);
+
+    EXPECT_TRUE(stream.good());
+    EXPECT_EQ("key", key);
+    EXPECT_EQ(-42, value);
+}
+
+TEST(BinaryCacheTest, rejects_other_version)
+{
+    std::stringstream stream;
+    Misc::writeCacheHeader(stream, sMagic, 3);
+
+    EXPECT_THROW(Misc::readCacheHeader(stream, sMagic, 4), std::runtime_error);
+}
+
+TEST(BinaryCacheTest, rejects_truncated_string)
+{
+    std::stringstream stream;
+    Misc::writeBinary(stream, static_cast<boost::uint32_t>(0xffffffff));
+
+    std::string value;
+    EXPECT_THROW(Misc::readBinaryString(stream, value), std::runtime_error);
+}
+
+TEST(BinaryCacheTest, fnv1a_hash)
+{
+    EXPECT_EQ(14695981039346656037ULL, Misc::hashFnv1a(""));
+    EXPECT_EQ(0xaf63dc4c8601ec8cULL, Misc::hashFnv1a("a"));
+    EXPECT_NE(Misc::hashFnv1a("morrowind.esm"), Misc::hashFnv1a("tribunal.esm"));
+}
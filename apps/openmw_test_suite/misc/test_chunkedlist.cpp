@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <components/misc/chunkedlist.hpp>
+
+namespace
+{
+
+    /// Counts the live instances, to check that the list destroys what it constructs.
+    struct Element
+    {
+        static int sNumInstances;
+
+        int mValue;
+        std::string mId;
+
+        Element(int value)
+            : mValue(value), mId("reference_with_a_long_id")
+        {
+            ++sNumInstances;
+        }
+
+        Element(const Element& other)
+            : mValue(other.mValue), mId(other.mId)
+        {
+            ++sNumInstances;
+        }
+
+        ~Element()
+        {
+            --sNumInstances;
+        }
+
+        bool operator==(int value) const
+        {
+            return mValue == value;
+        }
+    };
+
+    int Element::sNumInstances = 0;
+
+    std::size_t sNumAllocations = 0;
+
+    /// Counts the allocations made through it, including those of rebound copies.
+    template <typename T>
+    struct CountingAllocator : public std::allocator<T>
+    {
+        template <typename U>
+        struct rebind
+        {
+            typedef CountingAllocator<U> other;
+        };
+
+        CountingAllocator()
+        {
+        }
+
+        template <typename U>
+        CountingAllocator(const CountingAllocator<U>&)
+        {
+        }
+
+        T* allocate(std::size_t n, const void* = 0)
+        {
+            ++sNumAllocations;
+            return std::allocator<T>::allocate(n);
+        }
+    };
+
+    /// @return the number of allocations made to add \a numElements elements to an empty \a List
+    template <typename List>
+    std::size_t countAllocations(int numElements)
+    {
+        std::size_t start = sNumAllocations;
+        List list;
+        for (int i=0; i<numElements; ++i)
+            list.push_back(Element(i));
+        return sNumAllocations - start;
+    }
+
+    typedef Misc::ChunkedList<Element, CountingAllocator<Element> > CountedChunkedList;
+    typedef std::list<Element, CountingAllocator<Element> > CountedList;
+
+}
+
+TEST(ChunkedListTest, elements_are_not_moved_by_adding_more)
+{
+    Misc::ChunkedList<Element> list;
+    std::vector<const Element*> pointers;
+    std::vector<Misc::ChunkedList<Element>::iterator> iterators;
+    for (int i=0; i<1000; ++i)
+    {
+        list.push_back(Element(i));
+        pointers.push_back(&list.back());
+        iterators.push_back(--list.end());
+    }
+
+    ASSERT_EQ(1000u, list.size());
+    int i = 0;
+    for (Misc::ChunkedList<Element>::const_iterator it = list.begin(); it != list.end(); ++it, ++i)
+    {
+        EXPECT_EQ(i, it->mValue);
+        EXPECT_EQ(pointers[i], &*it);
+        EXPECT_EQ(pointers[i], &*iterators[i]);
+    }
+    EXPECT_EQ(1000, i);
+
+    EXPECT_EQ(500, std::find(list.begin(), list.end(), 500)->mValue);
+    EXPECT_TRUE(std::find(list.begin(), list.end(), 1000) == list.end());
+}
+
+TEST(ChunkedListTest, copies_and_destroys_all_elements)
+{
+    {
+        Misc::ChunkedList<Element> list;
+        for (int i=0; i<100; ++i)
+            list.push_back(Element(i));
+
+        Misc::ChunkedList<Element> copy (list);
+        ASSERT_EQ(list.size(), copy.size());
+        EXPECT_EQ(99, copy.back().mValue);
+        EXPECT_NE(&list.front(), &copy.front());
+
+        copy = list;
+        EXPECT_EQ(200, Element::sNumInstances);
+
+        list.clear();
+        EXPECT_TRUE(list.empty());
+        EXPECT_TRUE(list.begin() == list.end());
+        EXPECT_EQ(0u, list.getNumChunks());
+        EXPECT_EQ(100, Element::sNumInstances);
+    }
+    EXPECT_EQ(0, Element::sNumInstances);
+}
+
+TEST(ChunkedListTest, allocations_grow_logarithmically)
+{
+    // the chunks of 4, 8, ..., 1024 elements plus the growth of the chunk table
+    std::size_t allocations = countAllocations<CountedChunkedList>(2000);
+    EXPECT_GE(allocations, 9u);
+    EXPECT_LE(allocations, 9u + 5u);
+
+    EXPECT_EQ(0u, countAllocations<CountedChunkedList>(0));
+}
+
+TEST(ChunkedListTest, loading_cell_references_allocates_less_than_std_list)
+{
+    // the references of a 5x5 exterior grid, in the 20 lists of a CellStore, most of them statics
+    const int numTypes = 20;
+    const int numCells = 25;
+    const int numStatics = 600;
+    const int numOthers = 15;
+
+    std::size_t listAllocations = 0;
+    std::size_t chunkedAllocations = 0;
+    for (int cell=0; cell<numCells; ++cell)
+    {
+        for (int type=0; type<numTypes; ++type)
+        {
+            int numReferences = type == 0 ? numStatics : numOthers;
+            listAllocations += countAllocations<CountedList>(numReferences);
+            chunkedAllocations += countAllocations<CountedChunkedList>(numReferences);
+        }
+    }
+
+    // one allocation per reference, against a few per list
+    EXPECT_EQ(static_cast<std::size_t>(numCells * (numStatics + (numTypes - 1) * numOthers)), listAllocations);
+    EXPECT_LE(chunkedAllocations, static_cast<std::size_t>(numCells * numTypes * 7));
+    EXPECT_LT(chunkedAllocations * 5, listAllocations);
+}
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+#include <components/misc/compression.hpp>
+
+TEST(CompressionTest, decompresses_what_was_compressed)
+{
+    std::string data (10000, 'a');
+    data += "some text that does not repeat";
+
+    std::string compressed;
+    Misc::compress(data, compressed);
+    EXPECT_LT(compressed.size(), data.size());
+
+    std::string decompressed;
+    Misc::decompress(compressed.data(), compressed.size(), decompressed, data.size());
+    EXPECT_EQ(data, decompressed);
+}
+
+TEST(CompressionTest, throws_on_size_mismatch)
+{
+    std::string compressed;
+    Misc::compress("some data", compressed);
+
+    std::string decompressed;
+    EXPECT_THROW(Misc::decompress(compressed.data(), compressed.size(), decompressed, 4), std::runtime_error);
+}
+
+TEST(CompressionTest, rejects_a_size_zlib_can_not_produce_before_allocating)
+{
+    std::string compressed;
+    Misc::compress("some data", compressed);
+
+    // as read from a corrupt saved game
+    const boost::uint64_t size = static_cast<boost::uint64_t>(1) << 48;
+
+    std::string decompressed;
+    EXPECT_THROW(Misc::decompress(compressed.data(), compressed.size(), decompressed, size), std::runtime_error);
+    EXPECT_TRUE(decompressed.empty());
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <components/misc/stringid.hpp>
+
+TEST(StringIdTest, equal_ignoring_case)
+{
+    Misc::StringId lower ("gold_001");
+    Misc::StringId mixed ("Gold_001");
+    Misc::StringId other ("gold_005");
+
+    EXPECT_TRUE(lower == mixed);
+    EXPECT_EQ(lower.getHash(), mixed.getHash());
+    EXPECT_TRUE(lower != other);
+    EXPECT_EQ("gold_001", mixed.getString());
+
+    EXPECT_TRUE(mixed.equals("GOLD_001"));
+    EXPECT_FALSE(mixed.equals("gold_00"));
+}
+
+TEST(StringIdTest, shares_one_string_per_id)
+{
+    Misc::StringId first ("StringIdTest_shared");
+    std::size_t numStrings = Misc::StringId::getNumStrings();
+
+    Misc::StringId second ("STRINGIDTEST_SHARED");
+    EXPECT_EQ(&first.getString(), &second.getString());
+    EXPECT_EQ(numStrings, Misc::StringId::getNumStrings());
+
+    Misc::StringId third ("StringIdTest_other");
+    EXPECT_EQ(numStrings + 1, Misc::StringId::getNumStrings());
+}
+
+TEST(StringIdTest, empty_string_is_not_interned)
+{
+    Misc::StringId empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_TRUE(empty.getString().empty());
+    EXPECT_TRUE(empty == Misc::StringId(""));
+    EXPECT_FALSE(empty == Misc::StringId("a"));
+}
+
+TEST(StringIdTest, find_does_not_add_to_the_table)
+{
+    std::size_t numStrings = Misc::StringId::getNumStrings();
+    Misc::StringId missing = Misc::StringId::find("StringIdTest_missing");
+    EXPECT_TRUE(missing.empty());
+    EXPECT_EQ(numStrings, Misc::StringId::getNumStrings());
+
+    Misc::StringId added ("StringIdTest_found");
+    EXPECT_TRUE(Misc::StringId::find("STRINGIDTEST_FOUND") == added);
+}
@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+
+#include "apps/openmw/mwmechanics/cachedsource.hpp"
+
+namespace
+{
+    // stands in for ContainerStore and Spells, which need a World
+    struct Store
+    {
+        int mStateId;
+    };
+}
+
+TEST(CombatActionCacheTest, built_once_while_the_store_is_unchanged)
+{
+    Store store = { 1 };
+    MWMechanics::CachedSource<Store> source;
+
+    EXPECT_TRUE(source.update(&store, store.mStateId));
+    EXPECT_FALSE(source.update(&store, store.mStateId));
+    EXPECT_FALSE(source.update(&store, store.mStateId));
+}
+
+TEST(CombatActionCacheTest, rebuilt_when_the_state_id_changes)
+{
+    Store store = { 1 };
+    MWMechanics::CachedSource<Store> source;
+    source.update(&store, store.mStateId);
+
+    // an item was added or removed
+    store.mStateId = 2;
+    EXPECT_TRUE(source.update(&store, store.mStateId));
+    EXPECT_FALSE(source.update(&store, store.mStateId));
+}
+
+TEST(CombatActionCacheTest, rebuilt_when_the_store_changes)
+{
+    Store first = { 5 };
+    Store second = { 5 };
+    MWMechanics::CachedSource<Store> source;
+    source.update(&first, first.mStateId);
+
+    // e.g. a creature without an inventory, or another actor's store with the same id
+    EXPECT_TRUE(source.update(&second, second.mStateId));
+    EXPECT_TRUE(source.update(NULL, 0));
+    EXPECT_FALSE(source.update(NULL, 0));
+    EXPECT_TRUE(source.update(&first, first.mStateId));
+}
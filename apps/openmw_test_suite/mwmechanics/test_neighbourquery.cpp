@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+
+#include <components/sceneutil/workqueue.hpp>
+
+#include "apps/openmw/mwmechanics/neighbourquery.hpp"
+
+struct NeighbourQueryTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+        // Actors spread over a 3x3 exterior cell area, like the ones Actors looks for combat and head tracking
+        // targets among. Fixed seed, so every run sees the same scene.
+        std::srand(1234);
+
+        for (int i=0; i<400; ++i)
+        {
+            MWMechanics::NeighbourQuery::Point point;
+            point.mPosition = osg::Vec3f(randomFloat(-12288.f, 12288.f), randomFloat(-12288.f, 12288.f), randomFloat(-256.f, 256.f));
+            float angle = randomFloat(0.f, 6.2832f);
+            point.mForward = i % 10 == 0 ? osg::Vec3f() : osg::Vec3f(std::sin(angle), std::cos(angle), 0.f);
+            point.mRange = i % 3 == 0 ? 7168.f : 2000.f;
+            point.mVisible = i % 17 != 0;
+            mPoints.push_back(point);
+        }
+
+        // a crowd standing on the same spot, to check the order of equal distances
+        for (int i=0; i<20; ++i)
+        {
+            MWMechanics::NeighbourQuery::Point point;
+            point.mPosition = osg::Vec3f(100.f * (i % 2), 0.f, 0.f);
+            point.mRange = 500.f;
+            point.mVisible = true;
+            mPoints.push_back(point);
+        }
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static float randomFloat(float min, float max)
+    {
+        return min + (max - min) * (std::rand() / static_cast<float>(RAND_MAX));
+    }
+
+    void fill(MWMechanics::NeighbourQuery& query) const
+    {
+        query.clear();
+        for (std::vector<MWMechanics::NeighbourQuery::Point>::const_iterator it = mPoints.begin(); it != mPoints.end(); ++it)
+            query.addPoint(*it);
+    }
+
+    void expectSameResults(const MWMechanics::NeighbourQuery& expected, const MWMechanics::NeighbourQuery& actual) const
+    {
+        ASSERT_EQ(expected.getNumPoints(), actual.getNumPoints());
+        for (std::size_t i=0; i<expected.getNumPoints(); ++i)
+            EXPECT_EQ(expected.getNeighbours(i), actual.getNeighbours(i)) << "point " << i;
+    }
+
+    std::vector<MWMechanics::NeighbourQuery::Point> mPoints;
+};
+
+TEST_F(NeighbourQueryTest, finds_visible_points_in_range_and_in_front_nearest_first)
+{
+    MWMechanics::NeighbourQuery query;
+    fill(query);
+    query.run(NULL, 1);
+
+    for (std::size_t i=0; i<mPoints.size(); ++i)
+    {
+        const MWMechanics::NeighbourQuery::Point& point = mPoints[i];
+        const std::vector<std::size_t>& neighbours = query.getNeighbours(i);
+
+        std::size_t expectedCount = 0;
+        for (std::size_t j=0; j<mPoints.size(); ++j)
+        {
+            osg::Vec3f offset = mPoints[j].mPosition - point.mPosition;
+            if (j != i && mPoints[j].mVisible && offset.length() <= point.mRange
+                    && (point.mForward.length2() == 0.f || point.mForward.x() * offset.x() + point.mForward.y() * offset.y() > 0.f))
+                ++expectedCount;
+        }
+        ASSERT_EQ(expectedCount, neighbours.size());
+
+        for (std::size_t n=1; n<neighbours.size(); ++n)
+        {
+            float previous = (mPoints[neighbours[n-1]].mPosition - point.mPosition).length2();
+            float current = (mPoints[neighbours[n]].mPosition - point.mPosition).length2();
+            EXPECT_TRUE(previous < current || (previous == current && neighbours[n-1] < neighbours[n]));
+        }
+    }
+}
+
+TEST_F(NeighbourQueryTest, multithreaded_results_match_single_threaded_results)
+{
+    MWMechanics::NeighbourQuery singleThreaded;
+    fill(singleThreaded);
+    singleThreaded.run(NULL, 1);
+
+    osg::ref_ptr<SceneUtil::WorkQueue> workQueue (new SceneUtil::WorkQueue(4));
+
+    // more work items than threads, and a number that does not divide the points evenly
+    const int numItems[] = { 1, 4, 7, 1000 };
+    for (int i=0; i<4; ++i)
+    {
+        MWMechanics::NeighbourQuery multiThreaded;
+        fill(multiThreaded);
+        multiThreaded.run(workQueue, numItems[i]);
+        expectSameResults(singleThreaded, multiThreaded);
+    }
+
+    // reusing a query for the next frame gives the same results as a new one
+    fill(singleThreaded);
+    singleThreaded.run(workQueue, 3);
+    MWMechanics::NeighbourQuery fresh;
+    fill(fresh);
+    fresh.run(NULL, 1);
+    expectSameResults(fresh, singleThreaded);
+}
+
+TEST_F(NeighbourQueryTest, candidates_are_visited_in_the_same_order_for_any_number_of_threads)
+{
+    osg::ref_ptr<SceneUtil::WorkQueue> workQueue (new SceneUtil::WorkQueue(4));
+
+    // Several frames in which the actors move, with the combat and head tracking queries reused like Actors does.
+    // Actors::updateAiTargets visits every actor in snapshot order and its candidates nearest first, so this is the
+    // sequence of (actor, candidate) pairs its checks run on. The checks themselves need the world and are not run.
+    std::vector<std::vector<std::pair<std::size_t, std::size_t> > > candidates;
+    const int numItems[] = { 0, 2, 4, 9 };
+    for (int run=0; run<4; ++run)
+    {
+        MWMechanics::NeighbourQuery combatQuery;
+        MWMechanics::NeighbourQuery headTrackQuery;
+        std::vector<MWMechanics::NeighbourQuery::Point> points = mPoints;
+
+        for (int frame=0; frame<5; ++frame)
+        {
+            combatQuery.clear();
+            headTrackQuery.clear();
+            for (std::size_t i=0; i<points.size(); ++i)
+            {
+                points[i].mPosition += osg::Vec3f(50.f * ((i + frame) % 5), -30.f * ((i * 7 + frame) % 3), 0.f);
+
+                MWMechanics::NeighbourQuery::Point combatPoint = points[i];
+                combatPoint.mForward = osg::Vec3f();
+                combatQuery.addPoint(combatPoint);
+                headTrackQuery.addPoint(points[i]);
+            }
+
+            SceneUtil::WorkQueue* queue = numItems[run] > 0 ? workQueue.get() : NULL;
+            combatQuery.run(queue, numItems[run]);
+            headTrackQuery.run(queue, numItems[run]);
+
+            std::vector<std::pair<std::size_t, std::size_t> > visited;
+            for (std::size_t i=0; i<points.size(); ++i)
+            {
+                const std::vector<std::size_t>& targets = combatQuery.getNeighbours(i);
+                for (std::vector<std::size_t>::const_iterator it = targets.begin(); it != targets.end(); ++it)
+                    visited.push_back(std::make_pair(i, *it));
+
+                const std::vector<std::size_t>& headTrackTargets = headTrackQuery.getNeighbours(i);
+                for (std::vector<std::size_t>::const_iterator it = headTrackTargets.begin(); it != headTrackTargets.end(); ++it)
+                    visited.push_back(std::make_pair(i, *it));
+            }
+
+            if (run == 0)
+                candidates.push_back(visited);
+            else
+                EXPECT_EQ(candidates[frame], visited) << "frame " << frame << ", " << numItems[run] << " work items";
+        }
+    }
+}
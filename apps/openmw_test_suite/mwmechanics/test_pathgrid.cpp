@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include <components/esm/loadcell.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+#include "apps/openmw/mwmechanics/pathgrid.hpp"
+
+namespace
+{
+    void addEdge(ESM::Pathgrid& pathgrid, int v0, int v1)
+    {
+        ESM::Pathgrid::Edge edge;
+        edge.mV0 = v0;
+        edge.mV1 = v1;
+        pathgrid.mEdges.push_back(edge);
+    }
+
+    int getLength(const ESM::Pathgrid::Point& a, const ESM::Pathgrid::Point& b)
+    {
+        return std::abs(a.mX - b.mX) + std::abs(a.mY - b.mY) + std::abs(a.mZ - b.mZ);
+    }
+
+    int getLength(const std::list<ESM::Pathgrid::Point>& path)
+    {
+        int length = 0;
+        for (std::list<ESM::Pathgrid::Point>::const_iterator it = path.begin(); it != path.end(); ++it)
+        {
+            std::list<ESM::Pathgrid::Point>::const_iterator next = it;
+            if (++next != path.end())
+                length += getLength(*it, *next);
+        }
+        return length;
+    }
+
+    // Floyd-Warshall, -1 where there is no path
+    std::vector<std::vector<int> > getShortestLengths(const ESM::Pathgrid& pathgrid)
+    {
+        const std::size_t numPoints = pathgrid.mPoints.size();
+        std::vector<std::vector<int> > lengths (numPoints, std::vector<int>(numPoints, -1));
+        for (std::size_t i = 0; i < numPoints; ++i)
+            lengths[i][i] = 0;
+        for (std::size_t i = 0; i < pathgrid.mEdges.size(); ++i)
+        {
+            const ESM::Pathgrid::Edge& edge = pathgrid.mEdges[i];
+            lengths[edge.mV0][edge.mV1] = getLength(pathgrid.mPoints[edge.mV0], pathgrid.mPoints[edge.mV1]);
+        }
+        for (std::size_t k = 0; k < numPoints; ++k)
+            for (std::size_t i = 0; i < numPoints; ++i)
+                for (std::size_t j = 0; j < numPoints; ++j)
+                    if (lengths[i][k] >= 0 && lengths[k][j] >= 0
+                            && (lengths[i][j] < 0 || lengths[i][k] + lengths[k][j] < lengths[i][j]))
+                        lengths[i][j] = lengths[i][k] + lengths[k][j];
+        return lengths;
+    }
+
+    /// Waits until the single worker thread of \a workQueue finished everything queued before
+    void waitForWorkQueue(SceneUtil::WorkQueue& workQueue)
+    {
+        osg::ref_ptr<SceneUtil::WorkItem> item (new SceneUtil::WorkItem);
+        workQueue.addWorkItem(item);
+        item->waitTillDone();
+    }
+
+    struct PathgridNextHopsTest : public ::testing::Test
+    {
+        ESM::Cell mCell;
+        ESM::Pathgrid mPathgrid;
+
+        virtual void SetUp()
+        {
+            mCell.mData.mFlags = ESM::Cell::Interior;
+
+            // An uneven 4x4 lattice, so most pairs of points have a single shortest path
+            const int xs[] = { 0, 130, 370, 420 };
+            const int ys[] = { 0, 210, 260, 590 };
+            for (int y = 0; y < 4; ++y)
+                for (int x = 0; x < 4; ++x)
+                    mPathgrid.mPoints.push_back(ESM::Pathgrid::Point(xs[x], ys[y], (x * y) % 3 * 40));
+
+            for (int y = 0; y < 4; ++y)
+            {
+                for (int x = 0; x < 4; ++x)
+                {
+                    int index = y * 4 + x;
+                    if (x < 3 && !(x == 1 && y == 2)) // leave a gap in the middle
+                    {
+                        addEdge(mPathgrid, index, index + 1);
+                        addEdge(mPathgrid, index + 1, index);
+                    }
+                    if (y < 3)
+                    {
+                        addEdge(mPathgrid, index, index + 4);
+                        addEdge(mPathgrid, index + 4, index);
+                    }
+                }
+            }
+
+            // A shortcut that can only be walked in one direction
+            addEdge(mPathgrid, 0, 15);
+
+            // An island that can not be reached from the lattice
+            mPathgrid.mPoints.push_back(ESM::Pathgrid::Point(1000, 1000, 0));
+            mPathgrid.mPoints.push_back(ESM::Pathgrid::Point(1100, 1000, 0));
+            addEdge(mPathgrid, 16, 17);
+            addEdge(mPathgrid, 17, 16);
+        }
+    };
+}
+
+TEST_F(PathgridNextHopsTest, finds_the_same_paths_as_a_star_or_shorter)
+{
+    MWMechanics::PathgridGraph graph;
+    ASSERT_TRUE(graph.load(&mCell, &mPathgrid));
+
+    MWMechanics::PathgridGraph graphWithTable;
+    ASSERT_TRUE(graphWithTable.load(&mCell, &mPathgrid));
+    osg::ref_ptr<SceneUtil::WorkQueue> workQueue (new SceneUtil::WorkQueue(1));
+    graphWithTable.prepareNextHops(&mPathgrid, workQueue);
+    waitForWorkQueue(*workQueue);
+
+    const std::vector<std::vector<int> > shortest = getShortestLengths(mPathgrid);
+
+    const int numPoints = static_cast<int>(mPathgrid.mPoints.size());
+    for (int start = 0; start < numPoints; ++start)
+    {
+        for (int goal = 0; goal < numPoints; ++goal)
+        {
+            if (start == goal)
+                continue;
+
+            SCOPED_TRACE(testing::Message() << "from " << start << " to " << goal);
+
+            std::list<ESM::Pathgrid::Point> expected = graph.aStarSearch(start, goal);
+            std::list<ESM::Pathgrid::Point> actual = graphWithTable.aStarSearch(start, goal);
+
+            // the table is not used for cached paths
+            EXPECT_FALSE(graphWithTable.isPathCached(start, goal));
+
+            // both only return paths within a strongly connected component
+            if (!graph.isPointConnected(start, goal))
+            {
+                EXPECT_TRUE(expected.empty());
+                EXPECT_TRUE(actual.empty());
+                continue;
+            }
+
+            ASSERT_FALSE(expected.empty());
+            ASSERT_FALSE(actual.empty());
+            EXPECT_EQ(expected.front().mX, actual.front().mX);
+            EXPECT_EQ(expected.back().mX, actual.back().mX);
+            // aStarSearch does not reorder its open set when a cheaper way to a point is found,
+            // so its paths are sometimes a little longer than the shortest
+            EXPECT_LE(getLength(actual), getLength(expected));
+            EXPECT_EQ(shortest[start][goal], getLength(actual));
+        }
+    }
+}
+
+TEST_F(PathgridNextHopsTest, takes_one_way_edges_and_does_not_reach_other_components)
+{
+    osg::ref_ptr<MWMechanics::PathgridNextHops> nextHops (new MWMechanics::PathgridNextHops(mPathgrid));
+    nextHops->doWork();
+
+    EXPECT_EQ(15, nextHops->getNextHop(0, 15));
+    EXPECT_NE(0, nextHops->getNextHop(15, 0));
+    EXPECT_EQ(-1, nextHops->getNextHop(0, 16));
+    EXPECT_EQ(-1, nextHops->getNextHop(16, 0));
+    EXPECT_EQ(17, nextHops->getNextHop(16, 17));
+}
+
+TEST_F(PathgridNextHopsTest, caches_searched_paths_and_drops_the_least_recently_used)
+{
+    const int maxCachedPaths = static_cast<int>(MWMechanics::PathgridGraph::sMaxCachedPaths);
+    const int numPoints = 16; // the lattice
+    ASSERT_GT(numPoints * (numPoints - 1), maxCachedPaths);
+
+    MWMechanics::PathgridGraph graph;
+    ASSERT_TRUE(graph.load(&mCell, &mPathgrid));
+
+    std::vector<std::pair<int, int> > searched;
+    for (int start = 0; start < numPoints && static_cast<int>(searched.size()) < maxCachedPaths; ++start)
+        for (int goal = 0; goal < numPoints && static_cast<int>(searched.size()) < maxCachedPaths; ++goal)
+            if (start != goal)
+            {
+                graph.aStarSearch(start, goal);
+                searched.push_back(std::make_pair(start, goal));
+            }
+
+    for (std::size_t i = 0; i < searched.size(); ++i)
+        EXPECT_TRUE(graph.isPathCached(searched[i].first, searched[i].second));
+
+    // a cache hit returns the same path and makes it the most recently used
+    const std::list<ESM::Pathgrid::Point> first = graph.aStarSearch(searched[0].first, searched[0].second);
+    MWMechanics::PathgridGraph uncached;
+    ASSERT_TRUE(uncached.load(&mCell, &mPathgrid));
+    EXPECT_EQ(getLength(uncached.aStarSearch(searched[0].first, searched[0].second)), getLength(first));
+
+    // so the next new path drops the second one searched instead
+    graph.aStarSearch(15, 14);
+    EXPECT_TRUE(graph.isPathCached(15, 14));
+    EXPECT_TRUE(graph.isPathCached(searched[0].first, searched[0].second));
+    EXPECT_FALSE(graph.isPathCached(searched[1].first, searched[1].second));
+    for (std::size_t i = 2; i < searched.size(); ++i)
+        EXPECT_TRUE(graph.isPathCached(searched[i].first, searched[i].second));
+
+    // paths between components are not searched, so not cached either
+    EXPECT_TRUE(graph.aStarSearch(0, 16).empty());
+    EXPECT_FALSE(graph.isPathCached(0, 16));
+}
+
+TEST_F(PathgridNextHopsTest, copies_start_with_an_empty_cache)
+{
+    MWMechanics::PathgridGraph graph;
+    ASSERT_TRUE(graph.load(&mCell, &mPathgrid));
+    const std::list<ESM::Pathgrid::Point> path = graph.aStarSearch(0, 10);
+    ASSERT_TRUE(graph.isPathCached(0, 10));
+
+    MWMechanics::PathgridGraph copy (graph);
+    EXPECT_FALSE(copy.isPathCached(0, 10));
+    EXPECT_EQ(getLength(path), getLength(copy.aStarSearch(0, 10)));
+    EXPECT_TRUE(copy.isPathCached(0, 10));
+
+    MWMechanics::PathgridGraph assigned;
+    assigned = graph;
+    EXPECT_FALSE(assigned.isPathCached(0, 10));
+    EXPECT_TRUE(assigned.isPointConnected(0, 15));
+    EXPECT_FALSE(assigned.isPointConnected(0, 16));
+
+    // the copies have caches of their own
+    graph.aStarSearch(3, 12);
+    EXPECT_FALSE(copy.isPathCached(3, 12));
+    EXPECT_FALSE(assigned.isPathCached(3, 12));
+}
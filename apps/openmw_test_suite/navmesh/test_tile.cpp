@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+#include <osg/ref_ptr>
+
+#include <components/navmesh/tile.hpp>
+
+namespace
+{
+    const float sCellSize = 8192.f; // ESM::Land::REAL_SIZE
+
+    void addBox(NavMesh::Geometry& geometry, const osg::Vec3f& min, const osg::Vec3f& max)
+    {
+        osg::Vec3f corners[8];
+        for (int i=0; i<8; ++i)
+            corners[i] = osg::Vec3f(i & 1 ? max.x() : min.x(), i & 2 ? max.y() : min.y(), i & 4 ? max.z() : min.z());
+
+        const int faces[6][4] = { {0,1,3,2}, {4,5,7,6}, {0,1,5,4}, {2,3,7,6}, {0,2,6,4}, {1,3,7,5} };
+        for (int i=0; i<6; ++i)
+        {
+            geometry.addTriangle(corners[faces[i][0]], corners[faces[i][1]], corners[faces[i][2]]);
+            geometry.addTriangle(corners[faces[i][0]], corners[faces[i][2]], corners[faces[i][3]]);
+        }
+    }
+
+    float getHeight(float x, float y)
+    {
+        return 200.f * std::sin(x / 1500.f) * std::cos(y / 1100.f);
+    }
+
+    // Rolling hills as an exterior heightfield of 65x65 vertices
+    void addTerrain(NavMesh::Geometry& geometry)
+    {
+        const int verts = 65;
+        const float step = sCellSize / (verts - 1);
+        for (int y=0; y<verts-1; ++y)
+        {
+            for (int x=0; x<verts-1; ++x)
+            {
+                osg::Vec3f corners[4];
+                for (int i=0; i<4; ++i)
+                {
+                    float px = (x + (i & 1)) * step;
+                    float py = (y + (i >> 1)) * step;
+                    corners[i] = osg::Vec3f(px, py, getHeight(px, py));
+                }
+                geometry.addTriangle(corners[0], corners[1], corners[3]);
+                geometry.addTriangle(corners[0], corners[3], corners[2]);
+            }
+        }
+    }
+
+    // 40 buildings in a grid, with streets between them
+    void addTown(NavMesh::Geometry& geometry)
+    {
+        for (int i=0; i<40; ++i)
+        {
+            float x = 400.f + (i % 8) * 950.f;
+            float y = 400.f + (i / 8) * 1500.f;
+            addBox(geometry, osg::Vec3f(x, y, -400.f), osg::Vec3f(x + 500.f, y + 700.f, 700.f));
+        }
+    }
+
+    osg::Vec3f onTerrain(float x, float y)
+    {
+        return osg::Vec3f(x, y, getHeight(x, y));
+    }
+}
+
+struct NavMeshTileTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+        mBounds = osg::BoundingBox(0.f, 0.f, -1.f, sCellSize, sCellSize, 1.f);
+        addTerrain(mGeometry);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    NavMesh::Settings mSettings;
+    osg::BoundingBox mBounds;
+    NavMesh::Geometry mGeometry;
+};
+
+TEST_F(NavMeshTileTest, straight_path_on_open_terrain)
+{
+    osg::ref_ptr<NavMesh::Tile> tile (new NavMesh::Tile(mBounds, mSettings));
+    tile->build(mGeometry);
+
+    std::vector<osg::Vec3f> path;
+    ASSERT_TRUE(tile->findPath(onTerrain(1000.f, 1000.f), onTerrain(1500.f, 1200.f), path));
+    ASSERT_EQ(1u, path.size());
+    EXPECT_FLOAT_EQ(1500.f, path.back().x());
+    EXPECT_FLOAT_EQ(1200.f, path.back().y());
+}
+
+TEST_F(NavMeshTileTest, path_goes_around_a_wall)
+{
+    // a wall across the middle of the cell, with gaps at both ends
+    addBox(mGeometry, osg::Vec3f(4000.f, 500.f, -300.f), osg::Vec3f(4100.f, 6000.f, 600.f));
+
+    osg::ref_ptr<NavMesh::Tile> tile (new NavMesh::Tile(mBounds, mSettings));
+    tile->build(mGeometry);
+
+    std::vector<osg::Vec3f> path;
+    ASSERT_TRUE(tile->findPath(onTerrain(3000.f, 3000.f), onTerrain(5000.f, 3000.f), path));
+    ASSERT_GE(path.size(), 2u);
+
+    // no leg goes through the wall; the clearance is only as exact as the grid
+    osg::Vec3f previous = onTerrain(3000.f, 3000.f);
+    for (std::size_t i=0; i<path.size(); ++i)
+    {
+        for (int s=0; s<=100; ++s)
+        {
+            osg::Vec3f point = previous + (path[i] - previous) * (s / 100.f);
+            EXPECT_FALSE(point.x() > 4000.f && point.x() < 4100.f && point.y() > 500.f && point.y() < 6000.f)
+                    << "leg " << i << " crosses the wall at " << point.x() << " " << point.y();
+        }
+        previous = path[i];
+    }
+}
+
+TEST_F(NavMeshTileTest, can_walk_onto_a_low_step_but_not_a_tall_block)
+{
+    addBox(mGeometry, osg::Vec3f(2000.f, 2000.f, -300.f), osg::Vec3f(2400.f, 2400.f, getHeight(2200.f, 2200.f) + 20.f));
+    addBox(mGeometry, osg::Vec3f(6000.f, 6000.f, -300.f), osg::Vec3f(6400.f, 6400.f, 800.f));
+
+    osg::ref_ptr<NavMesh::Tile> tile (new NavMesh::Tile(mBounds, mSettings));
+    tile->build(mGeometry);
+
+    std::vector<osg::Vec3f> path;
+    EXPECT_TRUE(tile->findPath(onTerrain(1500.f, 1500.f), osg::Vec3f(2200.f, 2200.f, getHeight(2200.f, 2200.f) + 20.f), path));
+    EXPECT_FALSE(tile->findPath(onTerrain(5500.f, 5500.f), osg::Vec3f(6200.f, 6200.f, 800.f), path));
+}
+
+TEST_F(NavMeshTileTest, no_path_outside_the_tile)
+{
+    osg::ref_ptr<NavMesh::Tile> tile (new NavMesh::Tile(mBounds, mSettings));
+    tile->build(mGeometry);
+
+    std::vector<osg::Vec3f> path;
+    EXPECT_FALSE(tile->findPath(onTerrain(1000.f, 1000.f), onTerrain(9000.f, 1000.f), path));
+    EXPECT_TRUE(path.empty());
+}
+
+TEST_F(NavMeshTileTest, path_through_a_town)
+{
+    addTown(mGeometry);
+
+    osg::ref_ptr<NavMesh::Tile> tile (new NavMesh::Tile(mBounds, mSettings));
+    tile->build(mGeometry);
+
+    // the buildings block part of the terrain, but not all of it
+    EXPECT_GT(tile->getNumWalkableNodes(), tile->getNumNodes() / 2);
+    EXPECT_LT(tile->getNumWalkableNodes(), tile->getNumNodes());
+
+    const osg::Vec3f start = onTerrain(100.f, 100.f);
+    const osg::Vec3f end = onTerrain(8000.f, 8000.f);
+    std::vector<osg::Vec3f> path;
+    ASSERT_TRUE(tile->findPath(start, end, path));
+
+    // around the buildings, without large detours
+    float length = 0.f;
+    for (std::size_t i=1; i<path.size(); ++i)
+        length += (path[i] - path[i-1]).length();
+    EXPECT_LT(length, (end - start).length() * 1.5f);
+}
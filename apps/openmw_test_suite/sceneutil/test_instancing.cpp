@@ -0,0 +1,301 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <map>
+
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Viewport>
+
+#include <osgUtil/CullVisitor>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/RenderStage>
+#include <osgUtil/StateGraph>
+#include <osgUtil/Statistics>
+
+#include <components/sceneutil/clone.hpp>
+#include <components/sceneutil/instancing.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
+
+namespace
+{
+
+    class CountNodesVisitor : public osg::NodeVisitor
+    {
+    public:
+        CountNodesVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+            , mNumNodes(0)
+        {
+        }
+
+        virtual void apply(osg::Node& node)
+        {
+            ++mNumNodes;
+            traverse(node);
+        }
+
+        unsigned int mNumNodes;
+    };
+
+    struct Reference
+    {
+        osg::Vec3f mPosition;
+        osg::Quat mRotation;
+        float mScale;
+
+        osg::Matrixf getMatrix() const
+        {
+            return osg::Matrixf::scale(mScale, mScale, mScale) * osg::Matrixf::rotate(mRotation) * osg::Matrixf::translate(mPosition);
+        }
+    };
+
+}
+
+struct InstancingTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+        // a rock: a quad below a transformation, like the NIF loader creates them
+        mGeometry = new osg::Geometry;
+        osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+        vertices->push_back(osg::Vec3f(-50, -50, 0));
+        vertices->push_back(osg::Vec3f(50, -50, 0));
+        vertices->push_back(osg::Vec3f(50, 50, 0));
+        vertices->push_back(osg::Vec3f(-50, 50, 0));
+        mGeometry->setVertexArray(vertices);
+        mGeometry->setNormalArray(new osg::Vec3Array(4, osg::Vec3f(0, 0, 1)), osg::Array::BIND_PER_VERTEX);
+        osg::ref_ptr<osg::DrawElementsUShort> indices (new osg::DrawElementsUShort(GL_TRIANGLES));
+        unsigned short triangles[] = { 0, 1, 2, 0, 2, 3 };
+        indices->insert(indices->end(), triangles, triangles + 6);
+        mGeometry->addPrimitiveSet(indices);
+
+        osg::ref_ptr<osg::MatrixTransform> transform (new osg::MatrixTransform(osg::Matrix::translate(0, 0, 10)));
+        transform->addChild(mGeometry);
+        mTemplate = new osg::Group;
+        mTemplate->addChild(transform);
+
+        // the same rock repeated over a few exterior cells
+        for (int y=0; y<25; ++y)
+        {
+            for (int x=0; x<40; ++x)
+            {
+                Reference reference;
+                reference.mPosition = osg::Vec3f(x * 200.f, y * 200.f, 0.f);
+                reference.mRotation = osg::Quat((x * 25 + y) * 0.37f, osg::Vec3f(0, 0, 1));
+                reference.mScale = 0.5f + ((x + y) % 5) * 0.25f;
+                mReferences.push_back(reference);
+            }
+        }
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    /// One cloned model per reference, the way Objects inserts them.
+    osg::ref_ptr<osg::Group> createClonedScene() const
+    {
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        for (std::vector<Reference>::const_iterator it = mReferences.begin(); it != mReferences.end(); ++it)
+        {
+            osg::ref_ptr<SceneUtil::PositionAttitudeTransform> transform (new SceneUtil::PositionAttitudeTransform);
+            transform->setPosition(it->mPosition);
+            transform->setAttitude(it->mRotation);
+            transform->setScale(osg::Vec3f(it->mScale, it->mScale, it->mScale));
+            transform->addChild(osg::clone(mTemplate.get(), SceneUtil::CopyOp()));
+            root->addChild(transform);
+        }
+        return root;
+    }
+
+    typedef std::map<std::pair<int, int>, std::vector<osg::Matrixf> > Chunks;
+
+    /// The transformation of the geometry of each reference, sorted into 2048 unit chunks like StaticBatch does.
+    Chunks getChunks() const
+    {
+        Chunks chunks;
+        for (std::vector<Reference>::const_iterator it = mReferences.begin(); it != mReferences.end(); ++it)
+        {
+            std::pair<int, int> chunk (static_cast<int>(std::floor(it->mPosition.x() / 2048.f)),
+                                       static_cast<int>(std::floor(it->mPosition.y() / 2048.f)));
+            chunks[chunk].push_back(osg::Matrixf::translate(0, 0, 10) * it->getMatrix());
+        }
+        return chunks;
+    }
+
+    /// One InstancedGeometry per chunk, the way StaticBatch instances them.
+    osg::ref_ptr<osg::Group> createInstancedScene() const
+    {
+        Chunks chunks = getChunks();
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        for (Chunks::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+            root->addChild(new SceneUtil::InstancedGeometry(*mGeometry, it->second));
+        return root;
+    }
+
+    /// One merged geometry per chunk, the way StaticBatch merges models that are not instanced.
+    osg::ref_ptr<osg::Group> createMergedScene() const
+    {
+        const osg::Vec3Array* srcVertices = static_cast<const osg::Vec3Array*>(mGeometry->getVertexArray());
+        const osg::DrawElements* srcIndices = mGeometry->getPrimitiveSet(0)->getDrawElements();
+
+        Chunks chunks = getChunks();
+        osg::ref_ptr<osg::Group> root (new osg::Group);
+        for (Chunks::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+        {
+            osg::ref_ptr<osg::Vec3Array> vertices (new osg::Vec3Array);
+            osg::ref_ptr<osg::Vec3Array> normals (new osg::Vec3Array);
+            osg::ref_ptr<osg::DrawElementsUInt> indices (new osg::DrawElementsUInt(GL_TRIANGLES));
+            for (std::vector<osg::Matrixf>::const_iterator matrix = it->second.begin(); matrix != it->second.end(); ++matrix)
+            {
+                unsigned int firstVertex = vertices->size();
+                for (osg::Vec3Array::const_iterator vertex = srcVertices->begin(); vertex != srcVertices->end(); ++vertex)
+                {
+                    vertices->push_back(*vertex * (*matrix));
+                    normals->push_back(osg::Matrixf::transform3x3(osg::Vec3f(0, 0, 1), *matrix));
+                }
+                for (unsigned int i=0; i<srcIndices->getNumIndices(); ++i)
+                    indices->push_back(firstVertex + srcIndices->index(i));
+            }
+
+            osg::ref_ptr<osg::Geometry> merged (new osg::Geometry);
+            merged->setVertexArray(vertices);
+            merged->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+            merged->addPrimitiveSet(indices);
+            root->addChild(merged);
+        }
+        return root;
+    }
+
+    static unsigned int countNodes(osg::Node* root)
+    {
+        CountNodesVisitor visitor;
+        root->accept(visitor);
+        return visitor.mNumNodes;
+    }
+
+    /// Run the cull traversal without a graphics context.
+    /// @return the number of drawables that passed culling
+    static unsigned int cull(osg::Node* root)
+    {
+        osg::ref_ptr<osg::Viewport> viewport (new osg::Viewport(0, 0, 1280, 720));
+        osg::ref_ptr<osgUtil::CullVisitor> cullVisitor (new osgUtil::CullVisitor);
+        osg::ref_ptr<osgUtil::StateGraph> stateGraph (new osgUtil::StateGraph);
+        osg::ref_ptr<osgUtil::RenderStage> renderStage (new osgUtil::RenderStage);
+        renderStage->setViewport(viewport);
+
+        // looking across the scene, so part of the references are outside of the view
+        osg::ref_ptr<osg::RefMatrix> projection (new osg::RefMatrix(osg::Matrix::perspective(55.0, 1280.0/720.0, 1.0, 7000.0)));
+        osg::ref_ptr<osg::RefMatrix> view (new osg::RefMatrix(osg::Matrix::lookAt(osg::Vec3(4000, -1000, 1500), osg::Vec3(4000, 2500, 0), osg::Vec3(0, 0, 1))));
+
+        cullVisitor->setStateGraph(stateGraph);
+        cullVisitor->setRenderStage(renderStage);
+
+        cullVisitor->pushViewport(viewport);
+        cullVisitor->pushProjectionMatrix(projection);
+        cullVisitor->pushModelViewMatrix(view, osg::Transform::ABSOLUTE_RF);
+        root->accept(*cullVisitor);
+        cullVisitor->popModelViewMatrix();
+        cullVisitor->popProjectionMatrix();
+        cullVisitor->popViewport();
+
+        osgUtil::Statistics stats;
+        renderStage->getStats(stats);
+        return stats.numDrawables;
+    }
+
+    osg::ref_ptr<osg::Geometry> mGeometry;
+    osg::ref_ptr<osg::Group> mTemplate;
+    std::vector<Reference> mReferences;
+};
+
+TEST_F(InstancingTest, source_geometry_is_copied_and_left_untouched)
+{
+    std::vector<osg::Matrixf> matrices;
+    for (std::vector<Reference>::const_iterator it = mReferences.begin(); it != mReferences.end(); ++it)
+        matrices.push_back(it->getMatrix());
+
+    osg::ref_ptr<SceneUtil::InstancedGeometry> instanced (new SceneUtil::InstancedGeometry(*mGeometry, matrices));
+
+    // the source is a template that other threads use, so its arrays must not get vertex buffer objects
+    EXPECT_NE(mGeometry->getVertexArray(), instanced->getVertexArray());
+    EXPECT_NE(mGeometry->getNormalArray(), instanced->getNormalArray());
+    EXPECT_TRUE(mGeometry->getVertexArray()->getVertexBufferObject() == NULL);
+    EXPECT_TRUE(mGeometry->getNormalArray()->getVertexBufferObject() == NULL);
+    EXPECT_EQ(mGeometry->getVertexArray()->getNumElements(), instanced->getVertexArray()->getNumElements());
+    ASSERT_EQ(1u, instanced->getNumPrimitiveSets());
+    EXPECT_EQ(static_cast<int>(matrices.size()), instanced->getPrimitiveSet(0)->getNumInstances());
+    EXPECT_EQ(0, mGeometry->getPrimitiveSet(0)->getNumInstances());
+
+    for (unsigned int row=0; row<3; ++row)
+    {
+        const osg::Array* array = instanced->getVertexAttribArray(SceneUtil::InstancedGeometry::sInstanceAttribute + row);
+        ASSERT_TRUE(array != NULL);
+        EXPECT_EQ(matrices.size(), array->getNumElements());
+    }
+}
+
+TEST_F(InstancingTest, bound_covers_all_instances)
+{
+    std::vector<osg::Matrixf> matrices;
+    for (std::vector<Reference>::const_iterator it = mReferences.begin(); it != mReferences.end(); ++it)
+        matrices.push_back(it->getMatrix());
+
+    osg::ref_ptr<SceneUtil::InstancedGeometry> instanced (new SceneUtil::InstancedGeometry(*mGeometry, matrices));
+    const osg::BoundingBox& box = instanced->getBoundingBox();
+
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(mGeometry->getVertexArray());
+    for (std::vector<osg::Matrixf>::const_iterator it = matrices.begin(); it != matrices.end(); ++it)
+        for (osg::Vec3Array::const_iterator vertex = vertices->begin(); vertex != vertices->end(); ++vertex)
+            EXPECT_TRUE(box.contains(*vertex * (*it), 0.01f));
+
+    // and not much more than that
+    EXPECT_LT(box.xMax() - box.xMin(), 40 * 200.f + 200.f);
+}
+
+TEST_F(InstancingTest, intersections_hit_the_instances_where_they_are_drawn)
+{
+    osg::ref_ptr<osg::Group> scene = createInstancedScene();
+
+    for (unsigned int i=0; i<mReferences.size(); i += 97)
+    {
+        const Reference& reference = mReferences[i];
+
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector (new osgUtil::LineSegmentIntersector(
+                    reference.mPosition + osg::Vec3f(0, 0, 1000), reference.mPosition - osg::Vec3f(0, 0, 1000)));
+        osgUtil::IntersectionVisitor visitor (intersector);
+        scene->accept(visitor);
+
+        ASSERT_TRUE(intersector->containsIntersections());
+        EXPECT_NEAR(10 * reference.mScale, intersector->getFirstIntersection().getWorldIntersectPoint().z(), 0.01);
+
+        // between the rocks
+        intersector = new osgUtil::LineSegmentIntersector(reference.mPosition + osg::Vec3f(100, 100, 1000),
+                                                          reference.mPosition + osg::Vec3f(100, 100, -1000));
+        osgUtil::IntersectionVisitor missVisitor (intersector);
+        scene->accept(missVisitor);
+        EXPECT_FALSE(intersector->containsIntersections());
+    }
+}
+
+TEST_F(InstancingTest, instanced_and_merged_scenes_have_fewer_nodes_and_draws)
+{
+    osg::ref_ptr<osg::Group> cloned = createClonedScene();
+    osg::ref_ptr<osg::Group> instanced = createInstancedScene();
+    osg::ref_ptr<osg::Group> merged = createMergedScene();
+
+    // the cost of the cull traversal and the clones grows with the number of nodes
+    unsigned int clonedNodes = countNodes(cloned);
+    EXPECT_LT(countNodes(instanced) * 50, clonedNodes);
+    EXPECT_LT(countNodes(merged) * 50, clonedNodes);
+
+    unsigned int clonedDrawables = cull(cloned);
+    unsigned int instancedDrawables = cull(instanced);
+    unsigned int mergedDrawables = cull(merged);
+    EXPECT_GT(instancedDrawables, 0u);
+    EXPECT_LT(instancedDrawables * 10, clonedDrawables);
+    EXPECT_EQ(instancedDrawables, mergedDrawables);
+}
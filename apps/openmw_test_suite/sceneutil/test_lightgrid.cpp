@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include <components/sceneutil/lightgrid.hpp>
+
+struct LightGridTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+        // An interior lit by many small torches and candles, plus a few large lights,
+        // with objects scattered in between. Fixed seed to keep the test deterministic.
+        std::srand(42);
+
+        for (int i=0; i<300; ++i)
+            mLights.push_back(osg::BoundingSphere(randomPosition(), i % 50 == 0 ? 2000.f : randomFloat(64.f, 384.f)));
+
+        for (int i=0; i<2000; ++i)
+            mObjects.push_back(osg::BoundingSphere(randomPosition(), randomFloat(8.f, 256.f)));
+
+        mGrid.build(mLights);
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static float randomFloat(float min, float max)
+    {
+        return min + (max - min) * (std::rand() / static_cast<float>(RAND_MAX));
+    }
+
+    static osg::Vec3f randomPosition()
+    {
+        return osg::Vec3f(randomFloat(-4096.f, 4096.f), randomFloat(-4096.f, 4096.f), randomFloat(-512.f, 512.f));
+    }
+
+    std::vector<unsigned int> bruteForce(const osg::BoundingSphere& bound) const
+    {
+        std::vector<unsigned int> result;
+        for (unsigned int i=0; i<mLights.size(); ++i)
+            if (mLights[i].intersects(bound))
+                result.push_back(i);
+        return result;
+    }
+
+    std::vector<unsigned int> fromGrid(const osg::BoundingSphere& bound, size_t& numCandidates) const
+    {
+        std::vector<unsigned int> candidates;
+        mGrid.query(bound, candidates);
+        numCandidates += candidates.size();
+
+        std::vector<unsigned int> result;
+        for (unsigned int i=0; i<candidates.size(); ++i)
+            if (mLights[candidates[i]].intersects(bound))
+                result.push_back(candidates[i]);
+        return result;
+    }
+
+    std::vector<osg::BoundingSphere> mLights;
+    std::vector<osg::BoundingSphere> mObjects;
+    SceneUtil::LightGrid mGrid;
+};
+
+TEST_F(LightGridTest, finds_same_lights_as_brute_force)
+{
+    size_t numCandidates = 0;
+    for (unsigned int i=0; i<mObjects.size(); ++i)
+        ASSERT_EQ(bruteForce(mObjects[i]), fromGrid(mObjects[i], numCandidates));
+}
+
+TEST_F(LightGridTest, tests_fewer_lights_than_brute_force)
+{
+    size_t numCandidates = 0;
+    for (unsigned int i=0; i<mObjects.size(); ++i)
+        fromGrid(mObjects[i], numCandidates);
+
+    // The cull cost is dominated by the number of light/object intersection tests.
+    // The grid should only need to test a fraction of what testing every light would take.
+    size_t bruteForceTests = mObjects.size() * mLights.size();
+    EXPECT_LT(numCandidates * 4, bruteForceTests);
+}
+
+TEST_F(LightGridTest, bound_outside_of_grid_finds_nothing)
+{
+    std::vector<unsigned int> candidates;
+    mGrid.query(osg::BoundingSphere(osg::Vec3f(100000.f, 0.f, 0.f), 10.f), candidates);
+    EXPECT_TRUE(candidates.empty());
+}
+
+TEST_F(LightGridTest, empty_grid_finds_nothing)
+{
+    SceneUtil::LightGrid grid;
+    grid.build(std::vector<osg::BoundingSphere>());
+
+    std::vector<unsigned int> candidates;
+    grid.query(mObjects.front(), candidates);
+    EXPECT_TRUE(candidates.empty());
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osg/Vec3f>
+
+#include <components/terrain/compositemap.hpp>
+
+struct CompositeMapTest : public ::testing::Test
+{
+  protected:
+    virtual void SetUp()
+    {
+    }
+
+    virtual void TearDown()
+    {
+    }
+
+    static osg::ref_ptr<osg::Image> createLayer(int size, const osg::Vec4f& colour)
+    {
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (int t=0; t<size; ++t)
+            for (int s=0; s<size; ++s)
+                image->setColor(colour, s, t);
+        return image;
+    }
+
+    static osg::ref_ptr<osg::Image> createCheckerboard(int size)
+    {
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        for (int t=0; t<size; ++t)
+            for (int s=0; s<size; ++s)
+                image->setColor((s+t) % 2 ? osg::Vec4f(1,1,1,1) : osg::Vec4f(0,0,0,1), s, t);
+        return image;
+    }
+
+    static osg::ref_ptr<osg::Image> createBlendmap(int size, unsigned char value)
+    {
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(size, size, 1, GL_ALPHA, GL_UNSIGNED_BYTE);
+        std::fill(image->data(), image->data() + size*size, value);
+        return image;
+    }
+
+    static osg::ref_ptr<osg::Image> createComposite(int size)
+    {
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(size, size, 1, GL_RGB, GL_UNSIGNED_BYTE);
+        std::fill(image->data(), image->data() + size*size*3, 0);
+        return image;
+    }
+
+    static Terrain::LayerMipmaps createMipmaps(const osg::Image* image)
+    {
+        Terrain::LayerMipmaps mipmaps;
+        Terrain::createLayerMipmaps(image, 64, mipmaps);
+        return mipmaps;
+    }
+};
+
+TEST_F(CompositeMapTest, mipmaps_go_down_to_one_texel)
+{
+    Terrain::LayerMipmaps mipmaps = createMipmaps(createCheckerboard(128));
+
+    ASSERT_EQ(7u, mipmaps.size());
+    EXPECT_EQ(64, mipmaps.front()->s());
+    EXPECT_EQ(1, mipmaps.back()->s());
+    EXPECT_EQ(1, mipmaps.back()->t());
+
+    // a checkerboard averages to grey
+    EXPECT_NEAR(128, mipmaps.back()->data()[0], 2);
+}
+
+TEST_F(CompositeMapTest, uniform_layers_blend_like_the_layer_passes)
+{
+    std::vector<Terrain::LayerMipmaps> layers;
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(1,0,0,1))));
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(0,1,0,1))));
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(0,0,1,0.5f))));
+
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+    blendmaps.push_back(createBlendmap(17, 128));
+    blendmaps.push_back(createBlendmap(17, 255));
+
+    osg::ref_ptr<osg::Image> composite = createComposite(32);
+    Terrain::blendLayers(layers, blendmaps, 16.f, composite, 0, 0, 32);
+
+    // red, then half of the green layer, then the blue layer weighted by its alpha
+    float green = 128/255.f;
+    osg::Vec3f expected = osg::Vec3f(1-green, green, 0) * 0.5f + osg::Vec3f(0, 0, 1) * 0.5f;
+    for (int i=0; i<32*32; ++i)
+    {
+        EXPECT_NEAR(expected.x()*255, composite->data()[i*3], 2);
+        EXPECT_NEAR(expected.y()*255, composite->data()[i*3+1], 2);
+        EXPECT_NEAR(expected.z()*255, composite->data()[i*3+2], 2);
+    }
+}
+
+TEST_F(CompositeMapTest, blendmap_gradient_is_interpolated)
+{
+    std::vector<Terrain::LayerMipmaps> layers;
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(0,0,0,1))));
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(1,1,1,1))));
+
+    // blend value increases from 0 at the first column to 1 at the last
+    const int blendmapSize = 17;
+    osg::ref_ptr<osg::Image> blendmap = createBlendmap(blendmapSize, 0);
+    for (int t=0; t<blendmapSize; ++t)
+        for (int s=0; s<blendmapSize; ++s)
+            blendmap->data()[t*blendmapSize + s] = static_cast<unsigned char>(s * 255 / (blendmapSize-1));
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps (1, blendmap);
+
+    const int size = 64;
+    osg::ref_ptr<osg::Image> composite = createComposite(size);
+    Terrain::blendLayers(layers, blendmaps, 16.f, composite, 0, 0, size);
+
+    for (int row=0; row<size; ++row)
+    {
+        for (int col=0; col<size; ++col)
+        {
+            float u = (col + 0.5f) / size;
+            EXPECT_NEAR(u * 255, composite->data()[(row*size + col)*3], 3);
+        }
+    }
+}
+
+TEST_F(CompositeMapTest, area_is_written_without_touching_the_rest)
+{
+    std::vector<Terrain::LayerMipmaps> layers;
+    layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(1,1,1,1))));
+    std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+
+    osg::ref_ptr<osg::Image> composite = createComposite(16);
+    Terrain::blendLayers(layers, blendmaps, 4.f, composite, 8, 0, 8);
+
+    for (int row=0; row<16; ++row)
+    {
+        for (int col=0; col<16; ++col)
+        {
+            bool inside = col >= 8 && row < 8;
+            EXPECT_EQ(inside ? 255 : 0, composite->data()[(row*16 + col)*3]);
+        }
+    }
+}
+
+TEST_F(CompositeMapTest, cache_file_round_trip)
+{
+    std::string file = "test_compositemap.bin";
+
+    osg::ref_ptr<osg::Image> composite = createComposite(8);
+    for (int i=0; i<8*8*3; ++i)
+        composite->data()[i] = static_cast<unsigned char>(i);
+
+    Terrain::writeCompositeMap(file, 1234, *composite);
+
+    osg::ref_ptr<osg::Image> loaded = Terrain::readCompositeMap(file, 1234);
+    ASSERT_TRUE(loaded.valid());
+    EXPECT_EQ(8, loaded->s());
+    EXPECT_EQ(8, loaded->t());
+    EXPECT_TRUE(std::equal(composite->data(), composite->data() + 8*8*3, loaded->data()));
+
+    // a different key means the content files changed
+    EXPECT_FALSE(Terrain::readCompositeMap(file, 4321).valid());
+
+    std::remove(file.c_str());
+
+    EXPECT_FALSE(Terrain::readCompositeMap(file, 1234).valid());
+}
+
+TEST_F(CompositeMapTest, trimming_the_cache_keeps_recently_used_files)
+{
+    std::string directory = "test_compositemap_cache";
+    boost::filesystem::create_directories(directory);
+
+    osg::ref_ptr<osg::Image> composite = createComposite(8);
+    std::string files[3];
+    for (int i=0; i<3; ++i)
+    {
+        std::ostringstream name;
+        name << directory << "/composite_" << i << ".bin";
+        files[i] = name.str();
+        Terrain::writeCompositeMap(files[i], 1234, *composite);
+        boost::filesystem::last_write_time(files[i], 1000 + i);
+    }
+    std::string other = directory + "/other.bin";
+    boost::filesystem::copy_file(files[0], other);
+
+    // reading the oldest file makes it the most recently used one
+    ASSERT_TRUE(Terrain::readCompositeMap(files[0], 1234).valid());
+
+    boost::uint64_t size = boost::filesystem::file_size(files[0]);
+    Terrain::trimCompositeMapCache(directory, 2 * size);
+
+    EXPECT_TRUE(boost::filesystem::exists(files[0]));
+    EXPECT_FALSE(boost::filesystem::exists(files[1]));
+    EXPECT_TRUE(boost::filesystem::exists(files[2]));
+    // not a composite map
+    EXPECT_TRUE(boost::filesystem::exists(other));
+
+    boost::filesystem::remove_all(directory);
+}
+
+TEST_F(CompositeMapTest, packed_blendmaps_blend_like_separate_blendmaps)
+{
+    std::vector<Terrain::LayerMipmaps> layers;
+    for (int i=0; i<6; ++i)
+        layers.push_back(createMipmaps(createLayer(16, osg::Vec4f(i/5.f, 1-i/5.f, (i%2) ? 1 : 0, 1))));
+
+    // five blended layers, in one packed blendmap with four channels and a second one with a single used channel
+    const int blendmapSize = 17;
+    std::vector<osg::ref_ptr<osg::Image> > separate;
+    std::vector<osg::ref_ptr<osg::Image> > packed;
+    for (int i=0; i<2; ++i)
+    {
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(blendmapSize, blendmapSize, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        std::fill(image->data(), image->data() + blendmapSize*blendmapSize*4, 0);
+        packed.push_back(image);
+    }
+    for (int layer=0; layer<5; ++layer)
+    {
+        osg::ref_ptr<osg::Image> image = createBlendmap(blendmapSize, 0);
+        for (int i=0; i<blendmapSize*blendmapSize; ++i)
+        {
+            unsigned char value = static_cast<unsigned char>((i * 37 + layer * 91) % 256);
+            image->data()[i] = value;
+            packed[layer/4]->data()[i*4 + layer%4] = value;
+        }
+        separate.push_back(image);
+    }
+
+    const int size = 32;
+    osg::ref_ptr<osg::Image> expected = createComposite(size);
+    Terrain::blendLayers(layers, separate, 16.f, expected, 0, 0, size);
+    osg::ref_ptr<osg::Image> composite = createComposite(size);
+    Terrain::blendLayers(layers, packed, 16.f, composite, 0, 0, size);
+
+    EXPECT_TRUE(std::equal(expected->data(), expected->data() + size*size*3, composite->data()));
+}
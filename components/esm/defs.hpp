@@ -127,6 +127,7 @@ enum RecNameInts
     REC_ENAB = FourCC<'E','N','A','B'>::value,
     REC_CAM_ = FourCC<'C','A','M','_'>::value,
     REC_STLN = FourCC<'S','T','L','N'>::value,
+    REC_ZSAV = FourCC<'Z','S','A','V'>::value, ///< zlib-compressed block of the remaining saved game records
 
     // format 1
     REC_FILT = FourCC<'F','I','L','T'>::value,
@@ -77,6 +77,23 @@ namespace ESM
         endRecord("TES3");
     }
 
+    void ESMWriter::setStream(std::ostream& stream)
+    {
+        if (!mRecords.empty())
+            throw std::runtime_error ("Unclosed record remaining");
+
+        mStream = &stream;
+    }
+
+    void ESMWriter::writeRecords(const std::string& records, int count)
+    {
+        if (!mRecords.empty())
+            throw std::runtime_error ("Unclosed record remaining");
+
+        mStream->write (records.data(), records.size());
+        mRecordCount += count;
+    }
+
     void ESMWriter::close()
     {
         if (!mRecords.empty())
@@ -52,6 +52,13 @@ class ESMWriter
         void save(std::ostream& file);
         ///< Start saving a file by writing the TES3 header.
 
+        void setStream(std::ostream& stream);
+        ///< Write all following records to \a stream, without a TES3 header. Used to write records into
+        /// separate buffers, that are then joined with writeRecords().
+
+        void writeRecords(const std::string& records, int count);
+        ///< Append \a count complete records that were written by another ESMWriter.
+
         void close();
         ///< \note Does not close the stream.
 
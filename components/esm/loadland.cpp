@@ -8,6 +8,67 @@
 #include "esmwriter.hpp"
 #include "defs.hpp"
 
+namespace
+{
+    bool condLoad(ESM::ESMReader& reader, int flags, int& loaded, int dataFlag, void *ptr, unsigned int size)
+    {
+        if ((loaded & dataFlag) == 0 && (flags & dataFlag) != 0) {
+            reader.getHExact(ptr, size);
+            loaded |= dataFlag;
+            return true;
+        }
+        reader.skipHSubSize(size);
+        return false;
+    }
+
+    /// Read the data types in \a flags that are not in \a loaded yet from the land record at \a context.
+    /// Uses its own reader and scratch buffers, so that several threads can read land data at the same time.
+    /// \return The data types that are loaded now
+    int readLandData(const ESM::ESM_Context& context, int flags, int loaded, ESM::Land::LandData& data)
+    {
+        ESM::ESMReader reader;
+        reader.restoreContext(context);
+
+        if (reader.isNextSub("VNML")) {
+            condLoad(reader, flags, loaded, ESM::Land::DATA_VNML, data.mNormals, sizeof(data.mNormals));
+        }
+
+        if (reader.isNextSub("VHGT")) {
+            ESM::Land::VHGT vhgt;
+            if (condLoad(reader, flags, loaded, ESM::Land::DATA_VHGT, &vhgt, sizeof(vhgt))) {
+                float rowOffset = vhgt.mHeightOffset;
+                for (int y = 0; y < ESM::Land::LAND_SIZE; y++) {
+                    rowOffset += vhgt.mHeightData[y * ESM::Land::LAND_SIZE];
+
+                    data.mHeights[y * ESM::Land::LAND_SIZE] = rowOffset * ESM::Land::HEIGHT_SCALE;
+
+                    float colOffset = rowOffset;
+                    for (int x = 1; x < ESM::Land::LAND_SIZE; x++) {
+                        colOffset += vhgt.mHeightData[y * ESM::Land::LAND_SIZE + x];
+                        data.mHeights[x + y * ESM::Land::LAND_SIZE] = colOffset * ESM::Land::HEIGHT_SCALE;
+                    }
+                }
+                data.mUnk1 = vhgt.mUnk1;
+                data.mUnk2 = vhgt.mUnk2;
+            }
+        }
+
+        if (reader.isNextSub("WNAM")) {
+            condLoad(reader, flags, loaded, ESM::Land::DATA_WNAM, data.mWnam, 81);
+        }
+        if (reader.isNextSub("VCLR"))
+            condLoad(reader, flags, loaded, ESM::Land::DATA_VCLR, data.mColours, 3 * ESM::Land::LAND_NUM_VERTS);
+        if (reader.isNextSub("VTEX")) {
+            uint16_t vtex[ESM::Land::LAND_NUM_TEXTURES];
+            if (condLoad(reader, flags, loaded, ESM::Land::DATA_VTEX, vtex, sizeof(vtex))) {
+                ESM::Land::LandData::transposeTextureData(vtex, data.mTextures);
+            }
+        }
+
+        return loaded;
+    }
+}
+
 namespace ESM
 {
     unsigned int Land::sRecordId = REC_LAND;
@@ -51,7 +112,7 @@ namespace ESM
             esm.writeHNT("VCLR", mColours, 3*LAND_NUM_VERTS);
         }
         if (mDataTypes & Land::DATA_VTEX) {
-            static uint16_t vtex[LAND_NUM_TEXTURES];
+            uint16_t vtex[LAND_NUM_TEXTURES];
             transposeTextureData(mTextures, vtex);
             esm.writeHNT("VTEX", vtex, sizeof(vtex));
         }
@@ -63,7 +124,7 @@ namespace ESM
         , mY(0)
         , mPlugin(0)
         , mDataTypes(0)
-        , mDataLoaded(false)
+        , mDataLoaded(0)
         , mLandData(NULL)
     {
     }
@@ -153,7 +214,7 @@ namespace ESM
             }
         }
 
-        mDataLoaded = 0;
+        mDataLoaded.exchange(0);
         mLandData = NULL;
     }
 
@@ -180,12 +241,18 @@ namespace ESM
 
     void Land::loadData(int flags) const
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-
         // Try to load only available data
         flags = flags & mDataTypes;
-        // Return if all required data is loaded
-        if ((mDataLoaded & flags) == flags) {
+        // Return if all required data is loaded, without locking. The data is published before its flag.
+        if ((static_cast<int>(mDataLoaded) & flags) == flags) {
+            return;
+        }
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+
+        // Another thread may have loaded the data meanwhile
+        int loaded = mDataLoaded;
+        if ((loaded & flags) == flags) {
             return;
         }
         // Create storage if nothing is loaded
@@ -194,77 +261,36 @@ namespace ESM
             mLandData->mDataTypes = mDataTypes;
         }
 
-        ESM::ESMReader reader;
-        reader.restoreContext(mContext);
-
-        if (reader.isNextSub("VNML")) {
-            condLoad(reader, flags, DATA_VNML, mLandData->mNormals, sizeof(mLandData->mNormals));
-        }
-
-        if (reader.isNextSub("VHGT")) {
-            static VHGT vhgt;
-            if (condLoad(reader, flags, DATA_VHGT, &vhgt, sizeof(vhgt))) {
-                float rowOffset = vhgt.mHeightOffset;
-                for (int y = 0; y < LAND_SIZE; y++) {
-                    rowOffset += vhgt.mHeightData[y * LAND_SIZE];
-
-                    mLandData->mHeights[y * LAND_SIZE] = rowOffset * HEIGHT_SCALE;
-
-                    float colOffset = rowOffset;
-                    for (int x = 1; x < LAND_SIZE; x++) {
-                        colOffset += vhgt.mHeightData[y * LAND_SIZE + x];
-                        mLandData->mHeights[x + y * LAND_SIZE] = colOffset * HEIGHT_SCALE;
-                    }
-                }
-                mLandData->mUnk1 = vhgt.mUnk1;
-                mLandData->mUnk2 = vhgt.mUnk2;
-            }
-        }
+        mDataLoaded.OR(readLandData(mContext, flags, loaded, *mLandData));
+    }
 
-        if (reader.isNextSub("WNAM")) {
-            condLoad(reader, flags, DATA_WNAM, mLandData->mWnam, 81);
-        }
-        if (reader.isNextSub("VCLR"))
-            condLoad(reader, flags, DATA_VCLR, mLandData->mColours, 3 * LAND_NUM_VERTS);
-        if (reader.isNextSub("VTEX")) {
-            static uint16_t vtex[LAND_NUM_TEXTURES];
-            if (condLoad(reader, flags, DATA_VTEX, vtex, sizeof(vtex))) {
-                LandData::transposeTextureData(vtex, mLandData->mTextures);
-            }
-        }
+    void Land::loadData(int flags, LandData& data) const
+    {
+        data.mDataTypes = mDataTypes;
+        readLandData(mContext, flags & mDataTypes, 0, data);
     }
 
     void Land::unloadData()
     {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+
         if (mDataLoaded)
         {
+            mDataLoaded.exchange(0);
             delete mLandData;
             mLandData = NULL;
-            mDataLoaded = 0;
         }
     }
 
-    bool Land::condLoad(ESM::ESMReader& reader, int flags, int dataFlag, void *ptr, unsigned int size) const
-    {
-        if ((mDataLoaded & dataFlag) == 0 && (flags & dataFlag) != 0) {
-            reader.getHExact(ptr, size);
-            mDataLoaded |= dataFlag;
-            return true;
-        }
-        reader.skipHSubSize(size);
-        return false;
-    }
-
     bool Land::isDataLoaded(int flags) const
     {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
-        return (mDataLoaded & flags) == (flags & mDataTypes);
+        return (static_cast<int>(mDataLoaded) & flags) == (flags & mDataTypes);
     }
 
     Land::Land (const Land& land)
     : mFlags (land.mFlags), mX (land.mX), mY (land.mY), mPlugin (land.mPlugin),
       mContext (land.mContext), mDataTypes (land.mDataTypes),
-      mDataLoaded (land.mDataLoaded),
+      mDataLoaded (static_cast<unsigned int>(land.mDataLoaded)),
       mLandData (land.mLandData ? new LandData (*land.mLandData) : 0)
     {}
 
@@ -282,7 +308,7 @@ namespace ESM
         std::swap (mPlugin, land.mPlugin);
         std::swap (mContext, land.mContext);
         std::swap (mDataTypes, land.mDataTypes);
-        std::swap (mDataLoaded, land.mDataLoaded);
+        mDataLoaded.exchange (land.mDataLoaded.exchange (mDataLoaded));
         std::swap (mLandData, land.mLandData);
     }
 
@@ -311,13 +337,13 @@ namespace ESM
             mLandData = new LandData;
 
         mDataTypes |= flags;
-        mDataLoaded |= flags;
+        mDataLoaded.OR(flags);
     }
 
     void Land::remove (int flags)
     {
         mDataTypes &= ~flags;
-        mDataLoaded &= ~flags;
+        mDataLoaded.AND(~flags);
 
         if (!mDataLoaded)
         {
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include <OpenThreads/Mutex>
+#include <OpenThreads/Atomic>
 
 #include "esmcommon.hpp"
 
@@ -114,11 +115,19 @@ struct Land
 
     /**
      * Actually loads data
+     * @note Thread safe, can be called from several threads for the same land at once.
      */
     void loadData(int flags) const;
 
+    /**
+     * Loads data into \a data owned by the caller, leaving the data of this record alone.
+     * Use this for one-off reads, so that the shared data does not have to be unloaded afterwards.
+     */
+    void loadData(int flags, LandData& data) const;
+
     /**
      * Frees memory allocated for land data
+     * @attention Must not be called while the data may still be in use by another thread.
      */
     void unloadData();
 
@@ -153,14 +162,9 @@ struct Land
 
     private:
 
-        /// Loads data and marks it as loaded
-        /// \return true if data is actually loaded from file, false otherwise
-        /// including the case when data is already loaded
-        bool condLoad(ESM::ESMReader& reader, int flags, int dataFlag, void *ptr, unsigned int size) const;
-
         mutable OpenThreads::Mutex mMutex;
 
-        mutable int mDataLoaded;
+        mutable OpenThreads::Atomic mDataLoaded;
 
         mutable LandData *mLandData;
 };
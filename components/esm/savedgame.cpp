@@ -23,13 +23,17 @@ void ESM::SavedGame::load (ESMReader &esm)
     while (esm.isNextSub ("DEPE"))
         mContentFiles.push_back (esm.getHString());
 
-    esm.getSubNameIs("SCRN");
-    esm.getSubHeader();
-    mScreenshot.resize(esm.getSubSize());
-    esm.getExact(&mScreenshot[0], mScreenshot.size());
+    // optional, so that headers can be stored without their screenshot
+    if (esm.isNextSub("SCRN"))
+    {
+        esm.getSubHeader();
+        mScreenshot.resize(esm.getSubSize());
+        if (!mScreenshot.empty())
+            esm.getExact(&mScreenshot[0], mScreenshot.size());
+    }
 }
 
-void ESM::SavedGame::save (ESMWriter &esm) const
+void ESM::SavedGame::save (ESMWriter &esm, bool withScreenshot) const
 {
     esm.writeHNString ("PLNA", mPlayerName);
     esm.writeHNT ("PLLE", mPlayerLevel);
@@ -48,7 +52,11 @@ void ESM::SavedGame::save (ESMWriter &esm) const
          iter!=mContentFiles.end(); ++iter)
          esm.writeHNString ("DEPE", *iter);
 
-    esm.startSubRecord("SCRN");
-    esm.write(&mScreenshot[0], mScreenshot.size());
-    esm.endRecord("SCRN");
+    if (withScreenshot)
+    {
+        esm.startSubRecord("SCRN");
+        if (!mScreenshot.empty())
+            esm.write(&mScreenshot[0], mScreenshot.size());
+        esm.endRecord("SCRN");
+    }
 }
@@ -42,7 +42,9 @@ namespace ESM
         std::vector<char> mScreenshot; // raw jpg-encoded data
 
         void load (ESMReader &esm);
-        void save (ESMWriter &esm) const;
+        /// @param withScreenshot Write the SCRN subrecord, even if it is empty. Saved games need it to be
+        /// loadable by older versions, only the header index leaves it out.
+        void save (ESMWriter &esm, bool withScreenshot = true) const;
     };
 }
 
@@ -1,6 +1,7 @@
 #include "storage.hpp"
 
-#include <set>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include <OpenThreads/ScopedLock>
@@ -273,37 +274,6 @@ namespace ESMTerrain
         assert(vertY_ == numVerts);  // Ensure we covered whole area
     }
 
-    Storage::UniqueTextureId Storage::getVtexIndexAt(int cellX, int cellY,
-                                           int x, int y)
-    {
-        // For the first/last row/column, we need to get the texture from the neighbour cell
-        // to get consistent blending at the borders
-        --x;
-        if (x < 0)
-        {
-            --cellX;
-            x += ESM::Land::LAND_TEXTURE_SIZE;
-        }
-        if (y >= ESM::Land::LAND_TEXTURE_SIZE) // Y appears to be wrapped from the other side because why the hell not?
-        {
-            ++cellY;
-            y -= ESM::Land::LAND_TEXTURE_SIZE;
-        }
-
-        assert(x<ESM::Land::LAND_TEXTURE_SIZE);
-        assert(y<ESM::Land::LAND_TEXTURE_SIZE);
-
-        if (const ESM::Land::LandData *data = getLandData (cellX, cellY, ESM::Land::DATA_VTEX))
-        {
-            int tex = data->mTextures[y * ESM::Land::LAND_TEXTURE_SIZE + x];
-            if (tex == 0)
-                return std::make_pair(0,0); // vtex 0 is always the base texture, regardless of plugin
-            return std::make_pair(tex, getLand (cellX, cellY)->mPlugin);
-        }
-        else
-            return std::make_pair(0,0);
-    }
-
     std::string Storage::getTextureName(UniqueTextureId id)
     {
         static const std::string defaultTexture = "textures\\_land_default.dds";
@@ -346,68 +316,95 @@ namespace ESMTerrain
         assert (rowEnd <= realTextureSize);
         assert (colEnd <= realTextureSize);
 
-        // Save the used texture indices so we know the total number of textures
-        // and number of required blend maps
-        std::set<UniqueTextureId> textureIndices;
-        // Due to the way the blending works, the base layer will always shine through in between
-        // blend transitions (eg halfway between two texels, both blend values will be 0.5, so 25% of base layer visible).
-        // To get a consistent look, we need to make sure to use the same base layer in all cells.
-        // So we're always adding _land_default.dds as the base layer here, even if it's not referenced in this cell.
-        textureIndices.insert(std::make_pair(0,0));
+        const int blendmapSize = (realTextureSize-1) * chunkSize + 1;
 
-        for (int y=colStart; y<colEnd; ++y)
-            for (int x=rowStart; x<rowEnd; ++x)
+        // For the first/last row/column, we need to get the texture from the neighbour cell
+        // to get consistent blending at the borders. Look up the texture data of these cells once,
+        // rather than once per texel, indexed by [x < 0 ? 0 : 1][y >= LAND_TEXTURE_SIZE ? 1 : 0].
+        const ESM::Land::LandData* landData[2][2];
+        int plugins[2][2];
+        for (int i=0; i<2; ++i)
+        {
+            for (int j=0; j<2; ++j)
             {
-                UniqueTextureId id = getVtexIndexAt(cellX, cellY, x, y);
-                textureIndices.insert(id);
+                bool used = (i == 1 || rowStart == 0) && (j == 0 || colEnd == realTextureSize);
+                landData[i][j] = used ? getLandData(cellX-1+i, cellY+j, ESM::Land::DATA_VTEX) : NULL;
+                plugins[i][j] = landData[i][j] ? getLand(cellX-1+i, cellY+j)->mPlugin : 0;
             }
+        }
 
-        // Makes sure the indices are sorted, or rather,
-        // retrieved as sorted. This is important to keep the splatting order
-        // consistent across cells.
-        std::map<UniqueTextureId, int> textureIndicesMap;
-        for (std::set<UniqueTextureId>::iterator it = textureIndices.begin(); it != textureIndices.end(); ++it)
+        std::vector<UniqueTextureId> texelIds (blendmapSize*blendmapSize);
+        for (int y=0; y<blendmapSize; ++y)
         {
-            int size = textureIndicesMap.size();
-            textureIndicesMap[*it] = size;
-            layerList.push_back(getLayerInfo(getTextureName(*it)));
+            for (int x=0; x<blendmapSize; ++x)
+            {
+                // Y appears to be wrapped from the other side because why the hell not?
+                int texX = x + rowStart - 1;
+                int texY = y + colStart;
+                int i = 1, j = 0;
+                if (texX < 0)
+                {
+                    i = 0;
+                    texX += ESM::Land::LAND_TEXTURE_SIZE;
+                }
+                if (texY >= ESM::Land::LAND_TEXTURE_SIZE)
+                {
+                    j = 1;
+                    texY -= ESM::Land::LAND_TEXTURE_SIZE;
+                }
+
+                int tex = landData[i][j] ? landData[i][j]->mTextures[texY * ESM::Land::LAND_TEXTURE_SIZE + texX] : 0;
+                // vtex 0 is always the base texture, regardless of plugin
+                texelIds[y*blendmapSize + x] = tex == 0 ? std::make_pair(0,0) : std::make_pair(tex, plugins[i][j]);
+            }
         }
 
-        int numTextures = textureIndices.size();
+        // Sort the used texture indices, so that we know the number of required blend maps and
+        // the splatting order is consistent across cells.
+        // Due to the way the blending works, the base layer will always shine through in between
+        // blend transitions (eg halfway between two texels, both blend values will be 0.5, so 25% of base layer visible).
+        // To get a consistent look, we need to make sure to use the same base layer in all cells.
+        // So we're always adding _land_default.dds as the base layer here, even if it's not referenced in this cell.
+        std::vector<UniqueTextureId> textureIds (texelIds);
+        textureIds.push_back(std::make_pair(0,0));
+        std::sort(textureIds.begin(), textureIds.end());
+        textureIds.erase(std::unique(textureIds.begin(), textureIds.end()), textureIds.end());
+
+        for (std::vector<UniqueTextureId>::const_iterator it = textureIds.begin(); it != textureIds.end(); ++it)
+            layerList.push_back(getLayerInfo(getTextureName(*it)));
+
+        int numTextures = textureIds.size();
         // numTextures-1 since the base layer doesn't need blending
-        int numBlendmaps = pack ? static_cast<int>(std::ceil((numTextures - 1) / 4.f)) : (numTextures - 1);
+        int numBlendmaps = pack ? (numTextures - 1 + 3) / 4 : (numTextures - 1);
 
         int channels = pack ? 4 : 1;
+        GLenum format = pack ? GL_RGBA : GL_ALPHA;
 
-        // Second iteration - create and fill in the blend maps
-        const int blendmapSize = (realTextureSize-1) * chunkSize + 1;
-
+        // Second iteration - create the blend maps, then set the one channel covered by the layer of each texel.
+        // The texels of every other layer stay 0.
+        std::vector<unsigned char*> blendmapData;
         for (int i=0; i<numBlendmaps; ++i)
         {
-            GLenum format = pack ? GL_RGBA : GL_ALPHA;
-
             osg::ref_ptr<osg::Image> image (new osg::Image);
             image->allocateImage(blendmapSize, blendmapSize, 1, format, GL_UNSIGNED_BYTE);
-            unsigned char* pData = image->data();
+            std::memset(image->data(), 0, blendmapSize*blendmapSize*channels);
+            blendmapData.push_back(image->data());
+            blendmaps.push_back(image);
+        }
 
-            for (int y=0; y<blendmapSize; ++y)
+        for (int y=0; y<blendmapSize; ++y)
+        {
+            for (int x=0; x<blendmapSize; ++x)
             {
-                for (int x=0; x<blendmapSize; ++x)
-                {
-                    UniqueTextureId id = getVtexIndexAt(cellX, cellY, x+rowStart, y+colStart);
-                    assert(textureIndicesMap.find(id) != textureIndicesMap.end());
-                    int layerIndex = textureIndicesMap.find(id)->second;
-                    int blendIndex = (pack ? static_cast<int>(std::floor((layerIndex - 1) / 4.f)) : layerIndex - 1);
-                    int channel = pack ? std::max(0, (layerIndex-1) % 4) : 0;
-
-                    if (blendIndex == i)
-                        pData[(blendmapSize - y - 1)*blendmapSize*channels + x*channels + channel] = 255;
-                    else
-                        pData[(blendmapSize - y - 1)*blendmapSize*channels + x*channels + channel] = 0;
-                }
+                const UniqueTextureId& id = texelIds[y*blendmapSize + x];
+                int layerIndex = std::lower_bound(textureIds.begin(), textureIds.end(), id) - textureIds.begin();
+                if (layerIndex == 0)
+                    continue; // base layer
+
+                int blendIndex = pack ? (layerIndex - 1) / 4 : layerIndex - 1;
+                int channel = pack ? (layerIndex - 1) % 4 : 0;
+                blendmapData[blendIndex][(blendmapSize - y - 1)*blendmapSize*channels + x*channels + channel] = 255;
             }
-
-            blendmaps.push_back(image);
         }
     }
 
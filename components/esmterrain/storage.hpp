@@ -102,8 +102,6 @@ namespace ESMTerrain
         // pair  <texture id, plugin id>
         typedef std::pair<short, short> UniqueTextureId;
 
-        UniqueTextureId getVtexIndexAt(int cellX, int cellY,
-                                               int x, int y);
         std::string getTextureName (UniqueTextureId id);
 
         std::map<std::string, Terrain::LayerInfo> mLayerInfoMap;
@@ -0,0 +1,37 @@
+#include "contentfileskey.hpp"
+
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <components/misc/stringops.hpp>
+
+#include "collections.hpp"
+
+namespace Files
+{
+    std::string getContentFilesKey(const Collections& collections, const std::vector<std::string>& contentFiles)
+    {
+        std::ostringstream stream;
+
+        for (std::vector<std::string>::const_iterator it = contentFiles.begin(); it != contentFiles.end(); ++it)
+        {
+            stream << Misc::StringUtils::lowerCase(*it);
+
+            boost::filesystem::path extension = boost::filesystem::path(*it).extension();
+            const MultiDirCollection& collection = collections.getCollection(Misc::StringUtils::lowerCase(extension.string()));
+            if (collection.doesExist(*it))
+            {
+                boost::filesystem::path path = collection.getPath(*it);
+                boost::system::error_code ec;
+                boost::uintmax_t size = boost::filesystem::file_size(path, ec);
+                std::time_t time = boost::filesystem::last_write_time(path, ec);
+                stream << ':' << size << ':' << time;
+            }
+
+            stream << ';';
+        }
+
+        return stream.str();
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef COMPONENTS_FILES_CONTENTFILESKEY_HPP
+#define COMPONENTS_FILES_CONTENTFILESKEY_HPP
+
+#include <string>
+#include <vector>
+
+namespace Files
+{
+    class Collections;
+
+    /// Build a string identifying the given load order, for validating caches derived from the content files.
+    /// @note The key changes when a content file is added, removed, reordered, or when its size or modification time changes.
+    std::string getContentFilesKey(const Collections& collections, const std::vector<std::string>& contentFiles);
+}
+
+#endif
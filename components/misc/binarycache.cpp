@@ -0,0 +1,60 @@
+#include "binarycache.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const boost::uint32_t sByteOrder = 0x01020304;
+}
+
+namespace Misc
+{
+    void writeBinaryString (std::ostream& stream, const std::string& value)
+    {
+        writeBinary (stream, static_cast<boost::uint32_t> (value.size()));
+        stream.write (value.data(), value.size());
+    }
+
+    void readBinaryString (std::istream& stream, std::string& value)
+    {
+        boost::uint32_t size = 0;
+        readBinary (stream, size);
+        if (!stream || size > (1 << 24))
+            throw std::runtime_error ("invalid string size");
+        value.resize (size);
+        if (size)
+            stream.read (&value[0], size);
+    }
+
+    void writeCacheHeader (std::ostream& stream, const char magic[4], boost::uint32_t version)
+    {
+        stream.write (magic, 4);
+        writeBinary (stream, version);
+        writeBinary (stream, sByteOrder);
+    }
+
+    void readCacheHeader (std::istream& stream, const char magic[4], boost::uint32_t version)
+    {
+        char magic2[4];
+        stream.read (magic2, sizeof (magic2));
+        boost::uint32_t version2 = 0;
+        readBinary (stream, version2);
+        boost::uint32_t byteOrder = 0;
+        readBinary (stream, byteOrder);
+        if (!stream || !std::equal (magic2, magic2 + sizeof (magic2), magic) || version2!=version
+            || byteOrder!=sByteOrder)
+            throw std::runtime_error ("unknown format");
+    }
+
+    boost::uint64_t hashFnv1a (const std::string& data)
+    {
+        boost::uint64_t hash = 14695981039346656037ULL;
+        for (std::string::const_iterator it = data.begin(); it != data.end(); ++it)
+        {
+            hash ^= static_cast<unsigned char> (*it);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
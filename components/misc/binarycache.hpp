@@ -0,0 +1,43 @@
+#ifndef OPENMW_COMPONENTS_MISC_BINARYCACHE_H
+#define OPENMW_COMPONENTS_MISC_BINARYCACHE_H
+
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace Misc
+{
+    /// Helpers for the binary cache files the engine writes for itself. Values are stored in native byte order,
+    /// the header rejects files written by another version or on a machine of the other endianness.
+
+    template<typename T>
+    void writeBinary (std::ostream& stream, const T& value)
+    {
+        stream.write (reinterpret_cast<const char*> (&value), sizeof (T));
+    }
+
+    template<typename T>
+    void readBinary (std::istream& stream, T& value)
+    {
+        stream.read (reinterpret_cast<char*> (&value), sizeof (T));
+    }
+
+    void writeBinaryString (std::ostream& stream, const std::string& value);
+
+    /// @throw std::runtime_error if the size is not plausible
+    void readBinaryString (std::istream& stream, std::string& value);
+
+    /// Write the magic number, \a version and the byte order marker.
+    void writeCacheHeader (std::ostream& stream, const char magic[4], boost::uint32_t version);
+
+    /// Read a header written by writeCacheHeader.
+    /// @throw std::runtime_error if the magic number, the version or the byte order do not match
+    void readCacheHeader (std::istream& stream, const char magic[4], boost::uint32_t version);
+
+    /// 64-bit FNV-1a hash, to detect changes of the data a cache was built from.
+    boost::uint64_t hashFnv1a (const std::string& data);
+}
+
+#endif
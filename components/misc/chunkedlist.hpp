@@ -0,0 +1,215 @@
+#ifndef OPENMW_COMPONENTS_MISC_CHUNKEDLIST_H
+#define OPENMW_COMPONENTS_MISC_CHUNKEDLIST_H
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace Misc
+{
+
+    /// @brief A sequence that allocates its elements in chunks of growing size rather than one at a time.
+    /// @par Adding elements never moves the existing ones, so pointers, references and iterators to elements stay
+    /// valid until the list is cleared or destroyed. Elements are stored contiguously within a chunk, so iterating
+    /// does not chase a pointer per element. Elements can not be removed individually.
+    /// @par The chunks and the chunk table are allocated with \a Allocator.
+    template <typename T, typename Allocator = std::allocator<T> >
+    class ChunkedList
+    {
+    public:
+        template <typename Value, typename List>
+        class Iterator : public std::iterator<std::bidirectional_iterator_tag, Value>
+        {
+        public:
+            Iterator()
+                : mList(NULL), mChunk(0), mOffset(0)
+            {
+            }
+
+            Iterator(List* list, std::size_t chunk, std::size_t offset)
+                : mList(list), mChunk(chunk), mOffset(offset)
+            {
+            }
+
+            /// Allow conversion from iterator to const_iterator.
+            Iterator(const Iterator<T, ChunkedList>& other)
+                : mList(other.mList), mChunk(other.mChunk), mOffset(other.mOffset)
+            {
+            }
+
+            Value& operator*() const
+            {
+                return mList->mChunks[mChunk][mOffset];
+            }
+
+            Value* operator->() const
+            {
+                return &mList->mChunks[mChunk][mOffset];
+            }
+
+            Iterator& operator++()
+            {
+                if (++mOffset == getChunkSize(mChunk))
+                {
+                    ++mChunk;
+                    mOffset = 0;
+                }
+                return *this;
+            }
+
+            Iterator operator++(int)
+            {
+                Iterator iter = *this;
+                ++*this;
+                return iter;
+            }
+
+            Iterator& operator--()
+            {
+                if (mOffset == 0)
+                {
+                    --mChunk;
+                    mOffset = getChunkSize(mChunk);
+                }
+                --mOffset;
+                return *this;
+            }
+
+            Iterator operator--(int)
+            {
+                Iterator iter = *this;
+                --*this;
+                return iter;
+            }
+
+            bool operator==(const Iterator& other) const
+            {
+                return mChunk == other.mChunk && mOffset == other.mOffset;
+            }
+
+            bool operator!=(const Iterator& other) const
+            {
+                return !(*this == other);
+            }
+
+        private:
+            friend class Iterator<const T, const ChunkedList>;
+
+            List* mList;
+            std::size_t mChunk;
+            std::size_t mOffset;
+        };
+
+        typedef T value_type;
+        typedef Iterator<T, ChunkedList> iterator;
+        typedef Iterator<const T, const ChunkedList> const_iterator;
+
+        ChunkedList()
+            : mSize(0), mEndChunk(0), mEndOffset(0)
+        {
+        }
+
+        ChunkedList(const ChunkedList& other)
+            : mSize(0), mEndChunk(0), mEndOffset(0)
+        {
+            for (const_iterator it = other.begin(); it != other.end(); ++it)
+                push_back(*it);
+        }
+
+        ~ChunkedList()
+        {
+            clear();
+        }
+
+        ChunkedList& operator=(const ChunkedList& other)
+        {
+            if (this != &other)
+            {
+                clear();
+                for (const_iterator it = other.begin(); it != other.end(); ++it)
+                    push_back(*it);
+            }
+            return *this;
+        }
+
+        void push_back(const T& value)
+        {
+            if (mEndChunk == mChunks.size())
+            {
+                T* chunk = mAllocator.allocate(getChunkSize(mEndChunk));
+                try
+                {
+                    mChunks.push_back(chunk);
+                }
+                catch (...)
+                {
+                    mAllocator.deallocate(chunk, getChunkSize(mEndChunk));
+                    throw;
+                }
+            }
+
+            new (mChunks[mEndChunk] + mEndOffset) T(value);
+
+            ++mSize;
+            if (++mEndOffset == getChunkSize(mEndChunk))
+            {
+                ++mEndChunk;
+                mEndOffset = 0;
+            }
+        }
+
+        /// Destroy all elements and release their memory.
+        void clear()
+        {
+            for (iterator it = begin(); it != end(); ++it)
+                it->~T();
+
+            for (std::size_t i=0; i<mChunks.size(); ++i)
+                mAllocator.deallocate(mChunks[i], getChunkSize(i));
+
+            mChunks.clear();
+            mSize = 0;
+            mEndChunk = 0;
+            mEndOffset = 0;
+        }
+
+        iterator begin() { return iterator(this, 0, 0); }
+        iterator end() { return iterator(this, mEndChunk, mEndOffset); }
+        const_iterator begin() const { return const_iterator(this, 0, 0); }
+        const_iterator end() const { return const_iterator(this, mEndChunk, mEndOffset); }
+
+        T& front() { return *begin(); }
+        const T& front() const { return *begin(); }
+        T& back() { return *--end(); }
+        const T& back() const { return *--end(); }
+
+        std::size_t size() const { return mSize; }
+        bool empty() const { return mSize == 0; }
+
+        /// The number of memory allocations made for the elements currently in the list.
+        std::size_t getNumChunks() const { return mChunks.size(); }
+
+    private:
+        /// Each chunk is twice the size of the previous one, so a list of N elements needs O(log N) allocations
+        /// and wastes at most half of its memory.
+        static const std::size_t sFirstChunkSize = 4;
+
+        static std::size_t getChunkSize(std::size_t chunk)
+        {
+            return sFirstChunkSize << chunk;
+        }
+
+        Allocator mAllocator;
+        std::vector<T*, typename Allocator::template rebind<T*>::other> mChunks;
+        std::size_t mSize;
+
+        /// The chunk and offset of the position after the last element.
+        std::size_t mEndChunk;
+        std::size_t mEndOffset;
+    };
+
+}
+
+#endif
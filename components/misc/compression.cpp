@@ -0,0 +1,47 @@
+#include "compression.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+#include <zlib.h>
+
+namespace
+{
+    /// Deflate can not compress by more than about 1032:1, see http://www.zlib.net/zlib_tech.html
+    const boost::uint64_t sMaxCompressionRatio = 1032;
+}
+
+namespace Misc
+{
+    void compress(const std::string& data, std::string& compressed, int level)
+    {
+        size_t offset = compressed.size();
+
+        uLongf compressedSize = compressBound(data.size());
+        compressed.resize(offset + compressedSize);
+
+        int result = compress2(reinterpret_cast<Bytef*>(&compressed[offset]), &compressedSize,
+                               reinterpret_cast<const Bytef*>(data.data()), data.size(), level);
+        if (result != Z_OK)
+            throw std::runtime_error("zlib compression failed");
+
+        compressed.resize(offset + compressedSize);
+    }
+
+    void decompress(const char* data, size_t dataSize, std::string& decompressed, boost::uint64_t size)
+    {
+        if (size > (static_cast<boost::uint64_t>(dataSize) + 1) * sMaxCompressionRatio
+                || size > std::numeric_limits<size_t>::max() || size > std::numeric_limits<uLongf>::max())
+            throw std::runtime_error("zlib decompression failed, invalid uncompressed size");
+
+        decompressed.resize(static_cast<size_t>(size));
+        if (size == 0)
+            return;
+
+        uLongf decompressedSize = static_cast<uLongf>(size);
+        int result = uncompress(reinterpret_cast<Bytef*>(&decompressed[0]), &decompressedSize,
+                                reinterpret_cast<const Bytef*>(data), dataSize);
+        if (result != Z_OK || decompressedSize != size)
+            throw std::runtime_error("zlib decompression failed, data is corrupt");
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef OPENMW_COMPONENTS_MISC_COMPRESSION_H
+#define OPENMW_COMPONENTS_MISC_COMPRESSION_H
+
+#include <string>
+
+#include <boost/cstdint.hpp>
+
+namespace Misc
+{
+    /// Compress \a data with zlib and append the result to \a compressed.
+    /// @param level zlib compression level, 1 (fastest) to 9 (smallest)
+    /// @throw std::runtime_error
+    void compress(const std::string& data, std::string& compressed, int level = 6);
+
+    /// Decompress zlib-compressed \a data of which the uncompressed size is known to be \a size.
+    /// @note \a size is checked against the highest ratio zlib can compress by before allocating, since it
+    /// usually comes from a file.
+    /// @throw std::runtime_error if the data is corrupt or does not match \a size
+    void decompress(const char* data, size_t dataSize, std::string& decompressed, boost::uint64_t size);
+}
+
+#endif
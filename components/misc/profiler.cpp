@@ -0,0 +1,136 @@
+#include "profiler.hpp"
+
+#include <iomanip>
+
+#include <OpenThreads/ScopedLock>
+
+#if defined(_MSC_VER)
+#define OPENMW_PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define OPENMW_PROFILER_THREAD_LOCAL __thread
+#endif
+
+namespace
+{
+    // Upper bound on the recorded zones of each thread, to cap memory usage when the profiler is left running (~100 MB)
+    const size_t sMaxZones = 4*1024*1024;
+
+    // Buffer of the current thread, created on its first zone. Identifies threads that were not created
+    // through OpenThreads as well.
+    OPENMW_PROFILER_THREAD_LOCAL void* sThreadBuffer = NULL;
+
+    void writeEscaped(std::ostream& stream, const char* str)
+    {
+        for (; *str; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+                stream << '\\';
+            stream << *str;
+        }
+    }
+}
+
+namespace Misc
+{
+
+    OpenThreads::Atomic Profiler::sEnabled;
+
+    Profiler::Profiler()
+        : mStartTick(osg::Timer::instance()->tick())
+    {
+    }
+
+    Profiler& Profiler::get()
+    {
+        static Profiler instance;
+        return instance;
+    }
+
+    void Profiler::start()
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+            for (std::vector<ThreadBuffer*>::iterator it = mBuffers.begin(); it != mBuffers.end(); ++it)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> bufferLock((*it)->mMutex);
+                (*it)->mZones.clear();
+            }
+            mStartTick = osg::Timer::instance()->tick();
+        }
+        sEnabled.exchange(1);
+    }
+
+    void Profiler::stop()
+    {
+        sEnabled.exchange(0);
+    }
+
+    Profiler::ThreadBuffer* Profiler::getThreadBuffer()
+    {
+        if (sThreadBuffer)
+            return static_cast<ThreadBuffer*>(sThreadBuffer);
+
+        // Buffers are kept until exit, threads of the engine live that long anyway
+        ThreadBuffer* buffer = new ThreadBuffer;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        buffer->mThread = static_cast<int>(mBuffers.size());
+        mBuffers.push_back(buffer);
+        sThreadBuffer = buffer;
+        return buffer;
+    }
+
+    void Profiler::addZone(const char *name, osg::Timer_t begin, osg::Timer_t end)
+    {
+        ThreadBuffer* buffer = getThreadBuffer();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(buffer->mMutex);
+        if (!sEnabled || buffer->mZones.size() >= sMaxZones)
+            return;
+
+        Zone zone;
+        zone.mName = name;
+        zone.mBegin = begin;
+        zone.mEnd = end;
+        buffer->mZones.push_back(zone);
+    }
+
+    size_t Profiler::getNumZones() const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+        size_t numZones = 0;
+        for (std::vector<ThreadBuffer*>::const_iterator it = mBuffers.begin(); it != mBuffers.end(); ++it)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> bufferLock((*it)->mMutex);
+            numZones += (*it)->mZones.size();
+        }
+        return numZones;
+    }
+
+    void Profiler::writeChromeTrace(std::ostream &stream) const
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mMutex);
+
+        const osg::Timer* timer = osg::Timer::instance();
+
+        stream << std::fixed << std::setprecision(3);
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (std::vector<ThreadBuffer*>::const_iterator buffer = mBuffers.begin(); buffer != mBuffers.end(); ++buffer)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> bufferLock((*buffer)->mMutex);
+            for (std::vector<Zone>::const_iterator it = (*buffer)->mZones.begin(); it != (*buffer)->mZones.end(); ++it)
+            {
+                if (!first)
+                    stream << ",";
+                first = false;
+                stream << "\n{\"name\":\"";
+                writeEscaped(stream, it->mName);
+                stream << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << (*buffer)->mThread
+                       << ",\"ts\":" << timer->delta_u(mStartTick, it->mBegin)
+                       << ",\"dur\":" << timer->delta_u(it->mBegin, it->mEnd) << "}";
+            }
+        }
+        stream << "\n]}" << std::endl;
+    }
+
+}
@@ -0,0 +1,105 @@
+#ifndef OPENMW_COMPONENTS_MISC_PROFILER_H
+#define OPENMW_COMPONENTS_MISC_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include <osg/Timer>
+
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Mutex>
+
+namespace Misc
+{
+
+    /// @brief Records timed, nested zones of CPU work from any thread and exports them as a Chrome trace.
+    /// @note Zones are only recorded while the profiler is enabled. When disabled, a ProfileZone costs a single
+    /// branch on a static flag. Each thread records into its own buffer, so threads do not wait for each other.
+    class Profiler
+    {
+    public:
+        static Profiler& get();
+
+        static bool isEnabled() { return sEnabled != 0; }
+
+        /// Start recording. Previously recorded zones are discarded.
+        void start();
+
+        /// Stop recording, keeping the recorded zones around for export.
+        void stop();
+
+        /// Record a finished zone in the buffer of the calling thread. Called by ProfileZone, thread safe.
+        /// @param name Must point to a string with static storage duration.
+        void addZone(const char* name, osg::Timer_t begin, osg::Timer_t end);
+
+        /// Write the recorded zones of all threads in the Chrome trace event format, which can be loaded by
+        /// chrome://tracing or Perfetto. Nesting is reconstructed by the viewer from the zone times.
+        void writeChromeTrace(std::ostream& stream) const;
+
+        size_t getNumZones() const;
+
+    private:
+        Profiler();
+
+        struct Zone
+        {
+            const char* mName;
+            osg::Timer_t mBegin;
+            osg::Timer_t mEnd;
+        };
+
+        /// The zones of one thread. The mutex is only contended while the zones are cleared or exported.
+        struct ThreadBuffer
+        {
+            mutable OpenThreads::Mutex mMutex;
+            std::vector<Zone> mZones;
+            int mThread;
+        };
+
+        ThreadBuffer* getThreadBuffer();
+
+        static OpenThreads::Atomic sEnabled;
+
+        // guards mBuffers, which only grows when a thread records its first zone
+        mutable OpenThreads::Mutex mMutex;
+        std::vector<ThreadBuffer*> mBuffers;
+        osg::Timer_t mStartTick;
+    };
+
+    /// @brief Times the enclosing scope as a zone of the Profiler.
+    class ProfileZone
+    {
+    public:
+        /// @param name Must point to a string with static storage duration, e.g. a literal.
+        explicit ProfileZone(const char* name)
+            : mName(name)
+            , mActive(Profiler::isEnabled())
+            , mBegin(mActive ? osg::Timer::instance()->tick() : 0)
+        {
+        }
+
+        ~ProfileZone()
+        {
+            if (mActive)
+                Profiler::get().addZone(mName, mBegin, osg::Timer::instance()->tick());
+        }
+
+    private:
+        const char* mName;
+        bool mActive;
+        osg::Timer_t mBegin;
+
+        ProfileZone(const ProfileZone&);
+        ProfileZone& operator=(const ProfileZone&);
+    };
+
+}
+
+#define OPENMW_PROFILE_CONCAT_IMPL(a, b) a##b
+#define OPENMW_PROFILE_CONCAT(a, b) OPENMW_PROFILE_CONCAT_IMPL(a, b)
+
+/// Time the enclosing scope as a profiler zone with the given (literal) name.
+#define OPENMW_PROFILE_ZONE(name) Misc::ProfileZone OPENMW_PROFILE_CONCAT(profileZone, __LINE__)(name)
+
+#endif
@@ -7,7 +7,12 @@ namespace Misc
 
     void Rng::init()
     {
-        std::srand(static_cast<unsigned int>(std::time(NULL)));
+        init(static_cast<unsigned int>(std::time(NULL)));
+    }
+
+    void Rng::init(unsigned int seed)
+    {
+        std::srand(seed);
     }
 
     float Rng::rollProbability()
@@ -0,0 +1,126 @@
+#include "stringid.hpp"
+
+#include <set>
+
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+
+#include "stringops.hpp"
+
+namespace
+{
+
+    struct CiLess
+    {
+        bool operator()(const std::string& left, const std::string& right) const
+        {
+            return Misc::StringUtils::ciLess(left, right);
+        }
+    };
+
+    typedef std::set<std::string, CiLess> StringTable;
+
+    /// The table is split into shards with their own mutex, so that threads loading cells at the same time rarely
+    /// wait for each other.
+    const std::size_t sNumShards = 64;
+
+    struct Shard
+    {
+        StringTable mTable;
+        OpenThreads::Mutex mMutex;
+    };
+
+    // Constructed on first use, so StringIds can be created during static initialization.
+    Shard* getShards()
+    {
+        static Shard shards[sNumShards];
+        return shards;
+    }
+
+    Shard& getShard(const std::string& id)
+    {
+        // FNV-1a of the lower case string, so that equal IDs end up in the same shard
+        std::size_t hash = 2166136261u;
+        for (std::string::const_iterator it = id.begin(); it != id.end(); ++it)
+        {
+            hash ^= static_cast<unsigned char>(Misc::StringUtils::toLower(*it));
+            hash *= 16777619u;
+        }
+        return getShards()[hash % sNumShards];
+    }
+
+    const std::string& getEmpty()
+    {
+        static const std::string empty;
+        return empty;
+    }
+
+    // Function-local statics are not initialized thread safely in C++98, so make sure that they are constructed during
+    // static initialization, before any other thread is started.
+    const bool sInitialized = (getShards(), getEmpty(), true);
+
+}
+
+namespace Misc
+{
+
+    StringId::StringId()
+        : mString(NULL)
+    {
+    }
+
+    StringId::StringId(const std::string& id)
+        : mString(NULL)
+    {
+        if (id.empty())
+            return;
+
+        Shard& shard = getShard(id);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mMutex);
+
+        StringTable::iterator found = shard.mTable.find(id);
+        if (found == shard.mTable.end())
+            found = shard.mTable.insert(StringUtils::lowerCase(id)).first;
+
+        // elements of a std::set are never moved, so the address stays valid
+        mString = &*found;
+    }
+
+    StringId StringId::find(const std::string& id)
+    {
+        StringId result;
+        if (id.empty())
+            return result;
+
+        Shard& shard = getShard(id);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mMutex);
+
+        StringTable::const_iterator found = shard.mTable.find(id);
+        if (found != shard.mTable.end())
+            result.mString = &*found;
+        return result;
+    }
+
+    const std::string& StringId::getString() const
+    {
+        return mString ? *mString : getEmpty();
+    }
+
+    bool StringId::equals(const std::string& other) const
+    {
+        return StringUtils::ciEqual(getString(), other);
+    }
+
+    std::size_t StringId::getNumStrings()
+    {
+        std::size_t count = 0;
+        for (std::size_t i=0; i<sNumShards; ++i)
+        {
+            Shard& shard = getShards()[i];
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard.mMutex);
+            count += shard.mTable.size();
+        }
+        return count;
+    }
+
+}
@@ -0,0 +1,70 @@
+#ifndef OPENMW_COMPONENTS_MISC_STRINGID_H
+#define OPENMW_COMPONENTS_MISC_STRINGID_H
+
+#include <cstddef>
+#include <string>
+
+namespace Misc
+{
+
+    /// @brief A case-insensitive string that is interned in a global table, so that comparing and hashing are O(1).
+    /// @par All StringIds that are equal share one lower case copy of the string, which is never freed. Meant for
+    /// record IDs, which come from a limited set and are compared much more often than they are created. Arbitrary
+    /// strings, e.g. from scripts or the console, should be looked up with find() so that they do not grow the table.
+    class StringId
+    {
+    public:
+        /// The empty string, does not touch the table.
+        StringId();
+
+        /// Look up \a id in the table, case-insensitively, and add it if it is not in the table yet.
+        /// @note Thread safe.
+        explicit StringId(const std::string& id);
+
+        /// Look up \a id in the table without adding it, for IDs that come from queries rather than records.
+        /// @return an empty StringId if \a id is not in the table, so no record ID can be equal to it
+        /// @note Thread safe.
+        static StringId find(const std::string& id);
+
+        /// @return the lower case string
+        const std::string& getString() const;
+
+        bool empty() const
+        {
+            return mString == NULL;
+        }
+
+        bool operator==(const StringId& other) const
+        {
+            return mString == other.mString;
+        }
+
+        bool operator!=(const StringId& other) const
+        {
+            return mString != other.mString;
+        }
+
+        /// Orders by the address in the table, not alphabetically.
+        bool operator<(const StringId& other) const
+        {
+            return mString < other.mString;
+        }
+
+        /// Compare with a string that is not interned, case-insensitively.
+        bool equals(const std::string& other) const;
+
+        std::size_t getHash() const
+        {
+            return reinterpret_cast<std::size_t>(mString);
+        }
+
+        /// @return the number of strings in the table
+        static std::size_t getNumStrings();
+
+    private:
+        const std::string* mString;
+    };
+
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include "myguirendermanager.hpp"
 
 #include <stdexcept>
+#include <algorithm>
 
 #include <MyGUI_Gui.h>
 #include <MyGUI_Timer.h>
@@ -106,6 +107,12 @@ public:
     {
         osg::State *state = renderInfo.getState();
 
+        mReadFrom = (mReadFrom+1)%sNumBuffers;
+        const std::vector<Batch>& vec = mBatchVector[mReadFrom];
+        const std::vector<MyGUI::Vertex>& vertices = mVertexArray[mReadFrom];
+        if (vec.empty() || vertices.empty())
+            return;
+
         state->pushStateSet(mStateSet);
         state->apply();
 
@@ -115,12 +122,16 @@ public:
         glEnableClientState(GL_TEXTURE_COORD_ARRAY);
         glEnableClientState(GL_COLOR_ARRAY);
 
-        mReadFrom = (mReadFrom+1)%sNumBuffers;
-        const std::vector<Batch>& vec = mBatchVector[mReadFrom];
+        // All batches of this frame share one vertex array, so the pointers only need to be set up once.
+        // VBOs disabled due to crash in OSG: http://forum.openscenegraph.org/viewtopic.php?t=14909
+        const char* data = reinterpret_cast<const char*>(&vertices[0]);
+        glVertexPointer(3, GL_FLOAT, sizeof(MyGUI::Vertex), data);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(MyGUI::Vertex), data + 12);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(MyGUI::Vertex), data + 16);
+
         for (std::vector<Batch>::const_iterator it = vec.begin(); it != vec.end(); ++it)
         {
             const Batch& batch = *it;
-            osg::VertexBufferObject *vbo = batch.mVertexBuffer;
 
             if (batch.mStateSet)
             {
@@ -132,24 +143,7 @@ public:
             if(texture)
                 state->applyTextureAttribute(0, texture);
 
-            // VBOs disabled due to crash in OSG: http://forum.openscenegraph.org/viewtopic.php?t=14909
-            osg::GLBufferObject* bufferobject = 0;//state->isVertexBufferObjectSupported() ? vbo->getOrCreateGLBufferObject(state->getContextID()) : 0;
-            if (0)//bufferobject)
-            {
-                state->bindVertexBufferObject(bufferobject);
-
-                glVertexPointer(3, GL_FLOAT, sizeof(MyGUI::Vertex), (char*)NULL);
-                glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(MyGUI::Vertex), (char*)NULL + 12);
-                glTexCoordPointer(2, GL_FLOAT, sizeof(MyGUI::Vertex), (char*)NULL + 16);
-            }
-            else
-            {
-                glVertexPointer(3, GL_FLOAT, sizeof(MyGUI::Vertex), (char*)vbo->getArray(0)->getDataPointer());
-                glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(MyGUI::Vertex), (char*)vbo->getArray(0)->getDataPointer() + 12);
-                glTexCoordPointer(2, GL_FLOAT, sizeof(MyGUI::Vertex), (char*)vbo->getArray(0)->getDataPointer() + 16);
-            }
-
-            glDrawArrays(GL_TRIANGLES, 0, batch.mVertexCount);
+            glDrawArrays(GL_TRIANGLES, static_cast<GLint>(batch.mFirstVertex), static_cast<GLsizei>(batch.mVertexCount));
 
             if (batch.mStateSet)
             {
@@ -196,6 +190,9 @@ public:
         flipMat.preMultTranslate(osg::Vec3f(0,1,0));
         flipMat.preMultScale(osg::Vec3f(1,-1,1));
         mStateSet->setTextureAttribute(0, new osg::TexMat(flipMat), osg::StateAttribute::ON);
+
+        for (int i=0; i<sNumBuffers; ++i)
+            mNumDrawRequests[i] = 0;
     }
     Drawable(const Drawable &copy, const osg::CopyOp &copyop=osg::CopyOp::SHALLOW_COPY)
         : osg::Drawable(copy, copyop)
@@ -204,6 +201,8 @@ public:
         , mWriteTo(0)
         , mReadFrom(0)
     {
+        for (int i=0; i<sNumBuffers; ++i)
+            mNumDrawRequests[i] = 0;
     }
 
     // Defines the necessary information for a draw call
@@ -212,27 +211,58 @@ public:
         // May be empty
         osg::ref_ptr<osg::Texture2D> mTexture;
 
-        osg::ref_ptr<osg::VertexBufferObject> mVertexBuffer;
-        // need to hold on to this too as the mVertexBuffer does not hold a ref to its own array
-        osg::ref_ptr<osg::UByteArray> mArray;
-
         // optional
         osg::ref_ptr<osg::StateSet> mStateSet;
 
+        // Range in the frame's shared vertex array
+        size_t mFirstVertex;
         size_t mVertexCount;
     };
 
-    void addBatch(const Batch& batch)
+    /// Append the vertices of a MyGUI render request to this frame's shared vertex array.
+    /// Consecutive requests using the same texture and state are merged into a single draw call;
+    /// merging is limited to neighbours so the drawing order (and thus blending) is unchanged.
+    void addBatch(const MyGUI::Vertex* vertices, size_t count, osg::Texture2D* texture, osg::StateSet* stateSet)
     {
-        mBatchVector[mWriteTo].push_back(batch);
+        ++mNumDrawRequests[mWriteTo];
+        if (!count)
+            return;
+
+        std::vector<MyGUI::Vertex>& vertexArray = mVertexArray[mWriteTo];
+        std::vector<Batch>& batches = mBatchVector[mWriteTo];
+
+        size_t first = vertexArray.size();
+        vertexArray.insert(vertexArray.end(), vertices, vertices + count);
+
+        if (!batches.empty() && batches.back().mTexture == texture && batches.back().mStateSet == stateSet)
+        {
+            batches.back().mVertexCount += count;
+            return;
+        }
+
+        Batch batch;
+        batch.mTexture = texture;
+        batch.mStateSet = stateSet;
+        batch.mFirstVertex = first;
+        batch.mVertexCount = count;
+        batches.push_back(batch);
     }
 
     void clear()
     {
         mWriteTo = (mWriteTo+1)%sNumBuffers;
         mBatchVector[mWriteTo].clear();
+        // keeps its capacity, so the vertex storage is only reallocated when the GUI grows
+        mVertexArray[mWriteTo].clear();
+        mNumDrawRequests[mWriteTo] = 0;
     }
 
+    /// Number of doRender() requests MyGUI issued in the frame currently being collected.
+    unsigned int getNumDrawRequests() const { return mNumDrawRequests[mWriteTo]; }
+
+    /// Number of draw calls the requests of the frame currently being collected were merged into.
+    unsigned int getNumDrawCalls() const { return mBatchVector[mWriteTo].size(); }
+
     META_Object(osgMyGUI, Drawable)
 
 private:
@@ -242,28 +272,27 @@ private:
     // double buffering approach, to avoid the need for synchronization with the draw thread
     std::vector<Batch> mBatchVector[sNumBuffers];
 
+    // streaming vertex storage shared by all batches of a frame, ring-buffered along with mBatchVector
+    std::vector<MyGUI::Vertex> mVertexArray[sNumBuffers];
+
+    unsigned int mNumDrawRequests[sNumBuffers];
+
     int mWriteTo;
     mutable int mReadFrom;
 };
 
 class OSGVertexBuffer : public MyGUI::IVertexBuffer
 {
-    osg::ref_ptr<osg::VertexBufferObject> mBuffer;
-    osg::ref_ptr<osg::UByteArray> mVertexArray;
+    // Client-side staging storage. The vertices are copied into the Drawable's per-frame
+    // array on doRender(), so this can be freely modified while a previous frame is drawing.
+    std::vector<MyGUI::Vertex> mVertices;
 
     size_t mNeedVertexCount;
 
-    bool mQueuedForDrawing;
-
-    void destroy();
-    void create();
-
 public:
     OSGVertexBuffer();
     virtual ~OSGVertexBuffer();
 
-    void markAsQueuedForDrawing();
-
     virtual void setVertexCount(size_t count);
     virtual size_t getVertexCount();
 
@@ -272,31 +301,20 @@ public:
 
 /*internal:*/
 
-    osg::VertexBufferObject *getBuffer() const { return mBuffer.get(); }
-    osg::UByteArray *getArray() const { return mVertexArray.get(); }
+    const MyGUI::Vertex *getVertices() const { return mVertices.empty() ? NULL : &mVertices[0]; }
 };
 
 OSGVertexBuffer::OSGVertexBuffer()
   : mNeedVertexCount(0)
-  , mQueuedForDrawing(false)
 {
 }
 
 OSGVertexBuffer::~OSGVertexBuffer()
 {
-    destroy();
-}
-
-void OSGVertexBuffer::markAsQueuedForDrawing()
-{
-    mQueuedForDrawing = true;
 }
 
 void OSGVertexBuffer::setVertexCount(size_t count)
 {
-    if(count == mNeedVertexCount)
-        return;
-
     mNeedVertexCount = count;
 }
 
@@ -307,48 +325,14 @@ size_t OSGVertexBuffer::getVertexCount()
 
 MyGUI::Vertex *OSGVertexBuffer::lock()
 {
-    if (mQueuedForDrawing || !mVertexArray)
-    {
-        // Force recreating the buffer, to make sure we are not modifying a buffer currently
-        // queued for rendering in the last frame's draw thread.
-        // a more efficient solution might be double buffering
-        destroy();
-        create();
-        mQueuedForDrawing = false;
-    }
-    else
-    {
-        mVertexArray->resize(mNeedVertexCount * sizeof(MyGUI::Vertex));
-    }
-
-    MYGUI_PLATFORM_ASSERT(mBuffer.valid(), "Vertex buffer is not created");
+    // only grows the capacity, shrinking the vertex count does not reallocate
+    mVertices.resize(mNeedVertexCount);
 
-    return (MyGUI::Vertex*)&(*mVertexArray)[0];
+    return mVertices.empty() ? NULL : &mVertices[0];
 }
 
 void OSGVertexBuffer::unlock()
 {
-    mVertexArray->dirty();
-    mBuffer->dirty();
-}
-
-void OSGVertexBuffer::destroy()
-{
-    mBuffer = nullptr;
-    mVertexArray = nullptr;
-}
-
-void OSGVertexBuffer::create()
-{
-    MYGUI_PLATFORM_ASSERT(!mBuffer.valid(), "Vertex buffer already exist");
-
-    mVertexArray = new osg::UByteArray(mNeedVertexCount*sizeof(MyGUI::Vertex));
-
-    mBuffer = new osg::VertexBufferObject;
-    mBuffer->setDataVariance(osg::Object::DYNAMIC);
-    mBuffer->setUsage(GL_DYNAMIC_DRAW);
-    // NB mBuffer does not own the array
-    mBuffer->setArray(0, mVertexArray.get());
 }
 
 // ---------------------------------------------------------------------------
@@ -361,6 +345,8 @@ RenderManager::RenderManager(osgViewer::Viewer *viewer, osg::Group *sceneroot, R
   , mIsInitialise(false)
   , mInvScalingFactor(1.f)
   , mInjectState(NULL)
+  , mNumDrawRequests(0)
+  , mNumDrawCalls(0)
 {
     if (scalingFactor != 0.f)
         mInvScalingFactor = 1.f / scalingFactor;
@@ -441,21 +427,18 @@ void RenderManager::begin()
 
 void RenderManager::doRender(MyGUI::IVertexBuffer *buffer, MyGUI::ITexture *texture, size_t count)
 {
-    Drawable::Batch batch;
-    batch.mVertexCount = count;
-    batch.mVertexBuffer = static_cast<OSGVertexBuffer*>(buffer)->getBuffer();
-    static_cast<OSGVertexBuffer*>(buffer)->markAsQueuedForDrawing();
-    batch.mArray = static_cast<OSGVertexBuffer*>(buffer)->getArray();
+    OSGVertexBuffer* vertexBuffer = static_cast<OSGVertexBuffer*>(buffer);
+    count = std::min(count, vertexBuffer->getVertexCount());
+
+    osg::Texture2D* osgTexture = NULL;
     if (texture)
     {
-        batch.mTexture = static_cast<OSGTexture*>(texture)->getTexture();
-        if (batch.mTexture->getDataVariance() == osg::Object::DYNAMIC)
+        osgTexture = static_cast<OSGTexture*>(texture)->getTexture();
+        if (osgTexture->getDataVariance() == osg::Object::DYNAMIC)
             mDrawable->setDataVariance(osg::Object::DYNAMIC); // only for this frame, reset in begin()
     }
-    if (mInjectState)
-        batch.mStateSet = mInjectState;
 
-    mDrawable->addBatch(batch);
+    mDrawable->addBatch(vertexBuffer->getVertices(), count, osgTexture, mInjectState);
 }
 
 void RenderManager::setInjectState(osg::StateSet* stateSet)
@@ -486,6 +469,17 @@ void RenderManager::collectDrawCalls()
     end();
 
     mUpdate = false;
+
+    mNumDrawRequests = mDrawable->getNumDrawRequests();
+    mNumDrawCalls = mDrawable->getNumDrawCalls();
+
+    if (mViewer.valid() && mViewer->getFrameStamp())
+    {
+        unsigned int frameNumber = mViewer->getFrameStamp()->getFrameNumber();
+        osg::Stats* stats = mViewer->getViewerStats();
+        stats->setAttribute(frameNumber, "gui_draw_requests", mNumDrawRequests);
+        stats->setAttribute(frameNumber, "gui_draw_calls", mNumDrawCalls);
+    }
 }
 
 void RenderManager::setViewSize(int width, int height)
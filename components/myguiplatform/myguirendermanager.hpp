@@ -51,6 +51,9 @@ class RenderManager : public MyGUI::RenderManager, public MyGUI::IRenderTarget
 
     osg::StateSet* mInjectState;
 
+    unsigned int mNumDrawRequests;
+    unsigned int mNumDrawCalls;
+
     void destroyAllResources();
 
 public:
@@ -106,6 +109,11 @@ public:
 
     bool checkTexture(MyGUI::ITexture* _texture);
 
+    /// Number of render requests issued by MyGUI during the last collected frame.
+    unsigned int getNumDrawRequests() const { return mNumDrawRequests; }
+    /// Number of draw calls the last collected frame's requests were batched into.
+    unsigned int getNumDrawCalls() const { return mNumDrawCalls; }
+
 /*internal:*/
 
     void collectDrawCalls();
@@ -0,0 +1,528 @@
+#include "tile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <osg/Math>
+
+#include <components/misc/profiler.hpp>
+
+namespace
+{
+    // Direction offsets of Node::mLinks, orthogonal ones first
+    const int sDirX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+    const int sDirY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+    int getDirection(int dx, int dy)
+    {
+        for (int i=0; i<8; ++i)
+            if (sDirX[i] == dx && sDirY[i] == dy)
+                return i;
+        return -1;
+    }
+
+    const int sMaxPolygon = 12;
+
+    // Split a convex polygon at the plane where the coordinate \a axis equals \a value. \a below receives the part
+    // on the lower side and \a above the rest.
+    void dividePolygon(const osg::Vec3f* in, int numIn, osg::Vec3f* below, int& numBelow, osg::Vec3f* above, int& numAbove,
+                       float value, int axis)
+    {
+        float d[sMaxPolygon];
+        for (int i=0; i<numIn; ++i)
+            d[i] = value - in[i][axis];
+
+        numBelow = 0;
+        numAbove = 0;
+        for (int i=0, j=numIn-1; i<numIn; j=i, ++i)
+        {
+            bool inA = d[j] >= 0;
+            bool inB = d[i] >= 0;
+            if (inA != inB)
+            {
+                float s = d[j] / (d[j] - d[i]);
+                osg::Vec3f intersection = in[j] + (in[i] - in[j]) * s;
+                below[numBelow++] = intersection;
+                above[numAbove++] = intersection;
+                if (d[i] > 0)
+                    below[numBelow++] = in[i];
+                else if (d[i] < 0)
+                    above[numAbove++] = in[i];
+            }
+            else
+            {
+                if (d[i] >= 0)
+                {
+                    below[numBelow++] = in[i];
+                    if (d[i] != 0)
+                        continue;
+                }
+                above[numAbove++] = in[i];
+            }
+        }
+    }
+}
+
+namespace NavMesh
+{
+
+    Settings::Settings()
+        : mCellSize(32.f)
+        , mCellHeight(8.f)
+        , mAgentHeight(128.f)
+        , mAgentRadius(29.f)
+        , mMaxClimb(34.f)
+        , mMaxSlope(49.f)
+    {
+    }
+
+    void Geometry::addTriangle(const osg::Vec3f &a, const osg::Vec3f &b, const osg::Vec3f &c)
+    {
+        mVertices.push_back(a);
+        mVertices.push_back(b);
+        mVertices.push_back(c);
+        mBounds.expandBy(a);
+        mBounds.expandBy(b);
+        mBounds.expandBy(c);
+    }
+
+    Tile::Tile(const osg::BoundingBox &bounds, const Settings &settings)
+        : mBounds(bounds)
+        , mSettings(settings)
+        , mWidth(std::max(1, static_cast<int>(std::ceil((bounds.xMax() - bounds.xMin()) / settings.mCellSize))))
+        , mHeight(std::max(1, static_cast<int>(std::ceil((bounds.yMax() - bounds.yMin()) / settings.mCellSize))))
+        , mClimbCells(static_cast<int>(std::floor(settings.mMaxClimb / settings.mCellHeight)))
+        , mAgentHeightCells(static_cast<int>(std::ceil(settings.mAgentHeight / settings.mCellHeight)))
+    {
+    }
+
+    void Tile::build(const Geometry &geometry)
+    {
+        OPENMW_PROFILE_ZONE("NavMesh::Tile::build");
+
+        mColumns.clear();
+        mNodes.clear();
+        mFirstNode.assign(mWidth * mHeight + 1, 0);
+        if (!geometry.getNumTriangles())
+            return;
+
+        mBounds.zMin() = geometry.getBounds().zMin();
+        mBounds.zMax() = geometry.getBounds().zMax();
+
+        mColumns.resize(mWidth * mHeight);
+
+        float minWalkableNormalZ = std::cos(osg::DegreesToRadians(mSettings.mMaxSlope));
+        const std::vector<osg::Vec3f>& vertices = geometry.getVertices();
+        for (std::size_t i=0; i+2<vertices.size(); i+=3)
+        {
+            osg::Vec3f normal = (vertices[i+1] - vertices[i]) ^ (vertices[i+2] - vertices[i]);
+            if (normal.normalize() == 0.f)
+                continue; // degenerate
+            rasterizeTriangle(vertices[i], vertices[i+1], vertices[i+2], std::abs(normal.z()) >= minWalkableNormalZ);
+        }
+
+        buildNodes();
+        linkNodes();
+        erodeNodes();
+
+        // the spans are not needed to find paths
+        std::vector<std::vector<Span> >().swap(mColumns);
+    }
+
+    // Clips the triangle to each row and column of the grid it overlaps, like Recast's rasterizer does, so that
+    // steep triangles add the full height range they cover in a column.
+    void Tile::rasterizeTriangle(const osg::Vec3f &a, const osg::Vec3f &b, const osg::Vec3f &c, bool walkable)
+    {
+        osg::BoundingBox triangleBounds;
+        triangleBounds.expandBy(a);
+        triangleBounds.expandBy(b);
+        triangleBounds.expandBy(c);
+        if (triangleBounds.xMax() < mBounds.xMin() || triangleBounds.xMin() > mBounds.xMax()
+                || triangleBounds.yMax() < mBounds.yMin() || triangleBounds.yMin() > mBounds.yMax())
+            return;
+
+        const float cellSize = mSettings.mCellSize;
+        int y0 = static_cast<int>(std::floor((triangleBounds.yMin() - mBounds.yMin()) / cellSize));
+        int y1 = std::min(mHeight - 1, static_cast<int>(std::floor((triangleBounds.yMax() - mBounds.yMin()) / cellSize)));
+
+        osg::Vec3f buffer[4][sMaxPolygon];
+        osg::Vec3f* remaining = buffer[0];
+        osg::Vec3f* nextRemaining = buffer[1];
+        osg::Vec3f* row = buffer[2];
+        int numRemaining = 3;
+        remaining[0] = a;
+        remaining[1] = b;
+        remaining[2] = c;
+
+        for (int y=y0; y<=y1; ++y)
+        {
+            int numRow = 0;
+            int numNextRemaining = 0;
+            dividePolygon(remaining, numRemaining, row, numRow, nextRemaining, numNextRemaining,
+                          mBounds.yMin() + (y+1) * cellSize, 1);
+            std::swap(remaining, nextRemaining);
+            numRemaining = numNextRemaining;
+
+            if (numRow < 3 || y < 0)
+                continue;
+
+            float minX = row[0].x();
+            float maxX = row[0].x();
+            for (int i=1; i<numRow; ++i)
+            {
+                minX = std::min(minX, row[i].x());
+                maxX = std::max(maxX, row[i].x());
+            }
+            int x0 = static_cast<int>(std::floor((minX - mBounds.xMin()) / cellSize));
+            int x1 = std::min(mWidth - 1, static_cast<int>(std::floor((maxX - mBounds.xMin()) / cellSize)));
+
+            osg::Vec3f* rowRemaining = buffer[3];
+            osg::Vec3f* cell = nextRemaining;
+            int numRowRemaining = numRow;
+            std::copy(row, row + numRow, rowRemaining);
+            for (int x=x0; x<=x1; ++x)
+            {
+                int numCell = 0;
+                int numRest = 0;
+                dividePolygon(rowRemaining, numRowRemaining, cell, numCell, row, numRest,
+                              mBounds.xMin() + (x+1) * cellSize, 0);
+                std::copy(row, row + numRest, rowRemaining);
+                numRowRemaining = numRest;
+
+                if (numCell < 3 || x < 0)
+                    continue;
+
+                float minZ = cell[0].z();
+                float maxZ = cell[0].z();
+                for (int i=1; i<numCell; ++i)
+                {
+                    minZ = std::min(minZ, cell[i].z());
+                    maxZ = std::max(maxZ, cell[i].z());
+                }
+
+                addSpan(x, y, static_cast<int>(std::floor((minZ - mBounds.zMin()) / mSettings.mCellHeight)),
+                        static_cast<int>(std::ceil((maxZ - mBounds.zMin()) / mSettings.mCellHeight)), walkable);
+            }
+        }
+    }
+
+    void Tile::addSpan(int x, int y, int min, int max, bool walkable)
+    {
+        std::vector<Span>& spans = mColumns[x + y * mWidth];
+
+        // merge with the overlapping spans, keeping them sorted from the bottom up
+        std::vector<Span>::iterator it = spans.begin();
+        while (it != spans.end() && it->mMin <= max)
+        {
+            if (it->mMax < min)
+            {
+                ++it;
+                continue;
+            }
+
+            // the top surface decides whether the merged span is walkable
+            if (std::abs(it->mMax - max) <= mClimbCells)
+                walkable = walkable || it->mWalkable;
+            else if (it->mMax > max)
+                walkable = it->mWalkable;
+
+            min = std::min(min, it->mMin);
+            max = std::max(max, it->mMax);
+            it = spans.erase(it);
+        }
+
+        Span span;
+        span.mMin = min;
+        span.mMax = max;
+        span.mWalkable = walkable;
+        spans.insert(it, span);
+    }
+
+    void Tile::buildNodes()
+    {
+        for (int column=0; column<mWidth * mHeight; ++column)
+        {
+            mFirstNode[column] = static_cast<int>(mNodes.size());
+
+            const std::vector<Span>& spans = mColumns[column];
+            for (std::size_t i=0; i<spans.size(); ++i)
+            {
+                if (!spans[i].mWalkable)
+                    continue;
+
+                int ceiling = i+1 < spans.size() ? spans[i+1].mMin : std::numeric_limits<int>::max() / 2;
+                if (ceiling - spans[i].mMax < mAgentHeightCells)
+                    continue;
+
+                Node node;
+                node.mX = column % mWidth;
+                node.mY = column / mWidth;
+                node.mFloor = spans[i].mMax;
+                node.mCeiling = ceiling;
+                node.mBlocked = false;
+                std::fill(node.mLinks, node.mLinks + 8, -1);
+                mNodes.push_back(node);
+            }
+        }
+        mFirstNode[mWidth * mHeight] = static_cast<int>(mNodes.size());
+    }
+
+    void Tile::linkNodes()
+    {
+        for (std::size_t i=0; i<mNodes.size(); ++i)
+        {
+            Node& node = mNodes[i];
+            for (int dir=0; dir<4; ++dir)
+            {
+                int x = node.mX + sDirX[dir];
+                int y = node.mY + sDirY[dir];
+                if (x < 0 || y < 0 || x >= mWidth || y >= mHeight)
+                    continue;
+
+                // step to the node at the nearest height, if the agent fits through the gap
+                int column = x + y * mWidth;
+                int best = -1;
+                int bestClimb = mClimbCells + 1;
+                for (int n=mFirstNode[column]; n<mFirstNode[column+1]; ++n)
+                {
+                    const Node& other = mNodes[n];
+                    int climb = std::abs(other.mFloor - node.mFloor);
+                    int gap = std::min(node.mCeiling, other.mCeiling) - std::max(node.mFloor, other.mFloor);
+                    if (climb < bestClimb && gap >= mAgentHeightCells)
+                    {
+                        best = n;
+                        bestClimb = climb;
+                    }
+                }
+                node.mLinks[dir] = best;
+            }
+        }
+
+        // diagonal steps must be possible both ways around the corner
+        for (std::size_t i=0; i<mNodes.size(); ++i)
+        {
+            Node& node = mNodes[i];
+            for (int dir=4; dir<8; ++dir)
+            {
+                int viaX = node.mLinks[getDirection(sDirX[dir], 0)];
+                int viaY = node.mLinks[getDirection(0, sDirY[dir])];
+                if (viaX == -1 || viaY == -1)
+                    continue;
+                int throughX = mNodes[viaX].mLinks[getDirection(0, sDirY[dir])];
+                int throughY = mNodes[viaY].mLinks[getDirection(sDirX[dir], 0)];
+                if (throughX != -1 && throughX == throughY)
+                    node.mLinks[dir] = throughX;
+            }
+        }
+    }
+
+    void Tile::erodeNodes()
+    {
+        int radius = static_cast<int>(std::ceil(mSettings.mAgentRadius / mSettings.mCellSize));
+        if (radius <= 0)
+            return;
+
+        // distance in steps from the nearest node next to a wall or ledge
+        std::vector<int> distance (mNodes.size(), -1);
+        std::queue<int> open;
+        for (std::size_t i=0; i<mNodes.size(); ++i)
+        {
+            for (int dir=0; dir<4; ++dir)
+            {
+                if (mNodes[i].mLinks[dir] == -1)
+                {
+                    distance[i] = 0;
+                    open.push(static_cast<int>(i));
+                    break;
+                }
+            }
+        }
+
+        while (!open.empty())
+        {
+            int current = open.front();
+            open.pop();
+            if (distance[current] + 1 >= radius)
+                continue;
+            for (int dir=0; dir<4; ++dir)
+            {
+                int next = mNodes[current].mLinks[dir];
+                if (next != -1 && distance[next] == -1)
+                {
+                    distance[next] = distance[current] + 1;
+                    open.push(next);
+                }
+            }
+        }
+
+        for (std::size_t i=0; i<mNodes.size(); ++i)
+            mNodes[i].mBlocked = distance[i] != -1;
+    }
+
+    bool Tile::contains(const osg::Vec3f &point) const
+    {
+        return point.x() >= mBounds.xMin() && point.x() < mBounds.xMax()
+                && point.y() >= mBounds.yMin() && point.y() < mBounds.yMax();
+    }
+
+    std::size_t Tile::getNumWalkableNodes() const
+    {
+        std::size_t count = 0;
+        for (std::size_t i=0; i<mNodes.size(); ++i)
+            if (!mNodes[i].mBlocked)
+                ++count;
+        return count;
+    }
+
+    osg::Vec3f Tile::getNodePosition(int node) const
+    {
+        const Node& n = mNodes[node];
+        return osg::Vec3f(mBounds.xMin() + (n.mX + 0.5f) * mSettings.mCellSize,
+                          mBounds.yMin() + (n.mY + 0.5f) * mSettings.mCellSize,
+                          mBounds.zMin() + n.mFloor * mSettings.mCellHeight);
+    }
+
+    int Tile::findNode(const osg::Vec3f &point) const
+    {
+        if (mNodes.empty() || !contains(point))
+            return -1;
+
+        int x = static_cast<int>(std::floor((point.x() - mBounds.xMin()) / mSettings.mCellSize));
+        int y = static_cast<int>(std::floor((point.y() - mBounds.yMin()) / mSettings.mCellSize));
+
+        // the actor may stand closer to a wall than the nodes that are left, so look around
+        int maxRadius = static_cast<int>(std::ceil(mSettings.mAgentRadius / mSettings.mCellSize)) + 2;
+        int best = -1;
+        float bestDistance = 0.f;
+        for (int radius=0; radius<=maxRadius && best == -1; ++radius)
+        {
+            for (int cy=y-radius; cy<=y+radius; ++cy)
+            {
+                for (int cx=x-radius; cx<=x+radius; ++cx)
+                {
+                    if (std::max(std::abs(cx - x), std::abs(cy - y)) != radius)
+                        continue; // only the ring, the inside was searched already
+                    if (cx < 0 || cy < 0 || cx >= mWidth || cy >= mHeight)
+                        continue;
+
+                    int column = cx + cy * mWidth;
+                    for (int n=mFirstNode[column]; n<mFirstNode[column+1]; ++n)
+                    {
+                        if (mNodes[n].mBlocked)
+                            continue;
+                        osg::Vec3f position = getNodePosition(n);
+                        float dz = position.z() - point.z();
+                        if (dz > mSettings.mMaxClimb + mSettings.mCellHeight || -dz > mSettings.mAgentHeight)
+                            continue;
+                        float sqrDistance = (position - point).length2();
+                        if (best == -1 || sqrDistance < bestDistance)
+                        {
+                            best = n;
+                            bestDistance = sqrDistance;
+                        }
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    bool Tile::isWalkableLine(int from, int to) const
+    {
+        osg::Vec3f start = getNodePosition(from);
+        osg::Vec3f delta = getNodePosition(to) - start;
+        delta.z() = 0.f;
+        int steps = static_cast<int>(std::ceil(delta.length() / (mSettings.mCellSize * 0.5f)));
+
+        int current = from;
+        for (int i=1; i<=steps; ++i)
+        {
+            osg::Vec3f sample = start + delta * (static_cast<float>(i) / steps);
+            int x = static_cast<int>(std::floor((sample.x() - mBounds.xMin()) / mSettings.mCellSize));
+            int y = static_cast<int>(std::floor((sample.y() - mBounds.yMin()) / mSettings.mCellSize));
+            const Node& node = mNodes[current];
+            if (x == node.mX && y == node.mY)
+                continue;
+
+            int dir = getDirection(x - node.mX, y - node.mY);
+            if (dir == -1)
+                return false;
+            current = node.mLinks[dir];
+            if (current == -1 || mNodes[current].mBlocked)
+                return false;
+        }
+        return current == to;
+    }
+
+    bool Tile::findPath(const osg::Vec3f &start, const osg::Vec3f &end, std::vector<osg::Vec3f> &path) const
+    {
+        OPENMW_PROFILE_ZONE("NavMesh::Tile::findPath");
+
+        path.clear();
+
+        int startNode = findNode(start);
+        int endNode = findNode(end);
+        if (startNode == -1 || endNode == -1)
+            return false;
+
+        // A* over the node links
+        std::vector<float> cost (mNodes.size(), -1.f);
+        std::vector<int> parent (mNodes.size(), -1);
+        osg::Vec3f goal = getNodePosition(endNode);
+
+        typedef std::pair<float, int> Entry; // estimated total cost, node index
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+        cost[startNode] = 0.f;
+        open.push(Entry((goal - getNodePosition(startNode)).length(), startNode));
+        while (!open.empty())
+        {
+            int current = open.top().second;
+            open.pop();
+            if (current == endNode)
+                break;
+
+            osg::Vec3f position = getNodePosition(current);
+            for (int dir=0; dir<8; ++dir)
+            {
+                int next = mNodes[current].mLinks[dir];
+                if (next == -1 || mNodes[next].mBlocked)
+                    continue;
+
+                osg::Vec3f nextPosition = getNodePosition(next);
+                float nextCost = cost[current] + (nextPosition - position).length();
+                if (cost[next] >= 0.f && nextCost >= cost[next])
+                    continue;
+                cost[next] = nextCost;
+                parent[next] = current;
+                open.push(Entry(nextCost + (goal - nextPosition).length(), next));
+            }
+        }
+
+        if (cost[endNode] < 0.f)
+            return false;
+
+        std::vector<int> nodes;
+        for (int node = endNode; node != -1; node = parent[node])
+            nodes.push_back(node);
+        std::reverse(nodes.begin(), nodes.end());
+
+        // keep only the nodes where a straight line no longer stays on the walkable surface
+        int anchor = 0;
+        for (int i=2; i<static_cast<int>(nodes.size()); ++i)
+        {
+            if (!isWalkableLine(nodes[anchor], nodes[i]))
+            {
+                anchor = i-1;
+                path.push_back(getNodePosition(nodes[anchor]));
+            }
+        }
+
+        path.push_back(osg::Vec3f(end.x(), end.y(), getNodePosition(endNode).z()));
+        return true;
+    }
+
+}
@@ -0,0 +1,120 @@
+#ifndef OPENMW_COMPONENTS_NAVMESH_TILE_H
+#define OPENMW_COMPONENTS_NAVMESH_TILE_H
+
+#include <vector>
+#include <cstddef>
+
+#include <osg/Referenced>
+#include <osg/BoundingBox>
+#include <osg/Vec3f>
+
+namespace NavMesh
+{
+
+    /// Dimensions of the walking actor and resolution of the tiles, in game units
+    struct Settings
+    {
+        Settings();
+
+        /// Horizontal size of a grid column
+        float mCellSize;
+        /// Vertical resolution of the rasterized geometry
+        float mCellHeight;
+
+        float mAgentHeight;
+        float mAgentRadius;
+        /// Highest step the agent can walk up
+        float mMaxClimb;
+        /// Steepest walkable slope, in degrees
+        float mMaxSlope;
+    };
+
+    /// Collision triangles in world space, collected on the main thread and handed to a Tile.
+    class Geometry
+    {
+    public:
+        void addTriangle(const osg::Vec3f& a, const osg::Vec3f& b, const osg::Vec3f& c);
+
+        /// Three vertices per triangle
+        const std::vector<osg::Vec3f>& getVertices() const { return mVertices; }
+
+        std::size_t getNumTriangles() const { return mVertices.size() / 3; }
+
+        const osg::BoundingBox& getBounds() const { return mBounds; }
+
+    private:
+        std::vector<osg::Vec3f> mVertices;
+        osg::BoundingBox mBounds;
+    };
+
+    /// @brief The walkable surfaces of an area, found by rasterizing collision geometry into a grid of columns.
+    /// @par Each column holds the solid spans of the geometry above it. The top of a walkable span with room for the
+    /// agent above is a node; nodes of neighbouring columns are linked when the agent can step between them, and
+    /// nodes closer than the agent radius to a wall or ledge are removed. Self-contained, so a tile can be built on a
+    /// worker thread and then queried from the main thread.
+    class Tile : public osg::Referenced
+    {
+    public:
+        /// @param bounds Area covered by the tile. Only the horizontal extent is used, the height is taken from the geometry.
+        Tile(const osg::BoundingBox& bounds, const Settings& settings);
+
+        /// Rasterize the geometry and find the walkable nodes. Call once.
+        void build(const Geometry& geometry);
+
+        /// @return true if the point is in the horizontal extent of the tile
+        bool contains(const osg::Vec3f& point) const;
+
+        /// Find a walkable path between two points on the tile, simplified to the corners where the direction changes.
+        /// @param path Receives the points to walk to, not including the start and ending at \a end.
+        /// @return false if either point is not on a walkable surface or there is no path
+        bool findPath(const osg::Vec3f& start, const osg::Vec3f& end, std::vector<osg::Vec3f>& path) const;
+
+        std::size_t getNumNodes() const { return mNodes.size(); }
+
+        std::size_t getNumWalkableNodes() const;
+
+    private:
+        struct Span
+        {
+            int mMin;
+            int mMax;
+            bool mWalkable;
+        };
+
+        struct Node
+        {
+            int mX;
+            int mY;
+            int mFloor;
+            int mCeiling;
+            bool mBlocked;
+            /// Index of the node reached in each direction, or -1
+            int mLinks[8];
+        };
+
+        void rasterizeTriangle(const osg::Vec3f& a, const osg::Vec3f& b, const osg::Vec3f& c, bool walkable);
+        void addSpan(int x, int y, int min, int max, bool walkable);
+        void buildNodes();
+        void linkNodes();
+        void erodeNodes();
+
+        int findNode(const osg::Vec3f& point) const;
+        bool isWalkableLine(int from, int to) const;
+        osg::Vec3f getNodePosition(int node) const;
+
+        osg::BoundingBox mBounds;
+        Settings mSettings;
+        int mWidth;
+        int mHeight;
+        int mClimbCells;
+        int mAgentHeightCells;
+
+        std::vector<std::vector<Span> > mColumns;
+        std::vector<Node> mNodes;
+        /// Nodes of column x + y * mWidth are mNodes[mFirstNode[column]] to mNodes[mFirstNode[column+1]-1]
+        std::vector<int> mFirstNode;
+    };
+
+}
+
+#endif
@@ -1,8 +1,10 @@
 #include "scenemanager.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <osg/Node>
 #include <osg/Geode>
+#include <osg/KdTree>
 #include <osg/UserDataContainer>
 
 #include <osgParticle/ParticleSystem>
@@ -17,6 +19,7 @@
 
 #include <components/nifosg/nifloader.hpp>
 #include <components/nif/niffile.hpp>
+#include <components/misc/profiler.hpp>
 
 #include <components/vfs/manager.hpp>
 
@@ -124,6 +127,31 @@ namespace Resource
         int mMaxAnisotropy;
     };
 
+    /// Build a KdTree for each static geometry, so that intersection tests with the model and all of its instances
+    /// do not need to test every triangle. Skinned and morphed geometry changes its vertices, so it is left alone.
+    class BuildKdTreeVisitor : public osg::NodeVisitor
+    {
+    public:
+        BuildKdTreeVisitor()
+            : osg::NodeVisitor(TRAVERSE_ALL_CHILDREN)
+        {
+        }
+
+        virtual void apply(osg::Drawable& drawable)
+        {
+            osg::Geometry* geometry = drawable.asGeometry();
+            if (!geometry || std::strcmp(geometry->className(), "Geometry") != 0 || geometry->getShape())
+                return;
+
+            osg::ref_ptr<osg::KdTree> kdTree (new osg::KdTree);
+            if (kdTree->build(mBuildOptions, geometry))
+                geometry->setShape(kdTree);
+        }
+
+    private:
+        osg::KdTree::BuildOptions mBuildOptions;
+    };
+
     /// Set texture filtering settings on textures contained in StateSets.
     class SetFilterSettingsVisitor : public osg::NodeVisitor
     {
@@ -297,6 +325,7 @@ namespace Resource
 
     osg::ref_ptr<const osg::Node> SceneManager::getTemplate(const std::string &name)
     {
+        OPENMW_PROFILE_ZONE("SceneManager::getTemplate");
         std::string normalized = name;
         mVFS->normalizeFilename(normalized);
 
@@ -343,6 +372,10 @@ namespace Resource
             osgDB::Registry::instance()->getOrCreateSharedStateManager()->share(loaded.get());
             mSharedStateMutex.unlock();
 
+            // instances share the geometry of the template, and with it the KdTrees
+            BuildKdTreeVisitor buildKdTreeVisitor;
+            loaded->accept(buildKdTreeVisitor);
+
             if (mIncrementalCompileOperation)
                 mIncrementalCompileOperation->add(loaded);
 
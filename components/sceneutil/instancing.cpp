@@ -0,0 +1,122 @@
+#include "instancing.hpp"
+
+#include <osg/Program>
+#include <osg/VertexAttribDivisor>
+
+namespace
+{
+
+    osg::Array* copyArray(const osg::Array* array)
+    {
+        if (!array)
+            return NULL;
+        return static_cast<osg::Array*>(array->clone(osg::CopyOp::DEEP_COPY_ARRAYS));
+    }
+
+}
+
+namespace SceneUtil
+{
+
+const unsigned int InstancedGeometry::sInstanceAttribute;
+
+InstancedGeometry::InstancedGeometry()
+{
+}
+
+InstancedGeometry::InstancedGeometry(const InstancedGeometry& copy, const osg::CopyOp& copyop)
+    : osg::Geometry(copy, copyop)
+    , mInstances(copy.mInstances)
+{
+}
+
+InstancedGeometry::InstancedGeometry(const osg::Geometry& source, const std::vector<osg::Matrixf>& instances)
+    : mInstances(instances)
+{
+    // Copy the arrays: the source is usually a model template that is in use by other threads, and enabling vertex
+    // buffer objects would attach them to the arrays.
+    setVertexArray(copyArray(source.getVertexArray()));
+    setNormalArray(copyArray(source.getNormalArray()));
+    setColorArray(copyArray(source.getColorArray()));
+    for (unsigned int i=0; i<source.getNumTexCoordArrays(); ++i)
+        setTexCoordArray(i, copyArray(source.getTexCoordArray(i)));
+
+    for (unsigned int i=0; i<source.getNumPrimitiveSets(); ++i)
+    {
+        osg::ref_ptr<osg::PrimitiveSet> primitives = static_cast<osg::PrimitiveSet*>(source.getPrimitiveSet(i)->clone(osg::CopyOp::SHALLOW_COPY));
+        primitives->setNumInstances(instances.size());
+        addPrimitiveSet(primitives);
+    }
+
+    // the transformations are passed as three rows, the last row is always (0,0,0,1)
+    osg::StateSet* stateset = getOrCreateStateSet();
+    for (unsigned int row=0; row<3; ++row)
+    {
+        osg::ref_ptr<osg::Vec4Array> array (new osg::Vec4Array);
+        array->reserve(instances.size());
+        for (std::vector<osg::Matrixf>::const_iterator it = instances.begin(); it != instances.end(); ++it)
+            array->push_back(osg::Vec4f((*it)(0,row), (*it)(1,row), (*it)(2,row), (*it)(3,row)));
+
+        setVertexAttribArray(sInstanceAttribute + row, array, osg::Array::BIND_PER_VERTEX);
+        stateset->setAttribute(new osg::VertexAttribDivisor(sInstanceAttribute + row, 1));
+    }
+
+    setUseDisplayList(false);
+    setUseVertexBufferObjects(true);
+    setDataVariance(osg::Object::STATIC);
+}
+
+const std::vector<osg::Matrixf>& InstancedGeometry::getInstances() const
+{
+    return mInstances;
+}
+
+osg::BoundingBox InstancedGeometry::computeBoundingBox() const
+{
+    osg::BoundingBox sourceBox;
+    const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(getVertexArray());
+    if (vertices)
+    {
+        for (osg::Vec3Array::const_iterator it = vertices->begin(); it != vertices->end(); ++it)
+            sourceBox.expandBy(*it);
+    }
+
+    osg::BoundingBox box;
+    if (!sourceBox.valid())
+        return box;
+
+    for (std::vector<osg::Matrixf>::const_iterator it = mInstances.begin(); it != mInstances.end(); ++it)
+    {
+        for (unsigned int i=0; i<8; ++i)
+            box.expandBy(sourceBox.corner(i) * (*it));
+    }
+    return box;
+}
+
+void InstancedGeometry::accept(osg::PrimitiveFunctor& functor) const
+{
+    const osg::Vec3Array* vertices = dynamic_cast<const osg::Vec3Array*>(getVertexArray());
+    if (!vertices || vertices->empty())
+        return;
+
+    std::vector<osg::Vec3> transformed (vertices->size());
+    for (std::vector<osg::Matrixf>::const_iterator it = mInstances.begin(); it != mInstances.end(); ++it)
+    {
+        for (unsigned int i=0; i<vertices->size(); ++i)
+            transformed[i] = (*vertices)[i] * (*it);
+
+        functor.setVertexArray(transformed.size(), &transformed[0]);
+
+        for (unsigned int i=0; i<getNumPrimitiveSets(); ++i)
+            getPrimitiveSet(i)->accept(functor);
+    }
+}
+
+void bindInstanceAttributes(osg::Program* program)
+{
+    program->addBindAttribLocation("instanceRow0", InstancedGeometry::sInstanceAttribute);
+    program->addBindAttribLocation("instanceRow1", InstancedGeometry::sInstanceAttribute + 1);
+    program->addBindAttribLocation("instanceRow2", InstancedGeometry::sInstanceAttribute + 2);
+}
+
+}
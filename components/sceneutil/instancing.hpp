@@ -0,0 +1,57 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_INSTANCING_H
+#define OPENMW_COMPONENTS_SCENEUTIL_INSTANCING_H
+
+#include <vector>
+
+#include <osg/Geometry>
+#include <osg/Matrixf>
+
+namespace osg
+{
+    class Program;
+}
+
+namespace SceneUtil
+{
+
+    /// @brief Draws a geometry once per instance with one draw call, using a different transformation for each instance.
+    /// @par The vertex arrays are copied from the source geometry once, not per instance. The instance transformations
+    /// are passed as per-instance vertex attributes, so a vertex shader that applies them must be active, see
+    /// bindInstanceAttributes. Needs OpenGL 3.3 or the ARB_draw_instanced and ARB_instanced_arrays extensions.
+    /// @par Instances are not culled individually: the bound covers all instances, so they are culled as one group.
+    class InstancedGeometry : public osg::Geometry
+    {
+    public:
+        /// The first of the three vertex attribute indices holding the rows of the instance transformations.
+        /// @note Chosen to not alias the built-in attributes of the first four texture units on drivers that alias them.
+        static const unsigned int sInstanceAttribute = 12;
+
+        InstancedGeometry();
+        InstancedGeometry(const InstancedGeometry& copy, const osg::CopyOp& copyop=osg::CopyOp::SHALLOW_COPY);
+
+        /// @param source the geometry to draw, it is only read, so it may be a template that is shared with other threads
+        /// @param instances the transformation of each instance
+        InstancedGeometry(const osg::Geometry& source, const std::vector<osg::Matrixf>& instances);
+
+        META_Object(SceneUtil, InstancedGeometry)
+
+        const std::vector<osg::Matrixf>& getInstances() const;
+
+        /// The bounding box of all instances, so the instances are culled as one group.
+        virtual osg::BoundingBox computeBoundingBox() const;
+
+        /// Report the primitives of every instance with its transformation applied, so that intersection tests
+        /// see the instances where they are drawn.
+        virtual void accept(osg::PrimitiveFunctor& functor) const;
+
+    private:
+        std::vector<osg::Matrixf> mInstances;
+    };
+
+    /// Bind the vec4 attributes instanceRow0, instanceRow1 and instanceRow2 of a vertex shader in \a program to the rows
+    /// of the instance transformation.
+    void bindInstanceAttributes(osg::Program* program);
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "lightgrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Upper bound on the number of cells along each axis
+    const int sMaxCellsPerAxis = 16;
+
+    osg::BoundingBox getBox(const osg::BoundingSphere& sphere)
+    {
+        osg::BoundingBox box;
+        box.expandBy(sphere);
+        return box;
+    }
+}
+
+namespace SceneUtil
+{
+
+    LightGrid::LightGrid()
+        : mNumLights(0)
+    {
+        for (int i=0; i<3; ++i)
+            mSize[i] = 0;
+    }
+
+    void LightGrid::build(const std::vector<osg::BoundingSphere> &lightBounds)
+    {
+        mNumLights = lightBounds.size();
+        mBounds.init();
+        mCellStart.clear();
+        mLightIndices.clear();
+
+        float radiusSum = 0.f;
+        unsigned int numValid = 0;
+        for (std::vector<osg::BoundingSphere>::const_iterator it = lightBounds.begin(); it != lightBounds.end(); ++it)
+        {
+            if (!it->valid())
+                continue;
+            mBounds.expandBy(*it);
+            radiusSum += it->radius();
+            ++numValid;
+        }
+
+        if (!numValid || !mBounds.valid())
+        {
+            for (int i=0; i<3; ++i)
+                mSize[i] = 0;
+            return;
+        }
+
+        // aim for cells about the size of an average light
+        float cellSize = std::max(1.f, 2.f * radiusSum / numValid);
+        for (int i=0; i<3; ++i)
+        {
+            float extent = std::max(mBounds._max[i] - mBounds._min[i], 1.f);
+            mSize[i] = std::min(sMaxCellsPerAxis, std::max(1, static_cast<int>(std::ceil(extent / cellSize))));
+            mInvCellSize[i] = mSize[i] / extent;
+        }
+
+        const unsigned int numCells = mSize[0] * mSize[1] * mSize[2];
+
+        // first pass: count the lights per cell, second pass: fill in the light indices
+        std::vector<unsigned int> counts(numCells, 0);
+        for (int pass=0; pass<2; ++pass)
+        {
+            for (unsigned int light=0; light<lightBounds.size(); ++light)
+            {
+                if (!lightBounds[light].valid())
+                    continue;
+
+                int min[3], max[3];
+                getCellRange(getBox(lightBounds[light]), min, max);
+                for (int z=min[2]; z<=max[2]; ++z)
+                    for (int y=min[1]; y<=max[1]; ++y)
+                        for (int x=min[0]; x<=max[0]; ++x)
+                        {
+                            unsigned int cell = (z * mSize[1] + y) * mSize[0] + x;
+                            if (pass == 0)
+                                ++counts[cell];
+                            else
+                                mLightIndices[mCellStart[cell] + counts[cell]++] = light;
+                        }
+            }
+
+            if (pass == 0)
+            {
+                mCellStart.resize(numCells+1);
+                mCellStart[0] = 0;
+                for (unsigned int cell=0; cell<numCells; ++cell)
+                {
+                    mCellStart[cell+1] = mCellStart[cell] + counts[cell];
+                    counts[cell] = 0;
+                }
+                mLightIndices.resize(mCellStart[numCells]);
+            }
+        }
+    }
+
+    bool LightGrid::getCellRange(const osg::BoundingBox &box, int min[], int max[]) const
+    {
+        for (int i=0; i<3; ++i)
+        {
+            if (box._max[i] < mBounds._min[i] || box._min[i] > mBounds._max[i])
+                return false;
+            min[i] = std::max(0, static_cast<int>((box._min[i] - mBounds._min[i]) * mInvCellSize[i]));
+            max[i] = std::min(mSize[i]-1, static_cast<int>((box._max[i] - mBounds._min[i]) * mInvCellSize[i]));
+        }
+        return true;
+    }
+
+    void LightGrid::query(const osg::BoundingSphere &bound, std::vector<unsigned int> &lights) const
+    {
+        if (!bound.valid() || mCellStart.empty())
+            return;
+
+        int min[3], max[3];
+        if (!getCellRange(getBox(bound), min, max))
+            return;
+
+        size_t first = lights.size();
+
+        unsigned int numCells = (max[0]-min[0]+1) * (max[1]-min[1]+1) * (max[2]-min[2]+1);
+        if (numCells >= mNumLights)
+        {
+            // visiting the cells would be more expensive than just returning every light
+            for (unsigned int light=0; light<mNumLights; ++light)
+                lights.push_back(light);
+            return;
+        }
+
+        for (int z=min[2]; z<=max[2]; ++z)
+            for (int y=min[1]; y<=max[1]; ++y)
+                for (int x=min[0]; x<=max[0]; ++x)
+                {
+                    unsigned int cell = (z * mSize[1] + y) * mSize[0] + x;
+                    lights.insert(lights.end(), mLightIndices.begin() + mCellStart[cell], mLightIndices.begin() + mCellStart[cell+1]);
+                }
+
+        // lights spanning several cells are found more than once
+        std::sort(lights.begin() + first, lights.end());
+        lights.erase(std::unique(lights.begin() + first, lights.end()), lights.end());
+    }
+
+}
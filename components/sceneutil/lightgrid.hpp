@@ -0,0 +1,47 @@
+#ifndef OPENMW_COMPONENTS_SCENEUTIL_LIGHTGRID_H
+#define OPENMW_COMPONENTS_SCENEUTIL_LIGHTGRID_H
+
+#include <vector>
+
+#include <osg/BoundingSphere>
+#include <osg/BoundingBox>
+
+namespace SceneUtil
+{
+
+    /// @brief Uniform grid over a set of light bounds, used to quickly find the lights that may affect an object.
+    /// @par Built once per camera and frame by the LightManager, so each LightListCallback only needs to look at
+    /// the lights in the few grid cells overlapped by its bound instead of testing every light in the scene.
+    class LightGrid
+    {
+    public:
+        LightGrid();
+
+        /// Rebuild the grid for the given light bounds. Indices returned by query() refer to this list.
+        void build(const std::vector<osg::BoundingSphere>& lightBounds);
+
+        /// Append the indices of lights whose grid cells overlap \a bound to \a lights, in ascending order.
+        /// @note This is a conservative test, the caller is expected to check the actual intersection.
+        void query(const osg::BoundingSphere& bound, std::vector<unsigned int>& lights) const;
+
+        unsigned int getNumLights() const { return mNumLights; }
+
+    private:
+        /// Get the range of cells overlapped by \a box, clamped to the grid.
+        /// @return false if the box lies completely outside of the grid.
+        bool getCellRange(const osg::BoundingBox& box, int min[3], int max[3]) const;
+
+        unsigned int mNumLights;
+
+        osg::BoundingBox mBounds;
+        osg::Vec3f mInvCellSize;
+        int mSize[3];
+
+        // per cell, the range [mCellStart[i], mCellStart[i+1]) in mLightIndices
+        std::vector<unsigned int> mCellStart;
+        std::vector<unsigned int> mLightIndices;
+    };
+
+}
+
+#endif
@@ -4,10 +4,12 @@
 
 #include <osg/NodeVisitor>
 #include <osg/Geode>
+#include <osg/Uniform>
 
 #include <osgUtil/CullVisitor>
 
 #include <components/sceneutil/util.hpp>
+#include <components/misc/profiler.hpp>
 
 #include <boost/functional/hash.hpp>
 
@@ -205,6 +207,9 @@ namespace SceneUtil
             stateset->setAttribute(attr, osg::StateAttribute::ON);
             stateset->setAssociatedModes(attr, osg::StateAttribute::ON);
 
+            // for shaders emulating fixed function lighting, which can not tell the lights that are enabled
+            stateset->addUniform(new osg::Uniform("lightCount", static_cast<int>(mStartLight + lights.size())));
+
             stateSetCache.insert(std::make_pair(hash, stateset));
             return stateset;
         }
@@ -215,14 +220,17 @@ namespace SceneUtil
         return mLights;
     }
 
-    const std::vector<LightManager::LightSourceViewBound>& LightManager::getLightsInViewSpace(osg::Camera *camera, const osg::RefMatrix* viewMatrix)
+    LightManager::LightsInViewSpace& LightManager::getOrCreateLightsInViewSpace(osg::Camera *camera, const osg::RefMatrix* viewMatrix)
     {
         osg::observer_ptr<osg::Camera> camPtr (camera);
-        std::map<osg::observer_ptr<osg::Camera>, LightSourceViewBoundCollection>::iterator it = mLightsInViewSpace.find(camPtr);
+        std::map<osg::observer_ptr<osg::Camera>, LightsInViewSpace>::iterator it = mLightsInViewSpace.find(camPtr);
 
         if (it == mLightsInViewSpace.end())
         {
-            it = mLightsInViewSpace.insert(std::make_pair(camPtr, LightSourceViewBoundCollection())).first;
+            it = mLightsInViewSpace.insert(std::make_pair(camPtr, LightsInViewSpace())).first;
+
+            std::vector<osg::BoundingSphere> viewBounds;
+            viewBounds.reserve(mLights.size());
 
             for (std::vector<LightSourceTransform>::iterator lightIt = mLights.begin(); lightIt != mLights.end(); ++lightIt)
             {
@@ -233,15 +241,41 @@ namespace SceneUtil
                 LightSourceViewBound l;
                 l.mLightSource = lightIt->mLightSource;
                 l.mViewBound = viewBound;
-                it->second.push_back(l);
+                it->second.mLights.push_back(l);
+                viewBounds.push_back(viewBound);
             }
+
+            it->second.mGrid.build(viewBounds);
         }
         return it->second;
     }
 
+    const std::vector<LightManager::LightSourceViewBound>& LightManager::getLightsInViewSpace(osg::Camera *camera, const osg::RefMatrix* viewMatrix)
+    {
+        return getOrCreateLightsInViewSpace(camera, viewMatrix).mLights;
+    }
+
+    void LightManager::getLightsIntersecting(osg::Camera *camera, const osg::RefMatrix *viewMatrix, const osg::BoundingSphere &viewBound, LightList &lightList)
+    {
+        const LightsInViewSpace& lightsInViewSpace = getOrCreateLightsInViewSpace(camera, viewMatrix);
+
+        mQueryResult.clear();
+        lightsInViewSpace.mGrid.query(viewBound, mQueryResult);
+
+        for (std::vector<unsigned int>::const_iterator it = mQueryResult.begin(); it != mQueryResult.end(); ++it)
+        {
+            const LightSourceViewBound& l = lightsInViewSpace.mLights[*it];
+            if (l.mViewBound.intersects(viewBound))
+                lightList.push_back(&l);
+        }
+    }
+
     void LightManager::setStartLight(int start)
     {
         mStartLight = start;
+
+        // only the lights before the start light are enabled for objects without a light list
+        getOrCreateStateSet()->addUniform(new osg::Uniform("lightCount", start));
     }
 
     int LightManager::getStartLight() const
@@ -276,6 +310,7 @@ namespace SceneUtil
 
     void LightListCallback::operator()(osg::Node *node, osg::NodeVisitor *nv)
     {
+        OPENMW_PROFILE_ZONE("LightListCallback");
         osgUtil::CullVisitor* cv = static_cast<osgUtil::CullVisitor*>(nv);
 
         if (!mLightManager)
@@ -296,7 +331,6 @@ namespace SceneUtil
 
         // Possible optimizations:
         // - cull list of lights by the camera frustum
-        // - organize lights in a quad tree
 
 
         // update light list if necessary
@@ -307,7 +341,6 @@ namespace SceneUtil
 
             // Don't use Camera::getViewMatrix, that one might be relative to another camera!
             const osg::RefMatrix* viewMatrix = cv->getCurrentRenderStage()->getInitialViewMatrix();
-            const std::vector<LightManager::LightSourceViewBound>& lights = mLightManager->getLightsInViewSpace(cv->getCurrentCamera(), viewMatrix);
 
             // get the node bounds in view space
             // NB do not node->getBound() * modelView, that would apply the node's transformation twice
@@ -322,12 +355,7 @@ namespace SceneUtil
             transformBoundingSphere(mat, nodeBound);
 
             mLightList.clear();
-            for (unsigned int i=0; i<lights.size(); ++i)
-            {
-                const LightManager::LightSourceViewBound& l = lights[i];
-                if (l.mViewBound.intersects(nodeBound))
-                    mLightList.push_back(&l);
-            }
+            mLightManager->getLightsIntersecting(cv->getCurrentCamera(), viewMatrix, nodeBound, mLightList);
         }
         if (mLightList.size())
         {
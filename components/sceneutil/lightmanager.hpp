@@ -7,6 +7,8 @@
 #include <osg/NodeVisitor>
 #include <osg/observer_ptr>
 
+#include "lightgrid.hpp"
+
 namespace SceneUtil
 {
 
@@ -92,6 +94,7 @@ namespace SceneUtil
         unsigned int getLightingMask() const;
 
         /// Set the first light index that should be used by this manager, typically the number of directional lights in the scene.
+        /// @note The "lightCount" uniform tells shaders the number of enabled lights, including the ones before the start light.
         void setStartLight(int start);
 
         int getStartLight() const;
@@ -120,6 +123,11 @@ namespace SceneUtil
 
         typedef std::vector<const LightSourceViewBound*> LightList;
 
+        /// Append the lights from getLightsInViewSpace() whose view bound intersects \a viewBound to \a lightList,
+        /// in the same order. Uses a light grid built once per camera and frame, so the cost does not grow with the
+        /// total number of lights in the scene.
+        void getLightsIntersecting(osg::Camera* camera, const osg::RefMatrix* viewMatrix, const osg::BoundingSphere& viewBound, LightList& lightList);
+
         osg::ref_ptr<osg::StateSet> getLightListStateSet(const LightList& lightList, unsigned int frameNum);
 
     private:
@@ -127,7 +135,19 @@ namespace SceneUtil
         std::vector<LightSourceTransform> mLights;
 
         typedef std::vector<LightSourceViewBound> LightSourceViewBoundCollection;
-        std::map<osg::observer_ptr<osg::Camera>, LightSourceViewBoundCollection> mLightsInViewSpace;
+
+        struct LightsInViewSpace
+        {
+            LightSourceViewBoundCollection mLights;
+            LightGrid mGrid;
+        };
+
+        std::map<osg::observer_ptr<osg::Camera>, LightsInViewSpace> mLightsInViewSpace;
+
+        LightsInViewSpace& getOrCreateLightsInViewSpace(osg::Camera* camera, const osg::RefMatrix* viewMatrix);
+
+        // scratch space for getLightsIntersecting, only used during the cull traversal
+        std::vector<unsigned int> mQueryResult;
 
         // < Light list hash , StateSet >
         typedef std::map<size_t, osg::ref_ptr<osg::StateSet> > LightStateSetMap;
@@ -6,6 +6,10 @@
 
 #include <osg/MatrixTransform>
 
+#include <OpenThreads/ScopedLock>
+
+#include <components/misc/profiler.hpp>
+
 #include "skeleton.hpp"
 #include "util.hpp"
 
@@ -51,6 +55,7 @@ public:
 
     virtual bool cull(osg::NodeVisitor* nv, osg::Drawable* drw, osg::State*) const
     {
+        OPENMW_PROFILE_ZONE("RigGeometry::update");
         RigGeometry* geom = static_cast<RigGeometry*>(drw);
         geom->update(nv);
         return false;
@@ -65,9 +70,13 @@ public:
     virtual osg::BoundingBox computeBound(const osg::Drawable&) const  { return osg::BoundingBox(); }
 };
 
+unsigned int RigGeometry::sNumSkinnedVertices = 0;
+OpenThreads::Mutex RigGeometry::sNumSkinnedVerticesMutex;
+
 RigGeometry::RigGeometry()
     : mSkeleton(NULL)
     , mLastFrameNumber(0)
+    , mLastSkeletonFrame(0)
     , mBoundsFirstFrame(true)
 {
     setCullCallback(new UpdateRigGeometry);
@@ -81,6 +90,7 @@ RigGeometry::RigGeometry(const RigGeometry &copy, const osg::CopyOp &copyop)
     , mSkeleton(NULL)
     , mInfluenceMap(copy.mInfluenceMap)
     , mLastFrameNumber(0)
+    , mLastSkeletonFrame(0)
     , mBoundsFirstFrame(true)
 {
     setSourceGeometry(copy.mSourceGeometry);
@@ -221,7 +231,15 @@ void RigGeometry::update(osg::NodeVisitor* nv)
 
     if (mLastFrameNumber == nv->getTraversalNumber())
         return;
+
+    // The skeleton's level of detail may have skipped animating the bones since we were last skinned, in which case
+    // our vertices are still up to date. Only possible after the first skinning, and only if the skeleton is traversed at all.
+    unsigned int skeletonFrame = mSkeleton->getLastUpdateFrame();
+    if (mLastFrameNumber != 0 && skeletonFrame != 0 && skeletonFrame == mLastSkeletonFrame)
+        return;
+
     mLastFrameNumber = nv->getTraversalNumber();
+    mLastSkeletonFrame = skeletonFrame;
 
     mSkeleton->updateBoneMatrices(nv);
 
@@ -259,6 +277,18 @@ void RigGeometry::update(osg::NodeVisitor* nv)
 
     positionDst->dirty();
     normalDst->dirty();
+
+    // skinning runs in the cull traversal, which may use several threads
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sNumSkinnedVerticesMutex);
+    sNumSkinnedVertices += positionDst->size();
+}
+
+unsigned int RigGeometry::resetNumSkinnedVertices()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sNumSkinnedVerticesMutex);
+    unsigned int count = sNumSkinnedVertices;
+    sNumSkinnedVertices = 0;
+    return count;
 }
 
 void RigGeometry::updateBounds(osg::NodeVisitor *nv)
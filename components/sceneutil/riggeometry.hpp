@@ -4,6 +4,8 @@
 #include <osg/Geometry>
 #include <osg/Matrixf>
 
+#include <OpenThreads/Mutex>
+
 namespace SceneUtil
 {
 
@@ -44,6 +46,9 @@ namespace SceneUtil
         // Called automatically by our UpdateCallback
         void updateBounds(osg::NodeVisitor* nv);
 
+        /// Return the number of vertices skinned by all RigGeometries since the last call, for statistics.
+        static unsigned int resetNumSkinnedVertices();
+
     private:
         osg::ref_ptr<osg::Geometry> mSourceGeometry;
         Skeleton* mSkeleton;
@@ -68,8 +73,13 @@ namespace SceneUtil
         BoneSphereMap mBoneSphereMap;
 
         unsigned int mLastFrameNumber;
+        // Frame in which the skeleton pose used for the last skinning was animated
+        unsigned int mLastSkeletonFrame;
         bool mBoundsFirstFrame;
 
+        static unsigned int sNumSkinnedVertices;
+        static OpenThreads::Mutex sNumSkinnedVerticesMutex;
+
         bool initFromParentSkeleton(osg::NodeVisitor* nv);
 
         void updateGeomToSkelMatrix(osg::NodeVisitor* nv);
@@ -6,10 +6,14 @@
 #include <components/misc/stringops.hpp>
 
 #include <iostream>
+#include <algorithm>
 
 namespace SceneUtil
 {
 
+float Skeleton::sLodDistance = 0.f;
+unsigned int Skeleton::sLodMaxInterval = 1;
+
 class InitBoneCacheVisitor : public osg::NodeVisitor
 {
 public:
@@ -38,6 +42,9 @@ Skeleton::Skeleton()
     , mNeedToUpdateBoneMatrices(true)
     , mActive(true)
     , mLastFrameNumber(0)
+    , mLastUpdateFrame(0)
+    , mLastCullFrame(0)
+    , mLastCullDistance(0.f)
 {
 
 }
@@ -48,6 +55,9 @@ Skeleton::Skeleton(const Skeleton &copy, const osg::CopyOp &copyop)
     , mNeedToUpdateBoneMatrices(true)
     , mActive(copy.mActive)
     , mLastFrameNumber(0)
+    , mLastUpdateFrame(0)
+    , mLastCullFrame(0)
+    , mLastCullDistance(0.f)
 {
 
 }
@@ -135,13 +145,49 @@ bool Skeleton::getActive() const
     return mActive;
 }
 
+void Skeleton::setUpdateLod(float distance, unsigned int maxInterval)
+{
+    sLodDistance = std::max(0.f, distance);
+    sLodMaxInterval = std::max(1u, maxInterval);
+}
+
+bool Skeleton::needsUpdate(unsigned int frameNumber) const
+{
+    if (sLodDistance <= 0.f || mLastUpdateFrame == 0)
+        return true;
+
+    unsigned int interval = 1;
+    // update traversal runs before the cull traversal, so a visible skeleton was culled in the previous frame
+    if (mLastCullFrame+1 < frameNumber)
+        interval = sLodMaxInterval;
+    else if (mLastCullDistance > sLodDistance)
+        interval = std::min(sLodMaxInterval, static_cast<unsigned int>(mLastCullDistance / sLodDistance) + 1);
+
+    return frameNumber >= mLastUpdateFrame + interval;
+}
+
 void Skeleton::traverse(osg::NodeVisitor& nv)
 {
-    if (!getActive() && nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR
-            // need to process at least 2 frames before shutting off update, since we need to have both frame-alternating RigGeometries initialized
-            // this would be more naturally handled if the double-buffering was implemented in RigGeometry itself rather than in a FrameSwitch decorator node
-            && mLastFrameNumber != 0 && mLastFrameNumber+2 <= nv.getTraversalNumber())
-        return;
+    if (nv.getVisitorType() == osg::NodeVisitor::UPDATE_VISITOR)
+    {
+        if (!getActive()
+                // need to process at least 2 frames before shutting off update, since we need to have both frame-alternating RigGeometries initialized
+                // this would be more naturally handled if the double-buffering was implemented in RigGeometry itself rather than in a FrameSwitch decorator node
+                && mLastFrameNumber != 0 && mLastFrameNumber+2 <= nv.getTraversalNumber())
+            return;
+
+        // only the skinning is throttled, the update callbacks below still run every frame
+        if (needsUpdate(nv.getTraversalNumber()))
+            mLastUpdateFrame = nv.getTraversalNumber();
+    }
+    else if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
+    {
+        // with several cameras (e.g. water reflections), the closest view decides
+        float distance = nv.getDistanceToViewPoint(getBound().center(), true);
+        if (mLastCullFrame != nv.getTraversalNumber() || distance < mLastCullDistance)
+            mLastCullDistance = distance;
+        mLastCullFrame = nv.getTraversalNumber();
+    }
     osg::Group::traverse(nv);
 }
 
@@ -53,6 +53,17 @@ namespace SceneUtil
 
         bool getActive() const;
 
+        /// Frame number of the last update traversal whose pose the level of detail allows skinning, 0 if never updated.
+        unsigned int getLastUpdateFrame() const { return mLastUpdateFrame; }
+
+        /// Configure the animation level of detail, shared by all skeletons.
+        /// Skeletons further away from the viewer than \a distance have their bone matrices updated and their rigs
+        /// skinned only every few frames, with the interval growing with distance up to \a maxInterval. Skeletons
+        /// that were not visible in the previous frame use \a maxInterval. A distance of 0 disables the level of detail.
+        /// @note This only affects the skinned meshes. The bone nodes and everything else under the skeleton are still
+        /// updated every frame, so attached parts and queries of bone positions see the current pose.
+        static void setUpdateLod(float distance, unsigned int maxInterval);
+
         void traverse(osg::NodeVisitor& nv);
 
     private:
@@ -69,6 +80,16 @@ namespace SceneUtil
         bool mActive;
 
         unsigned int mLastFrameNumber;
+
+        unsigned int mLastUpdateFrame;
+        unsigned int mLastCullFrame;
+        float mLastCullDistance;
+
+        /// Does the level of detail allow skinning the pose of the given frame?
+        bool needsUpdate(unsigned int frameNumber) const;
+
+        static float sLodDistance;
+        static unsigned int sLodMaxInterval;
     };
 
 }
@@ -0,0 +1,318 @@
+#include "compositemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+
+#include <boost/filesystem/fstream.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <components/misc/binarycache.hpp>
+#include <components/misc/compression.hpp>
+
+namespace
+{
+    const char sCacheMagic[4] = { 'O', 'M', 'W', 'C' };
+
+    /// Increase when the layout of the cache file or the blending changes.
+    const boost::uint32_t sCacheVersion = 2;
+
+    unsigned char toByte(float value)
+    {
+        return static_cast<unsigned char>(std::max(0.f, std::min(1.f, value)) * 255.f + 0.5f);
+    }
+
+    /// Get the largest mipmap level that is not minified when it repeats \a texelsPerTile times.
+    const osg::Image* selectLevel(const Terrain::LayerMipmaps& mipmaps, float texelsPerTile)
+    {
+        for (Terrain::LayerMipmaps::const_iterator it = mipmaps.begin(); it != mipmaps.end(); ++it)
+        {
+            if ((*it)->s() <= texelsPerTile && (*it)->t() <= texelsPerTile)
+                return *it;
+        }
+        return mipmaps.back();
+    }
+
+    /// Bilinear sample of an RGBA image with repeat wrapping, like the layer textures are set up.
+    osg::Vec4f sampleLayer(const osg::Image* image, float u, float v)
+    {
+        int width = image->s();
+        int height = image->t();
+
+        float x = u * width - 0.5f;
+        float y = v * height - 0.5f;
+        float fx = x - std::floor(x);
+        float fy = y - std::floor(y);
+
+        int x0 = static_cast<int>(std::floor(x)) % width;
+        int y0 = static_cast<int>(std::floor(y)) % height;
+        if (x0 < 0)
+            x0 += width;
+        if (y0 < 0)
+            y0 += height;
+        int x1 = (x0 + 1) % width;
+        int y1 = (y0 + 1) % height;
+
+        const unsigned char* data = image->data();
+        osg::Vec4f colour;
+        for (int c=0; c<4; ++c)
+        {
+            float top = data[(y0*width + x0)*4 + c] * (1-fx) + data[(y0*width + x1)*4 + c] * fx;
+            float bottom = data[(y1*width + x0)*4 + c] * (1-fx) + data[(y1*width + x1)*4 + c] * fx;
+            colour[c] = (top * (1-fy) + bottom * fy) / 255.f;
+        }
+        return colour;
+    }
+
+    /// Bilinear sample of a blendmap. The corners of the chunk map to the centers of the corner texels,
+    /// like the texture matrix in FixedFunctionTechnique does.
+    float sampleBlendmap(const osg::Image* blendmap, int channel, float u, float v)
+    {
+        int size = blendmap->s();
+        int channels = blendmap->getPixelFormat() == GL_RGBA ? 4 : 1;
+
+        float x = u * (size-1);
+        float y = v * (size-1);
+        int x0 = std::min(static_cast<int>(x), size-2);
+        int y0 = std::min(static_cast<int>(y), size-2);
+        float fx = x - x0;
+        float fy = y - y0;
+
+        const unsigned char* data = blendmap->data();
+        float top = data[(y0*size + x0)*channels + channel] * (1-fx) + data[(y0*size + x0+1)*channels + channel] * fx;
+        float bottom = data[((y0+1)*size + x0)*channels + channel] * (1-fx) + data[((y0+1)*size + x0+1)*channels + channel] * fx;
+        return (top * (1-fy) + bottom * fy) / 255.f;
+    }
+}
+
+namespace Terrain
+{
+
+void createLayerMipmaps(const osg::Image* image, int maxSize, LayerMipmaps& mipmaps)
+{
+    mipmaps.clear();
+
+    int width = std::max(1, std::min(image->s(), maxSize));
+    int height = std::max(1, std::min(image->t(), maxSize));
+
+    // decode the first level, averaging a few texels of the source for each texel
+    int samplesX = std::max(1, std::min(4, image->s() / width));
+    int samplesY = std::max(1, std::min(4, image->t() / height));
+
+    osg::ref_ptr<osg::Image> level (new osg::Image);
+    level->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+    unsigned char* data = level->data();
+    for (int t=0; t<height; ++t)
+    {
+        for (int s=0; s<width; ++s)
+        {
+            osg::Vec4f colour;
+            for (int j=0; j<samplesY; ++j)
+                for (int i=0; i<samplesX; ++i)
+                    colour += image->getColor(osg::Vec2f((s + (i + 0.5f) / samplesX) / width,
+                                                         (t + (j + 0.5f) / samplesY) / height));
+            colour /= static_cast<float>(samplesX * samplesY);
+
+            for (int c=0; c<4; ++c)
+                data[(t*width + s)*4 + c] = toByte(colour[c]);
+        }
+    }
+    mipmaps.push_back(level);
+
+    while (width > 1 || height > 1)
+    {
+        const osg::Image* previous = mipmaps.back();
+        const unsigned char* src = previous->data();
+        int srcWidth = width;
+
+        width = std::max(1, width/2);
+        height = std::max(1, height/2);
+        int stepX = srcWidth / width;
+        int stepY = previous->t() / height;
+
+        level = new osg::Image;
+        level->allocateImage(width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE);
+        data = level->data();
+        for (int t=0; t<height; ++t)
+        {
+            for (int s=0; s<width; ++s)
+            {
+                for (int c=0; c<4; ++c)
+                {
+                    int sum = 0;
+                    for (int j=0; j<stepY; ++j)
+                        for (int i=0; i<stepX; ++i)
+                            sum += src[((t*stepY + j)*srcWidth + s*stepX + i)*4 + c];
+                    data[(t*width + s)*4 + c] = static_cast<unsigned char>((sum + stepX*stepY/2) / (stepX*stepY));
+                }
+            }
+        }
+        mipmaps.push_back(level);
+    }
+}
+
+void blendLayers(const std::vector<LayerMipmaps>& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                 float layerTileSize, osg::Image* composite, int x, int y, int size)
+{
+    float texelsPerTile = size / layerTileSize;
+
+    std::vector<const osg::Image*> layerImages;
+    for (std::vector<LayerMipmaps>::const_iterator it = layers.begin(); it != layers.end(); ++it)
+        layerImages.push_back(selectLevel(*it, texelsPerTile));
+
+    // packed blendmaps hold the blend values of four layers each
+    bool packed = !blendmaps.empty() && blendmaps[0]->getPixelFormat() == GL_RGBA;
+    unsigned int layersPerBlendmap = packed ? 4 : 1;
+    unsigned int numLayers = std::min(layerImages.size(), blendmaps.size() * layersPerBlendmap + 1);
+
+    unsigned char* data = composite->data();
+    int rowStride = composite->s() * 3;
+
+    for (int row=0; row<size; ++row)
+    {
+        float v = (row + 0.5f) / size;
+        unsigned char* texel = data + (y + row) * rowStride + x * 3;
+        for (int col=0; col<size; ++col, texel += 3)
+        {
+            float u = (col + 0.5f) / size;
+
+            // The first pass draws the base layer, each further pass blends its layer on top, weighted by
+            // the blendmap and the alpha of the layer texture. Lighting and vertex colours are applied to the
+            // composite map as a whole, which is equivalent since they scale every pass the same way.
+            osg::Vec4f colour = sampleLayer(layerImages[0], u * layerTileSize, v * layerTileSize);
+            for (unsigned int i=1; i<numLayers; ++i)
+            {
+                osg::Vec4f layer = sampleLayer(layerImages[i], u * layerTileSize, v * layerTileSize);
+                float blend = sampleBlendmap(blendmaps[(i-1) / layersPerBlendmap], (i-1) % layersPerBlendmap, u, v);
+                float alpha = blend * layer.a();
+                colour = colour * (1.f - alpha) + layer * alpha;
+            }
+
+            texel[0] = toByte(colour.r());
+            texel[1] = toByte(colour.g());
+            texel[2] = toByte(colour.b());
+        }
+    }
+}
+
+osg::ref_ptr<osg::Image> readCompositeMap(const std::string& file, boost::uint64_t key)
+{
+    if (!boost::filesystem::exists(file))
+        return NULL;
+
+    try
+    {
+        boost::filesystem::ifstream stream (file, std::ios::binary);
+
+        Misc::readCacheHeader (stream, sCacheMagic, sCacheVersion);
+        boost::uint64_t key2 = 0;
+        Misc::readBinary (stream, key2);
+
+        // content files changed
+        if (key2!=key)
+            return NULL;
+
+        boost::int32_t width = 0, height = 0;
+        boost::uint32_t compressedSize = 0;
+        Misc::readBinary (stream, width);
+        Misc::readBinary (stream, height);
+        Misc::readBinary (stream, compressedSize);
+        if (!stream || width <= 0 || height <= 0 || width > 4096 || height > 4096 || compressedSize > (1 << 26))
+            throw std::runtime_error ("invalid size");
+
+        std::string compressed (compressedSize, '\0');
+        if (compressedSize)
+            stream.read (&compressed[0], compressedSize);
+        if (!stream)
+            throw std::runtime_error ("unexpected end of file");
+
+        std::string data;
+        Misc::decompress (compressed.data(), compressed.size(), data, static_cast<size_t>(width) * height * 3);
+
+        osg::ref_ptr<osg::Image> image (new osg::Image);
+        image->allocateImage(width, height, 1, GL_RGB, GL_UNSIGNED_BYTE);
+        std::copy(data.begin(), data.end(), image->data());
+
+        // mark the file as recently used for trimCompositeMapCache
+        boost::system::error_code ec;
+        boost::filesystem::last_write_time(file, std::time(NULL), ec);
+
+        return image;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to load composite map " << file << ": " << e.what() << std::endl;
+        return NULL;
+    }
+}
+
+void writeCompositeMap(const std::string& file, boost::uint64_t key, const osg::Image& image)
+{
+    try
+    {
+        std::string compressed;
+        Misc::compress (std::string(reinterpret_cast<const char*>(image.data()), image.getTotalSizeInBytes()), compressed, 1);
+
+        boost::filesystem::path directory = boost::filesystem::path(file).parent_path();
+        if (!directory.empty())
+            boost::filesystem::create_directories (directory);
+
+        boost::filesystem::ofstream stream (file, std::ios::binary);
+
+        Misc::writeCacheHeader (stream, sCacheMagic, sCacheVersion);
+        Misc::writeBinary (stream, key);
+        Misc::writeBinary (stream, static_cast<boost::int32_t>(image.s()));
+        Misc::writeBinary (stream, static_cast<boost::int32_t>(image.t()));
+        Misc::writeBinary (stream, static_cast<boost::uint32_t>(compressed.size()));
+        stream.write (compressed.data(), compressed.size());
+
+        if (!stream)
+            throw std::runtime_error ("write failed");
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to write composite map " << file << ": " << e.what() << std::endl;
+    }
+}
+
+void trimCompositeMapCache(const std::string& directory, boost::uint64_t maxSize)
+{
+    if (!boost::filesystem::is_directory(directory))
+        return;
+
+    try
+    {
+        // (modification time, size) of each file
+        std::vector<std::pair<std::pair<std::time_t, boost::uint64_t>, boost::filesystem::path> > files;
+        boost::uint64_t totalSize = 0;
+
+        for (boost::filesystem::directory_iterator it (directory); it != boost::filesystem::directory_iterator(); ++it)
+        {
+            const boost::filesystem::path& path = it->path();
+            std::string name = path.filename().string();
+            if (name.compare(0, 10, "composite_") != 0 || path.extension() != ".bin"
+                    || !boost::filesystem::is_regular_file(path))
+                continue;
+
+            boost::uint64_t size = boost::filesystem::file_size(path);
+            files.push_back(std::make_pair(std::make_pair(boost::filesystem::last_write_time(path), size), path));
+            totalSize += size;
+        }
+
+        std::sort(files.begin(), files.end());
+
+        for (std::size_t i=0; i<files.size() && totalSize > maxSize; ++i)
+        {
+            boost::filesystem::remove(files[i].second);
+            totalSize -= files[i].first.second;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to trim composite map cache " << directory << ": " << e.what() << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef COMPONENTS_TERRAIN_COMPOSITEMAP_H
+#define COMPONENTS_TERRAIN_COMPOSITEMAP_H
+
+#include <string>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <osg/ref_ptr>
+#include <osg/Image>
+
+namespace Terrain
+{
+
+    /// Mipmaps of a layer texture as uncompressed RGBA images, from the largest level down to 1x1.
+    typedef std::vector<osg::ref_ptr<osg::Image> > LayerMipmaps;
+
+    /// Create the mipmaps of a layer texture for use by blendLayers.
+    /// @param image the layer texture, may be compressed
+    /// @param maxSize the largest mipmap level is no larger than this
+    void createLayerMipmaps(const osg::Image* image, int maxSize, LayerMipmaps& mipmaps);
+
+    /// Blend the layers of a terrain chunk on the CPU, the same way the layer passes of Terrain::Effect do,
+    /// and write the result to a square area of \a composite.
+    /// @param layers the mipmaps of each layer texture, starting with the base layer
+    /// @param blendmaps the blendmaps of the layers after the base layer, as created by Storage::getBlendmaps, packed or not
+    /// @param layerTileSize the number of times the layer textures repeat across the area
+    /// @param composite a GL_RGB image to write to
+    /// @param x first column of the area to write to
+    /// @param y first row of the area to write to
+    /// @param size width and height of the area to write to
+    /// @note Thread safe.
+    void blendLayers(const std::vector<LayerMipmaps>& layers, const std::vector<osg::ref_ptr<osg::Image> >& blendmaps,
+                     float layerTileSize, osg::Image* composite, int x, int y, int size);
+
+    /// Read a composite map saved with writeCompositeMap.
+    /// @return NULL if the file does not exist, is damaged or was saved with a different \a key
+    osg::ref_ptr<osg::Image> readCompositeMap(const std::string& file, boost::uint64_t key);
+
+    /// Save a composite map to \a file. Errors are logged and otherwise ignored, since the file is only a cache.
+    void writeCompositeMap(const std::string& file, boost::uint64_t key, const osg::Image& image);
+
+    /// Delete the least recently used composite map files (composite_*.bin) in \a directory until the remaining ones
+    /// take up no more than \a maxSize bytes. readCompositeMap updates the modification time of the files it uses.
+    void trimCompositeMapCache(const std::string& directory, boost::uint64_t maxSize);
+
+}
+
+#endif
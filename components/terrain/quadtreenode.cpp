@@ -0,0 +1,44 @@
+#include "quadtreenode.hpp"
+
+#include <algorithm>
+
+namespace Terrain
+{
+
+QuadTreeNode::QuadTreeNode(float size, const osg::Vec2f& center)
+    : mSize(size)
+    , mCenter(center)
+{
+}
+
+void QuadTreeNode::addChild(QuadTreeNode* child)
+{
+    mChildren.push_back(child);
+}
+
+QuadTreeNode* QuadTreeNode::getChildAt(const osg::Vec2f& point) const
+{
+    for (std::vector<osg::ref_ptr<QuadTreeNode> >::const_iterator it = mChildren.begin(); it != mChildren.end(); ++it)
+    {
+        if ((*it)->contains(point))
+            return *it;
+    }
+    return NULL;
+}
+
+bool QuadTreeNode::contains(const osg::Vec2f& point) const
+{
+    float halfSize = mSize/2.f;
+    return point.x() >= mCenter.x() - halfSize && point.x() < mCenter.x() + halfSize
+        && point.y() >= mCenter.y() - halfSize && point.y() < mCenter.y() + halfSize;
+}
+
+float QuadTreeNode::distance(const osg::Vec3f& point) const
+{
+    osg::Vec3f closest;
+    for (int i=0; i<3; ++i)
+        closest[i] = std::max(mBoundingBox._min[i], std::min(point[i], mBoundingBox._max[i]));
+    return (point - closest).length();
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef COMPONENTS_TERRAIN_QUADTREENODE_H
+#define COMPONENTS_TERRAIN_QUADTREENODE_H
+
+#include <vector>
+
+#include <osg/Referenced>
+#include <osg/ref_ptr>
+#include <osg/Vec2f>
+#include <osg/BoundingBox>
+
+namespace Terrain
+{
+
+    /// @brief A node in the terrain quad tree, covering a square area of the terrain.
+    /// @note The tree is not modified after it has been built, so it may be read from any thread.
+    class QuadTreeNode : public osg::Referenced
+    {
+    public:
+        /// @param size size of the node in cell units
+        /// @param center center of the node in cell units
+        QuadTreeNode(float size, const osg::Vec2f& center);
+
+        void addChild(QuadTreeNode* child);
+
+        unsigned int getNumChildren() const { return mChildren.size(); }
+
+        QuadTreeNode* getChild(unsigned int i) const { return mChildren[i]; }
+
+        /// Get the child that contains \a point, or NULL if there is no terrain at this point.
+        QuadTreeNode* getChildAt(const osg::Vec2f& point) const;
+
+        /// @param point in cell units
+        bool contains(const osg::Vec2f& point) const;
+
+        float getSize() const { return mSize; }
+
+        const osg::Vec2f& getCenter() const { return mCenter; }
+
+        /// Set the bounding box of the terrain in this node, in world units.
+        void setBoundingBox(const osg::BoundingBox& boundingBox) { mBoundingBox = boundingBox; }
+
+        const osg::BoundingBox& getBoundingBox() const { return mBoundingBox; }
+
+        /// Get the distance from \a point (in world units) to the bounding box of this node.
+        float distance(const osg::Vec3f& point) const;
+
+    private:
+        float mSize;
+        osg::Vec2f mCenter;
+        osg::BoundingBox mBoundingBox;
+
+        std::vector<osg::ref_ptr<QuadTreeNode> > mChildren;
+    };
+
+}
+
+#endif
@@ -0,0 +1,632 @@
+#include "quadtreeworld.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <OpenThreads/ScopedLock>
+
+#include <osg/Geometry>
+#include <osg/Texture2D>
+
+#include <osgUtil/CullVisitor>
+
+#include <components/sceneutil/lightmanager.hpp>
+#include <components/sceneutil/positionattitudetransform.hpp>
+#include <components/sceneutil/workqueue.hpp>
+
+#include <components/esm/loadland.hpp>
+
+#include "material.hpp"
+#include "storage.hpp"
+
+namespace
+{
+    class StaticBoundingBoxCallback : public osg::Drawable::ComputeBoundingBoxCallback
+    {
+    public:
+        StaticBoundingBoxCallback(const osg::BoundingBox& bounds)
+            : mBoundingBox(bounds)
+        {
+        }
+
+        virtual osg::BoundingBox computeBound(const osg::Drawable&) const
+        {
+            return mBoundingBox;
+        }
+
+    private:
+        osg::BoundingBox mBoundingBox;
+    };
+
+    /// Selects the chunks to render when culled, and the full detail chunks of loaded cells for other traversals.
+    class RootNode : public osg::Group
+    {
+    public:
+        RootNode(Terrain::QuadTreeWorld* world)
+            : mWorld(world)
+        {
+        }
+
+        virtual void traverse(osg::NodeVisitor& nv)
+        {
+            if (nv.getVisitorType() == osg::NodeVisitor::CULL_VISITOR)
+                mWorld->cull(static_cast<osgUtil::CullVisitor*>(&nv));
+            else if (nv.getVisitorType() != osg::NodeVisitor::UPDATE_VISITOR && nv.getVisitorType() != osg::NodeVisitor::EVENT_VISITOR)
+                mWorld->traverseLoadedCells(nv);
+        }
+
+    private:
+        Terrain::QuadTreeWorld* mWorld;
+    };
+
+    // Cached chunks are kept for this many frames after their last use, so that chunks do not have to be rebuilt
+    // when the camera moves back and forth across a LOD boundary.
+    const unsigned int sChunkCacheFrames = 300;
+}
+
+namespace Terrain
+{
+
+/// Blends the composite map of a chunk in the background.
+class CompositeMapWorkItem : public SceneUtil::WorkItem
+{
+public:
+    CompositeMapWorkItem(World* world, float size, const osg::Vec2f& center)
+        : mWorld(world)
+        , mSize(size)
+        , mCenter(center)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mImage = mWorld->getCompositeMapImage(mSize, mCenter);
+    }
+
+    osg::Image* getImage() { return mImage; }
+
+private:
+    World* mWorld;
+    float mSize;
+    osg::Vec2f mCenter;
+    osg::ref_ptr<osg::Image> mImage;
+};
+
+/// Builds a chunk in the background, so that the cull traversal does not have to wait for it.
+class ChunkWorkItem : public SceneUtil::WorkItem
+{
+public:
+    ChunkWorkItem(QuadTreeWorld* world, const QuadTreeNode* node, unsigned int lodFlags)
+        : mWorld(world)
+        , mNode(node)
+        , mLodFlags(lodFlags)
+        , mCompositeMapPending(false)
+    {
+    }
+
+    virtual void doWork()
+    {
+        mChunk = mWorld->createChunk(mNode, mLodFlags, false, mCompositeMapPending);
+    }
+
+    osg::Node* getChunk() { return mChunk; }
+
+    bool isCompositeMapPending() const { return mCompositeMapPending; }
+
+private:
+    QuadTreeWorld* mWorld;
+    const QuadTreeNode* mNode;
+    unsigned int mLodFlags;
+    osg::ref_ptr<osg::Node> mChunk;
+    bool mCompositeMapPending;
+};
+
+QuadTreeWorld::QuadTreeWorld(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
+                             Storage* storage, int nodeMask, float lodFactor)
+    : Terrain::World(parent, resourceSystem, ico, storage, nodeMask)
+    , mMinSize(0.25f)
+    , mMaxChunkSize(16.f)
+    , mCellWorldSize(storage->getCellWorldSize())
+    , mLodFactor(lodFactor)
+    , mTreeBuilt(false)
+    , mFrameNumber(0)
+    , mCache((storage->getCellVertices()-1)/4 + 1)
+    , mCompositeMapQueue(new SceneUtil::WorkQueue(1))
+    , mChunkQueue(new SceneUtil::WorkQueue(1))
+{
+    // The chunks are selected while culling, so the root has no bounds to cull against.
+    // Chunks are still culled individually.
+    mRootGroup = new RootNode(this);
+    mRootGroup->setCullingActive(false);
+    mTerrainRoot->setCullingActive(false);
+    mTerrainRoot->addChild(mRootGroup);
+}
+
+QuadTreeWorld::~QuadTreeWorld()
+{
+    // wait for the chunk and composite map in progress, they refer to this world
+    mChunkQueue = NULL;
+    mCompositeMapQueue = NULL;
+
+    mTerrainRoot->removeChild(mRootGroup);
+}
+
+QuadTreeNode* QuadTreeWorld::getRootNode(bool build)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTreeMutex);
+    if (mTreeBuilt || !build)
+        return mRootNode;
+
+    float minX, maxX, minY, maxY;
+    mStorage->getBounds(minX, maxX, minY, maxY);
+
+    // the root node has a power of two size, so that cells are never split between nodes
+    float size = 1.f;
+    while (size < maxX-minX || size < maxY-minY)
+        size *= 2.f;
+
+    mRootNode = buildTree(size, osg::Vec2f(minX + size/2.f, minY + size/2.f), minX, maxX, minY, maxY);
+    mTreeBuilt = true;
+
+    return mRootNode;
+}
+
+osg::ref_ptr<QuadTreeNode> QuadTreeWorld::buildTree(float size, const osg::Vec2f& center, float minX, float maxX, float minY, float maxY)
+{
+    float halfSize = size/2.f;
+    if (center.x() + halfSize <= minX || center.x() - halfSize >= maxX
+            || center.y() + halfSize <= minY || center.y() - halfSize >= maxY)
+        return NULL; // no terrain defined
+
+    osg::ref_ptr<QuadTreeNode> node (new QuadTreeNode(size, center));
+    osg::BoundingBox boundingBox;
+
+    if (size > mMinSize)
+    {
+        float childOffset = size/4.f;
+        for (int i=0; i<4; ++i)
+        {
+            osg::Vec2f childCenter = center + osg::Vec2f((i%2) ? childOffset : -childOffset, (i/2) ? childOffset : -childOffset);
+            osg::ref_ptr<QuadTreeNode> child = buildTree(halfSize, childCenter, minX, maxX, minY, maxY);
+            if (!child)
+                continue;
+            node->addChild(child);
+            boundingBox.expandBy(child->getBoundingBox());
+        }
+
+        if (!node->getNumChildren())
+            return NULL;
+    }
+    else
+    {
+        float minH, maxH;
+        if (!mStorage->getMinMaxHeights(size, center, minH, maxH))
+            return NULL;
+
+        boundingBox = osg::BoundingBox((center.x() - halfSize) * mCellWorldSize, (center.y() - halfSize) * mCellWorldSize, minH,
+                                       (center.x() + halfSize) * mCellWorldSize, (center.y() + halfSize) * mCellWorldSize, maxH);
+    }
+
+    node->setBoundingBox(boundingBox);
+    return node;
+}
+
+bool QuadTreeWorld::isSplit(const QuadTreeNode* node, const osg::Vec3f& eye) const
+{
+    if (!node->getNumChildren())
+        return false;
+    if (node->getSize() > mMaxChunkSize)
+        return true;
+    return node->distance(eye) < node->getSize() * mCellWorldSize * mLodFactor;
+}
+
+void QuadTreeWorld::cull(osgUtil::CullVisitor* cv)
+{
+    QuadTreeNode* rootNode = getRootNode(false);
+    if (!rootNode)
+        return;
+
+    unsigned int frame = cv->getFrameStamp() ? cv->getFrameStamp()->getFrameNumber() : 0;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mChunkCacheMutex);
+        mFrameNumber = frame;
+    }
+
+    std::vector<osg::ref_ptr<osg::Node> > chunks;
+    cull(rootNode, cv, cv->getViewPoint(), frame, chunks);
+
+    for (std::vector<osg::ref_ptr<osg::Node> >::const_iterator it = chunks.begin(); it != chunks.end(); ++it)
+        (*it)->accept(*cv);
+}
+
+bool QuadTreeWorld::cull(QuadTreeNode* node, osgUtil::CullVisitor* cv, const osg::Vec3f& eye, unsigned int frame,
+                         std::vector<osg::ref_ptr<osg::Node> >& chunks)
+{
+    if (cv->isCulled(node->getBoundingBox()))
+        return true;
+
+    if (isSplit(node, eye))
+    {
+        std::size_t numChunks = chunks.size();
+
+        // visit all children, so that all of their missing chunks are requested
+        bool complete = true;
+        for (unsigned int i=0; i<node->getNumChildren(); ++i)
+            complete = cull(node->getChild(i), cv, eye, frame, chunks) && complete;
+
+        // Nodes larger than mMaxChunkSize have no chunk of their own, render the parts that are done.
+        if (complete || node->getSize() > mMaxChunkSize)
+            return complete;
+
+        // Render this coarser chunk instead. Its edges may not match the stitching of the neighbours for a few frames.
+        osg::ref_ptr<osg::Node> chunk = getChunk(node, getLodFlags(node, eye), frame, true, false);
+        if (!chunk)
+            return false;
+
+        chunks.resize(numChunks);
+        chunks.push_back(chunk);
+        return true;
+    }
+
+    osg::ref_ptr<osg::Node> chunk = getChunk(node, getLodFlags(node, eye), frame, true, false);
+    if (!chunk)
+        return false;
+
+    chunks.push_back(chunk);
+    return true;
+}
+
+float QuadTreeWorld::getLodSize(const osg::Vec2f& point, const osg::Vec3f& eye) const
+{
+    const QuadTreeNode* node = mRootNode;
+    if (!node->contains(point))
+        return 0.f;
+
+    while (isSplit(node, eye))
+    {
+        node = node->getChildAt(point);
+        if (!node)
+            return 0.f;
+    }
+    return node->getSize();
+}
+
+unsigned int QuadTreeWorld::getLodFlags(const QuadTreeNode* node, const osg::Vec3f& eye) const
+{
+    // in the order of Terrain::Direction
+    static const osg::Vec2f directions[4] = { osg::Vec2f(0,1), osg::Vec2f(1,0), osg::Vec2f(0,-1), osg::Vec2f(-1,0) };
+
+    unsigned int lodFlags = 0;
+    for (int i=0; i<4; ++i)
+    {
+        // a point just outside the middle of this edge
+        osg::Vec2f point = node->getCenter() + directions[i] * (node->getSize()/2.f + mMinSize/2.f);
+        float neighbourSize = getLodSize(point, eye);
+
+        // Only the finer chunk needs to be stitched. The index buffer can skip up to 16 vertices per edge vertex
+        // of the neighbour, which is more than any distance based LOD difference between neighbours.
+        unsigned int lodDelta = 0;
+        for (float size = node->getSize(); size < neighbourSize && lodDelta < 4; size *= 2.f)
+            ++lodDelta;
+
+        lodFlags |= lodDelta << (4*i);
+    }
+    return lodFlags;
+}
+
+void QuadTreeWorld::collectLeaves(QuadTreeNode* node, int cellX, int cellY, std::vector<QuadTreeNode*>& leaves)
+{
+    osg::Vec2f offset = node->getCenter() - osg::Vec2f(cellX + 0.5f, cellY + 0.5f);
+    float maxOffset = (node->getSize() + 1.f) / 2.f;
+    if (std::abs(offset.x()) >= maxOffset || std::abs(offset.y()) >= maxOffset)
+        return;
+
+    if (!node->getNumChildren())
+    {
+        leaves.push_back(node);
+        return;
+    }
+
+    for (unsigned int i=0; i<node->getNumChildren(); ++i)
+        collectLeaves(node->getChild(i), cellX, cellY, leaves);
+}
+
+osg::ref_ptr<osg::Node> QuadTreeWorld::cacheCell(int x, int y)
+{
+    // called on the preload thread, which can afford to wait for the composite maps
+    return getCellChunks(x, y, true);
+}
+
+osg::ref_ptr<osg::Node> QuadTreeWorld::getCellChunks(int x, int y, bool waitForCompositeMaps)
+{
+    QuadTreeNode* rootNode = getRootNode(true);
+    if (!rootNode)
+        return NULL;
+
+    std::vector<QuadTreeNode*> leaves;
+    collectLeaves(rootNode, x, y, leaves);
+    if (leaves.empty())
+        return NULL;
+
+    unsigned int frame;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mChunkCacheMutex);
+        frame = mFrameNumber;
+    }
+
+    osg::ref_ptr<osg::Group> group (new osg::Group);
+    for (std::vector<QuadTreeNode*>::const_iterator it = leaves.begin(); it != leaves.end(); ++it)
+    {
+        osg::ref_ptr<osg::Node> chunk = getChunk(*it, 0, frame, false, waitForCompositeMaps);
+        if (chunk)
+            group->addChild(chunk);
+    }
+    return group;
+}
+
+void QuadTreeWorld::loadCell(int x, int y)
+{
+    // Normally in cache already, since the cell was preloaded. Otherwise, this is built on the main thread.
+    // Holding the chunks also keeps them in cache while the cell is loaded.
+    osg::ref_ptr<osg::Node> cell = getCellChunks(x, y, false);
+    if (cell)
+        mLoadedCells[std::make_pair(x, y)] = cell;
+}
+
+void QuadTreeWorld::unloadCell(int x, int y)
+{
+    mLoadedCells.erase(std::make_pair(x, y));
+}
+
+void QuadTreeWorld::traverseLoadedCells(osg::NodeVisitor& nv)
+{
+    for (std::map<std::pair<int, int>, osg::ref_ptr<osg::Node> >::const_iterator it = mLoadedCells.begin(); it != mLoadedCells.end(); ++it)
+        it->second->accept(nv);
+}
+
+osg::ref_ptr<osg::Node> QuadTreeWorld::getChunk(const QuadTreeNode* node, unsigned int lodFlags, unsigned int frame,
+                                                 bool async, bool waitForCompositeMap)
+{
+    std::pair<const QuadTreeNode*, unsigned int> key = std::make_pair(node, lodFlags);
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mChunkCacheMutex);
+        ChunkCache::iterator found = mChunkCache.find(key);
+        if (found != mChunkCache.end())
+        {
+            CachedChunk& cached = found->second;
+            cached.mLastUsed = std::max(cached.mLastUsed, frame);
+
+            if (cached.mWorkItem && cached.mWorkItem->isDone())
+            {
+                // a synchronous build may have replaced the placeholder in the meantime
+                if (!cached.mNode || cached.mCompositeMapPending)
+                {
+                    cached.mNode = cached.mWorkItem->getChunk();
+                    cached.mCompositeMapPending = cached.mWorkItem->isCompositeMapPending();
+                }
+                cached.mWorkItem = NULL;
+            }
+
+            if (cached.mNode && !cached.mCompositeMapPending)
+                return cached.mNode;
+
+            // keep rendering the placeholder until the composite map is ready, then rebuild the chunk
+            if (cached.mNode && !waitForCompositeMap && !isCompositeMapReady(node))
+                return cached.mNode;
+
+            if (async)
+            {
+                if (!cached.mWorkItem)
+                {
+                    cached.mWorkItem = new ChunkWorkItem(this, node, lodFlags);
+                    mChunkQueue->addWorkItem(cached.mWorkItem);
+                }
+                return cached.mNode;
+            }
+        }
+        else if (async)
+        {
+            CachedChunk chunk;
+            chunk.mWorkItem = new ChunkWorkItem(this, node, lodFlags);
+            chunk.mLastUsed = frame;
+            chunk.mCompositeMapPending = false;
+            mChunkCache.insert(std::make_pair(key, chunk));
+            mChunkQueue->addWorkItem(chunk.mWorkItem);
+            return NULL;
+        }
+    }
+
+    CachedChunk chunk;
+    chunk.mNode = createChunk(node, lodFlags, waitForCompositeMap, chunk.mCompositeMapPending);
+    chunk.mLastUsed = frame;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mChunkCacheMutex);
+    ChunkCache::iterator found = mChunkCache.find(key);
+    if (found == mChunkCache.end())
+        return mChunkCache.insert(std::make_pair(key, chunk)).first->second.mNode;
+
+    // another thread may have created the same chunk in the meantime
+    if (!found->second.mNode || (found->second.mCompositeMapPending && !chunk.mCompositeMapPending))
+    {
+        found->second.mNode = chunk.mNode;
+        found->second.mCompositeMapPending = chunk.mCompositeMapPending;
+        found->second.mLastUsed = std::max(found->second.mLastUsed, frame);
+    }
+    return found->second.mNode;
+}
+
+osg::ref_ptr<osg::Node> QuadTreeWorld::createChunk(const QuadTreeNode* node, unsigned int lodFlags, bool waitForCompositeMap,
+                                                   bool& compositeMapPending)
+{
+    float chunkSize = node->getSize();
+    const osg::Vec2f& chunkCenter = node->getCenter();
+
+    // every chunk has the same number of vertices, so each doubling of the size halves the vertex density
+    int lodLevel = 0;
+    for (float size = mMinSize; size < chunkSize; size *= 2.f)
+        ++lodLevel;
+
+    osg::Vec2f worldCenter = chunkCenter*mCellWorldSize;
+    osg::ref_ptr<SceneUtil::PositionAttitudeTransform> transform (new SceneUtil::PositionAttitudeTransform);
+    transform->setPosition(osg::Vec3f(worldCenter.x(), worldCenter.y(), 0.f));
+
+    osg::ref_ptr<osg::Vec3Array> positions (new osg::Vec3Array);
+    osg::ref_ptr<osg::Vec3Array> normals (new osg::Vec3Array);
+    osg::ref_ptr<osg::Vec4Array> colors (new osg::Vec4Array);
+
+    osg::ref_ptr<osg::VertexBufferObject> vbo (new osg::VertexBufferObject);
+    positions->setVertexBufferObject(vbo);
+    normals->setVertexBufferObject(vbo);
+    colors->setVertexBufferObject(vbo);
+
+    mStorage->fillVertexBuffers(lodLevel, chunkSize, chunkCenter, positions, normals, colors);
+
+    osg::ref_ptr<osg::Geometry> geometry (new osg::Geometry);
+    geometry->setVertexArray(positions);
+    geometry->setNormalArray(normals, osg::Array::BIND_PER_VERTEX);
+    geometry->setColorArray(colors, osg::Array::BIND_PER_VERTEX);
+    geometry->setUseDisplayList(false);
+    geometry->setUseVertexBufferObjects(true);
+
+    // the vertex buffer already has the reduced vertex density, so the index buffer only needs the stitching
+    geometry->addPrimitiveSet(mCache.getIndexBuffer(lodFlags));
+
+    // we already know the bounding box, so no need to let OSG compute it.
+    osg::Vec3f offset(worldCenter.x(), worldCenter.y(), 0.f);
+    const osg::BoundingBox& worldBounds = node->getBoundingBox();
+    geometry->setComputeBoundingBoxCallback(new StaticBoundingBoxCallback(
+        osg::BoundingBox(worldBounds._min - offset, worldBounds._max - offset)));
+
+    // use texture coordinates for both texture units, the layer texture and blend texture
+    for (unsigned int i=0; i<2; ++i)
+        geometry->setTexCoordArray(i, mCache.getUVBuffer());
+
+    compositeMapPending = false;
+
+    osg::ref_ptr<osg::Group> textured;
+    if (useCompositeMap(chunkSize))
+        textured = createCompositeMapGroup(getCompositeMap(node, waitForCompositeMap, compositeMapPending));
+    else
+    {
+        std::vector<LayerInfo> layerList;
+        std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+        mStorage->getBlendmaps(chunkSize, chunkCenter, false, blendmaps, layerList);
+
+        std::vector<osg::ref_ptr<osg::Texture2D> > layerTextures;
+        for (std::vector<LayerInfo>::const_iterator it = layerList.begin(); it != layerList.end(); ++it)
+            layerTextures.push_back(getTexture(it->mDiffuseMap));
+
+        std::vector<osg::ref_ptr<osg::Texture2D> > blendmapTextures;
+        for (std::vector<osg::ref_ptr<osg::Image> >::const_iterator it = blendmaps.begin(); it != blendmaps.end(); ++it)
+        {
+            osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
+            texture->setImage(*it);
+            texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+            texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+            texture->setResizeNonPowerOfTwoHint(false);
+            texture->getOrCreateUserDataContainer()->addDescription("dont_override_filter");
+            blendmapTextures.push_back(texture);
+        }
+
+        float blendmapScale = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
+        textured = new Terrain::Effect(layerTextures, blendmapTextures, blendmapScale, blendmapScale);
+    }
+
+    textured->addCullCallback(new SceneUtil::LightListCallback);
+    textured->addChild(geometry);
+    transform->addChild(textured);
+
+    return transform;
+}
+
+bool QuadTreeWorld::useCompositeMap(float chunkSize) const
+{
+    // Up to one cell, the layer passes are cheap enough and look better up close.
+    return mCompositeMapsOnly || chunkSize > 1.f;
+}
+
+bool QuadTreeWorld::isCompositeMapReady(const QuadTreeNode* node)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCompositeMapCacheMutex);
+    CompositeMapCache::const_iterator found = mCompositeMapCache.find(node);
+    return found != mCompositeMapCache.end() && (found->second.mTexture || found->second.mWorkItem->isDone());
+}
+
+osg::ref_ptr<osg::Texture2D> QuadTreeWorld::getCompositeMap(const QuadTreeNode* node, bool wait, bool& pending)
+{
+    osg::ref_ptr<CompositeMapWorkItem> workItem;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCompositeMapCacheMutex);
+        CompositeMapCache::iterator found = mCompositeMapCache.find(node);
+        if (found == mCompositeMapCache.end())
+        {
+            CompositeMap compositeMap;
+            compositeMap.mWorkItem = new CompositeMapWorkItem(this, node->getSize(), node->getCenter());
+            mCompositeMapQueue->addWorkItem(compositeMap.mWorkItem);
+            found = mCompositeMapCache.insert(std::make_pair(node, compositeMap)).first;
+        }
+
+        if (found->second.mTexture)
+        {
+            pending = false;
+            return found->second.mTexture;
+        }
+        workItem = found->second.mWorkItem;
+    }
+
+    if (wait)
+        workItem->waitTillDone();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCompositeMapCacheMutex);
+    CompositeMap& compositeMap = mCompositeMapCache[node];
+    if (!compositeMap.mTexture && workItem->isDone())
+    {
+        compositeMap.mTexture = createCompositeMapTexture(workItem->getImage());
+        compositeMap.mWorkItem = NULL;
+    }
+
+    pending = !compositeMap.mTexture;
+    if (!pending)
+        return compositeMap.mTexture;
+
+    if (!mPlaceholderTexture)
+    {
+        // the average colour of the default layer
+        LayerMipmaps mipmaps = getLayerMipmaps(mStorage->getDefaultLayer().mDiffuseMap);
+        mPlaceholderTexture = createCompositeMapTexture(mipmaps.back());
+    }
+    return mPlaceholderTexture;
+}
+
+void QuadTreeWorld::updateCache()
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mChunkCacheMutex);
+        for (ChunkCache::iterator it = mChunkCache.begin(); it != mChunkCache.end();)
+        {
+            // chunks in progress are dropped as well, the work item finishes without a cache entry to update
+            bool referenced = it->second.mNode && it->second.mNode->referenceCount() > 1;
+            if (!referenced && it->second.mLastUsed + sChunkCacheFrames < mFrameNumber)
+                mChunkCache.erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mCompositeMapCacheMutex);
+        for (CompositeMapCache::iterator it = mCompositeMapCache.begin(); it != mCompositeMapCache.end();)
+        {
+            // composite maps in progress are kept, so that their chunks are updated when they are done
+            bool referenced = !it->second.mTexture || it->second.mTexture->referenceCount() > 1;
+            if (!referenced)
+                mCompositeMapCache.erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    updateTextureCache();
+}
+
+}
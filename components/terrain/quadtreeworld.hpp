@@ -0,0 +1,172 @@
+#ifndef COMPONENTS_TERRAIN_QUADTREEWORLD_H
+#define COMPONENTS_TERRAIN_QUADTREEWORLD_H
+
+#include <map>
+#include <vector>
+
+#include "world.hpp"
+#include "quadtreenode.hpp"
+
+namespace osg
+{
+    class NodeVisitor;
+}
+
+namespace osgUtil
+{
+    class CullVisitor;
+}
+
+namespace SceneUtil
+{
+    class WorkQueue;
+}
+
+namespace Terrain
+{
+
+    class CompositeMapWorkItem;
+    class ChunkWorkItem;
+
+    /// @brief Terrain implementation that renders the whole terrain as a quad tree of chunks. The level of detail
+    /// of each chunk is chosen by its distance to the camera, and chunks are stitched to coarser neighbours.
+    /// Chunks up to one cell in size are textured with the layers of the terrain, larger chunks use a composite map
+    /// that is blended in the background. Until the composite map is done, the chunk is rendered with a placeholder.
+    /// Chunks needed for rendering are built in the background; until then, the coarser parent chunk is rendered.
+    class QuadTreeWorld : public Terrain::World
+    {
+    public:
+        /// @param lodFactor Chunks closer to the camera than lodFactor times their size are split into smaller,
+        ///                  more detailed chunks.
+        QuadTreeWorld(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
+                      Storage* storage, int nodeMask, float lodFactor);
+        ~QuadTreeWorld();
+
+        /// Create the full detail chunks of a cell and store them in cache for later use.
+        /// @note The returned ref_ptr should be kept by the caller to ensure that the chunks stay in cache for as long as needed.
+        /// @note Thread safe.
+        virtual osg::ref_ptr<osg::Node> cacheCell(int x, int y);
+
+        /// Loaded cells are only used for intersection tests; the rendered terrain does not depend on them.
+        /// The full detail chunks of the cell are built right away if they were not preloaded with cacheCell.
+        /// @note Not thread safe.
+        virtual void loadCell(int x, int y);
+
+        /// @note Not thread safe.
+        virtual void unloadCell(int x, int y);
+
+        /// Clear cached objects that have not been used for a while
+        /// @note Thread safe.
+        virtual void updateCache();
+
+        /// Traverse the chunks to render from the view point of \a cv.
+        /// @note Used by the terrain root node.
+        void cull(osgUtil::CullVisitor* cv);
+
+        /// Traverse the full detail chunks of the loaded cells, e.g. for intersection tests.
+        /// @note Used by the terrain root node.
+        void traverseLoadedCells(osg::NodeVisitor& nv);
+
+    private:
+        friend class ChunkWorkItem;
+
+        /// Get the root of the quad tree.
+        /// @param build Build the tree if that was not done yet. The tree is built when the first cell is loaded,
+        ///              since the terrain storage is not ready when the world is created.
+        /// @note Thread safe.
+        QuadTreeNode* getRootNode(bool build);
+
+        osg::ref_ptr<QuadTreeNode> buildTree(float size, const osg::Vec2f& center, float minX, float maxX, float minY, float maxY);
+
+        /// Should \a node be rendered by its children rather than as one chunk?
+        bool isSplit(const QuadTreeNode* node, const osg::Vec3f& eye) const;
+
+        /// Collect the chunks to render for \a node, using the chunk of a split node in place of its children
+        /// while the chunks of those are still being built.
+        /// @return Are the chunks of \a node complete?
+        bool cull(QuadTreeNode* node, osgUtil::CullVisitor* cv, const osg::Vec3f& eye, unsigned int frame,
+                  std::vector<osg::ref_ptr<osg::Node> >& chunks);
+
+        /// Get the size of the chunk rendered at \a point, or 0 if there is no terrain at this point.
+        float getLodSize(const osg::Vec2f& point, const osg::Vec3f& eye) const;
+
+        /// Get the LOD deltas to the neighbours of \a node, in the format used by BufferCache::getIndexBuffer.
+        unsigned int getLodFlags(const QuadTreeNode* node, const osg::Vec3f& eye) const;
+
+        void collectLeaves(QuadTreeNode* node, int cellX, int cellY, std::vector<QuadTreeNode*>& leaves);
+
+        osg::ref_ptr<osg::Node> getCellChunks(int x, int y, bool waitForCompositeMaps);
+
+        /// @param async Build the chunk in the background if it is not in cache, and return NULL until it is done.
+        osg::ref_ptr<osg::Node> getChunk(const QuadTreeNode* node, unsigned int lodFlags, unsigned int frame, bool async,
+                                         bool waitForCompositeMap);
+
+        /// @param compositeMapPending set to true if the chunk was created with a placeholder composite map
+        osg::ref_ptr<osg::Node> createChunk(const QuadTreeNode* node, unsigned int lodFlags, bool waitForCompositeMap,
+                                            bool& compositeMapPending);
+
+        bool useCompositeMap(float chunkSize) const;
+
+        /// Is the composite map of \a node done, so that its chunks can be rebuilt without the placeholder?
+        /// @note Thread safe.
+        bool isCompositeMapReady(const QuadTreeNode* node);
+
+        /// Get the composite map of \a node, starting to blend it in the background if needed.
+        /// @param wait wait for the composite map to be done rather than returning a placeholder
+        /// @param pending set to true if the placeholder was returned
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Texture2D> getCompositeMap(const QuadTreeNode* node, bool wait, bool& pending);
+
+        // size of the smallest chunks, in cell units
+        float mMinSize;
+
+        // chunks larger than this are always split, since Storage::fillVertexBuffers can not skip whole cells
+        float mMaxChunkSize;
+
+        float mCellWorldSize;
+
+        float mLodFactor;
+
+        osg::ref_ptr<QuadTreeNode> mRootNode;
+        bool mTreeBuilt;
+        OpenThreads::Mutex mTreeMutex;
+        osg::ref_ptr<osg::Group> mRootGroup;
+
+        struct CachedChunk
+        {
+            // NULL until the first build is done
+            osg::ref_ptr<osg::Node> mNode;
+            // building or rebuilding the chunk in the background
+            osg::ref_ptr<ChunkWorkItem> mWorkItem;
+            unsigned int mLastUsed;
+            bool mCompositeMapPending;
+        };
+
+        typedef std::map<std::pair<const QuadTreeNode*, unsigned int>, CachedChunk> ChunkCache;
+        ChunkCache mChunkCache;
+        unsigned int mFrameNumber;
+        OpenThreads::Mutex mChunkCacheMutex;
+
+        struct CompositeMap
+        {
+            // NULL until the work item is done
+            osg::ref_ptr<osg::Texture2D> mTexture;
+            osg::ref_ptr<CompositeMapWorkItem> mWorkItem;
+        };
+
+        typedef std::map<const QuadTreeNode*, CompositeMap> CompositeMapCache;
+        CompositeMapCache mCompositeMapCache;
+        osg::ref_ptr<osg::Texture2D> mPlaceholderTexture;
+        OpenThreads::Mutex mCompositeMapCacheMutex;
+
+        std::map<std::pair<int, int>, osg::ref_ptr<osg::Node> > mLoadedCells;
+
+        BufferCache mCache;
+
+        osg::ref_ptr<SceneUtil::WorkQueue> mCompositeMapQueue;
+        osg::ref_ptr<SceneUtil::WorkQueue> mChunkQueue;
+    };
+
+}
+
+#endif
@@ -62,7 +62,7 @@ namespace Terrain
         /// @param chunkCenter center of the chunk in cell units
         /// @param pack Whether to pack blend values for up to 4 layers into one texture (one in each channel) -
         ///        otherwise, each texture contains blend values for one layer only. Shader-based rendering
-        ///        can utilize packing, FFP can't.
+        ///        and composite maps can utilize packing, FFP can't.
         /// @param blendmaps created blendmaps will be written here
         /// @param layerList names of the layer textures used will be written here
         virtual void getBlendmaps (float chunkSize, const osg::Vec2f& chunkCenter, bool pack,
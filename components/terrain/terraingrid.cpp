@@ -6,10 +6,6 @@
 
 #include <OpenThreads/ScopedLock>
 
-#include <components/resource/resourcesystem.hpp>
-#include <components/resource/imagemanager.hpp>
-#include <components/resource/scenemanager.hpp>
-
 #include <components/sceneutil/lightmanager.hpp>
 #include <components/sceneutil/positionattitudetransform.hpp>
 #include <components/sceneutil/unrefqueue.hpp>
@@ -68,16 +64,42 @@ TerrainGrid::~TerrainGrid()
 
 osg::ref_ptr<osg::Node> TerrainGrid::cacheCell(int x, int y)
 {
+    std::pair<int, int> key = std::make_pair(x,y);
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mGridCacheMutex);
-        Grid::iterator found = mGridCache.find(std::make_pair(x,y));
+        GridCache::iterator found = mGridCache.find(key);
+
+        // another thread is building this cell, wait for it rather than building the cell twice
+        while (found != mGridCache.end() && found->second.mBuilding)
+        {
+            mGridCacheCondition.wait(&mGridCacheMutex);
+            found = mGridCache.find(key);
+        }
+
         if (found != mGridCache.end())
-            return found->second;
+            return found->second.mNode;
+
+        mGridCache[key].mBuilding = true;
+    }
+
+    osg::ref_ptr<osg::Node> node;
+    try
+    {
+        node = buildTerrain(NULL, 1.f, osg::Vec2f(x+0.5, y+0.5));
+    }
+    catch (...)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mGridCacheMutex);
+        mGridCache.erase(key);
+        mGridCacheCondition.broadcast();
+        throw;
     }
-    osg::ref_ptr<osg::Node> node = buildTerrain(NULL, 1.f, osg::Vec2f(x+0.5, y+0.5));
 
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mGridCacheMutex);
-    mGridCache.insert(std::make_pair(std::make_pair(x,y), node));
+    CachedCell& cell = mGridCache[key];
+    cell.mNode = node;
+    cell.mBuilding = false;
+    mGridCacheCondition.broadcast();
     return node;
 }
 
@@ -140,61 +162,59 @@ osg::ref_ptr<osg::Node> TerrainGrid::buildTerrain (osg::Group* parent, float chu
         osg::BoundingBox bounds(min, max);
         geometry->setComputeBoundingBoxCallback(new StaticBoundingBoxCallback(bounds));
 
-        std::vector<LayerInfo> layerList;
-        std::vector<osg::ref_ptr<osg::Image> > blendmaps;
-        mStorage->getBlendmaps(chunkSize, chunkCenter, false, blendmaps, layerList);
-
         // For compiling textures, I don't think the osgFX::Effect does it correctly
         osg::ref_ptr<osg::Node> textureCompileDummy (new osg::Node);
         unsigned int dummyTextureCounter = 0;
 
-        std::vector<osg::ref_ptr<osg::Texture2D> > layerTextures;
+        osg::ref_ptr<osg::Group> textured;
+        if (mCompositeMapsOnly)
+        {
+            osg::ref_ptr<osg::Texture2D> compositeMap = createCompositeMapTexture(getCompositeMapImage(chunkSize, chunkCenter));
+            textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(dummyTextureCounter++, compositeMap);
+            textured = createCompositeMapGroup(compositeMap);
+        }
+        else
         {
-            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureCacheMutex);
+            std::vector<LayerInfo> layerList;
+            std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+            mStorage->getBlendmaps(chunkSize, chunkCenter, false, blendmaps, layerList);
+
+            std::vector<osg::ref_ptr<osg::Texture2D> > layerTextures;
             for (std::vector<LayerInfo>::const_iterator it = layerList.begin(); it != layerList.end(); ++it)
             {
-                osg::ref_ptr<osg::Texture2D> texture = mTextureCache[it->mDiffuseMap];
-                if (!texture)
-                {
-                    texture = new osg::Texture2D(mResourceSystem->getImageManager()->getImage(it->mDiffuseMap));
-                    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
-                    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
-                    mResourceSystem->getSceneManager()->applyFilterSettings(texture);
-                    mTextureCache[it->mDiffuseMap] = texture;
-                }
-                layerTextures.push_back(texture);
+                layerTextures.push_back(getTexture(it->mDiffuseMap));
                 textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(dummyTextureCounter++, layerTextures.back());
             }
-        }
 
-        std::vector<osg::ref_ptr<osg::Texture2D> > blendmapTextures;
-        for (std::vector<osg::ref_ptr<osg::Image> >::const_iterator it = blendmaps.begin(); it != blendmaps.end(); ++it)
-        {
-            osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
-            texture->setImage(*it);
-            texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
-            texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
-            texture->setResizeNonPowerOfTwoHint(false);
-            texture->getOrCreateUserDataContainer()->addDescription("dont_override_filter");
-            blendmapTextures.push_back(texture);
-
-            textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(dummyTextureCounter++, blendmapTextures.back());
+            std::vector<osg::ref_ptr<osg::Texture2D> > blendmapTextures;
+            for (std::vector<osg::ref_ptr<osg::Image> >::const_iterator it = blendmaps.begin(); it != blendmaps.end(); ++it)
+            {
+                osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D);
+                texture->setImage(*it);
+                texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+                texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+                texture->setResizeNonPowerOfTwoHint(false);
+                texture->getOrCreateUserDataContainer()->addDescription("dont_override_filter");
+                blendmapTextures.push_back(texture);
+
+                textureCompileDummy->getOrCreateStateSet()->setTextureAttributeAndModes(dummyTextureCounter++, blendmapTextures.back());
+            }
+
+            float blendmapScale = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
+            textured = new Terrain::Effect(layerTextures, blendmapTextures, blendmapScale, blendmapScale);
         }
 
         // use texture coordinates for both texture units, the layer texture and blend texture
         for (unsigned int i=0; i<2; ++i)
             geometry->setTexCoordArray(i, mCache.getUVBuffer());
 
-        float blendmapScale = ESM::Land::LAND_TEXTURE_SIZE*chunkSize;
-        osg::ref_ptr<osgFX::Effect> effect (new Terrain::Effect(layerTextures, blendmapTextures, blendmapScale, blendmapScale));
-
-        effect->addCullCallback(new SceneUtil::LightListCallback);
+        textured->addCullCallback(new SceneUtil::LightListCallback);
 
-        transform->addChild(effect);
+        transform->addChild(textured);
 
         osg::Node* toAttach = geometry.get();
 
-        effect->addChild(toAttach);
+        textured->addChild(toAttach);
 
         if (mIncrementalCompileOperation)
         {
@@ -211,27 +231,11 @@ void TerrainGrid::loadCell(int x, int y)
     if (mGrid.find(std::make_pair(x, y)) != mGrid.end())
         return; // already loaded
 
-    // try to get it from the cache
-    osg::ref_ptr<osg::Node> terrainNode;
-    {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mGridCacheMutex);
-        Grid::const_iterator found = mGridCache.find(std::make_pair(x,y));
-        if (found != mGridCache.end())
-        {
-            terrainNode = found->second;
-            if (!terrainNode)
-                return; // no terrain defined
-        }
-    }
-
-    // didn't find in cache, build it
+    // Usually the cell was built by a preload work item already, or is still being built by one.
+    // Only build it here if it was not preloaded.
+    osg::ref_ptr<osg::Node> terrainNode = cacheCell(x, y);
     if (!terrainNode)
-    {
-        osg::Vec2f center(x+0.5f, y+0.5f);
-        terrainNode = buildTerrain(NULL, 1.f, center);
-        if (!terrainNode)
-            return; // no terrain defined
-    }
+        return; // no terrain defined
 
     mTerrainRoot->addChild(terrainNode);
 
@@ -257,25 +261,16 @@ void TerrainGrid::updateCache()
 {
     {
         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mGridCacheMutex);
-        for (Grid::iterator it = mGridCache.begin(); it != mGridCache.end();)
+        for (GridCache::iterator it = mGridCache.begin(); it != mGridCache.end();)
         {
-            if (it->second->referenceCount() <= 1)
+            if (!it->second.mBuilding && (!it->second.mNode || it->second.mNode->referenceCount() <= 1))
                 mGridCache.erase(it++);
             else
                 ++it;
         }
     }
 
-    {
-        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureCacheMutex);
-        for (TextureCache::iterator it = mTextureCache.begin(); it != mTextureCache.end();)
-        {
-            if (it->second->referenceCount() <= 1)
-                mTextureCache.erase(it++);
-            else
-                ++it;
-        }
-    }
+    updateTextureCache();
 }
 
 }
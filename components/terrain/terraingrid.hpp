@@ -3,6 +3,8 @@
 
 #include <osg/Vec2f>
 
+#include <OpenThreads/Condition>
+
 #include "world.hpp"
 #include "material.hpp"
 
@@ -26,6 +28,8 @@ namespace Terrain
         /// @note Thread safe.
         virtual osg::ref_ptr<osg::Node> cacheCell(int x, int y);
 
+        /// Attach the terrain of a cell built by cacheCell, waiting for it if another thread is still building it.
+        /// If the cell was not preloaded, it is built synchronously on the calling thread.
         /// @note Not thread safe.
         virtual void loadCell(int x, int y);
 
@@ -42,15 +46,22 @@ namespace Terrain
         // split each ESM::Cell into mNumSplits*mNumSplits terrain chunks
         unsigned int mNumSplits;
 
-        typedef std::map<std::string, osg::ref_ptr<osg::Texture2D> >  TextureCache;
-        TextureCache mTextureCache;
-        OpenThreads::Mutex mTextureCacheMutex;
-
         typedef std::map<std::pair<int, int>, osg::ref_ptr<osg::Node> > Grid;
         Grid mGrid;
 
-        Grid mGridCache;
+        struct CachedCell
+        {
+            CachedCell() : mBuilding(false) {}
+
+            osg::ref_ptr<osg::Node> mNode;
+            // set while a thread is building the cell, mNode is not valid yet
+            bool mBuilding;
+        };
+
+        typedef std::map<std::pair<int, int>, CachedCell> GridCache;
+        GridCache mGridCache;
         OpenThreads::Mutex mGridCacheMutex;
+        OpenThreads::Condition mGridCacheCondition;
 
         BufferCache mCache;
 
@@ -1,20 +1,95 @@
 #include "world.hpp"
 
+#include <cmath>
+#include <sstream>
+
+#include <boost/filesystem/path.hpp>
+
 #include <osg/Group>
+#include <osg/Material>
+#include <osg/Object>
+#include <osg/Texture2D>
+#include <osg/UserDataContainer>
 #include <osgUtil/IncrementalCompileOperation>
 
+#include <OpenThreads/ScopedLock>
+
+#include <components/resource/resourcesystem.hpp>
+#include <components/resource/resourcemanager.hpp>
+#include <components/resource/objectcache.hpp>
+#include <components/resource/imagemanager.hpp>
+#include <components/resource/scenemanager.hpp>
+
+#include <components/esm/loadland.hpp>
+
+#include <components/misc/binarycache.hpp>
+
 #include "storage.hpp"
 
 namespace Terrain
 {
 
+/// Holds the mipmaps of a layer texture in a resource cache.
+class LayerMipmapsObject : public osg::Object
+{
+public:
+    LayerMipmapsObject()
+    {
+    }
+
+    LayerMipmapsObject(const LayerMipmapsObject& copy, const osg::CopyOp& copyop)
+        : osg::Object(copy, copyop)
+        , mMipmaps(copy.mMipmaps)
+    {
+    }
+
+    META_Object(Terrain, LayerMipmapsObject)
+
+    LayerMipmaps mMipmaps;
+};
+
+/// Caches the layer mipmaps used for blending composite maps, and lets them expire like other resources.
+/// @note May be used from any thread.
+class LayerMipmapsManager : public Resource::ResourceManager
+{
+public:
+    LayerMipmapsManager(Resource::ImageManager* imageManager)
+        : ResourceManager(NULL)
+        , mImageManager(imageManager)
+    {
+    }
+
+    LayerMipmaps getMipmaps(const std::string& name)
+    {
+        osg::ref_ptr<osg::Object> obj = mCache->getRefFromObjectCache(name);
+        if (obj)
+            return static_cast<LayerMipmapsObject*>(obj.get())->mMipmaps;
+
+        // Composite maps have far fewer texels per layer repeat than this, so a small copy of the texture is enough.
+        osg::ref_ptr<LayerMipmapsObject> mipmaps (new LayerMipmapsObject);
+        createLayerMipmaps(mImageManager->getImage(name), 64, mipmaps->mMipmaps);
+
+        mCache->addEntryToObjectCache(name, mipmaps);
+        return mipmaps->mMipmaps;
+    }
+
+private:
+    Resource::ImageManager* mImageManager;
+};
+
 World::World(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUtil::IncrementalCompileOperation* ico,
              Storage* storage, int nodeMask)
-    : mStorage(storage)
+    : mCompositeMapResolution(128)
+    , mCompositeMapsOnly(false)
+    , mStorage(storage)
     , mParent(parent)
     , mResourceSystem(resourceSystem)
     , mIncrementalCompileOperation(ico)
+    , mLayerMipmapsManager(new LayerMipmapsManager(resourceSystem->getImageManager()))
+    , mCompositeMapCacheKey(0)
 {
+    mResourceSystem->addResourceManager(mLayerMipmapsManager.get());
+
     mTerrainRoot = new osg::Group;
     mTerrainRoot->setNodeMask(nodeMask);
     mTerrainRoot->getOrCreateStateSet()->setRenderingHint(osg::StateSet::OPAQUE_BIN);
@@ -24,6 +99,8 @@ World::World(osg::Group* parent, Resource::ResourceSystem* resourceSystem, osgUt
 
 World::~World()
 {
+    mResourceSystem->removeResourceManager(mLayerMipmapsManager.get());
+
     mParent->removeChild(mTerrainRoot);
 
     delete mStorage;
@@ -34,4 +111,123 @@ float World::getHeightAt(const osg::Vec3f &worldPos)
     return mStorage->getHeightAt(worldPos);
 }
 
+osg::ref_ptr<osg::Texture2D> World::getTexture(const std::string& name)
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureCacheMutex);
+    osg::ref_ptr<osg::Texture2D>& texture = mTextureCache[name];
+    if (!texture)
+    {
+        texture = new osg::Texture2D(mResourceSystem->getImageManager()->getImage(name));
+        texture->setWrap(osg::Texture::WRAP_S, osg::Texture::REPEAT);
+        texture->setWrap(osg::Texture::WRAP_T, osg::Texture::REPEAT);
+        mResourceSystem->getSceneManager()->applyFilterSettings(texture);
+    }
+    return texture;
+}
+
+void World::setCompositeMapCache(const std::string& directory, const std::string& key, boost::uint64_t maxSize)
+{
+    mCompositeMapCacheDir = directory;
+
+    mCompositeMapCacheKey = Misc::hashFnv1a(key);
+
+    trimCompositeMapCache(directory, maxSize);
+}
+
+LayerMipmaps World::getLayerMipmaps(const std::string& name)
+{
+    return mLayerMipmapsManager->getMipmaps(name);
+}
+
+osg::ref_ptr<osg::Image> World::getCompositeMapImage(float chunkSize, const osg::Vec2f& chunkCenter)
+{
+    int resolution = 1;
+    while (resolution < chunkSize * mCompositeMapResolution && resolution < 1024)
+        resolution *= 2;
+
+    osg::Vec2f origin = chunkCenter - osg::Vec2f(chunkSize/2.f, chunkSize/2.f);
+
+    std::string cacheFile;
+    if (!mCompositeMapCacheDir.empty())
+    {
+        // chunks are aligned to quarter cells
+        std::ostringstream name;
+        name << "composite_" << static_cast<int>(std::floor(origin.x() * 4)) << "_" << static_cast<int>(std::floor(origin.y() * 4))
+             << "_" << static_cast<int>(chunkSize * 4) << "_" << resolution << ".bin";
+        cacheFile = (boost::filesystem::path(mCompositeMapCacheDir) / name.str()).string();
+
+        osg::ref_ptr<osg::Image> image = readCompositeMap(cacheFile, mCompositeMapCacheKey);
+        if (image)
+            return image;
+    }
+
+    osg::ref_ptr<osg::Image> image (new osg::Image);
+    image->allocateImage(resolution, resolution, 1, GL_RGB, GL_UNSIGNED_BYTE);
+
+    // Layers and blendmaps are per cell, so chunks larger than a cell are blended one cell at a time.
+    // The first image row is at the largest y, like the texture coordinates of the chunk.
+    int numCells = std::max(1, static_cast<int>(chunkSize));
+    float cellSize = chunkSize / numCells;
+    int cellResolution = resolution / numCells;
+    for (int cellY=0; cellY<numCells; ++cellY)
+    {
+        for (int cellX=0; cellX<numCells; ++cellX)
+        {
+            osg::Vec2f cellCenter = origin + osg::Vec2f((cellX + 0.5f) * cellSize, (cellY + 0.5f) * cellSize);
+
+            std::vector<LayerInfo> layerList;
+            std::vector<osg::ref_ptr<osg::Image> > blendmaps;
+            mStorage->getBlendmaps(cellSize, cellCenter, true, blendmaps, layerList);
+
+            std::vector<LayerMipmaps> layers;
+            for (std::vector<LayerInfo>::const_iterator it = layerList.begin(); it != layerList.end(); ++it)
+                layers.push_back(getLayerMipmaps(it->mDiffuseMap));
+
+            blendLayers(layers, blendmaps, ESM::Land::LAND_TEXTURE_SIZE*cellSize, image,
+                        cellX * cellResolution, (numCells - 1 - cellY) * cellResolution, cellResolution);
+        }
+    }
+
+    if (!cacheFile.empty())
+        writeCompositeMap(cacheFile, mCompositeMapCacheKey, *image);
+
+    return image;
+}
+
+osg::ref_ptr<osg::Texture2D> World::createCompositeMapTexture(osg::Image* image)
+{
+    osg::ref_ptr<osg::Texture2D> texture (new osg::Texture2D(image));
+    texture->setWrap(osg::Texture::WRAP_S, osg::Texture::CLAMP_TO_EDGE);
+    texture->setWrap(osg::Texture::WRAP_T, osg::Texture::CLAMP_TO_EDGE);
+    texture->setResizeNonPowerOfTwoHint(false);
+    mResourceSystem->getSceneManager()->applyFilterSettings(texture);
+    return texture;
+}
+
+osg::ref_ptr<osg::Group> World::createCompositeMapGroup(osg::Texture2D* compositeMap)
+{
+    osg::ref_ptr<osg::Group> group (new osg::Group);
+    osg::StateSet* stateset = group->getOrCreateStateSet();
+
+    // same as Terrain::Effect, so that lighting and vertex colours match the layered terrain
+    osg::ref_ptr<osg::Material> material (new osg::Material);
+    material->setColorMode(osg::Material::AMBIENT_AND_DIFFUSE);
+    stateset->setAttributeAndModes(material, osg::StateAttribute::ON);
+
+    stateset->setTextureAttributeAndModes(0, compositeMap);
+    return group;
+}
+
+void World::updateTextureCache()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mTextureCacheMutex);
+    for (TextureCache::iterator it = mTextureCache.begin(); it != mTextureCache.end();)
+    {
+        if (it->second->referenceCount() <= 1)
+            mTextureCache.erase(it++);
+        else
+            ++it;
+    }
+}
+
 }
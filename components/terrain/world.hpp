@@ -1,14 +1,23 @@
 #ifndef COMPONENTS_TERRAIN_WORLD_H
 #define COMPONENTS_TERRAIN_WORLD_H
 
+#include <map>
+#include <memory>
+#include <string>
+
 #include <osg/ref_ptr>
 
+#include <OpenThreads/Mutex>
+
 #include "defs.hpp"
 #include "buffercache.hpp"
+#include "compositemap.hpp"
 
 namespace osg
 {
     class Group;
+    class Texture2D;
+    class Vec2f;
 }
 
 namespace osgUtil
@@ -24,6 +33,7 @@ namespace Resource
 namespace Terrain
 {
     class Storage;
+    class LayerMipmapsManager;
 
     /**
      * @brief The basic interface for a terrain world. How the terrain chunks are paged and displayed
@@ -51,7 +61,46 @@ namespace Terrain
 
         Storage* getStorage() { return mStorage; }
 
+        /// Set the resolution of composite maps in texels per cell. Composite maps are no larger than 1024x1024.
+        /// @note Not thread safe; call before any terrain is loaded.
+        void setCompositeMapResolution(int resolution) { mCompositeMapResolution = resolution; }
+
+        /// Use composite maps for all terrain chunks rather than rendering one pass per layer.
+        /// @note Not thread safe; call before any terrain is loaded.
+        void setCompositeMapsOnly(bool compositeMapsOnly) { mCompositeMapsOnly = compositeMapsOnly; }
+
+        /// Save composite maps to \a directory and load them from there if they were saved with the same \a key.
+        /// @param maxSize the least recently used files are deleted when the directory is set, so that the composite
+        ///                maps take up no more than this many bytes
+        /// @note Not thread safe; call before any terrain is loaded.
+        void setCompositeMapCache(const std::string& directory, const std::string& key, boost::uint64_t maxSize);
+
+        /// Get the composite map of a terrain chunk, loading it from the cache or blending the layers as needed.
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Image> getCompositeMapImage(float chunkSize, const osg::Vec2f& chunkCenter);
+
     protected:
+        /// Get the layer texture \a name, loading it if it is not in the cache yet.
+        /// @note Thread safe.
+        osg::ref_ptr<osg::Texture2D> getTexture(const std::string& name);
+
+        /// Clear cached textures that are no longer referenced
+        /// @note Thread safe.
+        void updateTextureCache();
+
+        /// Create a texture to render \a image as the composite map of a chunk.
+        osg::ref_ptr<osg::Texture2D> createCompositeMapTexture(osg::Image* image);
+
+        /// Create a group that renders its children with the single pass composite map material.
+        osg::ref_ptr<osg::Group> createCompositeMapGroup(osg::Texture2D* compositeMap);
+
+        /// Get the mipmaps of a layer texture used for blending composite maps.
+        /// @note Thread safe.
+        LayerMipmaps getLayerMipmaps(const std::string& name);
+
+        int mCompositeMapResolution;
+        bool mCompositeMapsOnly;
+
         Storage* mStorage;
 
         osg::ref_ptr<osg::Group> mParent;
@@ -60,6 +109,16 @@ namespace Terrain
         Resource::ResourceSystem* mResourceSystem;
 
         osg::ref_ptr<osgUtil::IncrementalCompileOperation> mIncrementalCompileOperation;
+
+    private:
+        typedef std::map<std::string, osg::ref_ptr<osg::Texture2D> >  TextureCache;
+        TextureCache mTextureCache;
+        OpenThreads::Mutex mTextureCacheMutex;
+
+        std::auto_ptr<LayerMipmapsManager> mLayerMipmapsManager;
+
+        std::string mCompositeMapCacheDir;
+        boost::uint64_t mCompositeMapCacheKey;
     };
 
 }
@@ -0,0 +1,61 @@
+#version 120
+
+// Vertex shader for SceneUtil::InstancedGeometry. Applies the transformation of the instance and emulates
+// the fixed function vertex processing; there is no fragment shader, so texturing and fog stay fixed function.
+
+#define MAX_LIGHTS 8
+
+// rows of the instance transformation, the last row is always (0,0,0,1)
+attribute vec4 instanceRow0;
+attribute vec4 instanceRow1;
+attribute vec4 instanceRow2;
+
+// 0: osg::Material::OFF, 1: AMBIENT_AND_DIFFUSE, 2: EMISSION
+uniform int colorMode;
+
+// number of enabled lights, set by SceneUtil::LightManager
+uniform int lightCount;
+
+void main(void)
+{
+    // the rows end up as the columns, so multiply from the left
+    mat4 instanceMatrix = mat4(instanceRow0, instanceRow1, instanceRow2, vec4(0.0, 0.0, 0.0, 1.0));
+    vec4 vertex = gl_Vertex * instanceMatrix;
+    vec3 normal = (vec4(gl_Normal, 0.0) * instanceMatrix).xyz;
+
+    vec4 viewPos = gl_ModelViewMatrix * vertex;
+    vec3 viewNormal = normalize(gl_NormalMatrix * normal);
+    gl_Position = gl_ProjectionMatrix * viewPos;
+    gl_ClipVertex = viewPos;
+    gl_FogFragCoord = abs(viewPos.z);
+
+    gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;
+    gl_TexCoord[1] = gl_TextureMatrix[1] * gl_MultiTexCoord1;
+    gl_TexCoord[2] = gl_TextureMatrix[2] * gl_MultiTexCoord2;
+    gl_TexCoord[3] = gl_TextureMatrix[3] * gl_MultiTexCoord3;
+
+    vec4 ambient = colorMode == 1 ? gl_Color : gl_FrontMaterial.ambient;
+    vec4 diffuse = colorMode == 1 ? gl_Color : gl_FrontMaterial.diffuse;
+    vec4 emission = colorMode == 2 ? gl_Color : gl_FrontMaterial.emission;
+
+    vec3 lightResult = emission.xyz + gl_LightModel.ambient.xyz * ambient.xyz;
+    for (int i=0; i<MAX_LIGHTS; ++i)
+    {
+        if (i >= lightCount)
+            break;
+
+        vec3 lightDir = gl_LightSource[i].position.xyz - viewPos.xyz * gl_LightSource[i].position.w;
+        float lightDistance = length(lightDir);
+        lightDir = normalize(lightDir);
+
+        float attenuation = 1.0;
+        if (gl_LightSource[i].position.w != 0.0)
+            attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * lightDistance
+                                 + gl_LightSource[i].quadraticAttenuation * lightDistance * lightDistance);
+
+        lightResult += (ambient.xyz * gl_LightSource[i].ambient.xyz
+                        + diffuse.xyz * gl_LightSource[i].diffuse.xyz * max(dot(viewNormal, lightDir), 0.0)) * attenuation;
+    }
+
+    gl_FrontColor = vec4(clamp(lightResult, 0.0, 1.0), diffuse.a);
+}